@@ -1,18 +1,31 @@
 #include "Auxiliaries.h"
+#include <algorithm>
 
 std::ostream& mtm::printGameBoard(std::ostream& os, const char* begin, 
 	const char* end, unsigned int width) {
-		std::string delimiter = std::string(2 * width + 1, '*');
-		const char* temp = begin;
-		os << delimiter << std::endl;
-		while(temp != end) {
-			os << "|" << (*temp);
-			++temp;
-			if ((temp - begin) % width == 0)
-				os << "|" << std::endl;
+		std::string board;
+		formatGameBoard(board, begin, end, width);
+		return os.write(board.data(), board.size());
+	}
+
+void mtm::formatGameBoard(std::string& buffer, const char* begin,
+	const char* end, unsigned int width) {
+		std::size_t cells = end - begin;
+		std::size_t rows = (width == 0) ? 0 : cells / width;
+		std::size_t delimiter = 2 * (std::size_t)width + 1;
+		buffer.resize(2 * delimiter + 1 + 2 * cells + 2 * rows);
+		char* out = &buffer[0];
+		out = std::fill_n(out, delimiter, '*');
+		*out++ = '\n';
+		for (std::size_t cell = 0; cell < cells; ++cell) {
+			*out++ = '|';
+			*out++ = begin[cell];
+			if (width != 0 && (cell + 1) % width == 0) {
+				*out++ = '|';
+				*out++ = '\n';
+			}
 		}
-		os << delimiter;
-		return os;
+		std::fill_n(out, delimiter, '*');
 	}
 
 
@@ -31,6 +31,11 @@ namespace mtm {
 	std::ostream& printGameBoard(std::ostream& os, const char* begin, 
 		const char* end, unsigned int width);
 
+	// formats the board printGameBoard prints into buffer, sized exactly before
+	// any cell is written (no reallocation, no per cell stream calls).
+	void formatGameBoard(std::string& buffer, const char* begin,
+		const char* end, unsigned int width);
+
 	// from previous parts:
 	
 	
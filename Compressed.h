@@ -0,0 +1,891 @@
+//
+//  Compressed.h
+//  Matrix
+//
+/*
+ This file exports a compressed representation of integer and bool matrices (comparison masks, mostly
+ constant grids, diagonals). The matrix is cut into Matrix<T>::TILE_SIZE square tiles and every tile keeps
+ the smallest of four encodings: one constant, runs of equal elements, or its elements packed with just
+ enough bits above the tile minimum (frame of reference). Reductions and any / all read the encodings
+ directly, elementwise operations stream tile by tile, and a write decompresses only its own tile.
+*/
+#ifndef Compressed_h
+#define Compressed_h
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "SummedArea.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Enum: TileEncoding
+* ------------------------
+* How a tile of a Compressed matrix keeps its elements.
+* CONSTANT_TILE - all the elements are equal, one value is kept.
+* RUN_TILE - the elements in row-major order within the tile, as runs of equal elements.
+* PACKED_TILE - element - minimum of the tile, in the fewest bits that hold the largest difference
+*               (a bool mask tile takes one bit per element).
+* DENSE_TILE - the elements as they are: a tile that does not compress, or was written through operator().
+*/
+enum TileEncoding { CONSTANT_TILE, RUN_TILE, PACKED_TILE, DENSE_TILE };
+
+template <typename T>
+class Compressed;
+
+//elementwise combination of compressed matrices, documented with its friend declaration in Compressed.
+template <typename T, typename F>
+Compressed<typename std::decay<typename std::result_of<F(T, T)>::type>::type>
+zip(const Compressed<T> &a, const Compressed<T> &b, F operation, Execution execution = SEQUENTIAL);
+
+//any / all of compressed matrices, documented with their friend declarations in Compressed.
+template <typename T>
+bool any(const Compressed<T> &mat);
+template <typename T>
+bool all(const Compressed<T> &mat);
+
+
+/**
+* Class: Compressed<T>
+* ------------------------
+* Read mostly matrix of an integral T (bool included) kept in compressed tiles, see TileEncoding. A tile
+* holds at most TILE_SIZE x TILE_SIZE elements (fewer on the last tile row and column).
+* Reading an element decodes it where it is. Writing through the non const operator() turns the tile
+* into a DENSE_TILE first, the other tiles stay compressed; recompress() encodes the written tiles again.
+* Reads through a non const Compressed also go to the non const operator(), so read through a const
+* reference to keep the tiles compressed.
+*/
+template <typename T>
+class Compressed{
+public:
+    typedef typename SumOf<T>::type Sum;
+
+private:
+    static_assert(std::is_integral<T>::value, "Compressed elements are integral (bool included)");
+
+    //not T itself, so the dense elements of a Compressed<bool> are not packed into bits by std::vector.
+    struct Element
+    {
+        T value;
+    };
+
+    struct Tile
+    {
+        TileEncoding encoding;
+        //CONSTANT_TILE: the element, PACKED_TILE: the minimum the codes are added to.
+        T base;
+        //PACKED_TILE: bits per code (1 to the bits of T).
+        int bits;
+        //RUN_TILE: the value of every run, and the tile index one past its last element.
+        std::vector<T> run_values;
+        std::vector<std::uint16_t> run_ends;
+        //PACKED_TILE: the codes, bits apiece, in 64 bit words.
+        std::vector<std::uint64_t> words;
+        //DENSE_TILE: the elements in row-major order within the tile.
+        std::vector<Element> elements;
+    };
+
+    static const int TILE = Matrix<T>::TILE_SIZE;
+
+    int m_Height;
+    int m_Width;
+    SharingPolicy m_Sharing;
+    Layout m_Layout;
+    MemoryPolicy m_Memory;
+    //tileRows() x tileCols(), row-major.
+    std::vector<Tile> m_Tiles;
+
+    Compressed(int height, int width, SharingPolicy sharing, Layout layout, MemoryPolicy memory);
+
+    int tileRows() const;
+    int tileCols() const;
+    //elements of the tile (tile_row, tile_col) per row, and per column.
+    int tileHeight(int tile_row) const;
+    int tileWidth(int tile_col) const;
+    void checkElement(int row, int col) const;
+
+    //the cheapest encoding of the count elements of a tile (in row-major order).
+    static Tile encode(const T* elements, int count);
+    //writes the count elements of tile to elements.
+    static void decode(const Tile &tile, T* elements, int count);
+    //element k of tile, in row-major order within the tile.
+    static T element(const Tile &tile, int k);
+    //code k of a PACKED_TILE.
+    static std::uint64_t code(const Tile &tile, int k);
+    //reductions of a tile of count elements.
+    static Sum tileSum(const Tile &tile, int count);
+    static bool tileAny(const Tile &tile, int count);
+    static bool tileAll(const Tile &tile, int count);
+    static T tileMinimum(const Tile &tile, int count);
+    static T tileMaximum(const Tile &tile, int count);
+
+    template <typename U>
+    friend class Compressed;
+
+public:
+    /**
+    * Constructor: Compressed
+    * Usage: Compressed<int> compressed(mat);
+    *        Compressed<bool> mask(mat > 0, mtm::PARALLEL);
+    * ---------------------------------------
+    * Encodes every tile of mat with its cheapest TileEncoding. decompress() gives mat back exactly.
+    @param execution - PARALLEL encodes the tiles on the shared ThreadPool (default SEQUENTIAL).
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    explicit Compressed(const Matrix<T> &mat, Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: decompress
+    * Usage: compressed.decompress()
+    * -----------------------------
+    @return the dense matrix, with the SharingPolicy, Layout and MemoryPolicy of the matrix compressed.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    Matrix<T> decompress(Execution execution = SEQUENTIAL) const;
+
+    /**
+    * Method: operator()
+    * Usage: compressed(row, col)
+    *        compressed(row, col) = value;
+    * -----------------------------
+    * The const version decodes the element in place of its tile. The non const version turns the tile
+    * holding (row, col) into a DENSE_TILE and returns a reference into it.
+    @exception AccessIllegalElement if (row, col) is not inside the matrix.
+    @exception bad_alloc - the non const version may throw it when it decompresses a tile.
+    */
+    T operator()(int row, int col) const;
+    T &operator()(int row, int col);
+
+    /**
+    * Method: recompress
+    * Usage: compressed.recompress()
+    * -----------------------------
+    * Encodes the DENSE_TILEs (the ones written through operator()) again with their cheapest encoding.
+    @param execution - PARALLEL encodes the tiles on the shared ThreadPool (default SEQUENTIAL).
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    void recompress(Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: map
+    * Usage: compressed.map(operation)
+    *        compressed.map([](int x) { return x > 3; }, mtm::PARALLEL)
+    * -----------------------------
+    * Applies operation to every element, one tile at a time: a CONSTANT_TILE costs one call and a RUN_TILE
+    * one call per run, other tiles are decoded into a tile sized buffer. The whole matrix is never dense.
+    @return the compressed matrix of the results, whose element type (integral) is the one operation returns.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    template <typename F>
+    Compressed<typename std::decay<typename std::result_of<F(T)>::type>::type>
+    map(F operation, Execution execution = SEQUENTIAL) const;
+
+    /**
+    * function zip - applying a binary operation on matching elements of two compressed matrices.
+    * Usage: zip(a, b, operation)
+    *        zip(a, b, [](int x, int y) { return x == y; }, mtm::PARALLEL)
+    * -----------------------------
+    * Tile by tile as map: two CONSTANT_TILEs cost one call, other pairs are decoded into tile sized buffers.
+    @return the compressed matrix of the results, with a's policies.
+    @exception DimensionMismatch if the dimensions of a and b differ.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    template <typename U, typename F>
+    friend Compressed<typename std::decay<typename std::result_of<F(U, U)>::type>::type>
+    zip(const Compressed<U> &a, const Compressed<U> &b, F operation, Execution execution);
+
+    /**
+    * Method: sum / minimum / maximum
+    * Usage: compressed.sum()
+    *        compressed.maximum(mtm::PARALLEL)
+    * -----------------------------
+    * Reductions read the encodings: a constant or a run counts once, a packed tile adds its minimum once
+    * and then its codes (a one bit tile by population count).
+    @return the sum of the elements (for a Compressed<bool>: the number of true elements), the smallest and
+    *       the largest element.
+    */
+    Sum sum(Execution execution = SEQUENTIAL) const;
+    T minimum(Execution execution = SEQUENTIAL) const;
+    T maximum(Execution execution = SEQUENTIAL) const;
+
+    /** any / all - as any / all of Matrix, on the encodings: any looks at the constants only (any other
+    * tile holds two different elements), all at the constants, the run values and the codes.
+    * Usage: any(compressed)
+    *        all(compressed)
+    */
+    template <typename U>
+    friend bool any(const Compressed<U> &mat);
+    template <typename U>
+    friend bool all(const Compressed<U> &mat);
+
+    /**
+    * Method: encoding / bytes
+    * Usage: compressed.encoding(row, col)
+    *        compressed.bytes()
+    * -----------------------------
+    @return the TileEncoding of the tile holding (row, col), and the bytes the encoded elements take
+    *       (tile bookkeeping excluded), to compare with height() * width() * sizeof(T).
+    @exception AccessIllegalElement - encoding throws it if (row, col) is not inside the matrix.
+    */
+    TileEncoding encoding(int row, int col) const;
+    std::size_t bytes() const;
+
+    int height() const;
+    int width() const;
+};
+
+
+
+template <typename T>
+const int Compressed<T>::TILE;
+
+template <typename T>
+Compressed<T>::Compressed(int height, int width, SharingPolicy sharing, Layout layout, MemoryPolicy memory) :
+m_Height(height),
+m_Width(width),
+m_Sharing(sharing),
+m_Layout(layout),
+m_Memory(memory),
+m_Tiles((std::size_t)((height + TILE - 1) / TILE) * ((width + TILE - 1) / TILE))
+{
+}
+
+template <typename T>
+int Compressed<T>::tileRows() const
+{
+    return (m_Height + TILE - 1) / TILE;
+}
+
+template <typename T>
+int Compressed<T>::tileCols() const
+{
+    return (m_Width + TILE - 1) / TILE;
+}
+
+template <typename T>
+int Compressed<T>::tileHeight(int tile_row) const
+{
+    return std::min(TILE, m_Height - tile_row * TILE);
+}
+
+template <typename T>
+int Compressed<T>::tileWidth(int tile_col) const
+{
+    return std::min(TILE, m_Width - tile_col * TILE);
+}
+
+template <typename T>
+void Compressed<T>::checkElement(int row, int col) const
+{
+    if (row < 0 || col < 0 || row >= m_Height || col >= m_Width)
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+}
+
+//The codes are differences from the minimum taken in std::uint64_t: the modular difference of two values
+//of T is their true difference, whatever the signedness of T.
+template <typename T>
+typename Compressed<T>::Tile Compressed<T>::encode(const T* elements, int count)
+{
+    Tile tile;
+    tile.bits = 0;
+    T low = elements[0];
+    T high = elements[0];
+    int runs = 1;
+    for (int k = 1; k < count; k++)
+    {
+        low = std::min(low, elements[k]);
+        high = std::max(high, elements[k]);
+        runs += (elements[k] != elements[k - 1]) ? 1 : 0;
+    }
+    tile.base = low;
+    if (runs == 1)
+    {
+        tile.encoding = CONSTANT_TILE;
+        return tile;
+    }
+    std::uint64_t range = (std::uint64_t)high - (std::uint64_t)low;
+    while (tile.bits < 64 && (range >> tile.bits) != 0)
+    {
+        tile.bits++;
+    }
+    std::size_t run_bytes = (std::size_t)runs * (sizeof(T) + sizeof(std::uint16_t));
+    std::size_t packed_bytes = ((std::size_t)count * tile.bits + 63) / 64 * sizeof(std::uint64_t);
+    std::size_t dense_bytes = (std::size_t)count * sizeof(T);
+    if (run_bytes <= packed_bytes && run_bytes < dense_bytes)
+    {
+        tile.encoding = RUN_TILE;
+        tile.run_values.reserve(runs);
+        tile.run_ends.reserve(runs);
+        for (int k = 1; k <= count; k++)
+        {
+            if (k == count || elements[k] != elements[k - 1])
+            {
+                tile.run_values.push_back(elements[k - 1]);
+                tile.run_ends.push_back((std::uint16_t)k);
+            }
+        }
+        return tile;
+    }
+    if (packed_bytes < dense_bytes)
+    {
+        tile.encoding = PACKED_TILE;
+        tile.words.assign(packed_bytes / sizeof(std::uint64_t), 0);
+        for (int k = 0; k < count; k++)
+        {
+            std::uint64_t value = (std::uint64_t)elements[k] - (std::uint64_t)low;
+            std::size_t bit = (std::size_t)k * tile.bits;
+            std::size_t shift = bit % 64;
+            tile.words[bit / 64] |= value << shift;
+            if (shift + tile.bits > 64)
+            {
+                tile.words[bit / 64 + 1] |= value >> (64 - shift);
+            }
+        }
+        return tile;
+    }
+    tile.encoding = DENSE_TILE;
+    tile.elements.resize(count);
+    for (int k = 0; k < count; k++)
+    {
+        tile.elements[k].value = elements[k];
+    }
+    return tile;
+}
+
+template <typename T>
+std::uint64_t Compressed<T>::code(const Tile &tile, int k)
+{
+    std::size_t bit = (std::size_t)k * tile.bits;
+    std::size_t shift = bit % 64;
+    std::uint64_t value = tile.words[bit / 64] >> shift;
+    if (shift + tile.bits > 64)
+    {
+        value |= tile.words[bit / 64 + 1] << (64 - shift);
+    }
+    return (tile.bits == 64) ? value : (value & ((std::uint64_t(1) << tile.bits) - 1));
+}
+
+template <typename T>
+void Compressed<T>::decode(const Tile &tile, T* elements, int count)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            std::fill(elements, elements + count, tile.base);
+            break;
+        case RUN_TILE:
+        {
+            int k = 0;
+            for (std::size_t run = 0; run < tile.run_values.size(); run++)
+            {
+                std::fill(elements + k, elements + tile.run_ends[run], tile.run_values[run]);
+                k = tile.run_ends[run];
+            }
+            break;
+        }
+        case PACKED_TILE:
+            for (int k = 0; k < count; k++)
+            {
+                elements[k] = (T)((std::uint64_t)tile.base + code(tile, k));
+            }
+            break;
+        default:
+            for (int k = 0; k < count; k++)
+            {
+                elements[k] = tile.elements[k].value;
+            }
+            break;
+    }
+}
+
+//runs are found by binary search on their ends.
+template <typename T>
+T Compressed<T>::element(const Tile &tile, int k)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            return tile.base;
+        case RUN_TILE:
+            return tile.run_values[std::upper_bound(tile.run_ends.begin(), tile.run_ends.end(), (std::uint16_t)k) -
+                                   tile.run_ends.begin()];
+        case PACKED_TILE:
+            return (T)((std::uint64_t)tile.base + code(tile, k));
+        default:
+            return tile.elements[k].value;
+    }
+}
+
+//A one bit tile sums to base * count plus the number of set bits, wider codes are added one by one.
+template <typename T>
+typename Compressed<T>::Sum Compressed<T>::tileSum(const Tile &tile, int count)
+{
+    Sum sum = Sum();
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            return Sum(tile.base) * count;
+        case RUN_TILE:
+        {
+            int k = 0;
+            for (std::size_t run = 0; run < tile.run_values.size(); run++)
+            {
+                sum += Sum(tile.run_values[run]) * (tile.run_ends[run] - k);
+                k = tile.run_ends[run];
+            }
+            return sum;
+        }
+        case PACKED_TILE:
+            if (tile.bits == 1)
+            {
+                for (std::size_t w = 0; w < tile.words.size(); w++)
+                {
+                    sum += (Sum)std::bitset<64>(tile.words[w]).count();
+                }
+            }
+            else
+            {
+                for (int k = 0; k < count; k++)
+                {
+                    sum += (Sum)code(tile, k);
+                }
+            }
+            return sum + Sum(tile.base) * count;
+        default:
+            for (int k = 0; k < count; k++)
+            {
+                sum += Sum(tile.elements[k].value);
+            }
+            return sum;
+    }
+}
+
+//Tiles of runs or codes hold two different elements, so one of them is not 0.
+template <typename T>
+bool Compressed<T>::tileAny(const Tile &tile, int count)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            return bool(tile.base);
+        case RUN_TILE:
+        case PACKED_TILE:
+            return true;
+        default:
+            for (int k = 0; k < count; k++)
+            {
+                if (bool(tile.elements[k].value))
+                {
+                    return true;
+                }
+            }
+            return false;
+    }
+}
+
+//A packed tile holds a 0 only if its minimum is not above 0, where 0 has the code 0 - base.
+template <typename T>
+bool Compressed<T>::tileAll(const Tile &tile, int count)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            return bool(tile.base);
+        case RUN_TILE:
+            return std::find(tile.run_values.begin(), tile.run_values.end(), T()) == tile.run_values.end();
+        case PACKED_TILE:
+        {
+            if (T() < tile.base)
+            {
+                return true;
+            }
+            std::uint64_t zero = (std::uint64_t)T() - (std::uint64_t)tile.base;
+            for (int k = 0; k < count; k++)
+            {
+                if (code(tile, k) == zero)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default:
+            for (int k = 0; k < count; k++)
+            {
+                if (!bool(tile.elements[k].value))
+                {
+                    return false;
+                }
+            }
+            return true;
+    }
+}
+
+template <typename T>
+T Compressed<T>::tileMinimum(const Tile &tile, int count)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+        case PACKED_TILE:
+            return tile.base;
+        case RUN_TILE:
+            return *std::min_element(tile.run_values.begin(), tile.run_values.end());
+        default:
+        {
+            T low = tile.elements[0].value;
+            for (int k = 1; k < count; k++)
+            {
+                low = std::min(low, tile.elements[k].value);
+            }
+            return low;
+        }
+    }
+}
+
+template <typename T>
+T Compressed<T>::tileMaximum(const Tile &tile, int count)
+{
+    switch (tile.encoding)
+    {
+        case CONSTANT_TILE:
+            return tile.base;
+        case RUN_TILE:
+            return *std::max_element(tile.run_values.begin(), tile.run_values.end());
+        case PACKED_TILE:
+        {
+            std::uint64_t high = 0;
+            for (int k = 0; k < count; k++)
+            {
+                high = std::max(high, code(tile, k));
+            }
+            return (T)((std::uint64_t)tile.base + high);
+        }
+        default:
+        {
+            T high = tile.elements[0].value;
+            for (int k = 1; k < count; k++)
+            {
+                high = std::max(high, tile.elements[k].value);
+            }
+            return high;
+        }
+    }
+}
+
+template <typename T>
+Compressed<T>::Compressed(const Matrix<T> &mat, Execution execution) :
+Compressed(mat.height(), mat.width(), mat.sharing(), mat.layout(), mat.memory())
+{
+    std::unique_ptr<T[]> rows = scratchElements<T>(mat.size());
+    mat.copyTo(rows.get());
+    const T* elements = rows.get();
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> scratch = scratchElements<T>(TILE * TILE);
+        for (int t = first; t < last; t++)
+        {
+            int tile_row = t / tile_cols;
+            int tile_col = t % tile_cols;
+            int height = tileHeight(tile_row);
+            int width = tileWidth(tile_col);
+            for (int i = 0; i < height; i++)
+            {
+                const T* from = elements + (std::size_t)(tile_row * TILE + i) * m_Width + tile_col * TILE;
+                std::copy(from, from + width, scratch.get() + i * width);
+            }
+            m_Tiles[t] = encode(scratch.get(), height * width);
+        }
+    });
+}
+
+template <typename T>
+Matrix<T> Compressed<T>::decompress(Execution execution) const
+{
+    std::unique_ptr<T[]> rows = scratchElements<T>((std::size_t)m_Height * m_Width);
+    T* elements = rows.get();
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> scratch = scratchElements<T>(TILE * TILE);
+        for (int t = first; t < last; t++)
+        {
+            int tile_row = t / tile_cols;
+            int tile_col = t % tile_cols;
+            int height = tileHeight(tile_row);
+            int width = tileWidth(tile_col);
+            decode(m_Tiles[t], scratch.get(), height * width);
+            for (int i = 0; i < height; i++)
+            {
+                std::copy(scratch.get() + i * width, scratch.get() + (i + 1) * width,
+                          elements + (std::size_t)(tile_row * TILE + i) * m_Width + tile_col * TILE);
+            }
+        }
+    });
+    Matrix<T> dense(Dimensions(m_Height, m_Width), T(), m_Sharing, m_Layout, m_Memory);
+    dense.copyFrom(elements);
+    return dense;
+}
+
+template <typename T>
+T Compressed<T>::operator()(int row, int col) const
+{
+    checkElement(row, col);
+    const Tile &tile = m_Tiles[(std::size_t)(row / TILE) * tileCols() + col / TILE];
+    return element(tile, (row % TILE) * tileWidth(col / TILE) + col % TILE);
+}
+
+template <typename T>
+T &Compressed<T>::operator()(int row, int col)
+{
+    checkElement(row, col);
+    Tile &tile = m_Tiles[(std::size_t)(row / TILE) * tileCols() + col / TILE];
+    int width = tileWidth(col / TILE);
+    if (tile.encoding != DENSE_TILE)
+    {
+        int count = tileHeight(row / TILE) * width;
+        std::unique_ptr<T[]> scratch = scratchElements<T>(count);
+        decode(tile, scratch.get(), count);
+        Tile dense;
+        dense.encoding = DENSE_TILE;
+        dense.base = T();
+        dense.bits = 0;
+        dense.elements.resize(count);
+        for (int k = 0; k < count; k++)
+        {
+            dense.elements[k].value = scratch[k];
+        }
+        tile = std::move(dense);
+    }
+    return tile.elements[(row % TILE) * width + col % TILE].value;
+}
+
+template <typename T>
+void Compressed<T>::recompress(Execution execution)
+{
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> scratch = scratchElements<T>(TILE * TILE);
+        for (int t = first; t < last; t++)
+        {
+            if (m_Tiles[t].encoding == DENSE_TILE)
+            {
+                int count = tileHeight(t / tile_cols) * tileWidth(t % tile_cols);
+                decode(m_Tiles[t], scratch.get(), count);
+                m_Tiles[t] = encode(scratch.get(), count);
+            }
+        }
+    });
+}
+
+template <typename T>
+template <typename F>
+Compressed<typename std::decay<typename std::result_of<F(T)>::type>::type>
+Compressed<T>::map(F operation, Execution execution) const
+{
+    typedef typename std::decay<typename std::result_of<F(T)>::type>::type R;
+    Compressed<R> mapped(m_Height, m_Width, m_Sharing, m_Layout, m_Memory);
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> from = scratchElements<T>(TILE * TILE);
+        std::unique_ptr<R[]> to = scratchElements<R>(TILE * TILE);
+        for (int t = first; t < last; t++)
+        {
+            const Tile &tile = m_Tiles[t];
+            int count = tileHeight(t / tile_cols) * tileWidth(t % tile_cols);
+            if (tile.encoding == CONSTANT_TILE)
+            {
+                to[0] = operation(tile.base);
+                mapped.m_Tiles[t] = Compressed<R>::encode(to.get(), 1);
+                continue;
+            }
+            if (tile.encoding == RUN_TILE)
+            {
+                int k = 0;
+                for (std::size_t run = 0; run < tile.run_values.size(); run++)
+                {
+                    std::fill(to.get() + k, to.get() + tile.run_ends[run], R(operation(tile.run_values[run])));
+                    k = tile.run_ends[run];
+                }
+            }
+            else
+            {
+                decode(tile, from.get(), count);
+                for (int k = 0; k < count; k++)
+                {
+                    to[k] = operation(from[k]);
+                }
+            }
+            mapped.m_Tiles[t] = Compressed<R>::encode(to.get(), count);
+        }
+    });
+    return mapped;
+}
+
+template <typename T, typename F>
+Compressed<typename std::decay<typename std::result_of<F(T, T)>::type>::type>
+zip(const Compressed<T> &a, const Compressed<T> &b, F operation, Execution execution)
+{
+    typedef typename std::decay<typename std::result_of<F(T, T)>::type>::type R;
+    if (a.m_Height != b.m_Height || a.m_Width != b.m_Width)
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(a.m_Height, a.m_Width),
+                                                    Dimensions(b.m_Height, b.m_Width));
+        throw error;
+    }
+    const int tile_size = Compressed<T>::TILE;
+    Compressed<R> zipped(a.m_Height, a.m_Width, a.m_Sharing, a.m_Layout, a.m_Memory);
+    int tile_cols = a.tileCols();
+    parallelRows((int)a.m_Tiles.size(), tile_size * tile_size, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> left = scratchElements<T>(tile_size * tile_size);
+        std::unique_ptr<T[]> right = scratchElements<T>(tile_size * tile_size);
+        std::unique_ptr<R[]> to = scratchElements<R>(tile_size * tile_size);
+        for (int t = first; t < last; t++)
+        {
+            int count = a.tileHeight(t / tile_cols) * a.tileWidth(t % tile_cols);
+            if (a.m_Tiles[t].encoding == CONSTANT_TILE && b.m_Tiles[t].encoding == CONSTANT_TILE)
+            {
+                to[0] = operation(a.m_Tiles[t].base, b.m_Tiles[t].base);
+                zipped.m_Tiles[t] = Compressed<R>::encode(to.get(), 1);
+                continue;
+            }
+            Compressed<T>::decode(a.m_Tiles[t], left.get(), count);
+            Compressed<T>::decode(b.m_Tiles[t], right.get(), count);
+            for (int k = 0; k < count; k++)
+            {
+                to[k] = operation(left[k], right[k]);
+            }
+            zipped.m_Tiles[t] = Compressed<R>::encode(to.get(), count);
+        }
+    });
+    return zipped;
+}
+
+//every reduction keeps one partial result per tile and combines them in tile order, so PARALLEL gives the
+//same result as SEQUENTIAL.
+template <typename T>
+typename Compressed<T>::Sum Compressed<T>::sum(Execution execution) const
+{
+    std::vector<Sum> partial(m_Tiles.size());
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        for (int t = first; t < last; t++)
+        {
+            partial[t] = tileSum(m_Tiles[t], tileHeight(t / tile_cols) * tileWidth(t % tile_cols));
+        }
+    });
+    Sum sum = Sum();
+    for (std::size_t t = 0; t < partial.size(); t++)
+    {
+        sum += partial[t];
+    }
+    return sum;
+}
+
+template <typename T>
+T Compressed<T>::minimum(Execution execution) const
+{
+    std::unique_ptr<T[]> partial = scratchElements<T>(m_Tiles.size());
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        for (int t = first; t < last; t++)
+        {
+            partial[t] = tileMinimum(m_Tiles[t], tileHeight(t / tile_cols) * tileWidth(t % tile_cols));
+        }
+    });
+    return *std::min_element(partial.get(), partial.get() + m_Tiles.size());
+}
+
+template <typename T>
+T Compressed<T>::maximum(Execution execution) const
+{
+    std::unique_ptr<T[]> partial = scratchElements<T>(m_Tiles.size());
+    int tile_cols = tileCols();
+    parallelRows((int)m_Tiles.size(), TILE * TILE, execution, [&](int first, int last)
+    {
+        for (int t = first; t < last; t++)
+        {
+            partial[t] = tileMaximum(m_Tiles[t], tileHeight(t / tile_cols) * tileWidth(t % tile_cols));
+        }
+    });
+    return *std::max_element(partial.get(), partial.get() + m_Tiles.size());
+}
+
+template <typename T>
+bool any(const Compressed<T> &mat)
+{
+    int tile_cols = mat.tileCols();
+    for (std::size_t t = 0; t < mat.m_Tiles.size(); t++)
+    {
+        int count = mat.tileHeight((int)t / tile_cols) * mat.tileWidth((int)t % tile_cols);
+        if (Compressed<T>::tileAny(mat.m_Tiles[t], count))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool all(const Compressed<T> &mat)
+{
+    int tile_cols = mat.tileCols();
+    for (std::size_t t = 0; t < mat.m_Tiles.size(); t++)
+    {
+        int count = mat.tileHeight((int)t / tile_cols) * mat.tileWidth((int)t % tile_cols);
+        if (!Compressed<T>::tileAll(mat.m_Tiles[t], count))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+TileEncoding Compressed<T>::encoding(int row, int col) const
+{
+    checkElement(row, col);
+    return m_Tiles[(std::size_t)(row / TILE) * tileCols() + col / TILE].encoding;
+}
+
+template <typename T>
+std::size_t Compressed<T>::bytes() const
+{
+    std::size_t bytes = 0;
+    for (std::size_t t = 0; t < m_Tiles.size(); t++)
+    {
+        const Tile &tile = m_Tiles[t];
+        bytes += sizeof(T) + tile.run_values.size() * sizeof(T) + tile.run_ends.size() * sizeof(std::uint16_t) +
+                 tile.words.size() * sizeof(std::uint64_t) + tile.elements.size() * sizeof(Element);
+    }
+    return bytes;
+}
+
+template <typename T>
+int Compressed<T>::height() const
+{
+    return m_Height;
+}
+
+template <typename T>
+int Compressed<T>::width() const
+{
+    return m_Width;
+}
+}
+
+#endif /* Compressed_h */
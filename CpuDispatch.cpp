@@ -0,0 +1,1088 @@
+#include "CpuDispatch.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MTM_X86_KERNELS
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+//Every variant has to round alike, so no variant may fuse a product and a sum into one instruction.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+    using mtm::Comparison;
+    using mtm::InstructionSet;
+
+    struct Kernels
+    {
+        void (*add_float)(const float*, const float*, float*, int);
+        void (*add_double)(const double*, const double*, double*, int);
+        void (*add_int)(const int*, const int*, int*, int);
+        void (*compare_float)(const float*, float, bool*, int, Comparison);
+        void (*compare_double)(const double*, double, bool*, int, Comparison);
+        void (*compare_int)(const int*, int, bool*, int, Comparison);
+        bool (*any_bool)(const bool*, int);
+        bool (*any_float)(const float*, int);
+        bool (*any_double)(const double*, int);
+        bool (*any_int)(const int*, int);
+        bool (*all_bool)(const bool*, int);
+        bool (*all_float)(const float*, int);
+        bool (*all_double)(const double*, int);
+        bool (*all_int)(const int*, int);
+        void (*transpose_float)(const float*, std::size_t, float*, std::size_t, int, int);
+        void (*transpose_double)(const double*, std::size_t, double*, std::size_t, int, int);
+        void (*transpose_int)(const int*, std::size_t, int*, std::size_t, int, int);
+        void (*multiply_add_float)(float, const float*, float*, int);
+        void (*multiply_add_double)(double, const double*, double*, int);
+        void (*multiply_add_rows_float)(const float*, const float*, float* const*, int);
+        void (*multiply_add_rows_double)(const double*, const double*, double* const*, int);
+        void (*dot_int8)(const std::int8_t*, const std::int8_t* const*, const std::int32_t*, int, std::int32_t*);
+    };
+
+
+    //Generic variants, also the tails of the vector loops.
+    template <typename T>
+    void addGeneric(const T* lhs, const T* rhs, T* out, int length)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            out[k] = lhs[k] + rhs[k];
+        }
+    }
+
+    template <typename T, typename P>
+    void compareWith(const T* from, bool* to, int length, P predicate)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            to[k] = predicate(from[k]);
+        }
+    }
+
+    template <typename T>
+    void compareGeneric(const T* from, T value, bool* to, int length, Comparison comparison)
+    {
+        switch (comparison)
+        {
+            case mtm::LESS:
+                compareWith(from, to, length, [value](T element) { return element < value; });
+                break;
+            case mtm::GREATER:
+                compareWith(from, to, length, [value](T element) { return element > value; });
+                break;
+            case mtm::LESS_EQUAL:
+                compareWith(from, to, length, [value](T element) { return element <= value; });
+                break;
+            case mtm::GREATER_EQUAL:
+                compareWith(from, to, length, [value](T element) { return element >= value; });
+                break;
+            case mtm::EQUAL:
+                compareWith(from, to, length, [value](T element) { return element == value; });
+                break;
+            default:
+                compareWith(from, to, length, [value](T element) { return element != value; });
+                break;
+        }
+    }
+
+    template <typename T>
+    bool anyGeneric(const T* from, int length)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            if (bool(from[k]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool allGeneric(const T* from, int length)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            if (!bool(from[k]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    void transposeGeneric(const T* from, std::size_t from_stride, T* to, std::size_t to_stride, int rows, int cols)
+    {
+        const int block = 8;
+        for (int row_block = 0; row_block < rows; row_block += block)
+        {
+            for (int col_block = 0; col_block < cols; col_block += block)
+            {
+                for (int i = row_block; i < rows && i < row_block + block; i++)
+                {
+                    for (int j = col_block; j < cols && j < col_block + block; j++)
+                    {
+                        to[j * to_stride + i] = from[i * from_stride + j];
+                    }
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void multiplyAddGeneric(T scale, const T* b, T* c, int length)
+    {
+        for (int j = 0; j < length; j++)
+        {
+            c[j] += scale * b[j];
+        }
+    }
+
+    template <typename T>
+    void multiplyAddRowsGeneric(const T* scales, const T* b, T* const* c, int length)
+    {
+        T* c0 = c[0];
+        T* c1 = c[1];
+        T* c2 = c[2];
+        T* c3 = c[3];
+        for (int j = 0; j < length; j++)
+        {
+            const T b_j = b[j];
+            c0[j] += scales[0] * b_j;
+            c1[j] += scales[1] * b_j;
+            c2[j] += scales[2] * b_j;
+            c3[j] += scales[3] * b_j;
+        }
+    }
+
+    void dotInt8Generic(const std::int8_t* a, const std::int8_t* const* b, const std::int32_t*, int length,
+                        std::int32_t* out)
+    {
+        std::int32_t sum0 = 0;
+        std::int32_t sum1 = 0;
+        std::int32_t sum2 = 0;
+        std::int32_t sum3 = 0;
+        for (int k = 0; k < length; k++)
+        {
+            std::int32_t value = a[k];
+            sum0 += value * b[0][k];
+            sum1 += value * b[1][k];
+            sum2 += value * b[2][k];
+            sum3 += value * b[3][k];
+        }
+        out[0] = sum0;
+        out[1] = sum1;
+        out[2] = sum2;
+        out[3] = sum3;
+    }
+
+    const Kernels GENERIC_KERNELS = {
+        addGeneric<float>, addGeneric<double>, addGeneric<int>,
+        compareGeneric<float>, compareGeneric<double>, compareGeneric<int>,
+        anyGeneric<bool>, anyGeneric<float>, anyGeneric<double>, anyGeneric<int>,
+        allGeneric<bool>, allGeneric<float>, allGeneric<double>, allGeneric<int>,
+        transposeGeneric<float>, transposeGeneric<double>, transposeGeneric<int>,
+        multiplyAddGeneric<float>, multiplyAddGeneric<double>,
+        multiplyAddRowsGeneric<float>, multiplyAddRowsGeneric<double>,
+        dotInt8Generic
+    };
+
+
+#ifdef MTM_X86_KERNELS
+#define AVX2_KERNEL __attribute__((target("avx2")))
+#define AVX512_KERNEL __attribute__((target("avx2,avx512f,avx512dq,avx512bw,avx512vl")))
+#define VNNI_KERNEL __attribute__((target("avx2,avx512f,avx512dq,avx512bw,avx512vl,avx512vnni")))
+
+    //bit t of bits becomes to[t].
+    inline void expandBits(unsigned int bits, bool* to, int count)
+    {
+        for (int t = 0; t < count; t++)
+        {
+            to[t] = ((bits >> t) & 1u) != 0;
+        }
+    }
+
+    AVX2_KERNEL void addFloatAvx2(const float* lhs, const float* rhs, float* out, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            _mm256_storeu_ps(out + k, _mm256_add_ps(_mm256_loadu_ps(lhs + k), _mm256_loadu_ps(rhs + k)));
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    AVX2_KERNEL void addDoubleAvx2(const double* lhs, const double* rhs, double* out, int length)
+    {
+        int k = 0;
+        for (; k + 4 <= length; k += 4)
+        {
+            _mm256_storeu_pd(out + k, _mm256_add_pd(_mm256_loadu_pd(lhs + k), _mm256_loadu_pd(rhs + k)));
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    AVX2_KERNEL void addIntAvx2(const int* lhs, const int* rhs, int* out, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + k)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + k)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), sum);
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    //The predicates are the ordered (false on NaN) ones, except NOT_EQUAL which is unordered, as in C++.
+    template <int Predicate>
+    AVX2_KERNEL int compareFloatAvx2(const float* from, float value, bool* to, int length)
+    {
+        const __m256 compared = _mm256_set1_ps(value);
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __m256 mask = _mm256_cmp_ps(_mm256_loadu_ps(from + k), compared, Predicate);
+            expandBits((unsigned int)_mm256_movemask_ps(mask), to + k, 8);
+        }
+        return k;
+    }
+
+    AVX2_KERNEL void compareFloatAvx2(const float* from, float value, bool* to, int length, Comparison comparison)
+    {
+        int k = 0;
+        switch (comparison)
+        {
+            case mtm::LESS: k = compareFloatAvx2<_CMP_LT_OQ>(from, value, to, length); break;
+            case mtm::GREATER: k = compareFloatAvx2<_CMP_GT_OQ>(from, value, to, length); break;
+            case mtm::LESS_EQUAL: k = compareFloatAvx2<_CMP_LE_OQ>(from, value, to, length); break;
+            case mtm::GREATER_EQUAL: k = compareFloatAvx2<_CMP_GE_OQ>(from, value, to, length); break;
+            case mtm::EQUAL: k = compareFloatAvx2<_CMP_EQ_OQ>(from, value, to, length); break;
+            default: k = compareFloatAvx2<_CMP_NEQ_UQ>(from, value, to, length); break;
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    template <int Predicate>
+    AVX2_KERNEL int compareDoubleAvx2(const double* from, double value, bool* to, int length)
+    {
+        const __m256d compared = _mm256_set1_pd(value);
+        int k = 0;
+        for (; k + 4 <= length; k += 4)
+        {
+            __m256d mask = _mm256_cmp_pd(_mm256_loadu_pd(from + k), compared, Predicate);
+            expandBits((unsigned int)_mm256_movemask_pd(mask), to + k, 4);
+        }
+        return k;
+    }
+
+    AVX2_KERNEL void compareDoubleAvx2(const double* from, double value, bool* to, int length,
+                                       Comparison comparison)
+    {
+        int k = 0;
+        switch (comparison)
+        {
+            case mtm::LESS: k = compareDoubleAvx2<_CMP_LT_OQ>(from, value, to, length); break;
+            case mtm::GREATER: k = compareDoubleAvx2<_CMP_GT_OQ>(from, value, to, length); break;
+            case mtm::LESS_EQUAL: k = compareDoubleAvx2<_CMP_LE_OQ>(from, value, to, length); break;
+            case mtm::GREATER_EQUAL: k = compareDoubleAvx2<_CMP_GE_OQ>(from, value, to, length); break;
+            case mtm::EQUAL: k = compareDoubleAvx2<_CMP_EQ_OQ>(from, value, to, length); break;
+            default: k = compareDoubleAvx2<_CMP_NEQ_UQ>(from, value, to, length); break;
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    //AVX2 only compares integers for == and >, the other comparisons swap the operands or negate.
+    AVX2_KERNEL void compareIntAvx2(const int* from, int value, bool* to, int length, Comparison comparison)
+    {
+        const __m256i compared = _mm256_set1_epi32(value);
+        bool swap = (comparison == mtm::LESS || comparison == mtm::GREATER_EQUAL);
+        bool equality = (comparison == mtm::EQUAL || comparison == mtm::NOT_EQUAL);
+        unsigned int negate = (comparison == mtm::LESS_EQUAL || comparison == mtm::GREATER_EQUAL ||
+                               comparison == mtm::NOT_EQUAL) ? 0xffu : 0u;
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __m256i elements = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + k));
+            __m256i mask = equality ? _mm256_cmpeq_epi32(elements, compared)
+                                    : (swap ? _mm256_cmpgt_epi32(compared, elements)
+                                            : _mm256_cmpgt_epi32(elements, compared));
+            unsigned int bits = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(mask)) ^ negate;
+            expandBits(bits, to + k, 8);
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    AVX2_KERNEL bool anyBoolAvx2(const bool* from, int length)
+    {
+        int k = 0;
+        for (; k + 32 <= length; k += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + k));
+            if (!_mm256_testz_si256(bytes, bytes))
+            {
+                return true;
+            }
+        }
+        return anyGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool allBoolAvx2(const bool* from, int length)
+    {
+        int k = 0;
+        for (; k + 32 <= length; k += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + k));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256())) != 0)
+            {
+                return false;
+            }
+        }
+        return allGeneric(from + k, length - k);
+    }
+
+    //NaN converts to true: any looks for an element unordered or not equal to 0, all for one equal to 0.
+    AVX2_KERNEL bool anyFloatAvx2(const float* from, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(from + k), _mm256_setzero_ps(), _CMP_NEQ_UQ)) != 0)
+            {
+                return true;
+            }
+        }
+        return anyGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool allFloatAvx2(const float* from, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(from + k), _mm256_setzero_ps(), _CMP_EQ_OQ)) != 0)
+            {
+                return false;
+            }
+        }
+        return allGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool anyDoubleAvx2(const double* from, int length)
+    {
+        int k = 0;
+        for (; k + 4 <= length; k += 4)
+        {
+            if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(from + k), _mm256_setzero_pd(), _CMP_NEQ_UQ)) != 0)
+            {
+                return true;
+            }
+        }
+        return anyGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool allDoubleAvx2(const double* from, int length)
+    {
+        int k = 0;
+        for (; k + 4 <= length; k += 4)
+        {
+            if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(from + k), _mm256_setzero_pd(), _CMP_EQ_OQ)) != 0)
+            {
+                return false;
+            }
+        }
+        return allGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool anyIntAvx2(const int* from, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __m256i elements = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + k));
+            if (!_mm256_testz_si256(elements, elements))
+            {
+                return true;
+            }
+        }
+        return anyGeneric(from + k, length - k);
+    }
+
+    AVX2_KERNEL bool allIntAvx2(const int* from, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __m256i elements = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(from + k));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(elements, _mm256_setzero_si256())) != 0)
+            {
+                return false;
+            }
+        }
+        return allGeneric(from + k, length - k);
+    }
+
+    //8 x 8 blocks of 32 bit elements: unpack pairs, shuffle quadruples, then swap the 128 bit halves.
+    //Shuffles move bits without interpreting them, so int blocks go through the float registers.
+    template <typename T>
+    AVX2_KERNEL void transpose32Avx2(const T* from, std::size_t from_stride, T* to, std::size_t to_stride,
+                                     int rows, int cols)
+    {
+        int full_rows = rows / 8 * 8;
+        int full_cols = cols / 8 * 8;
+        for (int i = 0; i < full_rows; i += 8)
+        {
+            for (int j = 0; j < full_cols; j += 8)
+            {
+                __m256 r[8];
+                for (int t = 0; t < 8; t++)
+                {
+                    r[t] = _mm256_loadu_ps(reinterpret_cast<const float*>(from + (i + t) * from_stride + j));
+                }
+                __m256 u[8];
+                for (int t = 0; t < 8; t += 2)
+                {
+                    u[t] = _mm256_unpacklo_ps(r[t], r[t + 1]);
+                    u[t + 1] = _mm256_unpackhi_ps(r[t], r[t + 1]);
+                }
+                __m256 s[8];
+                for (int t = 0; t < 8; t += 4)
+                {
+                    s[t] = _mm256_shuffle_ps(u[t], u[t + 2], 0x44);
+                    s[t + 1] = _mm256_shuffle_ps(u[t], u[t + 2], 0xee);
+                    s[t + 2] = _mm256_shuffle_ps(u[t + 1], u[t + 3], 0x44);
+                    s[t + 3] = _mm256_shuffle_ps(u[t + 1], u[t + 3], 0xee);
+                }
+                for (int t = 0; t < 4; t++)
+                {
+                    _mm256_storeu_ps(reinterpret_cast<float*>(to + (j + t) * to_stride + i),
+                                     _mm256_permute2f128_ps(s[t], s[t + 4], 0x20));
+                    _mm256_storeu_ps(reinterpret_cast<float*>(to + (j + t + 4) * to_stride + i),
+                                     _mm256_permute2f128_ps(s[t], s[t + 4], 0x31));
+                }
+            }
+        }
+        transposeGeneric(from + full_cols, from_stride, to + full_cols * to_stride, to_stride, full_rows,
+                         cols - full_cols);
+        transposeGeneric(from + full_rows * from_stride, from_stride, to + full_rows, to_stride, rows - full_rows,
+                         cols);
+    }
+
+    AVX2_KERNEL void transposeFloatAvx2(const float* from, std::size_t from_stride, float* to, std::size_t to_stride,
+                                        int rows, int cols)
+    {
+        transpose32Avx2(from, from_stride, to, to_stride, rows, cols);
+    }
+
+    AVX2_KERNEL void transposeIntAvx2(const int* from, std::size_t from_stride, int* to, std::size_t to_stride,
+                                      int rows, int cols)
+    {
+        transpose32Avx2(from, from_stride, to, to_stride, rows, cols);
+    }
+
+    AVX2_KERNEL void transposeDoubleAvx2(const double* from, std::size_t from_stride, double* to,
+                                         std::size_t to_stride, int rows, int cols)
+    {
+        int full_rows = rows / 4 * 4;
+        int full_cols = cols / 4 * 4;
+        for (int i = 0; i < full_rows; i += 4)
+        {
+            for (int j = 0; j < full_cols; j += 4)
+            {
+                __m256d r0 = _mm256_loadu_pd(from + i * from_stride + j);
+                __m256d r1 = _mm256_loadu_pd(from + (i + 1) * from_stride + j);
+                __m256d r2 = _mm256_loadu_pd(from + (i + 2) * from_stride + j);
+                __m256d r3 = _mm256_loadu_pd(from + (i + 3) * from_stride + j);
+                __m256d u0 = _mm256_unpacklo_pd(r0, r1);
+                __m256d u1 = _mm256_unpackhi_pd(r0, r1);
+                __m256d u2 = _mm256_unpacklo_pd(r2, r3);
+                __m256d u3 = _mm256_unpackhi_pd(r2, r3);
+                _mm256_storeu_pd(to + j * to_stride + i, _mm256_permute2f128_pd(u0, u2, 0x20));
+                _mm256_storeu_pd(to + (j + 1) * to_stride + i, _mm256_permute2f128_pd(u1, u3, 0x20));
+                _mm256_storeu_pd(to + (j + 2) * to_stride + i, _mm256_permute2f128_pd(u0, u2, 0x31));
+                _mm256_storeu_pd(to + (j + 3) * to_stride + i, _mm256_permute2f128_pd(u1, u3, 0x31));
+            }
+        }
+        transposeGeneric(from + full_cols, from_stride, to + full_cols * to_stride, to_stride, full_rows,
+                         cols - full_cols);
+        transposeGeneric(from + full_rows * from_stride, from_stride, to + full_rows, to_stride, rows - full_rows,
+                         cols);
+    }
+
+    AVX2_KERNEL void multiplyAddFloatAvx2(float scale, const float* b, float* c, int length)
+    {
+        const __m256 scales = _mm256_set1_ps(scale);
+        int j = 0;
+        for (; j + 8 <= length; j += 8)
+        {
+            _mm256_storeu_ps(c + j, _mm256_add_ps(_mm256_loadu_ps(c + j), _mm256_mul_ps(scales, _mm256_loadu_ps(b + j))));
+        }
+        multiplyAddGeneric(scale, b + j, c + j, length - j);
+    }
+
+    AVX2_KERNEL void multiplyAddDoubleAvx2(double scale, const double* b, double* c, int length)
+    {
+        const __m256d scales = _mm256_set1_pd(scale);
+        int j = 0;
+        for (; j + 4 <= length; j += 4)
+        {
+            _mm256_storeu_pd(c + j, _mm256_add_pd(_mm256_loadu_pd(c + j), _mm256_mul_pd(scales, _mm256_loadu_pd(b + j))));
+        }
+        multiplyAddGeneric(scale, b + j, c + j, length - j);
+    }
+
+    AVX2_KERNEL void multiplyAddRowsFloatAvx2(const float* scales, const float* b, float* const* c, int length)
+    {
+        __m256 s[4];
+        for (int t = 0; t < 4; t++)
+        {
+            s[t] = _mm256_set1_ps(scales[t]);
+        }
+        int j = 0;
+        for (; j + 8 <= length; j += 8)
+        {
+            __m256 b_j = _mm256_loadu_ps(b + j);
+            for (int t = 0; t < 4; t++)
+            {
+                _mm256_storeu_ps(c[t] + j, _mm256_add_ps(_mm256_loadu_ps(c[t] + j), _mm256_mul_ps(s[t], b_j)));
+            }
+        }
+        float* rest[4] = { c[0] + j, c[1] + j, c[2] + j, c[3] + j };
+        multiplyAddRowsGeneric(scales, b + j, rest, length - j);
+    }
+
+    AVX2_KERNEL void multiplyAddRowsDoubleAvx2(const double* scales, const double* b, double* const* c, int length)
+    {
+        __m256d s[4];
+        for (int t = 0; t < 4; t++)
+        {
+            s[t] = _mm256_set1_pd(scales[t]);
+        }
+        int j = 0;
+        for (; j + 4 <= length; j += 4)
+        {
+            __m256d b_j = _mm256_loadu_pd(b + j);
+            for (int t = 0; t < 4; t++)
+            {
+                _mm256_storeu_pd(c[t] + j, _mm256_add_pd(_mm256_loadu_pd(c[t] + j), _mm256_mul_pd(s[t], b_j)));
+            }
+        }
+        double* rest[4] = { c[0] + j, c[1] + j, c[2] + j, c[3] + j };
+        multiplyAddRowsGeneric(scales, b + j, rest, length - j);
+    }
+
+    AVX2_KERNEL int horizontalSum(__m256i sum)
+    {
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+        return _mm_cvtsi128_si32(half);
+    }
+
+    AVX2_KERNEL __m256i widen(const std::int8_t* bytes)
+    {
+        return _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+    }
+
+    //Bytes are widened to int16 and multiplied by vpmaddwd, which adds pairs of products into int32 lanes.
+    //(vpmaddubsw would take the bytes directly but saturates its int16 pair sums.)
+    AVX2_KERNEL void dotInt8Avx2(const std::int8_t* a, const std::int8_t* const* b, const std::int32_t*, int length,
+                                 std::int32_t* out)
+    {
+        __m256i sum[4];
+        for (int t = 0; t < 4; t++)
+        {
+            sum[t] = _mm256_setzero_si256();
+        }
+        for (int k = 0; k < length; k += 16)
+        {
+            __m256i row = widen(a + k);
+            for (int t = 0; t < 4; t++)
+            {
+                sum[t] = _mm256_add_epi32(sum[t], _mm256_madd_epi16(row, widen(b[t] + k)));
+            }
+        }
+        for (int t = 0; t < 4; t++)
+        {
+            out[t] = horizontalSum(sum[t]);
+        }
+    }
+
+
+    AVX512_KERNEL void addFloatAvx512(const float* lhs, const float* rhs, float* out, int length)
+    {
+        int k = 0;
+        for (; k + 16 <= length; k += 16)
+        {
+            _mm512_storeu_ps(out + k, _mm512_add_ps(_mm512_loadu_ps(lhs + k), _mm512_loadu_ps(rhs + k)));
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    AVX512_KERNEL void addDoubleAvx512(const double* lhs, const double* rhs, double* out, int length)
+    {
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            _mm512_storeu_pd(out + k, _mm512_add_pd(_mm512_loadu_pd(lhs + k), _mm512_loadu_pd(rhs + k)));
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    AVX512_KERNEL void addIntAvx512(const int* lhs, const int* rhs, int* out, int length)
+    {
+        int k = 0;
+        for (; k + 16 <= length; k += 16)
+        {
+            _mm512_storeu_si512(out + k, _mm512_add_epi32(_mm512_loadu_si512(lhs + k), _mm512_loadu_si512(rhs + k)));
+        }
+        addGeneric(lhs + k, rhs + k, out + k, length - k);
+    }
+
+    //Comparison masks are turned into bool bytes with a masked move of ones.
+    template <int Predicate>
+    AVX512_KERNEL int compareFloatAvx512(const float* from, float value, bool* to, int length)
+    {
+        const __m512 compared = _mm512_set1_ps(value);
+        const __m128i ones = _mm_set1_epi8(1);
+        int k = 0;
+        for (; k + 16 <= length; k += 16)
+        {
+            __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(from + k), compared, Predicate);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(to + k), _mm_maskz_mov_epi8(mask, ones));
+        }
+        return k;
+    }
+
+    AVX512_KERNEL void compareFloatAvx512(const float* from, float value, bool* to, int length,
+                                          Comparison comparison)
+    {
+        int k = 0;
+        switch (comparison)
+        {
+            case mtm::LESS: k = compareFloatAvx512<_CMP_LT_OQ>(from, value, to, length); break;
+            case mtm::GREATER: k = compareFloatAvx512<_CMP_GT_OQ>(from, value, to, length); break;
+            case mtm::LESS_EQUAL: k = compareFloatAvx512<_CMP_LE_OQ>(from, value, to, length); break;
+            case mtm::GREATER_EQUAL: k = compareFloatAvx512<_CMP_GE_OQ>(from, value, to, length); break;
+            case mtm::EQUAL: k = compareFloatAvx512<_CMP_EQ_OQ>(from, value, to, length); break;
+            default: k = compareFloatAvx512<_CMP_NEQ_UQ>(from, value, to, length); break;
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    template <int Predicate>
+    AVX512_KERNEL int compareDoubleAvx512(const double* from, double value, bool* to, int length)
+    {
+        const __m512d compared = _mm512_set1_pd(value);
+        const __m128i ones = _mm_set1_epi8(1);
+        int k = 0;
+        for (; k + 8 <= length; k += 8)
+        {
+            __mmask8 mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(from + k), compared, Predicate);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(to + k), _mm_maskz_mov_epi8(mask, ones));
+        }
+        return k;
+    }
+
+    AVX512_KERNEL void compareDoubleAvx512(const double* from, double value, bool* to, int length,
+                                           Comparison comparison)
+    {
+        int k = 0;
+        switch (comparison)
+        {
+            case mtm::LESS: k = compareDoubleAvx512<_CMP_LT_OQ>(from, value, to, length); break;
+            case mtm::GREATER: k = compareDoubleAvx512<_CMP_GT_OQ>(from, value, to, length); break;
+            case mtm::LESS_EQUAL: k = compareDoubleAvx512<_CMP_LE_OQ>(from, value, to, length); break;
+            case mtm::GREATER_EQUAL: k = compareDoubleAvx512<_CMP_GE_OQ>(from, value, to, length); break;
+            case mtm::EQUAL: k = compareDoubleAvx512<_CMP_EQ_OQ>(from, value, to, length); break;
+            default: k = compareDoubleAvx512<_CMP_NEQ_UQ>(from, value, to, length); break;
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    template <int Predicate>
+    AVX512_KERNEL int compareIntAvx512(const int* from, int value, bool* to, int length)
+    {
+        const __m512i compared = _mm512_set1_epi32(value);
+        const __m128i ones = _mm_set1_epi8(1);
+        int k = 0;
+        for (; k + 16 <= length; k += 16)
+        {
+            __mmask16 mask = _mm512_cmp_epi32_mask(_mm512_loadu_si512(from + k), compared, Predicate);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(to + k), _mm_maskz_mov_epi8(mask, ones));
+        }
+        return k;
+    }
+
+    AVX512_KERNEL void compareIntAvx512(const int* from, int value, bool* to, int length, Comparison comparison)
+    {
+        int k = 0;
+        switch (comparison)
+        {
+            case mtm::LESS: k = compareIntAvx512<_MM_CMPINT_LT>(from, value, to, length); break;
+            case mtm::GREATER: k = compareIntAvx512<_MM_CMPINT_NLE>(from, value, to, length); break;
+            case mtm::LESS_EQUAL: k = compareIntAvx512<_MM_CMPINT_LE>(from, value, to, length); break;
+            case mtm::GREATER_EQUAL: k = compareIntAvx512<_MM_CMPINT_NLT>(from, value, to, length); break;
+            case mtm::EQUAL: k = compareIntAvx512<_MM_CMPINT_EQ>(from, value, to, length); break;
+            default: k = compareIntAvx512<_MM_CMPINT_NE>(from, value, to, length); break;
+        }
+        compareGeneric(from + k, value, to + k, length - k, comparison);
+    }
+
+    AVX512_KERNEL void multiplyAddFloatAvx512(float scale, const float* b, float* c, int length)
+    {
+        const __m512 scales = _mm512_set1_ps(scale);
+        int j = 0;
+        for (; j + 16 <= length; j += 16)
+        {
+            _mm512_storeu_ps(c + j, _mm512_add_ps(_mm512_loadu_ps(c + j), _mm512_mul_ps(scales, _mm512_loadu_ps(b + j))));
+        }
+        multiplyAddGeneric(scale, b + j, c + j, length - j);
+    }
+
+    AVX512_KERNEL void multiplyAddDoubleAvx512(double scale, const double* b, double* c, int length)
+    {
+        const __m512d scales = _mm512_set1_pd(scale);
+        int j = 0;
+        for (; j + 8 <= length; j += 8)
+        {
+            _mm512_storeu_pd(c + j, _mm512_add_pd(_mm512_loadu_pd(c + j), _mm512_mul_pd(scales, _mm512_loadu_pd(b + j))));
+        }
+        multiplyAddGeneric(scale, b + j, c + j, length - j);
+    }
+
+    AVX512_KERNEL void multiplyAddRowsFloatAvx512(const float* scales, const float* b, float* const* c, int length)
+    {
+        __m512 s[4];
+        for (int t = 0; t < 4; t++)
+        {
+            s[t] = _mm512_set1_ps(scales[t]);
+        }
+        int j = 0;
+        for (; j + 16 <= length; j += 16)
+        {
+            __m512 b_j = _mm512_loadu_ps(b + j);
+            for (int t = 0; t < 4; t++)
+            {
+                _mm512_storeu_ps(c[t] + j, _mm512_add_ps(_mm512_loadu_ps(c[t] + j), _mm512_mul_ps(s[t], b_j)));
+            }
+        }
+        float* rest[4] = { c[0] + j, c[1] + j, c[2] + j, c[3] + j };
+        multiplyAddRowsGeneric(scales, b + j, rest, length - j);
+    }
+
+    AVX512_KERNEL void multiplyAddRowsDoubleAvx512(const double* scales, const double* b, double* const* c,
+                                                   int length)
+    {
+        __m512d s[4];
+        for (int t = 0; t < 4; t++)
+        {
+            s[t] = _mm512_set1_pd(scales[t]);
+        }
+        int j = 0;
+        for (; j + 8 <= length; j += 8)
+        {
+            __m512d b_j = _mm512_loadu_pd(b + j);
+            for (int t = 0; t < 4; t++)
+            {
+                _mm512_storeu_pd(c[t] + j, _mm512_add_pd(_mm512_loadu_pd(c[t] + j), _mm512_mul_pd(s[t], b_j)));
+            }
+        }
+        double* rest[4] = { c[0] + j, c[1] + j, c[2] + j, c[3] + j };
+        multiplyAddRowsGeneric(scales, b + j, rest, length - j);
+    }
+
+    //vpdpbusd multiplies unsigned by signed bytes: a is flipped to a + 128, which adds 128 * sums[t] to every
+    //dot product, taken off at the end. A last block of 32 bytes goes through the 256 bit form.
+    VNNI_KERNEL void dotInt8Vnni(const std::int8_t* a, const std::int8_t* const* b, const std::int32_t* sums,
+                                 int length, std::int32_t* out)
+    {
+        const __m512i flip = _mm512_set1_epi8((char)0x80);
+        __m512i sum[4];
+        __m256i last[4];
+        for (int t = 0; t < 4; t++)
+        {
+            sum[t] = _mm512_setzero_si512();
+            last[t] = _mm256_setzero_si256();
+        }
+        int k = 0;
+        for (; k + 64 <= length; k += 64)
+        {
+            __m512i row = _mm512_xor_si512(_mm512_loadu_si512(a + k), flip);
+            for (int t = 0; t < 4; t++)
+            {
+                sum[t] = _mm512_dpbusd_epi32(sum[t], row, _mm512_loadu_si512(b[t] + k));
+            }
+        }
+        if (k < length)
+        {
+            __m256i row = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k)),
+                                           _mm256_set1_epi8((char)0x80));
+            for (int t = 0; t < 4; t++)
+            {
+                last[t] = _mm256_dpbusd_epi32(last[t], row, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b[t] + k)));
+            }
+        }
+        for (int t = 0; t < 4; t++)
+        {
+            std::int32_t lanes[16];
+            _mm512_storeu_si512(lanes, sum[t]);
+            std::int32_t total = horizontalSum(last[t]);
+            for (int lane = 0; lane < 16; lane++)
+            {
+                total += lanes[lane];
+            }
+            out[t] = total - 128 * sums[t];
+        }
+    }
+
+    //any / all and the transposes are bound by memory, the AVX-512 variants keep the AVX2 loops.
+    const Kernels AVX2_KERNELS = {
+        addFloatAvx2, addDoubleAvx2, addIntAvx2,
+        compareFloatAvx2, compareDoubleAvx2, compareIntAvx2,
+        anyBoolAvx2, anyFloatAvx2, anyDoubleAvx2, anyIntAvx2,
+        allBoolAvx2, allFloatAvx2, allDoubleAvx2, allIntAvx2,
+        transposeFloatAvx2, transposeDoubleAvx2, transposeIntAvx2,
+        multiplyAddFloatAvx2, multiplyAddDoubleAvx2,
+        multiplyAddRowsFloatAvx2, multiplyAddRowsDoubleAvx2,
+        dotInt8Avx2
+    };
+
+    const Kernels AVX512_KERNELS = {
+        addFloatAvx512, addDoubleAvx512, addIntAvx512,
+        compareFloatAvx512, compareDoubleAvx512, compareIntAvx512,
+        anyBoolAvx2, anyFloatAvx2, anyDoubleAvx2, anyIntAvx2,
+        allBoolAvx2, allFloatAvx2, allDoubleAvx2, allIntAvx2,
+        transposeFloatAvx2, transposeDoubleAvx2, transposeIntAvx2,
+        multiplyAddFloatAvx512, multiplyAddDoubleAvx512,
+        multiplyAddRowsFloatAvx512, multiplyAddRowsDoubleAvx512,
+        dotInt8Avx2
+    };
+
+    const Kernels AVX512_VNNI_KERNELS = {
+        addFloatAvx512, addDoubleAvx512, addIntAvx512,
+        compareFloatAvx512, compareDoubleAvx512, compareIntAvx512,
+        anyBoolAvx2, anyFloatAvx2, anyDoubleAvx2, anyIntAvx2,
+        allBoolAvx2, allFloatAvx2, allDoubleAvx2, allIntAvx2,
+        transposeFloatAvx2, transposeDoubleAvx2, transposeIntAvx2,
+        multiplyAddFloatAvx512, multiplyAddDoubleAvx512,
+        multiplyAddRowsFloatAvx512, multiplyAddRowsDoubleAvx512,
+        dotInt8Vnni
+    };
+
+    const Kernels* const TABLES[] = { &GENERIC_KERNELS, &AVX2_KERNELS, &AVX512_KERNELS, &AVX512_VNNI_KERNELS };
+
+    //The processor reports the instructions (CPUID), the operating system whether it saves the wider
+    //registers on context switches (XGETBV: bits 1-2 for the ymm state, 5-7 for the zmm state).
+    InstructionSet detect()
+    {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & (1u << 27)) || !(ecx & (1u << 28)))
+        {
+            return mtm::GENERIC_ISA;
+        }
+        unsigned int state_low = 0, state_high = 0;
+        __asm__ volatile("xgetbv" : "=a"(state_low), "=d"(state_high) : "c"(0));
+        if ((state_low & 0x6u) != 0x6u || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & (1u << 5)))
+        {
+            return mtm::GENERIC_ISA;
+        }
+        const unsigned int avx512 = (1u << 16) | (1u << 17) | (1u << 30) | (1u << 31);
+        if ((state_low & 0xe6u) != 0xe6u || (ebx & avx512) != avx512)
+        {
+            return mtm::AVX2_ISA;
+        }
+        return (ecx & (1u << 11)) ? mtm::AVX512_VNNI_ISA : mtm::AVX512_ISA;
+    }
+#else
+    const Kernels* const TABLES[] = { &GENERIC_KERNELS, &GENERIC_KERNELS, &GENERIC_KERNELS, &GENERIC_KERNELS };
+
+    InstructionSet detect()
+    {
+        return mtm::GENERIC_ISA;
+    }
+#endif
+
+    const char* const NAMES[] = { "generic", "avx2", "avx512", "avx512vnni" };
+
+    InstructionSet initial()
+    {
+        InstructionSet isa = mtm::detectedInstructionSet();
+        const char* requested = std::getenv("MTM_ISA");
+        for (int level = 0; requested != NULL && level < isa; level++)
+        {
+            if (std::strcmp(requested, NAMES[level]) == 0)
+            {
+                return (InstructionSet)level;
+            }
+        }
+        return isa;
+    }
+
+    std::atomic<int>& active()
+    {
+        static std::atomic<int> isa(initial());
+        return isa;
+    }
+
+    const Kernels& kernels()
+    {
+        return *TABLES[active().load(std::memory_order_relaxed)];
+    }
+}
+
+
+mtm::InstructionSet mtm::detectedInstructionSet()
+{
+    static const InstructionSet detected = detect();
+    return detected;
+}
+
+mtm::InstructionSet mtm::instructionSet()
+{
+    return (InstructionSet)active().load(std::memory_order_relaxed);
+}
+
+mtm::InstructionSet mtm::setInstructionSet(InstructionSet isa)
+{
+    InstructionSet applied = (isa < detectedInstructionSet()) ? isa : detectedInstructionSet();
+    active().store(applied, std::memory_order_relaxed);
+    return applied;
+}
+
+std::vector<mtm::InstructionSet> mtm::supportedInstructionSets()
+{
+    std::vector<InstructionSet> supported;
+    for (int level = GENERIC_ISA; level <= detectedInstructionSet(); level++)
+    {
+        supported.push_back((InstructionSet)level);
+    }
+    return supported;
+}
+
+const char* mtm::instructionSetName(InstructionSet isa)
+{
+    return NAMES[isa];
+}
+
+
+void mtm::addRun(const float* lhs, const float* rhs, float* out, int length)
+{
+    kernels().add_float(lhs, rhs, out, length);
+}
+
+void mtm::addRun(const double* lhs, const double* rhs, double* out, int length)
+{
+    kernels().add_double(lhs, rhs, out, length);
+}
+
+void mtm::addRun(const int* lhs, const int* rhs, int* out, int length)
+{
+    kernels().add_int(lhs, rhs, out, length);
+}
+
+void mtm::compareRun(const float* from, float value, bool* to, int length, Comparison comparison)
+{
+    kernels().compare_float(from, value, to, length, comparison);
+}
+
+void mtm::compareRun(const double* from, double value, bool* to, int length, Comparison comparison)
+{
+    kernels().compare_double(from, value, to, length, comparison);
+}
+
+void mtm::compareRun(const int* from, int value, bool* to, int length, Comparison comparison)
+{
+    kernels().compare_int(from, value, to, length, comparison);
+}
+
+bool mtm::anyRun(const bool* from, int length)
+{
+    return kernels().any_bool(from, length);
+}
+
+bool mtm::anyRun(const float* from, int length)
+{
+    return kernels().any_float(from, length);
+}
+
+bool mtm::anyRun(const double* from, int length)
+{
+    return kernels().any_double(from, length);
+}
+
+bool mtm::anyRun(const int* from, int length)
+{
+    return kernels().any_int(from, length);
+}
+
+bool mtm::allRun(const bool* from, int length)
+{
+    return kernels().all_bool(from, length);
+}
+
+bool mtm::allRun(const float* from, int length)
+{
+    return kernels().all_float(from, length);
+}
+
+bool mtm::allRun(const double* from, int length)
+{
+    return kernels().all_double(from, length);
+}
+
+bool mtm::allRun(const int* from, int length)
+{
+    return kernels().all_int(from, length);
+}
+
+void mtm::transposeBlock(const float* from, std::size_t from_stride, float* to, std::size_t to_stride, int rows,
+                         int cols)
+{
+    kernels().transpose_float(from, from_stride, to, to_stride, rows, cols);
+}
+
+void mtm::transposeBlock(const double* from, std::size_t from_stride, double* to, std::size_t to_stride, int rows,
+                         int cols)
+{
+    kernels().transpose_double(from, from_stride, to, to_stride, rows, cols);
+}
+
+void mtm::transposeBlock(const int* from, std::size_t from_stride, int* to, std::size_t to_stride, int rows, int cols)
+{
+    kernels().transpose_int(from, from_stride, to, to_stride, rows, cols);
+}
+
+void mtm::multiplyAddRun(float scale, const float* b, float* c, int length)
+{
+    kernels().multiply_add_float(scale, b, c, length);
+}
+
+void mtm::multiplyAddRun(double scale, const double* b, double* c, int length)
+{
+    kernels().multiply_add_double(scale, b, c, length);
+}
+
+void mtm::multiplyAddRows(const float* scales, const float* b, float* const* c, int length)
+{
+    kernels().multiply_add_rows_float(scales, b, c, length);
+}
+
+void mtm::multiplyAddRows(const double* scales, const double* b, double* const* c, int length)
+{
+    kernels().multiply_add_rows_double(scales, b, c, length);
+}
+
+void mtm::dotInt8Rows(const std::int8_t* a, const std::int8_t* const* b, const std::int32_t* sums, int length,
+                      std::int32_t* out)
+{
+    kernels().dot_int8(a, b, sums, length, out);
+}
@@ -0,0 +1,135 @@
+//
+//  CpuDispatch.h
+//  Matrix
+//
+/*
+ This file exports the hot loops of Matrix (elementwise sums, comparisons, any/all, transposes, the
+ product kernels) for float, double, int, bool and int8 elements, each built once per instruction set
+ (generic, AVX2, AVX-512, AVX-512 VNNI) in CpuDispatch.cpp. The best variant the processor supports is
+ picked once, at the first call, from CPUID. The MTM_ISA environment variable (generic, avx2, avx512,
+ avx512vnni) lowers the choice, to test or time every variant on one machine. All variants give
+ bitwise identical results: they perform the same operations on every element in the same order.
+*/
+#ifndef CpuDispatch_h
+#define CpuDispatch_h
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+namespace mtm{
+
+/**
+* Enum: InstructionSet
+* ------------------------
+* Kernel variants, each one requiring the previous ones.
+* GENERIC_ISA - portable C++ loops.
+* AVX2_ISA - 256 bit AVX2.
+* AVX512_ISA - 512 bit AVX-512 F, DQ, BW and VL.
+* AVX512_VNNI_ISA - AVX-512 and its int8 dot product instructions (vpdpbusd).
+*/
+enum InstructionSet { GENERIC_ISA, AVX2_ISA, AVX512_ISA, AVX512_VNNI_ISA };
+
+/**
+* Enum: Comparison
+* ------------------------
+* The comparisons of an element with a value, in the order of Matrix's comparison operators.
+*/
+enum Comparison { LESS, GREATER, LESS_EQUAL, GREATER_EQUAL, EQUAL, NOT_EQUAL };
+
+/**
+* function: detectedInstructionSet / instructionSet / setInstructionSet
+* Usage: detectedInstructionSet()
+*        instructionSet()
+*        setInstructionSet(mtm::GENERIC_ISA)
+* -----------------------------
+* detectedInstructionSet is the best variant the processor and the operating system support (CPUID and
+* XGETBV). instructionSet is the variant the kernels use: the detected one, or the MTM_ISA one if that is
+* lower. setInstructionSet replaces it (for test harnesses, not while kernels are running).
+@return the variant in use after the call, which is never above detectedInstructionSet().
+*/
+InstructionSet detectedInstructionSet();
+InstructionSet instructionSet();
+InstructionSet setInstructionSet(InstructionSet isa);
+
+/**
+* function: supportedInstructionSets / instructionSetName
+* Usage: supportedInstructionSets()
+*        instructionSetName(isa)
+* -----------------------------
+@return all the variants up to detectedInstructionSet(), and the MTM_ISA spelling of a variant.
+*/
+std::vector<InstructionSet> supportedInstructionSets();
+const char* instructionSetName(InstructionSet isa);
+
+
+/**
+* function: addRun
+* Usage: addRun(lhs, rhs, out, length)
+* -----------------------------
+* out[k] = lhs[k] + rhs[k] for k < length. out may be lhs or rhs.
+*/
+void addRun(const float* lhs, const float* rhs, float* out, int length);
+void addRun(const double* lhs, const double* rhs, double* out, int length);
+void addRun(const int* lhs, const int* rhs, int* out, int length);
+
+/**
+* function: compareRun
+* Usage: compareRun(from, value, to, length, mtm::LESS)
+* -----------------------------
+* to[k] = (from[k] < value) (or the other Comparison) for k < length, with the C++ semantics of NaN.
+*/
+void compareRun(const float* from, float value, bool* to, int length, Comparison comparison);
+void compareRun(const double* from, double value, bool* to, int length, Comparison comparison);
+void compareRun(const int* from, int value, bool* to, int length, Comparison comparison);
+
+/**
+* function: anyRun / allRun
+* Usage: anyRun(from, length)
+*        allRun(from, length)
+* -----------------------------
+@return whether some / all of the length elements convert to true (are not 0).
+*/
+bool anyRun(const bool* from, int length);
+bool anyRun(const float* from, int length);
+bool anyRun(const double* from, int length);
+bool anyRun(const int* from, int length);
+bool allRun(const bool* from, int length);
+bool allRun(const float* from, int length);
+bool allRun(const double* from, int length);
+bool allRun(const int* from, int length);
+
+/**
+* function: transposeBlock
+* Usage: transposeBlock(from, from_stride, to, to_stride, rows, cols)
+* -----------------------------
+* to[j * to_stride + i] = from[i * from_stride + j] for i < rows, j < cols. The blocks must not overlap.
+*/
+void transposeBlock(const float* from, std::size_t from_stride, float* to, std::size_t to_stride, int rows, int cols);
+void transposeBlock(const double* from, std::size_t from_stride, double* to, std::size_t to_stride, int rows,
+                    int cols);
+void transposeBlock(const int* from, std::size_t from_stride, int* to, std::size_t to_stride, int rows, int cols);
+
+/**
+* function: multiplyAddRun / multiplyAddRows
+* Usage: multiplyAddRun(scale, b, c, length)
+*        multiplyAddRows(scales, b, c, length)
+* -----------------------------
+* The inner loops of multiplyBlocked: c[j] += scale * b[j], and c[t][j] += scales[t] * b[j] for the four
+* rows t of c, for j < length. The product is rounded before the sum (never fused), in every variant.
+*/
+void multiplyAddRun(float scale, const float* b, float* c, int length);
+void multiplyAddRun(double scale, const double* b, double* c, int length);
+void multiplyAddRows(const float* scales, const float* b, float* const* c, int length);
+void multiplyAddRows(const double* scales, const double* b, double* const* c, int length);
+
+/**
+* function: dotInt8Rows
+* Usage: dotInt8Rows(a, b, sums, length, out)
+* -----------------------------
+* Kernel of multiplyInt8: out[t] is the int32 dot product of a with b[t] for the four rows t of b.
+* length must be a multiple of 32, sums[t] the sum of the elements of b[t].
+*/
+void dotInt8Rows(const std::int8_t* a, const std::int8_t* const* b, const std::int32_t* sums, int length,
+                 std::int32_t* out);
+}
+
+#endif /* CpuDispatch_h */
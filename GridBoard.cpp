@@ -0,0 +1,205 @@
+#include "GridBoard.h"
+#include <algorithm>
+#include <memory>
+
+namespace {
+    //large enough for any board, small enough that adding 1 can not overflow.
+    const int FAR = std::numeric_limits<int>::max() / 2;
+
+    void checkSource(const mtm::GridPoint& point, int rows, int cols)
+    {
+        if (point.row < 0 || point.row >= rows || point.col < 0 || point.col >= cols)
+        {
+            mtm::Matrix<int>::AccessIllegalElement error;
+            throw error;
+        }
+    }
+}
+
+//Row sweeps first give the distance to the nearest source of the same row, then the column sweeps
+//combine rows: |dr| + |dc| is minimized one axis at a time.
+mtm::Matrix<int> mtm::manhattanDistance(const Dimensions& dims, const std::vector<GridPoint>& sources,
+                                        Execution execution)
+{
+    Matrix<int> distances(dims, UNREACHABLE);
+    int rows = dims.getRow();
+    int cols = dims.getCol();
+    if (sources.empty())
+    {
+        return distances;
+    }
+    std::vector<int> field((std::size_t)rows * cols, FAR);
+    for (std::size_t k = 0; k < sources.size(); k++)
+    {
+        checkSource(sources[k], rows, cols);
+        field[(std::size_t)sources[k].row * cols + sources[k].col] = 0;
+    }
+    int* data = &field[0];
+    parallelRows(rows, cols, execution, [data, cols](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            int* row = data + (std::size_t)i * cols;
+            for (int j = 1; j < cols; j++)
+            {
+                row[j] = std::min(row[j], row[j - 1] + 1);
+            }
+            for (int j = cols - 2; j >= 0; j--)
+            {
+                row[j] = std::min(row[j], row[j + 1] + 1);
+            }
+        }
+    });
+    parallelRows(cols, rows, execution, [data, rows, cols](int first, int last)
+    {
+        for (int i = 1; i < rows; i++)
+        {
+            int* row = data + (std::size_t)i * cols;
+            const int* above = row - cols;
+            for (int j = first; j < last; j++)
+            {
+                row[j] = std::min(row[j], above[j] + 1);
+            }
+        }
+        for (int i = rows - 2; i >= 0; i--)
+        {
+            int* row = data + (std::size_t)i * cols;
+            const int* below = row + cols;
+            for (int j = first; j < last; j++)
+            {
+                row[j] = std::min(row[j], below[j] + 1);
+            }
+        }
+    });
+    distances.copyFrom(data);
+    return distances;
+}
+
+//The queue is one preallocated array of cell indices, every cell enters it at most once.
+mtm::Matrix<int> mtm::distanceField(const Matrix<bool>& walls, const std::vector<GridPoint>& sources)
+{
+    int rows = walls.height();
+    int cols = walls.width();
+    std::size_t cells = (std::size_t)rows * cols;
+    std::unique_ptr<bool[]> blocked(new bool[cells]);
+    walls.copyTo(blocked.get());
+    std::vector<int> field(cells, UNREACHABLE);
+    std::vector<std::size_t> queue(cells);
+    std::size_t head = 0;
+    std::size_t tail = 0;
+    for (std::size_t k = 0; k < sources.size(); k++)
+    {
+        checkSource(sources[k], rows, cols);
+        std::size_t cell = (std::size_t)sources[k].row * cols + sources[k].col;
+        if (!blocked[cell] && field[cell] != 0)
+        {
+            field[cell] = 0;
+            queue[tail++] = cell;
+        }
+    }
+    while (head < tail)
+    {
+        std::size_t cell = queue[head++];
+        int row = (int)(cell / cols);
+        int col = (int)(cell % cols);
+        int next = field[cell] + 1;
+        std::size_t neighbours[4];
+        int count = 0;
+        if (row > 0)
+        {
+            neighbours[count++] = cell - cols;
+        }
+        if (row < rows - 1)
+        {
+            neighbours[count++] = cell + cols;
+        }
+        if (col > 0)
+        {
+            neighbours[count++] = cell - 1;
+        }
+        if (col < cols - 1)
+        {
+            neighbours[count++] = cell + 1;
+        }
+        for (int n = 0; n < count; n++)
+        {
+            if (!blocked[neighbours[n]] && field[neighbours[n]] == UNREACHABLE)
+            {
+                field[neighbours[n]] = next;
+                queue[tail++] = neighbours[n];
+            }
+        }
+    }
+    Matrix<int> distances(Dimensions(rows, cols), UNREACHABLE);
+    distances.copyFrom(&field[0]);
+    return distances;
+}
+
+//Row by row, the diamond row at offset dr spans the columns within k - |dr| of the center.
+std::vector<mtm::GridPoint> mtm::pointsWithin(const Dimensions& dims, const GridPoint& center, int k)
+{
+    std::vector<GridPoint> points;
+    if (k < 0)
+    {
+        return points;
+    }
+    int first_row = std::max(0, center.row - k);
+    int last_row = std::min(dims.getRow() - 1, center.row + k);
+    for (int row = first_row; row <= last_row; row++)
+    {
+        int reach = k - std::abs(row - center.row);
+        int first_col = std::max(0, center.col - reach);
+        int last_col = std::min(dims.getCol() - 1, center.col + reach);
+        for (int col = first_col; col <= last_col; col++)
+        {
+            points.push_back(GridPoint(row, col));
+        }
+    }
+    return points;
+}
+
+std::vector<mtm::GridPoint> mtm::pointsWithin(const Matrix<int>& distances, int k)
+{
+    std::vector<GridPoint> points;
+    int rows = distances.height();
+    int cols = distances.width();
+    std::vector<int> field((std::size_t)rows * cols);
+    distances.copyTo(&field[0]);
+    for (int row = 0; row < rows; row++)
+    {
+        const int* values = &field[(std::size_t)row * cols];
+        for (int col = 0; col < cols; col++)
+        {
+            if (values[col] <= k)
+            {
+                points.push_back(GridPoint(row, col));
+            }
+        }
+    }
+    return points;
+}
+
+const std::string& mtm::BoardRenderer::render(const char* begin, const char* end, unsigned int width)
+{
+    formatGameBoard(m_Buffer, begin, end, width);
+    return m_Buffer;
+}
+
+const std::string& mtm::BoardRenderer::render(const Matrix<char>& board)
+{
+    m_Cells.resize((std::size_t)board.size());
+    board.copyTo(&m_Cells[0]);
+    return render(&m_Cells[0], &m_Cells[0] + m_Cells.size(), board.width());
+}
+
+std::ostream& mtm::BoardRenderer::print(std::ostream& os, const char* begin, const char* end, unsigned int width)
+{
+    const std::string& text = render(begin, end, width);
+    return os.write(text.data(), text.size());
+}
+
+std::ostream& mtm::BoardRenderer::print(std::ostream& os, const Matrix<char>& board)
+{
+    const std::string& text = render(board);
+    return os.write(text.data(), text.size());
+}
@@ -0,0 +1,102 @@
+//
+//  GridBoard.h
+//  Matrix
+//
+/*
+ This file exports whole board operations on top of GridPoint and Matrix: distance fields from many
+ sources at once, range queries around a point, and a buffered game board renderer.
+*/
+#ifndef GridBoard_h
+#define GridBoard_h
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "Auxiliaries.h"
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+//distance of the cells no source can reach (no sources, or walled off by distanceField).
+const int UNREACHABLE = std::numeric_limits<int>::max();
+
+
+/**
+* function: manhattanDistance
+* Usage: manhattanDistance(dims, sources)
+*        manhattanDistance(dims, sources, mtm::PARALLEL)
+* -----------------------------
+* Creates the Manhattan distance transform of a board: every cell holds GridPoint::distance to the nearest source.
+* The transform is separable, one forward and one backward sweep along every row, then along every column,
+* so it takes linear time whatever the number of sources.
+@param execution - PARALLEL sweeps bands of rows (and then of columns) on the shared ThreadPool (default SEQUENTIAL).
+@return matrix of dims holding the distances, UNREACHABLE everywhere when sources is empty.
+@exception IllegalInitialization if dims is not positive.
+@exception AccessIllegalElement if a source is outside the board.
+*/
+Matrix<int> manhattanDistance(const Dimensions &dims, const std::vector<GridPoint> &sources,
+                              Execution execution = SEQUENTIAL);
+
+/**
+* function: distanceField
+* Usage: distanceField(walls, sources)
+* -----------------------------
+* Multi source breadth first search: every cell holds the number of steps (up, down, left, right) on
+* the shortest path from the nearest source that avoids the cells where walls is true.
+* Equals manhattanDistance when there are no walls. Linear in the size of the board.
+@return matrix of walls' dimensions, UNREACHABLE on walls and on cells no source can reach.
+@exception AccessIllegalElement if a source is outside the board.
+*/
+Matrix<int> distanceField(const Matrix<bool> &walls, const std::vector<GridPoint> &sources);
+
+/**
+* function: pointsWithin
+* Usage: pointsWithin(dims, center, k)
+*        pointsWithin(distances, k)
+* -----------------------------
+* Range queries: all the cells of the board at distance at most k from center (the diamond around it,
+* enumerated directly, so the cost is the size of the answer), or all the cells whose value in a
+* distance field (manhattanDistance, distanceField) is at most k.
+@return the cells in row-major order.
+*/
+std::vector<GridPoint> pointsWithin(const Dimensions &dims, const GridPoint &center, int k);
+std::vector<GridPoint> pointsWithin(const Matrix<int> &distances, int k);
+
+
+/**
+* Class: BoardRenderer
+* ------------------------
+* Formats a game board in the layout of printGameBoard into one buffer (see formatGameBoard) and hands
+* the whole text to the stream in a single write. The buffer is kept between calls, so rendering one
+* frame after the other allocates nothing once it has grown to the board size.
+*/
+class BoardRenderer{
+private:
+    std::string m_Buffer;
+    std::vector<char> m_Cells;
+
+public:
+    /**
+    * Method: render
+    * Usage: renderer.render(begin, end, width)
+    *        renderer.render(board)
+    * -----------------------------
+    @return the text printGameBoard(os, begin, end, width) writes, valid until the next render.
+    */
+    const std::string &render(const char* begin, const char* end, unsigned int width);
+    const std::string &render(const Matrix<char> &board);
+
+    /**
+    * Method: print
+    * Usage: renderer.print(os, begin, end, width)
+    *        renderer.print(os, board)
+    * -----------------------------
+    * Renders the board and writes it to os with one call.
+    @return os.
+    */
+    std::ostream &print(std::ostream &os, const char* begin, const char* end, unsigned int width);
+    std::ostream &print(std::ostream &os, const Matrix<char> &board);
+};
+}
+
+#endif /* GridBoard_h */
@@ -0,0 +1,243 @@
+//
+//  HalfFloat.h
+//  Matrix
+//
+/*
+ This file exports Half (IEEE 754 binary16) and BFloat16, 16 bit floating point element types that
+ store a Matrix in half the memory of float and compute in float. Matrix<float>::cast<Half>() and
+ Matrix<Half>::cast<float>() use the F16C conversion instructions when compiled for them.
+*/
+#ifndef HalfFloat_h
+#define HalfFloat_h
+#include <cstring>
+#include <type_traits>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+namespace mtm{
+
+/**
+* Class: Half
+* ------------------------
+* IEEE 754 half precision number (1 sign, 5 exponent, 10 mantissa bits): about 3 decimal digits, range
+* +-65504. Converts implicitly from and to float, rounding to nearest even, so any expression on Half
+* values is computed in float and only rounded when stored back. Trivially copyable, Half() is +0.
+*/
+class Half{
+private:
+    unsigned short m_Bits;
+
+public:
+    Half() : m_Bits(0) {}
+    Half(float value) : m_Bits(fromFloat(value)) {}
+    operator float() const { return toFloat(m_Bits); }
+
+    //the binary16 encoding.
+    unsigned short bits() const { return m_Bits; }
+    static Half fromBits(unsigned short bits)
+    {
+        Half half;
+        half.m_Bits = bits;
+        return half;
+    }
+
+    static unsigned short fromFloat(float value);
+    static float toFloat(unsigned short bits);
+};
+
+/**
+* Class: BFloat16
+* ------------------------
+* Brain floating point number: the upper 16 bits of a float (1 sign, 8 exponent, 7 mantissa bits), so it
+* keeps the whole float range with about 2 decimal digits. Converts implicitly from and to float,
+* rounding to nearest even. Trivially copyable, BFloat16() is +0.
+*/
+class BFloat16{
+private:
+    unsigned short m_Bits;
+
+public:
+    BFloat16() : m_Bits(0) {}
+    BFloat16(float value) : m_Bits(fromFloat(value)) {}
+    operator float() const { return toFloat(m_Bits); }
+
+    unsigned short bits() const { return m_Bits; }
+    static BFloat16 fromBits(unsigned short bits)
+    {
+        BFloat16 value;
+        value.m_Bits = bits;
+        return value;
+    }
+
+    static unsigned short fromFloat(float value);
+    static float toFloat(unsigned short bits);
+};
+
+
+/**
+* function: convertRun (16 bit overloads)
+* Usage: convertRun(from, to, length)
+* -----------------------------
+* Bulk conversions picked by Matrix::cast for float <-> Half and float <-> BFloat16, 8 elements per
+* instruction with F16C. See the generic convertRun in Matrix.h.
+*/
+void convertRun(const float* from, Half* to, int length);
+void convertRun(const Half* from, float* to, int length);
+void convertRun(const float* from, BFloat16* to, int length);
+void convertRun(const BFloat16* from, float* to, int length);
+
+
+
+//Normal numbers are rebiased and rounded on the 13 dropped mantissa bits (a carry into the exponent
+//is the correct rounding, up to infinity), numbers below the smallest normal become subnormals.
+inline unsigned short Half::fromFloat(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000u;
+    unsigned int magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x7f800000u)
+    {
+        unsigned int nan = (magnitude > 0x7f800000u) ? (0x200u | ((magnitude >> 13) & 0x3ffu)) : 0u;
+        return (unsigned short)(sign | 0x7c00u | nan);
+    }
+    if (magnitude >= 0x47800000u)
+    {
+        return (unsigned short)(sign | 0x7c00u);
+    }
+    if (magnitude < 0x38800000u)
+    {
+        unsigned int exponent = magnitude >> 23;
+        unsigned int shift = 126 - exponent;
+        if (shift > 24)
+        {
+            return (unsigned short)sign;
+        }
+        unsigned int mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+        unsigned int half = mantissa >> shift;
+        unsigned int rest = mantissa & ((1u << shift) - 1);
+        unsigned int midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1u)))
+        {
+            half++;
+        }
+        return (unsigned short)(sign | half);
+    }
+    unsigned int half = (magnitude - 0x38000000u) >> 13;
+    unsigned int rest = magnitude & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+    {
+        half++;
+    }
+    return (unsigned short)(sign | half);
+}
+
+inline float Half::toFloat(unsigned short bits)
+{
+    unsigned int sign = (unsigned int)(bits & 0x8000u) << 16;
+    unsigned int exponent = (bits >> 10) & 0x1fu;
+    unsigned int mantissa = bits & 0x3ffu;
+    unsigned int result;
+    if (exponent == 0)
+    {
+        float magnitude = (float)mantissa * 5.9604644775390625e-8f;
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 31)
+    {
+        result = sign | 0x7f800000u | (mantissa << 13);
+    }
+    else
+    {
+        result = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &result, sizeof(value));
+    return value;
+}
+
+inline unsigned short BFloat16::fromFloat(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u)
+    {
+        return (unsigned short)((bits >> 16) | 0x40u);
+    }
+    return (unsigned short)((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+}
+
+inline float BFloat16::toFloat(unsigned short bits)
+{
+    unsigned int result = (unsigned int)bits << 16;
+    float value;
+    std::memcpy(&value, &result, sizeof(value));
+    return value;
+}
+
+
+inline void convertRun(const float* from, Half* to, int length)
+{
+    int k = 0;
+#ifdef __F16C__
+    for (; k + 8 <= length; k += 8)
+    {
+        __m128i packed = _mm256_cvtps_ph(_mm256_loadu_ps(from + k), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(to + k), packed);
+    }
+#endif
+    for (; k < length; k++)
+    {
+        to[k] = Half(from[k]);
+    }
+}
+
+inline void convertRun(const Half* from, float* to, int length)
+{
+    int k = 0;
+#ifdef __F16C__
+    for (; k + 8 <= length; k += 8)
+    {
+        __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + k));
+        _mm256_storeu_ps(to + k, _mm256_cvtph_ps(packed));
+    }
+#endif
+    for (; k < length; k++)
+    {
+        to[k] = (float)from[k];
+    }
+}
+
+inline void convertRun(const float* from, BFloat16* to, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        to[k] = BFloat16(from[k]);
+    }
+}
+
+inline void convertRun(const BFloat16* from, float* to, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        to[k] = (float)from[k];
+    }
+}
+}
+
+
+//Mixed expressions compute in the wider type: Half with float gives float, with double gives double.
+namespace std{
+template <> struct common_type<mtm::Half, float> { typedef float type; };
+template <> struct common_type<float, mtm::Half> { typedef float type; };
+template <> struct common_type<mtm::Half, double> { typedef double type; };
+template <> struct common_type<double, mtm::Half> { typedef double type; };
+template <> struct common_type<mtm::BFloat16, float> { typedef float type; };
+template <> struct common_type<float, mtm::BFloat16> { typedef float type; };
+template <> struct common_type<mtm::BFloat16, double> { typedef double type; };
+template <> struct common_type<double, mtm::BFloat16> { typedef double type; };
+template <> struct common_type<mtm::Half, mtm::BFloat16> { typedef float type; };
+template <> struct common_type<mtm::BFloat16, mtm::Half> { typedef float type; };
+}
+
+#endif /* HalfFloat_h */
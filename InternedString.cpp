@@ -0,0 +1,105 @@
+#include "InternedString.h"
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+    //The arena: an unordered_set never moves its nodes, so pointers to its strings stay valid.
+    std::mutex& arenaMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    std::unordered_set<std::string>& arena()
+    {
+        static std::unordered_set<std::string> strings;
+        return strings;
+    }
+
+    const std::string* intern(const std::string& text)
+    {
+        std::lock_guard<std::mutex> lock(arenaMutex());
+        return &*arena().insert(text).first;
+    }
+
+    const std::string* empty()
+    {
+        static const std::string* empty_string = intern(std::string());
+        return empty_string;
+    }
+
+    //reused between concatenations of the same thread, so looking up an existing result allocates nothing.
+    thread_local std::string scratch;
+}
+
+mtm::InternedString::InternedString() : m_String(empty()) {}
+
+mtm::InternedString::InternedString(const std::string& text) : m_String(intern(text)) {}
+
+mtm::InternedString::InternedString(const char* text) : m_String(intern(std::string(text))) {}
+
+const std::string& mtm::InternedString::str() const
+{
+    return *m_String;
+}
+
+mtm::InternedString mtm::InternedString::operator+(const InternedString& other) const
+{
+    InternedString sum(*this);
+    sum += other;
+    return sum;
+}
+
+mtm::InternedString& mtm::InternedString::operator+=(const InternedString& other)
+{
+    if (other.m_String->empty())
+    {
+        return *this;
+    }
+    scratch.assign(*m_String).append(*other.m_String);
+    std::lock_guard<std::mutex> lock(arenaMutex());
+    std::unordered_set<std::string>::const_iterator found = arena().find(scratch);
+    m_String = (found != arena().end()) ? &*found : &*arena().insert(scratch).first;
+    return *this;
+}
+
+bool mtm::InternedString::operator==(const InternedString& other) const
+{
+    return m_String == other.m_String;
+}
+
+bool mtm::InternedString::operator!=(const InternedString& other) const
+{
+    return m_String != other.m_String;
+}
+
+bool mtm::InternedString::operator<(const InternedString& other) const
+{
+    return *m_String < *other.m_String;
+}
+
+bool mtm::InternedString::operator>(const InternedString& other) const
+{
+    return *m_String > *other.m_String;
+}
+
+bool mtm::InternedString::operator<=(const InternedString& other) const
+{
+    return *m_String <= *other.m_String;
+}
+
+bool mtm::InternedString::operator>=(const InternedString& other) const
+{
+    return *m_String >= *other.m_String;
+}
+
+std::size_t mtm::InternedString::arenaSize()
+{
+    std::lock_guard<std::mutex> lock(arenaMutex());
+    return arena().size();
+}
+
+std::ostream& mtm::operator<<(std::ostream& os, const InternedString& text)
+{
+    return os << text.str();
+}
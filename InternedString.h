@@ -0,0 +1,86 @@
+//
+//  InternedString.h
+//  Matrix
+//
+/*
+ This file exports InternedString, a string element type for Matrix<T> backed by a process wide
+ string arena, so string matrices can be copied and compared without touching the heap.
+*/
+#ifndef InternedString_h
+#define InternedString_h
+#include <cstddef>
+#include <iostream>
+#include <string>
+namespace mtm{
+
+/**
+* Class: InternedString
+* ------------------------
+* Handle to an immutable string kept in a shared arena. Every distinct text is stored once and never
+* freed, a handle is a single pointer to it. This makes InternedString trivially copyable, so a
+* Matrix<InternedString> copies, fills and moves its elements as plain memory, and equality is a
+* pointer comparison. Concatenation (operator+, operator+=) looks the result up in the arena and
+* only stores it when it is new.
+* Meant for matrices holding a limited vocabulary of labels; texts created once and then discarded
+* keep occupying the arena for the rest of the run.
+* All operations are thread safe.
+*/
+class InternedString{
+private:
+    const std::string* m_String;
+
+public:
+    /**
+    * Constructor: InternedString
+    * Usage: InternedString str;
+    *        InternedString str("text");
+    * ---------------------------------------
+    @param text the text to intern, "" when not given.
+    @exception bad_alloc - will be thrown if a new text can not be stored.
+    */
+    InternedString();
+    InternedString(const std::string &text);
+    InternedString(const char *text);
+
+    /**
+    * Method: str
+    * Usage: label.str()
+    * -----------------------------
+    @return reference to the interned text, valid for the rest of the run.
+    */
+    const std::string &str() const;
+
+    /**
+    * operator+ / operator+=
+    * Usage: label1 + label2
+    *        label1 += label2
+    * -----------------------------
+    @return handle to the interned concatenation of the two texts.
+    @exception bad_alloc - will be thrown if a new text can not be stored.
+    */
+    InternedString operator+(const InternedString &other) const;
+    InternedString &operator+=(const InternedString &other);
+
+    /**
+    *Comparison operators == != (handle identity, which is text equality) and < > <= >= (text order).
+    */
+    bool operator==(const InternedString &other) const;
+    bool operator!=(const InternedString &other) const;
+    bool operator<(const InternedString &other) const;
+    bool operator>(const InternedString &other) const;
+    bool operator<=(const InternedString &other) const;
+    bool operator>=(const InternedString &other) const;
+
+    /**
+    * static function: arenaSize
+    * Usage: InternedString::arenaSize()
+    * -----------------------------
+    @return number of distinct texts stored in the arena.
+    */
+    static std::size_t arenaSize();
+};
+
+std::ostream &operator<<(std::ostream &os, const InternedString &text);
+}
+
+#endif /* InternedString_h */
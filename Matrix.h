@@ -10,11 +10,258 @@
 */
 #ifndef Matrix_h
 #define Matrix_h
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <span>
+#include <version>
+#endif
+#ifdef __cpp_lib_mdspan
+#include <array>
+#include <mdspan>
+#endif
 #include "Auxiliaries.h"
+#include "CpuDispatch.h"
+#include "MatrixMemory.h"
+#include "ThreadPool.h"
 namespace mtm{
 
+template<typename T>
+class Matrix;
+
+/**
+* Enum: SharingPolicy
+* ------------------------
+* DEEP_COPY - every copy of the matrix allocates and copies its own elements (default).
+* COPY_ON_WRITE - copies share one reference counted buffer, the elements are duplicated only
+*                 when one of the sharing matrices is first modified. A matrix that has handed out a
+*                 reference or pointer to write through (non const operator(), data(), iterators or
+*                 blocks) stops sharing its buffer: later copies of it get their own.
+*/
+enum SharingPolicy { DEEP_COPY, COPY_ON_WRITE };
+
+/**
+* Enum: Layout
+* ------------------------
+* Order in which the elements of a matrix are kept in memory.
+* ROW_MAJOR - row after row (default).
+* COLUMN_MAJOR - column after column.
+* TILED - square tiles of Matrix<T>::TILE_SIZE elements per side, each tile stored row-major and the
+*         tiles themselves stored in Morton (Z) order, so that 2d neighbours stay close in memory.
+*/
+enum Layout { ROW_MAJOR, COLUMN_MAJOR, TILED };
+
+/**
+* Enum: BlockOrder
+* ------------------------
+* Order in which Matrix::blocks visits the blocks of a matrix.
+* ROW_MAJOR_BLOCKS - block row after block row (default).
+* COLUMN_MAJOR_BLOCKS - block column after block column.
+* Z_ORDER_BLOCKS - Morton order of the (block row, block column) coordinates, so that consecutive blocks
+*                  stay close in both directions (blocks that share rows and columns are visited together).
+*/
+enum BlockOrder { ROW_MAJOR_BLOCKS, COLUMN_MAJOR_BLOCKS, Z_ORDER_BLOCKS };
+
+/**
+* function: elementSum
+* Usage: elementSum(lhs, rhs)
+* -----------------------------
+* The element addition used by the Matrix operators: lhs + rhs. For strings the result is reserved
+* at its final length first, so a concatenation allocates once instead of growing its buffer.
+*/
+template <typename T>
+T elementSum(const T &lhs, const T &rhs)
+{
+    return lhs + rhs;
+}
+
+template <typename C, typename Traits, typename Allocator>
+std::basic_string<C, Traits, Allocator> elementSum(const std::basic_string<C, Traits, Allocator> &lhs,
+                                                   const std::basic_string<C, Traits, Allocator> &rhs)
+{
+    std::basic_string<C, Traits, Allocator> sum;
+    sum.reserve(lhs.size() + rhs.size());
+    sum.append(lhs).append(rhs);
+    return sum;
+}
+
+/**
+* function: convertRun
+* Usage: convertRun(from, to, length)
+* -----------------------------
+* Converts length consecutive elements with static_cast, used by Matrix::cast once per run.
+* Element types with faster bulk conversions provide overloads for their pointer types (see HalfFloat.h).
+*/
+template <typename T, typename U>
+void convertRun(const T* from, U* to, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        to[k] = static_cast<U>(from[k]);
+    }
+}
+
+/**
+* function: scratchElements
+* Usage: std::unique_ptr<T[]> rows = scratchElements<T>(mat.size());
+* -----------------------------
+* Contiguous buffer of count default initialized elements, the staging area for copyTo / copyFrom and for
+* the algorithms that work on the elements of a matrix in row-major order. Use it instead of std::vector<T>:
+* std::vector<bool> packs its elements into bits and has no bool* to hand to copyTo, so code written with
+* it would not compile (or would need a special case) for Matrix<bool>.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+std::unique_ptr<T[]> scratchElements(std::size_t count)
+{
+    return std::unique_ptr<T[]>(new T[count]);
+}
+
+/**
+* function: addRun / compareRun / anyRun / allRun / transposeBlock
+* -----------------------------
+* The run kernels of Matrix's sums, comparisons, any / all and transposes, with the contracts of their
+* CpuDispatch.h overloads, which take over for float, double, int (and bool for any / all) elements.
+*/
+template <typename T>
+void addRun(const T* lhs, const T* rhs, T* out, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        out[k] = elementSum(lhs[k], rhs[k]);
+    }
+}
+
+template <typename T>
+void compareRun(const T* from, const T &value, bool* to, int length, Comparison comparison)
+{
+    for (int k = 0; k < length; k++)
+    {
+        switch (comparison)
+        {
+            case LESS:
+                to[k] = bool(from[k] < value);
+                break;
+            case GREATER:
+                to[k] = bool(from[k] > value);
+                break;
+            case LESS_EQUAL:
+                to[k] = bool(from[k] <= value);
+                break;
+            case GREATER_EQUAL:
+                to[k] = bool(from[k] >= value);
+                break;
+            case EQUAL:
+                to[k] = bool(from[k] == value);
+                break;
+            default:
+                to[k] = bool(from[k] != value);
+                break;
+        }
+    }
+}
+
+template <typename T>
+bool anyRun(const T* from, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        if (bool(from[k]) == true)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool allRun(const T* from, int length)
+{
+    for (int k = 0; k < length; k++)
+    {
+        if (bool(from[k]) == false)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void transposeBlock(const T* from, std::size_t from_stride, T* to, std::size_t to_stride, int rows, int cols)
+{
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            to[j * to_stride + i] = from[i * from_stride + j];
+        }
+    }
+}
+
+//to (cols x rows) = from (rows x cols) transposed, both row-major, in TILE_SIZE blocks.
+template <typename T>
+void transposeArray(const T* from, int rows, int cols, T* to)
+{
+    const int block = Matrix<T>::TILE_SIZE;
+    for (int row_block = 0; row_block < rows; row_block += block)
+    {
+        for (int col_block = 0; col_block < cols; col_block += block)
+        {
+            transposeBlock(from + (std::size_t)row_block * cols + col_block, cols,
+                           to + (std::size_t)col_block * rows + row_block, rows, std::min(block, rows - row_block),
+                           std::min(block, cols - col_block));
+        }
+    }
+}
+
+//true for the scalar types a Matrix<T> can be combined with although they are not T.
+template <typename T, typename S>
+struct MixedScalar : std::integral_constant<bool, std::is_arithmetic<S>::value && !std::is_same<T, S>::value> {};
+
+//elementwise combination functions, documented with their friend declarations in Matrix.
+template <typename T, typename F>
+Matrix<T> zip(const Matrix<T> &a, const Matrix<T> &b, F operation, Execution execution = SEQUENTIAL);
+template <typename T, typename F>
+Matrix<T> zip(const Matrix<T> &a, const Matrix<T> &b, const Matrix<T> &c, F operation,
+              Execution execution = SEQUENTIAL);
+template <typename T, typename F>
+Matrix<T> &combine(Matrix<T> &a, const Matrix<T> &b, F operation, Execution execution = SEQUENTIAL);
+template <typename T, typename F>
+Matrix<T> &combine(Matrix<T> &a, const Matrix<T> &b, const Matrix<T> &c, F operation,
+                   Execution execution = SEQUENTIAL);
+
+//assembly functions, documented with their friend declarations in Matrix.
+template <typename T>
+Matrix<T> hstack(const std::vector< Matrix<T> > &mats, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> hstack(const Matrix<T> &a, const Matrix<T> &b, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> vstack(const std::vector< Matrix<T> > &mats, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> vstack(const Matrix<T> &a, const Matrix<T> &b, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> block(const std::vector< std::vector< Matrix<T> > > &blocks, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> blockDiagonal(const std::vector< Matrix<T> > &mats, const T &fill = T(), Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> tile(const Matrix<T> &mat, int rows, int cols, Execution execution = SEQUENTIAL);
+template <typename T>
+Matrix<T> repeat(const Matrix<T> &mat, int rows, int cols, Execution execution = SEQUENTIAL);
+
 /**
 * Class: Matrix<ValueType>
 * ------------------------
@@ -23,21 +270,195 @@ namespace mtm{
 template<typename T>
 class Matrix{
 private:
+    //Reference counted element buffer, shared between copy-on-write copies.
+    //TILED buffers also keep the Morton placement of their tiles:
+    //tile_slots[tile row * tiles per row + tile col] is the position of that tile in the buffer,
+    //tile_origins[position] is the inverse mapping.
+    //The elements live in raw malloc/calloc memory and are constructed in place, which lets
+    //trivially copyable types skip per element work: a value whose bytes are all zero comes straight
+    //from calloc (untouched pages of a huge buffer are only faulted in when first used), other values
+    //are filled with std::fill_n / memset, and copies are a single memcpy. Other types are constructed
+    //with std::uninitialized_fill_n / std::uninitialized_copy, which destroy what they built if an element throws.
+    //Large buffers of a matrix with a MemoryPolicy other than DEFAULT_MEMORY come from allocatePages
+    //instead (mapped is their size in bytes, 0 for heap buffers). FIRST_TOUCH buffers of trivially
+    //copyable elements are filled and copied by the pool workers in parallel (see inBands).
+    //count elements are constructed, the buffer has room for capacity of them (reserve and the row appends
+    //of a ROW_MAJOR matrix keep spare room at its end).
+    //Buffers of Adopt and Wrap are external: the caller allocated them and deleter (empty for Wrap) takes them
+    //back when the last reference goes, or when the elements move to a buffer of their own (relocate).
+    //unshareable is set once a reference or pointer the caller may write through was handed out (as the
+    //copy-on-write strings of libstdc++ do): copies then get a buffer of their own instead of sharing it.
+    struct Storage
+    {
+        T* data;
+        std::size_t count;
+        std::size_t capacity;
+        std::atomic<int> references;
+        bool unshareable;
+        std::vector<std::size_t> tile_slots;
+        std::vector<int> tile_origins;
+        MemoryPolicy memory;
+        std::size_t mapped;
+        bool external;
+        std::function<void(T*)> deleter;
+
+        //buffer of count copies of init.
+        Storage(std::size_t count, const T& init, MemoryPolicy memory);
+
+        //external buffer of count elements at data with room for capacity, with no reference yet (the
+        //adopting matrix takes the first one).
+        Storage(T* data, std::size_t count, std::size_t capacity, const std::function<void(T*)> &deleter);
+        ~Storage();
+
+        //new buffer (with a single reference) holding a copy of this one.
+        Storage* duplicate() const;
+
+        //moves the elements to a new allocation of the given capacity (at least count), one memcpy when
+        //T is trivially copyable.
+        void relocate(std::size_t capacity);
+
+        //constructs copies of init at the end, or destroys the last elements, up to count (at most capacity).
+        void resize(std::size_t count, const T& init);
+
+    private:
+        //buffer with no constructed elements yet (count is set once they are built).
+        struct Raw {};
+        Storage(Raw, std::size_t capacity, bool zeroed, MemoryPolicy memory);
+
+        //allocate sets mapped for the new allocation (0 on the heap), deallocate takes the mapped size it was given.
+        T* allocate(std::size_t capacity, bool zeroed);
+        static void deallocate(T* data, std::size_t mapped);
+        bool firstTouch() const;
+        template <typename F>
+        void inBands(std::size_t count, F body) const;
+        static bool zeroBytes(const T& value);
+        void fill(T* data, std::size_t count, const T& init, std::true_type trivially_copyable);
+        void fill(T* data, std::size_t count, const T& init, std::false_type trivially_copyable);
+        void copy(T* data, std::size_t count, const T* source, std::true_type trivially_copyable);
+        void copy(T* data, std::size_t count, const T* source, std::false_type trivially_copyable);
+        static void destroy(T* data, std::size_t count, std::true_type trivially_destructible);
+        static void destroy(T* data, std::size_t count, std::false_type trivially_destructible);
+    };
+
     Dimensions m_Dims;
-    T** m_Array;
+    Storage* m_Storage;
+    SharingPolicy m_Sharing;
+    Layout m_Layout;
+    MemoryPolicy m_Memory;
+
+    //takes an additional reference to storage, used to share one buffer under another shape or layout.
+    Matrix(Storage* storage, Dimensions dims, SharingPolicy sharing, Layout layout);
+
+    //throws DimensionMismatch unless mat has the same dimensions as this matrix.
+    void checkDimensions(const Matrix &mat) const;
+
+    //number of elements in the buffer (TILED buffers are padded to whole tiles).
+    std::size_t count() const;
+
+    //number of tiles per row/column of a TILED matrix.
+    int tileRows() const;
+    int tileCols() const;
+
+    //fills the Morton tile placement tables of a new TILED buffer.
+    void placeTiles();
+
+    //position of element (row_index, col_index) in the buffer. No bounds check.
+    std::size_t offset(int row_index, int col_index) const;
+
+    //The buffer is covered by runs: maximal stretches of consecutive buffer elements that all belong to the
+    //matrix (rows for ROW_MAJOR, columns for COLUMN_MAJOR, tile rows for TILED). Two matrices of the same
+    //dimensions and layout have identical runs, so elementwise operations can walk them as plain arrays.
+    int runCount() const;
+    int runLength(int run) const;
+    std::size_t runOffset(int run) const;
+
+    //Elementwise kernels behind every operator, apply, zip and combine: out = operation(a (,b (,c))).
+    //When all layouts match they loop over runs, otherwise over TILE_SIZE blocks of coordinates.
+    //out must have a's dimensions and may be a itself.
+    template <typename R, typename F>
+    static void transform(Matrix<R> &out, const Matrix &a, F operation, Execution execution);
+    template <typename R, typename U, typename F>
+    static void transform(Matrix<R> &out, const Matrix &a, const Matrix<U> &b, F operation, Execution execution);
+    template <typename R, typename F>
+    static void transform(Matrix<R> &out, const Matrix &a, const Matrix &b, const Matrix &c, F operation,
+                          Execution execution);
+
+    //out = a + b and out = (a compared with value) run by run, through addRun / compareRun.
+    //out must have a's dimensions and layout, b too.
+    static void addRuns(Matrix &out, const Matrix &a, const Matrix &b);
+    static void compareRuns(Matrix<bool> &out, const Matrix &a, const T &value, Comparison comparison);
+
+    //In place kernels: operation(a element) or operation(a element, b element) gets a non const
+    //reference to the element of a, so heavy elements (strings) can grow without being rebuilt.
+    template <typename F>
+    static void update(Matrix &a, F operation);
+    template <typename F>
+    static void update(Matrix &a, const Matrix &b, F operation);
+
+    //drops this matrix's reference to its buffer, freeing it if this was the last one.
+    void release();
+
+    //gives this matrix a private copy of its buffer if it is currently shared.
+    void detach();
+
+    //whether no other matrix references the buffer, so it may be resized in place.
+    bool ownsBuffer() const;
+
+    //the buffer a COPY_ON_WRITE copy of this matrix uses, with the reference taken: this matrix's own, or a
+    //duplicate once it is unshareable.
+    Storage* share() const;
+
+    //number of elements from (any row, col_index) on in the same row that follow each other in the buffer.
+    int rowRun(int col_index) const;
+
+    //Copies source into out with its element (0, 0) at (row_index, col_index), in the longest pieces that
+    //are contiguous in both buffers (whole rows or columns when the layouts allow). out must own its buffer.
+    static void place(Matrix &out, int row_index, int col_index, const Matrix &source, Execution execution);
+
+    //Stacks a grid of blocks: the blocks of a grid row have equal heights, the grid rows equal widths.
+    //The result has the first block's SharingPolicy, Layout and MemoryPolicy.
+    static Matrix assemble(const std::vector< std::vector<const Matrix*> > &grid, Execution execution);
+
+    //In place: removes erased runs (rows of a ROW_MAJOR matrix, columns of a COLUMN_MAJOR one) at run
+    //position and puts inserted runs of fill there, moving the following runs with std::move (memmove for
+    //trivially copyable T). Growth past the capacity doubles it. The buffer must be owned and not TILED.
+    void spliceRuns(int position, int inserted, int erased, const T& fill);
+
+    //Replaces the buffer by a new one of dims: rows [0, position) are kept, inserted rows of fill follow,
+    //the erased rows after them are dropped, and columns are kept up to the narrower width. Kept elements are
+    //moved (copied if the old buffer is shared) a run at a time.
+    void rebuild(Dimensions dims, int position, int inserted, int erased, const T& fill);
+
+    //element access without bounds check. The non const version detaches first.
+    T* elements();
+    const T* elements() const;
+
+    //elements() for the accessors that hand the caller something to write through: also makes the buffer
+    //unshareable.
+    T* exposeElements();
+
+    template <typename U>
+    friend class Matrix;
     
 public:
     /**
     * Constructor: Matrix
     * Usage: Matrix<T> mat(mtm::Dimensions dims);
     *        Matrix<T> mat(mtm::Dimensions dims, T initializer);
+    *        Matrix<T> mat(mtm::Dimensions dims, T initializer, mtm::COPY_ON_WRITE);
+    *        Matrix<T> mat(mtm::Dimensions dims, T initializer, mtm::DEEP_COPY, mtm::COLUMN_MAJOR);
+    *        Matrix<T> mat(mtm::Dimensions dims, T initializer, mtm::DEEP_COPY, mtm::ROW_MAJOR, mtm::FIRST_TOUCH);
     * ---------------------------------------
     @param dims the dimensions of the matrix to construct, must be 2 positive numbers.
     @param initializer a specific value to initialize all matrix element, if not given will get default value - 0 for numeric types, "" (empty string) for std::string.
+    @param sharing how copies of this matrix treat its elements, see SharingPolicy (default DEEP_COPY).
+    @param layout memory order of the elements, see Layout (default ROW_MAJOR).
+    @param memory placement of a large buffer, see MemoryPolicy (default DEFAULT_MEMORY). Results computed from this matrix inherit it.
     @exception IllegalInitializtion - the constructor will throw this error if illegal dimensions were passed (row or col >=0)
     @exception bad_alloc - will be thrown if memory allocation failed (by new)
     */
-    Matrix(mtm::Dimensions dims,const T& initializer = T());
+    Matrix(mtm::Dimensions dims,const T& initializer = T(), SharingPolicy sharing = DEEP_COPY,
+           Layout layout = ROW_MAJOR, MemoryPolicy memory = DEFAULT_MEMORY);
 
     /**
     * Destructor: ~Matrix
@@ -50,23 +471,37 @@ public:
     * Copy constructor: Matrix
     * Usage: Matrix<T>(Matrix<T> &mat)
     *---------------------------------------
+    * The copy gets the SharingPolicy of other. A COPY_ON_WRITE copy shares other's buffer, unless other
+    * handed out a reference to write through (see SharingPolicy).
     @param other reference to the matrix to copy.
     @exception bad_alloc - will be thrown if memory allocation failed (by new)
     */
         
     Matrix(const Matrix &other);
 
+    /**
+    * Move constructor: Matrix
+    * Usage: Matrix<T>(std::move(mat))
+    *---------------------------------------
+    * Takes over the buffer of other without copying any element.
+    @param other the matrix to move from, it is left empty and may only be assigned to or destroyed.
+    */
+    Matrix(Matrix &&other) noexcept;
+
     /**
     * operator=
     * Usage: matrix =  other
     *---------------------------------------
     * The operator is assigning the matrix, dealing with realese of current menmory and copying into the object.
     *can be used to initialize new matrix and or reassigning an exisiting one.
+    * The matrix gets the SharingPolicy of other, and shares other's buffer if it is COPY_ON_WRITE (and
+    * other handed out no reference to write through, see SharingPolicy).
     @param other reference to the matrix to copy.
     @exception bad_alloc - will be thrown if memory allocation failed (by new)
     */
     
     Matrix& operator=(Matrix const &other);
+    Matrix& operator=(Matrix &&other) noexcept;
     
     /**
     * Method: height
@@ -97,6 +532,160 @@ public:
 
     int size() const;
 
+
+    /**
+    * Method: sharing / setSharing
+    * Usage: mat.sharing()
+    *        mat.setSharing(mtm::COPY_ON_WRITE)
+    * -----------------------------
+    * Reads or changes the SharingPolicy used for future copies of this matrix.
+    * Switching to DEEP_COPY gives the matrix a private buffer right away.
+    @return the current SharingPolicy (sharing).
+    @exception bad_alloc - will be thrown if memory allocation failed (by new).
+    */
+    SharingPolicy sharing() const;
+    void setSharing(SharingPolicy sharing);
+
+
+    //side of the square tiles of the TILED layout.
+    static const int TILE_SIZE = 32;
+
+    /**
+    * Method: layout / toLayout
+    * Usage: mat.layout()
+    *        mat.toLayout(mtm::COLUMN_MAJOR)
+    * -----------------------------
+    * layout returns the memory order of this matrix. toLayout creates a new matrix with the same
+    * elements kept in the given order, copied block by block so both sides are read and written in cache sized pieces.
+    * Converting a temporary moves the elements instead of copying them when T is not trivially copyable.
+    @return the Layout of this matrix (layout) or the converted matrix (toLayout).
+    @exception bad_alloc - will be thrown if memory allocation failed (by new).
+    */
+    Layout layout() const;
+
+    //MemoryPolicy the buffer of this matrix was allocated with.
+    MemoryPolicy memory() const;
+
+    /**
+    * Method: data / rowStride / colStride
+    * Usage: mat.data()
+    *        mat.data()[i * mat.rowStride() + j * mat.colStride()]
+    * -----------------------------
+    * The element buffer of a ROW_MAJOR or COLUMN_MAJOR matrix, for handing it to other code without a copy:
+    * element (i, j) is data()[i * rowStride() + j * colStride()]. The non const data detaches first, so
+    * writes through it are not seen by COPY_ON_WRITE copies, made before or after. The pointer is valid
+    * until the matrix is destroyed, assigned or resized.
+    @exception AccessIllegalElement if the matrix is TILED (toLayout gives a matrix data can be taken from).
+    */
+    T* data();
+    const T* data() const;
+    std::size_t rowStride() const;
+    std::size_t colStride() const;
+
+#if __cplusplus >= 202002L
+    /**
+    * Method: span
+    * Usage: std::span<double> view = mat.span();
+    * -----------------------------
+    * The size() elements of data() as a std::span (C++20), in the order of the Layout.
+    @exception AccessIllegalElement if the matrix is TILED.
+    */
+    std::span<T> span();
+    std::span<const T> span() const;
+#endif
+
+#ifdef __cpp_lib_mdspan
+    /**
+    * Method: mdspan
+    * Usage: auto view = mat.mdspan(); view[i, j]
+    * -----------------------------
+    * data() as a two dimensional std::mdspan (C++23) of height() x width() with the strides of the Layout.
+    @exception AccessIllegalElement if the matrix is TILED.
+    */
+    std::mdspan<T, std::dextents<std::size_t, 2>, std::layout_stride> mdspan();
+    std::mdspan<const T, std::dextents<std::size_t, 2>, std::layout_stride> mdspan() const;
+#endif
+
+    Matrix toLayout(Layout layout) const &;
+    Matrix toLayout(Layout layout) &&;
+
+
+    /**
+    * Method: copyTo / copyFrom
+    * Usage: mat.copyTo(buffer)
+    *        mat.copyFrom(buffer)
+    * -----------------------------
+    * Copies all the elements to (or from) a plain array in row-major order, whatever the layout of the matrix.
+    * Meant for kernels that work on packed arrays, such as multiply.
+    @param destination / source - array of at least size() elements.
+    @exception bad_alloc - copyFrom may throw it when a COPY_ON_WRITE matrix has to copy its shared buffer.
+    */
+    void copyTo(T* destination) const;
+    void copyFrom(const T* source);
+
+
+    /**
+    * Method: capacity / reserve / shrinkToFit
+    * Usage: mat.capacity()
+    *        mat.reserve(mtm::Dimensions(1000, mat.width()))
+    *        mat.shrinkToFit()
+    * -----------------------------
+    * capacity is the number of elements the buffer has room for. reserve makes room for a matrix of dims in
+    * this layout, so growing up to dims along the contiguous axis (rows of a ROW_MAJOR matrix, columns of a
+    * COLUMN_MAJOR one) does not reallocate. shrinkToFit gives the spare room back.
+    * Elements are relocated with one memcpy when T is trivially copyable, moved otherwise.
+    @exception IllegalInitialization if dims are not 2 positive numbers (reserve).
+    @exception bad_alloc - will be thrown if memory allocation failed.
+    */
+    int capacity() const;
+    void reserve(mtm::Dimensions dims);
+    void shrinkToFit();
+
+    /**
+    * Method: resize
+    * Usage: mat.resize(mtm::Dimensions(rows, cols))
+    *        mat.resize(mtm::Dimensions(rows, cols), fill)
+    * -----------------------------
+    * Changes the dimensions of the matrix in place, keeping the elements that are inside both the old and
+    * the new dimensions. New elements are copies of fill.
+    @exception IllegalInitialization if dims are not 2 positive numbers.
+    @exception bad_alloc - will be thrown if memory allocation failed.
+    */
+    void resize(mtm::Dimensions dims, const T &fill = T());
+
+    /**
+    * Method: appendRow / appendCol
+    * Usage: mat.appendRow(values)
+    *        mat.appendCol(values)
+    * -----------------------------
+    * Adds values as a new last row (column). Along the contiguous axis (rows of ROW_MAJOR, columns of
+    * COLUMN_MAJOR) the capacity grows geometrically, so n appends of a row take amortized O(width) each.
+    * Along the other axis the buffer is rebuilt in O(size), as it is for TILED when a new row (column) of
+    * tiles is needed.
+    @param values - width() (height()) elements.
+    @exception DimensionMismatch if values does not have width() (height()) elements.
+    @exception bad_alloc - will be thrown if memory allocation failed.
+    */
+    void appendRow(const std::vector<T> &values);
+    void appendCol(const std::vector<T> &values);
+
+    /**
+    * Method: insertRows / eraseRows
+    * Usage: mat.insertRows(position, rows)
+    *        mat.eraseRows(position, count)
+    * -----------------------------
+    * insertRows puts the rows of rows before row position (height() appends them), eraseRows removes count
+    * rows starting at position. A ROW_MAJOR matrix shifts its following rows in place, other layouts rebuild.
+    @exception DimensionMismatch if rows.width() != width().
+    @exception AccessIllegalElement if position is outside [0, height()] (insertRows), or count is not positive
+    *          or the rows [position, position + count) are not all in the matrix (eraseRows).
+    @exception IllegalInitialization if every row would be erased.
+    @exception bad_alloc - will be thrown if memory allocation failed.
+    */
+    void insertRows(int position, const Matrix &rows);
+    void eraseRows(int position, int count);
+
+
     
     /**
     * static function: Diagonal
@@ -111,7 +700,36 @@ public:
     @exception bad_alloc - will be thrown if memory allocation failed (by new).
     */
         
-    static Matrix<T> Diagonal(int size, T init);
+    static Matrix<T> Diagonal(int size, const T &init);
+
+
+    /**
+    * static function: Adopt / Wrap
+    * Usage: Adopt(data, dims, stride, [](float* p) { delete[] p; })
+    *        Adopt(data, dims, stride, deleter, mtm::COLUMN_MAJOR, mtm::COPY_ON_WRITE)
+    *        Wrap(data, dims, dims.getCol())
+    * -----------------------------
+    * Create a matrix on a buffer the caller filled, without copying it. Element (i, j) is data[i * stride + j]
+    * for ROW_MAJOR, data[j * stride + i] for COLUMN_MAJOR.
+    * Adopt takes ownership: deleter(data) is called when no matrix uses the buffer any more, that is when the
+    * last copy sharing it goes, or earlier if the matrix grows past it and moves to a buffer of its own (an
+    * empty deleter leaves the buffer to the caller). Padded rows (columns) are closed up in place, and the
+    * padding behind the last row (column) is kept as capacity.
+    * Wrap only borrows the buffer: it must outlive the matrix and its COPY_ON_WRITE copies, and cannot be
+    * padded. Writes to the matrix reach the buffer as long as its elements are not copied (a COPY_ON_WRITE
+    * matrix writes to a copy while the buffer is shared, and a DEEP_COPY copy is a copy).
+    @param stride elements between the starts of two rows (ROW_MAJOR) or columns (COLUMN_MAJOR).
+    @param layout ROW_MAJOR or COLUMN_MAJOR (default ROW_MAJOR).
+    @param sharing see SharingPolicy (default DEEP_COPY).
+    @remarks (assumptions) T is trivially copyable.
+    @exception IllegalInitialization if data is NULL, dims are not positive, layout is TILED, or stride is
+    *          shorter than a row (column), or longer for Wrap. The buffer then stays the caller's.
+    @exception bad_alloc - will be thrown if memory allocation failed (by new), the buffer then stays the caller's.
+    */
+    static Matrix<T> Adopt(T* data, Dimensions dims, std::size_t stride, const std::function<void(T*)> &deleter,
+                           Layout layout = ROW_MAJOR, SharingPolicy sharing = DEEP_COPY);
+    static Matrix<T> Wrap(T* data, Dimensions dims, std::size_t stride, Layout layout = ROW_MAJOR,
+                          SharingPolicy sharing = DEEP_COPY);
     
     
     /**
@@ -119,6 +737,8 @@ public:
     * Usage: mat.transpost()
     * -----------------------------
     * This method create a new transposed object of this matrix. (swapped rows and cols).
+    * A ROW_MAJOR matrix transposes into a COLUMN_MAJOR one with the same buffer (and vice versa), so the
+    * elements are never reordered: COPY_ON_WRITE matrices share the buffer, others copy it as a whole.
     @return new transposed matrix.
     @exception bad_alloc - will be thrown if memory allocation failed (by new).
     */
@@ -135,8 +755,10 @@ public:
     @param mat1 the matrix to add.
     @exception bad_alloc - will be thrown if memory allocation failed (by new).
     @exception DimensionMismatch if the given matrices are not of the same dimensions.
+    @remarks when the left operand is a temporary its buffer is reused for the result.
     */
-    Matrix operator+(const Matrix &mat1) const;
+    Matrix operator+(const Matrix &mat1) const &;
+    Matrix operator+(const Matrix &mat1) &&;
     
     
     /**
@@ -148,7 +770,8 @@ public:
     @exception bad_alloc - will be thrown if memory allocation failed (by new).
     @remarks numeric types only,
     */
-    Matrix operator-() const;
+    Matrix operator-() const &;
+    Matrix operator-() &&;
     
     
     /**
@@ -162,7 +785,45 @@ public:
     @exception DimensionMismatch if the given matrices are not of the same dimensions.
     @remarks numeric types only. matrices need to have same dimensions.
     */
-    Matrix operator-(const Matrix mat) const;
+    Matrix operator-(const Matrix &mat) const;
+
+
+    /**
+    * operator + / operator - (mixed types)
+    * Usage: mat_float + mat_double
+    *        mat_double - mat_int
+    *        mat_double + 2
+    *        2 + mat_double
+    * -----------------------------
+    * Adds (or subtracts) a matrix of another element type, or adds an arithmetic scalar of another type.
+    * The result element type is std::common_type of the two element types, both operands are converted
+    * element by element inside the single pass that computes the result, no converted copy is made.
+    * The result keeps the SharingPolicy, Layout and MemoryPolicy of this matrix.
+    @return new matrix of the common type.
+    @exception DimensionMismatch if the given matrices are not of the same dimensions.
+    @exception bad_alloc - will be thrown if memory allocation failed (by new).
+    */
+    template <typename U>
+    Matrix<typename std::common_type<T, U>::type> operator+(const Matrix<U> &mat) const;
+    template <typename U>
+    Matrix<typename std::common_type<T, U>::type> operator-(const Matrix<U> &mat) const;
+    template <typename S, typename = typename std::enable_if<MixedScalar<T, S>::value>::type>
+    Matrix<typename std::common_type<T, S>::type> operator+(const S &scalar) const;
+
+
+    /**
+    * Method: cast
+    * Usage: mat.cast<float>()
+    *        mat.cast<mtm::Half>(mtm::PARALLEL)
+    * -----------------------------
+    * Creates a matrix of the elements converted to U (static_cast, or the bulk conversions of convertRun
+    * overloads such as float <-> Half), with the SharingPolicy, Layout and MemoryPolicy of this matrix.
+    @param execution - PARALLEL converts bands of runs on the shared ThreadPool (default SEQUENTIAL).
+    @return the converted matrix.
+    @exception bad_alloc - will be thrown if memory allocation failed (by new).
+    */
+    template <typename U>
+    Matrix<U> cast(Execution execution = SEQUENTIAL) const;
     
     
     
@@ -175,7 +836,21 @@ public:
     @remarks change the matrix itself, not creating a new copy.
     */
         
-    Matrix& operator+=(T obj);
+    Matrix& operator+=(const T &obj);
+
+
+    /**
+    * operator+= (with matrix)
+    * Usage: mat1 += mat2
+    * -----------------------------
+    *This operator adds each element of mat2 to the element of mat1 in the same position, in place
+    *(for strings: appends, reusing the capacity each element already has).
+    @param mat - the matrix to add.
+    @return reference to the updated matrix.
+    @exception DimensionMismatch if the given matrices are not of the same dimensions.
+    */
+
+    Matrix& operator+=(const Matrix &mat);
     
     
     /**
@@ -186,14 +861,18 @@ public:
     *This operator create a copy of the matrix and adds the object of type T to each of the matrix elements.
     @param obj - the T type object we want to add to the matrix.
     @param mat - the matrix we want to copy and add obj to.
-    @remarks creates a new matrix.
+    @remarks creates a new matrix, unless mat is a temporary: then its buffer is updated in place and reused.
     @exception bad_alloc - will be thrown if memory allocation failed (by new).
     */
         
     template<typename U>
-    friend Matrix<U> operator+(U obj, const Matrix<U> mat);
+    friend Matrix<U> operator+(const U &obj, const Matrix<U> &mat);
+    template<typename U>
+    friend Matrix<U> operator+(const Matrix<U> &mat, const U &obj);
     template<typename U>
-    friend Matrix<U> operator+(const Matrix<U> mat, U obj);
+    friend Matrix<U> operator+(const U &obj, Matrix<U> &&mat);
+    template<typename U>
+    friend Matrix<U> operator+(Matrix<U> &&mat, const U &obj);
     
     
     /**
@@ -203,11 +882,14 @@ public:
     *This operator gives access to the actual elements in the matrix, and enable to change them as well.
     @param row_index an integer representing the row index
     @param col_index an integer representing the column index
-    @remarks can be used to change element value.
+    @remarks can be used to change element value (non const matrices only). The matrix then stops sharing its
+    *        buffer with later COPY_ON_WRITE copies, so writes through the reference are never seen by a copy.
     @return - reference to the matrix element in the given position.
     @exception AccessIllegalElement is thrown if the given indices are out of the scope of the matrix.
+    @exception bad_alloc - may be thrown by a COPY_ON_WRITE matrix that has to copy its shared buffer.
     */
-     T &operator()(int row_index, int col_index) const;
+     T &operator()(int row_index, int col_index);
+     const T &operator()(int row_index, int col_index) const;
     
 
     
@@ -223,12 +905,12 @@ public:
     @exception bad_alloc will be thrown if memory allocation failed (by new).
     */
 
-    Matrix<bool> operator<(T compare) const;
-    Matrix<bool> operator>(T compare) const;
-    Matrix<bool> operator>=(T compare) const;
-    Matrix<bool> operator<=(T compare) const;
-    Matrix<bool> operator==(T compare) const;
-    Matrix<bool> operator!=(T compare) const;
+    Matrix<bool> operator<(const T &compare) const;
+    Matrix<bool> operator>(const T &compare) const;
+    Matrix<bool> operator>=(const T &compare) const;
+    Matrix<bool> operator<=(const T &compare) const;
+    Matrix<bool> operator==(const T &compare) const;
+    Matrix<bool> operator!=(const T &compare) const;
         
     /**
     *Boolean functions
@@ -243,7 +925,7 @@ public:
      */
         
     template <typename U>
-    friend bool any(Matrix<U> mat);
+    friend bool any(const Matrix<U> &mat);
         
     /** any - return true if at least one element that is not 0 exists.
     * Usage: any(mat)
@@ -255,7 +937,7 @@ public:
      
     */
     template <typename U>
-    friend bool all(Matrix<U> mat);
+    friend bool all(const Matrix<U> &mat);
 
 
     /** method apply - applying a class operator() on each matrix element.
@@ -269,6 +951,79 @@ public:
     template <typename U>
     Matrix<T> apply(U operation) const;
 
+
+    /** functions zip / combine - applying a binary (or ternary) class operator() on matching elements.
+    * Usage: zip(a, b, operation)             zip(a, b, c, operation)
+    *        combine(a, b, operation)         combine(a, b, c, operation)
+    * -----------------------------
+    * zip creates a new matrix in which each element is operation(a(i,j), b(i,j)) (or operation(a(i,j), b(i,j), c(i,j))).
+    * combine stores the same results into a itself, without allocating a new matrix.
+    * The dimensions are checked once, afterwards the rows are processed by a tight loop without bounds checks.
+    @param operation - class object that supports operator() on two (or three) T elements.
+    @param execution - PARALLEL splits the rows between the threads of the shared ThreadPool (default SEQUENTIAL).
+    @return new matrix of results (zip) or reference to a (combine).
+    @remarks (assumptions) operation returns a value convertible to T, and may be called concurrently when PARALLEL is used.
+    @exception DimensionMismatch if the given matrices are not of the same dimensions.
+    @exception bad_alloc will be thrown if memory allocation failed (by new).
+    */
+    template <typename U, typename F>
+    friend Matrix<U> zip(const Matrix<U> &a, const Matrix<U> &b, F operation, Execution execution);
+    template <typename U, typename F>
+    friend Matrix<U> zip(const Matrix<U> &a, const Matrix<U> &b, const Matrix<U> &c, F operation,
+                         Execution execution);
+    template <typename U, typename F>
+    friend Matrix<U> &combine(Matrix<U> &a, const Matrix<U> &b, F operation, Execution execution);
+    template <typename U, typename F>
+    friend Matrix<U> &combine(Matrix<U> &a, const Matrix<U> &b, const Matrix<U> &c, F operation,
+                              Execution execution);
+
+
+    /** functions hstack / vstack / block / blockDiagonal - assembling a matrix from pieces.
+    * Usage: hstack(a, b)                     hstack(mats, mtm::PARALLEL)
+    *        vstack(a, b)                     vstack(mats)
+    *        block(blocks)                    blockDiagonal(mats, fill)
+    * -----------------------------
+    * hstack puts the matrices side by side, vstack one under the other. block takes rows of matrices: every
+    * row is stacked horizontally, and the rows vertically. blockDiagonal puts the matrices along the
+    * diagonal and fill everywhere else. The result dimensions are computed first and the result allocated
+    * once, then every piece is copied in whole rows (or columns) where the layouts are contiguous.
+    * The result has the first matrix's SharingPolicy, Layout and MemoryPolicy.
+    @param execution - PARALLEL splits the rows of every piece between the threads of the shared ThreadPool (default SEQUENTIAL).
+    @return new matrix.
+    @exception DimensionMismatch if the heights of matrices stacked horizontally, or the widths of matrices
+    *          stacked vertically, differ.
+    @exception IllegalInitialization if there are no matrices (or a row of blocks is empty).
+    @exception bad_alloc will be thrown if memory allocation failed (by new).
+    */
+    template <typename U>
+    friend Matrix<U> hstack(const std::vector< Matrix<U> > &mats, Execution execution);
+    template <typename U>
+    friend Matrix<U> hstack(const Matrix<U> &a, const Matrix<U> &b, Execution execution);
+    template <typename U>
+    friend Matrix<U> vstack(const std::vector< Matrix<U> > &mats, Execution execution);
+    template <typename U>
+    friend Matrix<U> vstack(const Matrix<U> &a, const Matrix<U> &b, Execution execution);
+    template <typename U>
+    friend Matrix<U> block(const std::vector< std::vector< Matrix<U> > > &blocks, Execution execution);
+    template <typename U>
+    friend Matrix<U> blockDiagonal(const std::vector< Matrix<U> > &mats, const U &fill, Execution execution);
+
+    /** functions tile / repeat - repeating a matrix.
+    * Usage: tile(mat, rows, cols)            repeat(mat, rows, cols, mtm::PARALLEL)
+    * -----------------------------
+    * tile creates the rows x cols grid of copies of mat. repeat replaces every element by a rows x cols
+    * block of copies of it (mat(i, j) lands on (i * rows + a, j * cols + b)).
+    @param execution - PARALLEL splits the work between the threads of the shared ThreadPool (default SEQUENTIAL).
+    @return new matrix of dimensions (mat.height() * rows, mat.width() * cols), with mat's SharingPolicy,
+    *       Layout and MemoryPolicy.
+    @exception IllegalInitialization if rows or cols is not positive.
+    @exception bad_alloc will be thrown if memory allocation failed (by new).
+    */
+    template <typename U>
+    friend Matrix<U> tile(const Matrix<U> &mat, int rows, int cols, Execution execution);
+    template <typename U>
+    friend Matrix<U> repeat(const Matrix<U> &mat, int rows, int cols, Execution execution);
+
         
     /**
     *operator<<
@@ -299,16 +1054,21 @@ public:
      operator* dereferncing - iterator can rewrite value, const_iterator can read only.
      basic boolean comparison operators == !=.
      if trying to access an element out of the scope of the matrix an AccessIllegalElement will be thrown.
+     writing through an iterator of a COPY_ON_WRITE matrix copies the shared buffer first.
     */
         class iterator
         {
         private:
-            T **matrix;
+            Matrix<T> *matrix;
             int row_index, col_index;
             int row_num, col_num;
             
             iterator(const Matrix<T> &mat, int row = 0, int col = 0);
             friend class Matrix<T>;
+            friend class const_iterator;
+
+            //bounds checked read access, never detaches (used by const_iterator).
+            const T &read() const;
 
         public:
             T &operator*() const;
@@ -340,7 +1100,7 @@ public:
             friend class Matrix<T>::iterator;
 
         public:
-            T operator*() const;
+            const T &operator*() const;
             const_iterator &operator++();
             const_iterator operator++(int);
 
@@ -374,7 +1134,131 @@ public:
         
     iterator end();
     const_iterator end() const;
-        
+
+
+    /**
+    * Class: BlockView<E>
+    * ------------------------
+    * View of a rectangle of a matrix (a block of Matrix::blocks): its origin, its dimensions, and access to
+    * its elements by coordinates relative to the origin. E is T for a Block (read and write) and const T
+    * for a ConstBlock (read only).
+    * A view does not own anything: it is valid as long as the matrix is not resized, assigned or copied
+    * (a copy of a COPY_ON_WRITE matrix would share the elements written through the view).
+    */
+    template <typename E>
+    class BlockView
+    {
+    private:
+        const Matrix<T> *m_Matrix;
+        E *m_Data;
+        int m_Row, m_Col;
+        int m_Height, m_Width;
+
+        BlockView(const Matrix<T> *matrix, E *data, int row, int col, int height, int width);
+        friend class Matrix<T>;
+
+    public:
+        /**
+        * Method: row / col / height / width
+        * -----------------------------
+        @return the origin of the block in the matrix, and its dimensions (the blocks of the last block row
+        *       and column may be smaller than asked).
+        */
+        int row() const;
+        int col() const;
+        int height() const;
+        int width() const;
+
+        /**
+        * Method: operator()
+        * Usage: block(row_index, col_index)
+        * -----------------------------
+        @return the element (row() + row_index, col() + col_index) of the matrix.
+        @exception AccessIllegalElement if (row_index, col_index) is not inside the block.
+        */
+        E &operator()(int row_index, int col_index) const;
+
+        /**
+        * Method: copyTo / copyFrom
+        * Usage: block.copyTo(buffer)
+        *        block.copyFrom(buffer)
+        * -----------------------------
+        * Copies the elements of the block to (from) height() * width() elements in row-major order, in the
+        * longest pieces contiguous in the matrix layout. copyFrom is available on a Block only.
+        */
+        void copyTo(typename std::remove_const<E>::type *destination) const;
+        void copyFrom(const T *source) const;
+    };
+
+    typedef BlockView<T> Block;
+    typedef BlockView<const T> ConstBlock;
+
+    /**
+    * Class: BlockRange<E>
+    * ------------------------
+    * The blocks of a matrix in a BlockOrder, as a range (for (Block block : mat.blocks(64, 64))) and by
+    * index, so the blocks can be handed to worker threads:
+    *     Matrix<T>::Blocks blocks = mat.blocks(64, 64, mtm::Z_ORDER_BLOCKS);
+    *     parallelRows(blocks.size(), 64 * 64, mtm::PARALLEL, [&](int first, int last) { ... blocks[k] ... });
+    * Threads may write different blocks of a Block range at the same time.
+    */
+    template <typename E>
+    class BlockRange
+    {
+    private:
+        const Matrix<T> *m_Matrix;
+        E *m_Data;
+        int m_BlockHeight, m_BlockWidth;
+        int m_BlockCols;
+        //block row * m_BlockCols + block column of every block, in the order of the range.
+        std::vector<int> m_Order;
+
+        BlockRange(const Matrix<T> *matrix, E *data, int block_height, int block_width, BlockOrder order);
+        friend class Matrix<T>;
+
+    public:
+        class iterator
+        {
+        private:
+            const BlockRange *m_Range;
+            int m_Index;
+
+            iterator(const BlockRange *range, int index);
+            friend class BlockRange;
+
+        public:
+            BlockView<E> operator*() const;
+            iterator &operator++();
+            iterator operator++(int);
+
+            bool operator==(const iterator &other) const;
+            bool operator!=(const iterator &other) const;
+        };
+
+        int size() const;
+        BlockView<E> operator[](int index) const;
+        iterator begin() const;
+        iterator end() const;
+    };
+
+    typedef BlockRange<T> Blocks;
+    typedef BlockRange<const T> ConstBlocks;
+
+    /** method blocks
+    * Usage: mat.blocks(64, 64)
+    *        mat.blocks(64, 64, mtm::Z_ORDER_BLOCKS)
+    * -----------------------------
+    * Cuts the matrix into block_height x block_width blocks (smaller on the last block row and column)
+    * visited in order. Blocks that are multiples of TILE_SIZE and start on TILE_SIZE boundaries read whole
+    * tiles of a TILED matrix, and block rows of a ROW_MAJOR one are contiguous runs.
+    * The non const version copies the shared buffer of a COPY_ON_WRITE matrix first, once for all the blocks.
+    @return range of Block (ConstBlock for a const matrix) views.
+    @exception IllegalInitialization if block_height or block_width is not positive.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    Blocks blocks(int block_height, int block_width, BlockOrder order = ROW_MAJOR_BLOCKS);
+    ConstBlocks blocks(int block_height, int block_width, BlockOrder order = ROW_MAJOR_BLOCKS) const;
+
     
     /**
      Exceptions for the class:
@@ -419,180 +1303,1428 @@ public:
 
 //friends functions declaration
 template<typename T>
-Matrix<T> operator+(T obj, const Matrix<T> mat);
+Matrix<T> operator+(const T &obj, const Matrix<T> &mat);
 
 template<typename T>
-Matrix<T> operator+(const Matrix<T> mat, T obj);
+Matrix<T> operator+(const Matrix<T> &mat, const T &obj);
+
+template<typename T>
+Matrix<T> operator+(const T &obj, Matrix<T> &&mat);
+
+template<typename T>
+Matrix<T> operator+(Matrix<T> &&mat, const T &obj);
 
 template <typename T>
-bool all(Matrix<T> mat);
+bool all(const Matrix<T> &mat);
 
 template <typename T>
-bool any(Matrix<T> mat);
+bool any(const Matrix<T> &mat);
 
 template <typename T>
 std::ostream &operator<<(std::ostream &os, const Matrix<T> &matrix);
 
 
 
-//Constructor allocating memory and creates a new matrix object, initializng its element to init or the default T class value.
-template<typename T>
-Matrix<T>::Matrix(Dimensions dims, const T& init):
-m_Dims(dims.getRow(), dims.getCol())
+//Storage allocates the element buffer, the creating matrix holds the first reference.
+template <typename T>
+Matrix<T>::Storage::Storage(Raw, std::size_t capacity, bool zeroed, MemoryPolicy memory) :
+data(NULL),
+count(0),
+capacity(capacity),
+references(1),
+unshareable(false),
+memory(memory),
+mapped(0),
+external(false)
 {
-    if(m_Dims.getRow() <= 0 || m_Dims.getCol() <= 0)
+    data = allocate(capacity, zeroed);
+}
+
+//A FIRST_TOUCH buffer is written even when it already holds zeros, that write is what places its pages.
+template <typename T>
+Matrix<T>::Storage::Storage(std::size_t count, const T& init, MemoryPolicy memory) :
+data(NULL),
+count(0),
+capacity(count),
+references(1),
+unshareable(false),
+memory(memory),
+mapped(0),
+external(false)
+{
+    bool zeroed = std::is_trivially_copyable<T>::value && zeroBytes(init);
+    data = allocate(count, zeroed);
+    if (!zeroed || firstTouch())
+    {
+        try{
+            fill(data, count, init, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+        }catch(...){
+            deallocate(data, mapped);
+            throw;
+        }
+    }
+    this->count = count;
+}
+
+template <typename T>
+Matrix<T>::Storage::Storage(T* data, std::size_t count, std::size_t capacity, const std::function<void(T*)> &deleter) :
+data(data),
+count(count),
+capacity(capacity),
+references(0),
+unshareable(false),
+memory(DEFAULT_MEMORY),
+mapped(0),
+external(true),
+deleter(deleter)
+{
+}
+
+//External elements are trivially copyable (Adopt and Wrap check it), so there is nothing to destroy.
+template <typename T>
+Matrix<T>::Storage::~Storage()
+{
+    if (external)
+    {
+        if (deleter)
+        {
+            deleter(data);
+        }
+        return;
+    }
+    destroy(data, count, std::integral_constant<bool, std::is_trivially_destructible<T>::value>());
+    deallocate(data, mapped);
+}
+
+template <typename T>
+typename Matrix<T>::Storage* Matrix<T>::Storage::duplicate() const
+{
+    Storage* storage = new Storage(Raw(), count, false, memory);
+    try{
+        storage->copy(storage->data, count, data, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+        storage->count = count;
+        storage->tile_slots = tile_slots;
+        storage->tile_origins = tile_origins;
+    }catch(...){
+        delete storage;
+        throw;
+    }
+    return storage;
+}
+
+template <typename T>
+T* Matrix<T>::Storage::allocate(std::size_t capacity, bool zeroed)
+{
+    if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T))
+    {
+        throw std::bad_alloc();
+    }
+    std::size_t bytes = capacity * sizeof(T);
+    void* elements = NULL;
+    mapped = 0;
+    if (memory != DEFAULT_MEMORY && bytes >= LARGE_ALLOCATION)
+    {
+        elements = allocatePages(bytes, memory);
+        mapped = (elements != NULL) ? bytes : 0;
+    }
+    if (elements == NULL)
+    {
+        elements = zeroed ? std::calloc(capacity, sizeof(T)) : std::malloc(bytes);
+    }
+    if (elements == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(elements);
+}
+
+template <typename T>
+void Matrix<T>::Storage::deallocate(T* data, std::size_t mapped)
+{
+    if (mapped != 0)
+    {
+        releasePages(data, mapped);
+    }
+    else
+    {
+        std::free(data);
+    }
+}
+
+//Elements that are not trivially copyable are moved into the new allocation, then the moved from ones destroyed.
+//An external buffer is handed to its deleter instead.
+template <typename T>
+void Matrix<T>::Storage::relocate(std::size_t capacity)
+{
+    T* old_data = data;
+    std::size_t old_mapped = mapped;
+    T* new_data = NULL;
+    try{
+        new_data = allocate(capacity, false);
+    }catch(...){
+        mapped = old_mapped;
+        throw;
+    }
+    try{
+        if (std::is_trivially_copyable<T>::value)
+        {
+            copy(new_data, count, old_data, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+        }
+        else
+        {
+            std::uninitialized_copy(std::make_move_iterator(old_data), std::make_move_iterator(old_data + count),
+                                    new_data);
+        }
+    }catch(...){
+        deallocate(new_data, mapped);
+        mapped = old_mapped;
+        throw;
+    }
+    if (external)
+    {
+        if (deleter)
+        {
+            deleter(old_data);
+        }
+        external = false;
+        deleter = nullptr;
+    }
+    else
+    {
+        destroy(old_data, count, std::integral_constant<bool, std::is_trivially_destructible<T>::value>());
+        deallocate(old_data, old_mapped);
+    }
+    data = new_data;
+    this->capacity = capacity;
+}
+
+template <typename T>
+void Matrix<T>::Storage::resize(std::size_t count, const T& init)
+{
+    if (count < this->count)
+    {
+        destroy(data + count, this->count - count,
+                std::integral_constant<bool, std::is_trivially_destructible<T>::value>());
+    }
+    else if (count > this->count)
+    {
+        fill(data + this->count, count - this->count, init,
+             std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+    }
+    this->count = count;
+}
+
+template <typename T>
+bool Matrix<T>::Storage::firstTouch() const
+{
+    return memory == FIRST_TOUCH && mapped != 0 && std::is_trivially_copyable<T>::value;
+}
+
+//body(first, last) over [0, count) split in 4 bands per pool thread, rounded to whole LARGE_ALLOCATION
+//pages so no page is shared by two workers. The workers claim the bands as they go: the pages are spread
+//over the workers' nodes, but a band is not tied to the worker that will later process those rows.
+template <typename T>
+template <typename F>
+void Matrix<T>::Storage::inBands(std::size_t count, F body) const
+{
+    ThreadPool& pool = ThreadPool::instance();
+    std::size_t page = LARGE_ALLOCATION / sizeof(T) > 0 ? LARGE_ALLOCATION / sizeof(T) : 1;
+    std::size_t bands = 4 * (std::size_t)pool.size();
+    std::size_t band = ((count + bands - 1) / bands + page - 1) / page * page;
+    int parts = (int)((count + band - 1) / band);
+    pool.parallelFor(0, parts, 1, [body, band, count](int first, int last)
+    {
+        body((std::size_t)first * band, std::min((std::size_t)last * band, count));
+    });
+}
+
+//true when every byte of value is 0, so calloc'ed memory already holds copies of it.
+template <typename T>
+bool Matrix<T>::Storage::zeroBytes(const T& value)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (std::size_t i = 0; i < sizeof(T); i++)
+    {
+        if (bytes[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void Matrix<T>::Storage::fill(T* data, std::size_t count, const T& init, std::true_type)
+{
+    if (firstTouch())
+    {
+        const T value = init;
+        inBands(count, [data, value](std::size_t first, std::size_t last)
+        {
+            std::fill(data + first, data + last, value);
+        });
+        return;
+    }
+    if (sizeof(T) == 1)
+    {
+        std::memset(static_cast<void*>(data), *reinterpret_cast<const unsigned char*>(&init), count);
+        return;
+    }
+    std::fill_n(data, count, init);
+}
+
+template <typename T>
+void Matrix<T>::Storage::fill(T* data, std::size_t count, const T& init, std::false_type)
+{
+    std::uninitialized_fill_n(data, count, init);
+}
+
+template <typename T>
+void Matrix<T>::Storage::copy(T* data, std::size_t count, const T* source, std::true_type)
+{
+    if (firstTouch())
+    {
+        inBands(count, [data, source](std::size_t first, std::size_t last)
+        {
+            std::memcpy(static_cast<void*>(data + first), static_cast<const void*>(source + first),
+                        (last - first) * sizeof(T));
+        });
+        return;
+    }
+    std::memcpy(static_cast<void*>(data), static_cast<const void*>(source), count * sizeof(T));
+}
+
+template <typename T>
+void Matrix<T>::Storage::copy(T* data, std::size_t count, const T* source, std::false_type)
+{
+    std::uninitialized_copy(source, source + count, data);
+}
+
+template <typename T>
+void Matrix<T>::Storage::destroy(T*, std::size_t, std::true_type)
+{
+}
+
+template <typename T>
+void Matrix<T>::Storage::destroy(T* data, std::size_t count, std::false_type)
+{
+    for (std::size_t k = 0; k < count; k++)
+    {
+        data[k].~T();
+    }
+}
+
+
+//Constructor allocating memory and creates a new matrix object, initializng its element to init or the default T class value.
+template<typename T>
+Matrix<T>::Matrix(Dimensions dims, const T& init, SharingPolicy sharing, Layout layout, MemoryPolicy memory):
+m_Dims(dims.getRow(), dims.getCol()),
+m_Storage(NULL),
+m_Sharing(sharing),
+m_Layout(layout),
+m_Memory(memory)
+{
+    if(m_Dims.getRow() <= 0 || m_Dims.getCol() <= 0)
+    {
+        Matrix<T>::IllegalInitialization error;
+        throw error;
+    }
+
+    m_Storage = new Storage(count(), init, m_Memory);
+    try{
+        if (m_Layout == TILED)
+        {
+            placeTiles();
+        }
+    }catch(...){
+        delete m_Storage;
+        throw;
+    }
+}
+
+template<typename T>
+Matrix<T>::Matrix(Storage* storage, Dimensions dims, SharingPolicy sharing, Layout layout):
+m_Dims(dims),
+m_Storage(storage),
+m_Sharing(sharing),
+m_Layout(layout),
+m_Memory(storage->memory)
+{
+    m_Storage->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+//Destructor frees all allocated memory (unless still shared), item cannot be accessed afterwards.
+template <typename T>
+Matrix<T>::~Matrix()
+{
+    //    std::cout<<"Destructor in action"<<std::endl;
+    release();
+}
+
+
+//Copy constructor provides deep copy by value and not by reference - creates a new identical matrix in differen part of the memory.
+//COPY_ON_WRITE matrices only take another reference to the same buffer.
+template <typename T>
+Matrix<T>::Matrix(const Matrix &other):
+m_Dims(other.m_Dims),
+m_Storage(other.m_Storage),
+m_Sharing(other.m_Sharing),
+m_Layout(other.m_Layout),
+m_Memory(other.m_Memory)
+{
+    m_Storage = (m_Sharing == COPY_ON_WRITE) ? other.share() : other.m_Storage->duplicate();
+}
+
+
+//Move constructor steals the buffer, the moved from matrix is left with no elements.
+template <typename T>
+Matrix<T>::Matrix(Matrix &&other) noexcept:
+m_Dims(other.m_Dims),
+m_Storage(other.m_Storage),
+m_Sharing(other.m_Sharing),
+m_Layout(other.m_Layout),
+m_Memory(other.m_Memory)
+{
+    other.m_Dims = Dimensions(0, 0);
+    other.m_Storage = NULL;
+}
+
+
+//assignment operator used to create a new matrix copy or reassignig matrix object. release memory of exisiting object.
+template <typename T>
+Matrix<T>& Matrix<T>::operator=(Matrix const &other)
+{
+    Storage* storage = (other.m_Sharing == COPY_ON_WRITE) ? other.share() : other.m_Storage->duplicate();
+
+    release();
+    m_Dims = other.m_Dims;
+    m_Storage = storage;
+    m_Sharing = other.m_Sharing;
+    m_Layout = other.m_Layout;
+    m_Memory = other.m_Memory;
+    return *this;
+           
+}
+
+
+template <typename T>
+Matrix<T>& Matrix<T>::operator=(Matrix &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_Dims = other.m_Dims;
+        m_Storage = other.m_Storage;
+        m_Sharing = other.m_Sharing;
+        m_Layout = other.m_Layout;
+        m_Memory = other.m_Memory;
+        other.m_Dims = Dimensions(0, 0);
+        other.m_Storage = NULL;
+    }
+    return *this;
+}
+
+
+template <typename T>
+std::size_t Matrix<T>::count() const
+{
+    if (m_Layout == TILED)
+    {
+        return (std::size_t)tileRows() * tileCols() * TILE_SIZE * TILE_SIZE;
+    }
+    return (std::size_t)m_Dims.getRow() * (std::size_t)m_Dims.getCol();
+}
+
+template <typename T>
+void Matrix<T>::release()
+{
+    if (m_Storage != NULL && m_Storage->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        delete m_Storage;
+    }
+    m_Storage = NULL;
+}
+
+//A buffer referenced only by this matrix can not gain new references concurrently (only its owner copies it),
+//so a count of 1 means the buffer may be written in place.
+template <typename T>
+void Matrix<T>::detach()
+{
+    if (m_Storage->references.load(std::memory_order_acquire) == 1)
+    {
+        return;
+    }
+    Storage* storage = m_Storage->duplicate();
+    release();
+    m_Storage = storage;
+}
+
+template <typename T>
+bool Matrix<T>::ownsBuffer() const
+{
+    return m_Storage->references.load(std::memory_order_acquire) == 1;
+}
+
+//The duplicate comes back with its reference taken, like a shared buffer, and starts out shareable.
+template <typename T>
+typename Matrix<T>::Storage* Matrix<T>::share() const
+{
+    if (m_Storage->unshareable)
+    {
+        return m_Storage->duplicate();
+    }
+    m_Storage->references.fetch_add(1, std::memory_order_relaxed);
+    return m_Storage;
+}
+
+template <typename T>
+void Matrix<T>::spliceRuns(int position, int inserted, int erased, const T& fill)
+{
+    bool rows = (m_Layout == ROW_MAJOR);
+    std::size_t length = rows ? m_Dims.getCol() : m_Dims.getRow();
+    std::size_t old_count = m_Storage->count;
+    std::size_t start = (std::size_t)position * length;
+    std::size_t new_count = old_count + inserted * length - erased * length;
+    if (inserted > erased)
+    {
+        if (new_count > m_Storage->capacity)
+        {
+            m_Storage->relocate(std::max(new_count, 2 * m_Storage->capacity));
+        }
+        m_Storage->resize(new_count, fill);
+        T* data = m_Storage->data;
+        std::move_backward(data + start + erased * length, data + old_count, data + new_count);
+    }
+    else
+    {
+        T* data = m_Storage->data;
+        std::move(data + start + erased * length, data + old_count, data + start + inserted * length);
+        m_Storage->resize(new_count, fill);
+    }
+    std::fill(m_Storage->data + start, m_Storage->data + start + inserted * length, fill);
+    int runs = (rows ? m_Dims.getRow() : m_Dims.getCol()) + inserted - erased;
+    m_Dims = rows ? Dimensions(runs, m_Dims.getCol()) : Dimensions(m_Dims.getRow(), runs);
+}
+
+//Old row i lands on row i (before position), nowhere (erased) or i - erased + inserted. Those targets are
+//consecutive, so ROW_MAJOR rows, COLUMN_MAJOR column segments and TILED tile rows move as whole runs.
+template <typename T>
+void Matrix<T>::rebuild(Dimensions dims, int position, int inserted, int erased, const T& fill)
+{
+    Matrix grown(dims, fill, m_Sharing, m_Layout, m_Memory);
+    T* to = grown.elements();
+    T* from = m_Storage->data;
+    bool owned = ownsBuffer();
+    int rows = m_Dims.getRow();
+    int cols = std::min(m_Dims.getCol(), dims.getCol());
+    auto target = [position, inserted, erased](int row_index)
+    {
+        return row_index < position ? row_index : (row_index < position + erased ? -1 : row_index - erased + inserted);
+    };
+    auto transfer = [owned](T* source, int length, T* destination)
+    {
+        if (owned)
+        {
+            std::move(source, source + length, destination);
+        }
+        else
+        {
+            std::copy(source, source + length, destination);
+        }
+    };
+    switch (m_Layout)
+    {
+        case ROW_MAJOR:
+            for (int i = 0; i < rows; i++)
+            {
+                int row_index = target(i);
+                if (row_index >= 0 && row_index < dims.getRow())
+                {
+                    transfer(from + offset(i, 0), cols, to + grown.offset(row_index, 0));
+                }
+            }
+            break;
+        case COLUMN_MAJOR:
+            for (int j = 0; j < cols; j++)
+            {
+                int kept = std::min(position, dims.getRow());
+                transfer(from + offset(0, j), kept, to + grown.offset(0, j));
+                int moved = std::min(rows - position - erased, dims.getRow() - position - inserted);
+                if (moved > 0)
+                {
+                    transfer(from + offset(position + erased, j), moved, to + grown.offset(position + inserted, j));
+                }
+            }
+            break;
+        default:
+            for (int run = 0; run < runCount(); run++)
+            {
+                int origin = m_Storage->tile_origins[run / TILE_SIZE];
+                int col_index = (origin % tileCols()) * TILE_SIZE;
+                int length = std::min(runLength(run), cols - col_index);
+                int row_index = target((origin / tileCols()) * TILE_SIZE + run % TILE_SIZE);
+                if (length > 0 && row_index >= 0 && row_index < dims.getRow())
+                {
+                    transfer(from + runOffset(run), length, to + grown.offset(row_index, col_index));
+                }
+            }
+    }
+    *this = std::move(grown);
+}
+
+template <typename T>
+T* Matrix<T>::elements()
+{
+    detach();
+    return m_Storage->data;
+}
+
+template <typename T>
+const T* Matrix<T>::elements() const
+{
+    return m_Storage->data;
+}
+
+template <typename T>
+T* Matrix<T>::exposeElements()
+{
+    T* data = elements();
+    m_Storage->unshareable = true;
+    return data;
+}
+
+
+template <typename T>
+const int Matrix<T>::TILE_SIZE;
+
+template <typename T>
+int Matrix<T>::tileRows() const
+{
+    return (m_Dims.getRow() + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+template <typename T>
+int Matrix<T>::tileCols() const
+{
+    return (m_Dims.getCol() + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+//Spreads the low 32 bits of value to the even bit positions, used to interleave tile coordinates.
+inline unsigned long long spreadBits(unsigned long long value)
+{
+    value &= 0xFFFFFFFFULL;
+    value = (value | (value << 16)) & 0x0000FFFF0000FFFFULL;
+    value = (value | (value << 8)) & 0x00FF00FF00FF00FFULL;
+    value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    value = (value | (value << 2)) & 0x3333333333333333ULL;
+    value = (value | (value << 1)) & 0x5555555555555555ULL;
+    return value;
+}
+
+//Orders the tiles by their Morton code. The codes of a non square tile grid have gaps, so the tiles
+//are ranked instead of placed at their code, which keeps the buffer free of unused tiles.
+template <typename T>
+void Matrix<T>::placeTiles()
+{
+    int rows = tileRows();
+    int cols = tileCols();
+    std::vector< std::pair<unsigned long long, int> > codes;
+    codes.reserve((std::size_t)rows * cols);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            codes.push_back(std::make_pair((spreadBits(i) << 1) | spreadBits(j), i * cols + j));
+        }
+    }
+    std::sort(codes.begin(), codes.end());
+    m_Storage->tile_slots.assign(codes.size(), 0);
+    m_Storage->tile_origins.assign(codes.size(), 0);
+    for (std::size_t slot = 0; slot < codes.size(); slot++)
+    {
+        m_Storage->tile_slots[codes[slot].second] = slot;
+        m_Storage->tile_origins[slot] = codes[slot].second;
+    }
+}
+
+template <typename T>
+std::size_t Matrix<T>::offset(int row_index, int col_index) const
+{
+    switch (m_Layout)
+    {
+        case ROW_MAJOR:
+            return (std::size_t)row_index * m_Dims.getCol() + col_index;
+        case COLUMN_MAJOR:
+            return (std::size_t)col_index * m_Dims.getRow() + row_index;
+        default:
+            std::size_t tile = m_Storage->tile_slots[(row_index / TILE_SIZE) * tileCols() + col_index / TILE_SIZE];
+            return (tile * TILE_SIZE + row_index % TILE_SIZE) * TILE_SIZE + col_index % TILE_SIZE;
+    }
+}
+
+template <typename T>
+int Matrix<T>::runCount() const
+{
+    switch (m_Layout)
+    {
+        case ROW_MAJOR:
+            return m_Dims.getRow();
+        case COLUMN_MAJOR:
+            return m_Dims.getCol();
+        default:
+            return tileRows() * tileCols() * TILE_SIZE;
+    }
+}
+
+template <typename T>
+int Matrix<T>::runLength(int run) const
+{
+    switch (m_Layout)
+    {
+        case ROW_MAJOR:
+            return m_Dims.getCol();
+        case COLUMN_MAJOR:
+            return m_Dims.getRow();
+        default:
+            int origin = m_Storage->tile_origins[run / TILE_SIZE];
+            int row_index = (origin / tileCols()) * TILE_SIZE + run % TILE_SIZE;
+            int col_index = (origin % tileCols()) * TILE_SIZE;
+            if (row_index >= m_Dims.getRow())
+            {
+                return 0;
+            }
+            return std::min(TILE_SIZE, m_Dims.getCol() - col_index);
+    }
+}
+
+template <typename T>
+std::size_t Matrix<T>::runOffset(int run) const
+{
+    switch (m_Layout)
+    {
+        case ROW_MAJOR:
+            return (std::size_t)run * m_Dims.getCol();
+        case COLUMN_MAJOR:
+            return (std::size_t)run * m_Dims.getRow();
+        default:
+            return (std::size_t)run * TILE_SIZE;
+    }
+}
+
+
+template <typename T>
+template <typename R, typename F>
+void Matrix<T>::transform(Matrix<R> &out, const Matrix &a, F operation, Execution execution)
+{
+    R* to = out.elements();
+    const T* from = a.elements();
+    if (out.m_Layout == a.m_Layout)
+    {
+        parallelRows(a.runCount(), a.runLength(0), execution, [&](int first, int last)
+        {
+            for (int run = first; run < last; run++)
+            {
+                std::size_t start = a.runOffset(run);
+                int length = a.runLength(run);
+                R* out_run = to + start;
+                const T* in_run = from + start;
+                for (int k = 0; k < length; k++)
+                {
+                    out_run[k] = operation(in_run[k]);
+                }
+            }
+        });
+        return;
+    }
+    int rows = a.height();
+    int cols = a.width();
+    parallelRows((rows + TILE_SIZE - 1) / TILE_SIZE, cols * TILE_SIZE, execution, [&](int first, int last)
+    {
+        for (int row_block = first * TILE_SIZE; row_block < std::min(rows, last * TILE_SIZE); row_block += TILE_SIZE)
+        {
+            for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+            {
+                for (int i = row_block; i < std::min(rows, row_block + TILE_SIZE); i++)
+                {
+                    for (int j = col_block; j < std::min(cols, col_block + TILE_SIZE); j++)
+                    {
+                        to[out.offset(i, j)] = operation(from[a.offset(i, j)]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+template <typename R, typename U, typename F>
+void Matrix<T>::transform(Matrix<R> &out, const Matrix &a, const Matrix<U> &b, F operation, Execution execution)
+{
+    R* to = out.elements();
+    const T* lhs = a.elements();
+    const U* rhs = b.elements();
+    if (out.m_Layout == a.m_Layout && a.m_Layout == b.m_Layout)
     {
-        Matrix<T>::IllegalInitialization error;
+        parallelRows(a.runCount(), a.runLength(0), execution, [&](int first, int last)
+        {
+            for (int run = first; run < last; run++)
+            {
+                std::size_t start = a.runOffset(run);
+                int length = a.runLength(run);
+                R* out_run = to + start;
+                const T* lhs_run = lhs + start;
+                const U* rhs_run = rhs + start;
+                for (int k = 0; k < length; k++)
+                {
+                    out_run[k] = operation(lhs_run[k], rhs_run[k]);
+                }
+            }
+        });
+        return;
+    }
+    int rows = a.height();
+    int cols = a.width();
+    parallelRows((rows + TILE_SIZE - 1) / TILE_SIZE, cols * TILE_SIZE, execution, [&](int first, int last)
+    {
+        for (int row_block = first * TILE_SIZE; row_block < std::min(rows, last * TILE_SIZE); row_block += TILE_SIZE)
+        {
+            for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+            {
+                for (int i = row_block; i < std::min(rows, row_block + TILE_SIZE); i++)
+                {
+                    for (int j = col_block; j < std::min(cols, col_block + TILE_SIZE); j++)
+                    {
+                        to[out.offset(i, j)] = operation(lhs[a.offset(i, j)], rhs[b.offset(i, j)]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+template <typename T>
+template <typename R, typename F>
+void Matrix<T>::transform(Matrix<R> &out, const Matrix &a, const Matrix &b, const Matrix &c, F operation,
+                          Execution execution)
+{
+    R* to = out.elements();
+    const T* first_in = a.elements();
+    const T* second_in = b.elements();
+    const T* third_in = c.elements();
+    if (out.m_Layout == a.m_Layout && a.m_Layout == b.m_Layout && b.m_Layout == c.m_Layout)
+    {
+        parallelRows(a.runCount(), a.runLength(0), execution, [&](int first, int last)
+        {
+            for (int run = first; run < last; run++)
+            {
+                std::size_t start = a.runOffset(run);
+                int length = a.runLength(run);
+                R* out_run = to + start;
+                const T* first_run = first_in + start;
+                const T* second_run = second_in + start;
+                const T* third_run = third_in + start;
+                for (int k = 0; k < length; k++)
+                {
+                    out_run[k] = operation(first_run[k], second_run[k], third_run[k]);
+                }
+            }
+        });
+        return;
+    }
+    int rows = a.height();
+    int cols = a.width();
+    parallelRows((rows + TILE_SIZE - 1) / TILE_SIZE, cols * TILE_SIZE, execution, [&](int first, int last)
+    {
+        for (int row_block = first * TILE_SIZE; row_block < std::min(rows, last * TILE_SIZE); row_block += TILE_SIZE)
+        {
+            for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+            {
+                for (int i = row_block; i < std::min(rows, row_block + TILE_SIZE); i++)
+                {
+                    for (int j = col_block; j < std::min(cols, col_block + TILE_SIZE); j++)
+                    {
+                        to[out.offset(i, j)] = operation(first_in[a.offset(i, j)], second_in[b.offset(i, j)],
+                                                         third_in[c.offset(i, j)]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+
+template <typename T>
+template <typename F>
+void Matrix<T>::update(Matrix &a, F operation)
+{
+    T* elements = a.elements();
+    for (int run = 0; run < a.runCount(); run++)
+    {
+        T* run_elements = elements + a.runOffset(run);
+        int length = a.runLength(run);
+        for (int k = 0; k < length; k++)
+        {
+            operation(run_elements[k]);
+        }
+    }
+}
+
+template <typename T>
+template <typename F>
+void Matrix<T>::update(Matrix &a, const Matrix &b, F operation)
+{
+    T* to = a.elements();
+    const T* from = b.elements();
+    if (a.m_Layout == b.m_Layout)
+    {
+        for (int run = 0; run < a.runCount(); run++)
+        {
+            std::size_t start = a.runOffset(run);
+            int length = a.runLength(run);
+            for (int k = 0; k < length; k++)
+            {
+                operation(to[start + k], from[start + k]);
+            }
+        }
+        return;
+    }
+    for (int row_block = 0; row_block < a.height(); row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < a.width(); col_block += TILE_SIZE)
+        {
+            for (int i = row_block; i < std::min(a.height(), row_block + TILE_SIZE); i++)
+            {
+                for (int j = col_block; j < std::min(a.width(), col_block + TILE_SIZE); j++)
+                {
+                    operation(to[a.offset(i, j)], from[b.offset(i, j)]);
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void Matrix<T>::addRuns(Matrix &out, const Matrix &a, const Matrix &b)
+{
+    T* to = out.elements();
+    const T* lhs = a.elements();
+    const T* rhs = b.elements();
+    for (int run = 0; run < a.runCount(); run++)
+    {
+        std::size_t start = a.runOffset(run);
+        addRun(lhs + start, rhs + start, to + start, a.runLength(run));
+    }
+}
+
+template <typename T>
+void Matrix<T>::compareRuns(Matrix<bool> &out, const Matrix &a, const T &value, Comparison comparison)
+{
+    bool* to = out.elements();
+    const T* from = a.elements();
+    for (int run = 0; run < a.runCount(); run++)
+    {
+        std::size_t start = a.runOffset(run);
+        compareRun(from + start, value, to + start, a.runLength(run), comparison);
+    }
+}
+
+
+//Providing basic dimension information
+template <typename T>
+int Matrix<T>::height() const
+{
+    return m_Dims.getRow();
+}
+
+template <typename T>
+int Matrix<T>::width() const
+{
+    return m_Dims.getCol();
+}
+
+template <typename T>
+int Matrix<T>::size() const
+{
+    return ( m_Dims.getRow() * m_Dims.getCol() );
+}
+
+
+template <typename T>
+SharingPolicy Matrix<T>::sharing() const
+{
+    return m_Sharing;
+}
+
+template <typename T>
+void Matrix<T>::setSharing(SharingPolicy sharing)
+{
+    if (sharing == DEEP_COPY)
+    {
+        detach();
+    }
+    m_Sharing = sharing;
+}
+
+
+template <typename T>
+Layout Matrix<T>::layout() const
+{
+    return m_Layout;
+}
+
+template <typename T>
+MemoryPolicy Matrix<T>::memory() const
+{
+    return m_Memory;
+}
+
+template <typename T>
+T* Matrix<T>::data()
+{
+    if (m_Layout == TILED)
+    {
+        AccessIllegalElement error;
         throw error;
     }
+    return exposeElements();
+}
 
-    
-    m_Array = new T *[m_Dims.getRow()];
+template <typename T>
+const T* Matrix<T>::data() const
+{
+    if (m_Layout == TILED)
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    return elements();
+}
+
+template <typename T>
+std::size_t Matrix<T>::rowStride() const
+{
+    return (m_Layout == COLUMN_MAJOR) ? 1 : (std::size_t)m_Dims.getCol();
+}
+
+template <typename T>
+std::size_t Matrix<T>::colStride() const
+{
+    return (m_Layout == COLUMN_MAJOR) ? (std::size_t)m_Dims.getRow() : 1;
+}
+
+#if __cplusplus >= 202002L
+template <typename T>
+std::span<T> Matrix<T>::span()
+{
+    return std::span<T>(data(), (std::size_t)size());
+}
+
+template <typename T>
+std::span<const T> Matrix<T>::span() const
+{
+    return std::span<const T>(data(), (std::size_t)size());
+}
+#endif
+
+#ifdef __cpp_lib_mdspan
+template <typename T>
+std::mdspan<T, std::dextents<std::size_t, 2>, std::layout_stride> Matrix<T>::mdspan()
+{
+    std::dextents<std::size_t, 2> extents(m_Dims.getRow(), m_Dims.getCol());
+    std::array<std::size_t, 2> strides = { rowStride(), colStride() };
+    return std::mdspan<T, std::dextents<std::size_t, 2>, std::layout_stride>(
+        data(), std::layout_stride::mapping<std::dextents<std::size_t, 2> >(extents, strides));
+}
+
+template <typename T>
+std::mdspan<const T, std::dextents<std::size_t, 2>, std::layout_stride> Matrix<T>::mdspan() const
+{
+    std::dextents<std::size_t, 2> extents(m_Dims.getRow(), m_Dims.getCol());
+    std::array<std::size_t, 2> strides = { rowStride(), colStride() };
+    return std::mdspan<const T, std::dextents<std::size_t, 2>, std::layout_stride>(
+        data(), std::layout_stride::mapping<std::dextents<std::size_t, 2> >(extents, strides));
+}
+#endif
 
-    for (int i = 0; i < m_Dims.getRow(); i++)
+template <typename T>
+Matrix<T> Matrix<T>::toLayout(Layout layout) const &
+{
+    if (layout == m_Layout)
     {
-        try{
-            m_Array[i] = new T[m_Dims.getCol()];
-        
-        
-            for (int j = 0; j < m_Dims.getCol(); j++)
+        return *this;
+    }
+    Matrix<T> converted(m_Dims, T(), m_Sharing, layout, m_Memory);
+    if (m_Layout == TILED || layout == TILED)
+    {
+        transform(converted, *this, [](const T &element) { return element; }, SEQUENTIAL);
+        return converted;
+    }
+    //between ROW_MAJOR and COLUMN_MAJOR the buffer is transposed, as a (rows x cols) or (cols x rows) array.
+    int rows = (m_Layout == ROW_MAJOR) ? m_Dims.getRow() : m_Dims.getCol();
+    int cols = (m_Layout == ROW_MAJOR) ? m_Dims.getCol() : m_Dims.getRow();
+    T* to = converted.elements();
+    const T* from = elements();
+    for (int row_block = 0; row_block < rows; row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+        {
+            transposeBlock(from + (std::size_t)row_block * cols + col_block, cols,
+                           to + (std::size_t)col_block * rows + row_block, rows, std::min(TILE_SIZE, rows - row_block),
+                           std::min(TILE_SIZE, cols - col_block));
+        }
+    }
+    return converted;
+}
+
+//A temporary that owns its buffer hands its elements over instead of copying them.
+template <typename T>
+Matrix<T> Matrix<T>::toLayout(Layout layout) &&
+{
+    if (layout == m_Layout)
+    {
+        return std::move(*this);
+    }
+    if (std::is_trivially_copyable<T>::value || m_Storage->references.load(std::memory_order_acquire) != 1)
+    {
+        return static_cast<const Matrix &>(*this).toLayout(layout);
+    }
+    Matrix<T> converted(m_Dims, T(), m_Sharing, layout, m_Memory);
+    T* to = converted.elements();
+    T* from = m_Storage->data;
+    for (int row_block = 0; row_block < m_Dims.getRow(); row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < m_Dims.getCol(); col_block += TILE_SIZE)
+        {
+            for (int i = row_block; i < std::min(m_Dims.getRow(), row_block + TILE_SIZE); i++)
             {
-                m_Array[i][j] = init;
+                for (int j = col_block; j < std::min(m_Dims.getCol(), col_block + TILE_SIZE); j++)
+                {
+                    to[converted.offset(i, j)] = std::move(from[offset(i, j)]);
+                }
             }
-            
-        }catch(std::bad_alloc& e){
-            for(int k = 0; k < i; k++){
-                delete[] m_Array[k];
+        }
+    }
+    return converted;
+}
+
+
+template <typename T>
+void Matrix<T>::copyTo(T* destination) const
+{
+    const T* from = elements();
+    if (m_Layout == ROW_MAJOR)
+    {
+        std::copy(from, from + count(), destination);
+        return;
+    }
+    int rows = m_Dims.getRow();
+    int cols = m_Dims.getCol();
+    for (int row_block = 0; row_block < rows; row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+        {
+            for (int i = row_block; i < std::min(rows, row_block + TILE_SIZE); i++)
+            {
+                for (int j = col_block; j < std::min(cols, col_block + TILE_SIZE); j++)
+                {
+                    destination[(std::size_t)i * cols + j] = from[offset(i, j)];
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void Matrix<T>::copyFrom(const T* source)
+{
+    T* to = elements();
+    if (m_Layout == ROW_MAJOR)
+    {
+        std::copy(source, source + count(), to);
+        return;
+    }
+    int rows = m_Dims.getRow();
+    int cols = m_Dims.getCol();
+    for (int row_block = 0; row_block < rows; row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < cols; col_block += TILE_SIZE)
+        {
+            for (int i = row_block; i < std::min(rows, row_block + TILE_SIZE); i++)
+            {
+                for (int j = col_block; j < std::min(cols, col_block + TILE_SIZE); j++)
+                {
+                    to[offset(i, j)] = source[(std::size_t)i * cols + j];
+                }
             }
-            delete[] m_Array;
-            throw e;
         }
     }
 }
 
-
-//Destructor frees all allocated memory, item cannot be accessed afterwards.
+
+template <typename T>
+int Matrix<T>::capacity() const
+{
+    return (int)m_Storage->capacity;
+}
+
+template <typename T>
+void Matrix<T>::reserve(Dimensions dims)
+{
+    if (dims.getRow() <= 0 || dims.getCol() <= 0)
+    {
+        IllegalInitialization error;
+        throw error;
+    }
+    std::size_t needed = (std::size_t)dims.getRow() * dims.getCol();
+    if (m_Layout == TILED)
+    {
+        needed = (std::size_t)((dims.getRow() + TILE_SIZE - 1) / TILE_SIZE) *
+                 ((dims.getCol() + TILE_SIZE - 1) / TILE_SIZE) * TILE_SIZE * TILE_SIZE;
+    }
+    if (needed > m_Storage->capacity)
+    {
+        detach();
+        m_Storage->relocate(needed);
+    }
+}
+
+template <typename T>
+void Matrix<T>::shrinkToFit()
+{
+    if (m_Storage->capacity > m_Storage->count && ownsBuffer())
+    {
+        m_Storage->relocate(m_Storage->count);
+    }
+}
+
+//Changes along the runs of a ROW_MAJOR (COLUMN_MAJOR) matrix splice whole rows (columns) at the end.
+template <typename T>
+void Matrix<T>::resize(Dimensions dims, const T &fill)
+{
+    if (dims.getRow() <= 0 || dims.getCol() <= 0)
+    {
+        IllegalInitialization error;
+        throw error;
+    }
+    int rows = m_Dims.getRow();
+    int cols = m_Dims.getCol();
+    if (dims == m_Dims)
+    {
+        return;
+    }
+    if (ownsBuffer() && m_Layout == ROW_MAJOR && dims.getCol() == cols)
+    {
+        spliceRuns(std::min(rows, dims.getRow()), std::max(0, dims.getRow() - rows), std::max(0, rows - dims.getRow()),
+                   fill);
+        return;
+    }
+    if (ownsBuffer() && m_Layout == COLUMN_MAJOR && dims.getRow() == rows)
+    {
+        spliceRuns(std::min(cols, dims.getCol()), std::max(0, dims.getCol() - cols), std::max(0, cols - dims.getCol()),
+                   fill);
+        return;
+    }
+    rebuild(dims, std::min(rows, dims.getRow()), std::max(0, dims.getRow() - rows), std::max(0, rows - dims.getRow()),
+            fill);
+}
+
+//A TILED matrix whose last row (column) of tiles has padding left grows into it without moving anything.
+template <typename T>
+void Matrix<T>::appendRow(const std::vector<T> &values)
+{
+    int rows = m_Dims.getRow();
+    int cols = m_Dims.getCol();
+    if (values.size() != (std::size_t)cols)
+    {
+        DimensionMismatch error(Dimensions(1, (int)values.size()), Dimensions(1, cols));
+        throw error;
+    }
+    if (ownsBuffer() && m_Layout == ROW_MAJOR)
+    {
+        spliceRuns(rows, 1, 0, T());
+    }
+    else if (ownsBuffer() && m_Layout == TILED && rows % TILE_SIZE != 0)
+    {
+        m_Dims = Dimensions(rows + 1, cols);
+    }
+    else
+    {
+        rebuild(Dimensions(rows + 1, cols), rows, 1, 0, T());
+    }
+    T* data = elements();
+    for (int j = 0; j < cols; j++)
+    {
+        data[offset(rows, j)] = values[j];
+    }
+}
+
 template <typename T>
-Matrix<T>::~Matrix()
+void Matrix<T>::appendCol(const std::vector<T> &values)
 {
-    //    std::cout<<"Destructor in action"<<std::endl;
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    int rows = m_Dims.getRow();
+    int cols = m_Dims.getCol();
+    if (values.size() != (std::size_t)rows)
+    {
+        DimensionMismatch error(Dimensions((int)values.size(), 1), Dimensions(rows, 1));
+        throw error;
+    }
+    if (ownsBuffer() && m_Layout == COLUMN_MAJOR)
+    {
+        spliceRuns(cols, 1, 0, T());
+    }
+    else if (ownsBuffer() && m_Layout == TILED && cols % TILE_SIZE != 0)
+    {
+        m_Dims = Dimensions(rows, cols + 1);
+    }
+    else
+    {
+        rebuild(Dimensions(rows, cols + 1), rows, 0, 0, T());
+    }
+    T* data = elements();
+    for (int i = 0; i < rows; i++)
     {
-        delete[] m_Array[i];
+        data[offset(i, cols)] = values[i];
     }
-    delete[] m_Array;
 }
 
-
-//Copy constructor provides deep copy by value and not by reference - creates a new identical matrix in differen part of the memory.
 template <typename T>
-Matrix<T>::Matrix(const Matrix &other):
-m_Dims(other.m_Dims),
-m_Array(new T* [m_Dims.getRow()])
+void Matrix<T>::insertRows(int position, const Matrix &rows)
 {
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    if (rows.m_Dims.getCol() != m_Dims.getCol())
     {
-        try{
-            m_Array[i] = new T[m_Dims.getCol()];
- 
-        
-            for (int j = 0; j < m_Dims.getCol(); j++)
-            {
-                m_Array[i][j] = other.m_Array[i][j];
-            }
-        }catch(std::bad_alloc& e){
-            for(int k = 0; k < i; k++){
-                delete[] m_Array[k];
-                
-            }
-            delete [] m_Array;
-            throw e;
+        DimensionMismatch error(rows.m_Dims, m_Dims);
+        throw error;
+    }
+    if (position < 0 || position > m_Dims.getRow())
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    if (&rows == this)
+    {
+        Matrix copy(rows);
+        insertRows(position, copy);
+        return;
+    }
+    int inserted = rows.m_Dims.getRow();
+    if (ownsBuffer() && m_Layout == ROW_MAJOR)
+    {
+        spliceRuns(position, inserted, 0, T());
+    }
+    else
+    {
+        rebuild(Dimensions(m_Dims.getRow() + inserted, m_Dims.getCol()), position, inserted, 0, T());
+    }
+    T* data = elements();
+    const T* source = rows.elements();
+    for (int i = 0; i < inserted; i++)
+    {
+        for (int j = 0; j < m_Dims.getCol(); j++)
+        {
+            data[offset(position + i, j)] = source[rows.offset(i, j)];
         }
     }
 }
 
-
-//assignment operator used to create a new matrix copy or reassignig matrix object. release memory of exisiting object.
 template <typename T>
-Matrix<T>& Matrix<T>::operator=(Matrix const &other)
+void Matrix<T>::eraseRows(int position, int count)
 {
-    T** ptr = new T* [other.m_Dims.getRow()];
-
-    for (int i = 0; i < other.m_Dims.getRow(); i++)
+    if (count <= 0 || position < 0 || position > m_Dims.getRow() - count)
     {
-        try{
-                ptr[i] = new T[other.m_Dims.getCol()];
-            
-                for (int j = 0; j < other.m_Dims.getCol(); j++)
-                {
-                   ptr[i][j] = other.m_Array[i][j];
-                }
-           }catch(std::bad_alloc& e){
-               
-               for(int k = 0; k < i; k++){
-                   delete[] ptr[k];
-               }
-               delete[] ptr;
-               throw e;
-           }
+        AccessIllegalElement error;
+        throw error;
     }
-    
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    if (count == m_Dims.getRow())
     {
-        delete[] m_Array[i];
+        IllegalInitialization error;
+        throw error;
+    }
+    if (ownsBuffer() && m_Layout == ROW_MAJOR)
+    {
+        spliceRuns(position, 0, count, T());
+    }
+    else
+    {
+        rebuild(Dimensions(m_Dims.getRow() - count, m_Dims.getCol()), position, 0, count, T());
     }
-    delete[] m_Array;
-    
-    m_Dims = other.m_Dims;
-    m_Array = ptr;
-    return *this;
-           
 }
 
-//Providing basic dimension information
-template <typename T>
-int Matrix<T>::height() const
-{
-    return m_Dims.getRow();
-}
 
 template <typename T>
-int Matrix<T>::width() const
+Matrix<T> Matrix<T>::Diagonal(int size, const T &init)
 {
-    return m_Dims.getCol();
+    mtm::Dimensions dims(size, size);
+    Matrix<T> diagonal(dims);
+    T* elements = diagonal.elements();
+    for (int i = 0; i < size; i++)
+    {
+        elements[diagonal.offset(i, i)] = init;
+    }
+    return diagonal;
 }
 
+//A padded buffer is closed up a run at a time from the front: every run moves towards the start, so
+//memmove never overwrites a run that has not moved yet.
 template <typename T>
-int Matrix<T>::size() const
+Matrix<T> Matrix<T>::Adopt(T* data, Dimensions dims, std::size_t stride, const std::function<void(T*)> &deleter,
+                           Layout layout, SharingPolicy sharing)
 {
-    return ( m_Dims.getRow() * m_Dims.getCol() );
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable elements can be adopted");
+    if (data == NULL || dims.getRow() <= 0 || dims.getCol() <= 0 || layout == TILED ||
+        stride < (std::size_t)((layout == COLUMN_MAJOR) ? dims.getRow() : dims.getCol()))
+    {
+        IllegalInitialization error;
+        throw error;
+    }
+    std::size_t runs = (layout == COLUMN_MAJOR) ? dims.getCol() : dims.getRow();
+    std::size_t length = (layout == COLUMN_MAJOR) ? dims.getRow() : dims.getCol();
+    Storage* storage = new Storage(data, runs * length, (runs - 1) * stride + length, deleter);
+    for (std::size_t run = 1; run < runs && stride != length; run++)
+    {
+        std::memmove(static_cast<void*>(data + run * length), static_cast<const void*>(data + run * stride),
+                     length * sizeof(T));
+    }
+    return Matrix<T>(storage, dims, sharing, layout);
 }
 
-
 template <typename T>
-Matrix<T> Matrix<T>::Diagonal(int size, T init)
+Matrix<T> Matrix<T>::Wrap(T* data, Dimensions dims, std::size_t stride, Layout layout, SharingPolicy sharing)
 {
-    mtm::Dimensions dims(size, size);
-    Matrix<T> diagonal(dims);
-    for (int i = 0; i < size; i++)
+    if (stride != (std::size_t)((layout == COLUMN_MAJOR) ? dims.getRow() : dims.getCol()))
     {
-        diagonal.m_Array[i][i] = init;
+        IllegalInitialization error;
+        throw error;
     }
-    return diagonal;
+    return Adopt(data, dims, stride, std::function<void(T*)>(), layout, sharing);
 }
 
 
+//Row and column major transposes only swap the dimensions and the layout, the buffer is reused as is.
+//TILED matrices are transposed tile by tile with transposeBlock.
 template <typename T>
 Matrix<T> Matrix<T>::transpose() const
 {
     mtm::Dimensions dims(m_Dims.getCol(),m_Dims.getRow());
-    Matrix<T> transposed(dims);
-    for (int i = 0; i < m_Dims.getCol(); i++)
+    if (m_Layout != TILED)
     {
+        Layout flipped = (m_Layout == ROW_MAJOR) ? COLUMN_MAJOR : ROW_MAJOR;
+        Storage* storage = (m_Sharing == COPY_ON_WRITE) ? share() : m_Storage->duplicate();
+        Matrix<T> transposed(storage, dims, m_Sharing, flipped);
+        storage->references.fetch_sub(1, std::memory_order_relaxed);
+        return transposed;
+    }
 
-        for (int j = 0; j < m_Dims.getRow(); j++)
+    Matrix<T> transposed(dims, T(), m_Sharing, TILED, m_Memory);
+    T* to = transposed.elements();
+    const T* from = elements();
+    for (int row_block = 0; row_block < m_Dims.getRow(); row_block += TILE_SIZE)
+    {
+        for (int col_block = 0; col_block < m_Dims.getCol(); col_block += TILE_SIZE)
         {
-            transposed.m_Array[i][j] = m_Array[j][i];
+            transposeBlock(from + offset(row_block, col_block), TILE_SIZE, to + transposed.offset(col_block, row_block),
+                           TILE_SIZE, std::min(TILE_SIZE, m_Dims.getRow() - row_block),
+                           std::min(TILE_SIZE, m_Dims.getCol() - col_block));
         }
     }
     return transposed;
@@ -600,7 +2732,7 @@ Matrix<T> Matrix<T>::transpose() const
 
 
 template <typename T>
-Matrix<T> Matrix<T>::operator+(const Matrix<T> &mat) const
+void Matrix<T>::checkDimensions(const Matrix<T> &mat) const
 {
     if (m_Dims.getCol() != mat.m_Dims.getCol() || m_Dims.getRow() != mat.m_Dims.getRow())
     {
@@ -609,281 +2741,584 @@ Matrix<T> Matrix<T>::operator+(const Matrix<T> &mat) const
         DimensionMismatch error(dims1, dims2);
         throw error;
     }
+}
+
+
+//The arithmetic operators build their result in a single pass over the source buffers instead of
+//copying the left operand first and updating the copy. Results keep the layout of the left operand.
+template <typename T>
+Matrix<T> Matrix<T>::operator+(const Matrix<T> &mat) const &
+{
+    checkDimensions(mat);
     
-    Matrix<T> sum = *this;
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    Matrix<T> sum(m_Dims, T(), m_Sharing, m_Layout, m_Memory);
+    if (m_Layout == mat.m_Layout)
     {
-        for (int j = 0; j < m_Dims.getCol(); j++)
-        {
-            sum.m_Array[i][j] += mat.m_Array[i][j];
-        }
+        addRuns(sum, *this, mat);
+        return sum;
     }
+    transform(sum, *this, mat, [](const T &lhs, const T &rhs) { return elementSum(lhs, rhs); }, SEQUENTIAL);
     
     return sum;
     
 }
 
-
+//The overloads taking a temporary reuse its buffer: the result is written in place and moved out.
 template <typename T>
-Matrix<T> Matrix<T>::operator-() const
+Matrix<T> Matrix<T>::operator+(const Matrix<T> &mat) &&
 {
-    Matrix<T> after_mat(*this);
+    (*this) += mat;
+    return std::move(*this);
+}
 
-    for (int i = 0; i < m_Dims.getRow(); i++)
-    {
-        for (int j = 0; j < m_Dims.getCol(); j++)
-        {
-            after_mat.m_Array[i][j] = (-1) * m_Array[i][j];
-        }
-    }
+
+template <typename T>
+Matrix<T> Matrix<T>::operator-() const &
+{
+    Matrix<T> after_mat(m_Dims, T(), m_Sharing, m_Layout, m_Memory);
+    transform(after_mat, *this, [](const T &element) { return (-1) * element; }, SEQUENTIAL);
 
     return after_mat;
 }
 
+template <typename T>
+Matrix<T> Matrix<T>::operator-() &&
+{
+    update(*this, [](T &element) { element = (-1) * element; });
+    return std::move(*this);
+}
+
 
 template<typename T>
-Matrix<T> Matrix<T>::operator-(const Matrix mat) const
+Matrix<T> Matrix<T>::operator-(const Matrix &mat) const
 {
     return ( (*this)+(-mat) );
 }
 
 
 template <typename T>
-Matrix<T>& Matrix<T>::operator+=(T obj)
+template <typename U>
+Matrix<typename std::common_type<T, U>::type> Matrix<T>::operator+(const Matrix<U> &mat) const
 {
-    for(int i = 0; i < m_Dims.getRow(); i++){
-        
-        for(int j = 0; j < m_Dims.getCol(); j++){
-            m_Array[i][j] += obj;
-        }
+    typedef typename std::common_type<T, U>::type R;
+    if (m_Dims != mat.m_Dims)
+    {
+        DimensionMismatch error(m_Dims, mat.m_Dims);
+        throw error;
+    }
+    Matrix<R> sum(m_Dims, R(), m_Sharing, m_Layout, m_Memory);
+    transform(sum, *this, mat, [](const T &lhs, const U &rhs) { return static_cast<R>(lhs) + static_cast<R>(rhs); },
+              SEQUENTIAL);
+    return sum;
+}
+
+template <typename T>
+template <typename U>
+Matrix<typename std::common_type<T, U>::type> Matrix<T>::operator-(const Matrix<U> &mat) const
+{
+    typedef typename std::common_type<T, U>::type R;
+    if (m_Dims != mat.m_Dims)
+    {
+        DimensionMismatch error(m_Dims, mat.m_Dims);
+        throw error;
     }
+    Matrix<R> difference(m_Dims, R(), m_Sharing, m_Layout, m_Memory);
+    transform(difference, *this, mat,
+              [](const T &lhs, const U &rhs) { return static_cast<R>(lhs) - static_cast<R>(rhs); }, SEQUENTIAL);
+    return difference;
+}
+
+template <typename T>
+template <typename S, typename>
+Matrix<typename std::common_type<T, S>::type> Matrix<T>::operator+(const S &scalar) const
+{
+    typedef typename std::common_type<T, S>::type R;
+    const R added = static_cast<R>(scalar);
+    Matrix<R> sum(m_Dims, R(), m_Sharing, m_Layout, m_Memory);
+    transform(sum, *this, [added](const T &element) { return static_cast<R>(element) + added; }, SEQUENTIAL);
+    return sum;
+}
+
+//Scalar on the left: arithmetic addition commutes, so the matrix operator does the work.
+template <typename S, typename T, typename = typename std::enable_if<MixedScalar<T, S>::value>::type>
+Matrix<typename std::common_type<T, S>::type> operator+(const S &scalar, const Matrix<T> &mat)
+{
+    return mat + scalar;
+}
+
+//Runs of the result match the runs of this matrix (same dimensions and layout), each is converted in one call.
+template <typename T>
+template <typename U>
+Matrix<U> Matrix<T>::cast(Execution execution) const
+{
+    Matrix<U> converted(m_Dims, U(), m_Sharing, m_Layout, m_Memory);
+    U* to = converted.elements();
+    const T* from = elements();
+    const Matrix<T>& source = *this;
+    parallelRows(runCount(), runLength(0), execution, [&](int first, int last)
+    {
+        for (int run = first; run < last; run++)
+        {
+            std::size_t start = source.runOffset(run);
+            convertRun(from + start, to + start, source.runLength(run));
+        }
+    });
+    return converted;
+}
+
+
+template <typename T>
+Matrix<T>& Matrix<T>::operator+=(const T &obj)
+{
+    update(*this, [&obj](T &element) { element += obj; });
+    return *this;
+}
+
+template <typename T>
+Matrix<T>& Matrix<T>::operator+=(const Matrix &mat)
+{
+    checkDimensions(mat);
+    update(*this, mat, [](T &element, const T &added) { element += added; });
     return *this;
 }
 
 
 template<typename T>
-Matrix<T> operator+(T obj, const Matrix<T> mat)
+Matrix<T> operator+(const T &obj, const Matrix<T> &mat)
 {
-    Matrix<T> sum(mat);
-    for(int i = 0; i < mat.height(); i++){
-        for(int j = 0; j < mat.width(); j++){
-            sum.m_Array[i][j] = obj + sum.m_Array[i][j];
-        }
-    }
+    Matrix<T> sum(mat.m_Dims, T(), mat.m_Sharing, mat.m_Layout, mat.m_Memory);
+    Matrix<T>::transform(sum, mat, [&obj](const T &element) { return elementSum(obj, element); }, SEQUENTIAL);
     return sum;
 }
 
 template<typename T>
-Matrix<T> operator+(const Matrix<T> mat, T obj)
+Matrix<T> operator+(const Matrix<T> &mat, const T &obj)
 {
-    Matrix<T> sum(mat);
-    for(int i = 0; i < mat.height(); i++){
-        for(int j = 0; j < mat.width(); j++){
-            sum.m_Array[i][j] =sum.m_Array[i][j] + obj;
-        }
-    }
+    Matrix<T> sum(mat.m_Dims, T(), mat.m_Sharing, mat.m_Layout, mat.m_Memory);
+    Matrix<T>::transform(sum, mat, [&obj](const T &element) { return elementSum(element, obj); }, SEQUENTIAL);
     return sum;
 }
 
+template<typename T>
+Matrix<T> operator+(const T &obj, Matrix<T> &&mat)
+{
+    Matrix<T>::update(mat, [&obj](T &element) { element = elementSum(obj, element); });
+    return std::move(mat);
+}
+
+template<typename T>
+Matrix<T> operator+(Matrix<T> &&mat, const T &obj)
+{
+    mat += obj;
+    return std::move(mat);
+}
+
+
+template <typename T>
+T &Matrix<T>::operator()(int row_index, int col_index)
+{
+    if (row_index >= m_Dims.getRow() || row_index < 0 || col_index >= m_Dims.getCol() || col_index < 0)
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    return exposeElements()[offset(row_index, col_index)];
+}
 
 template <typename T>
-T &Matrix<T>::operator()(int row_index, int col_index) const
+const T &Matrix<T>::operator()(int row_index, int col_index) const
 {
     if (row_index >= m_Dims.getRow() || row_index < 0 || col_index >= m_Dims.getCol() || col_index < 0)
     {
         AccessIllegalElement error;
         throw error;
     }
-    return m_Array[row_index][col_index];
+    return elements()[offset(row_index, col_index)];
+}
+
+
+template <typename T>
+std::ostream &operator<<(std::ostream &os, const Matrix<T> &matrix)
+{
+    typename Matrix<T>::const_iterator it_begin = matrix.begin();
+    typename Matrix<T>::const_iterator it_end = matrix.end();
+
+    return mtm::printMatrix(os, it_begin, it_end, matrix.width());
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator<(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, LESS);
+    return to_return;
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator>(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, GREATER);
+    return to_return;
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator<=(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, LESS_EQUAL);
+    return to_return;
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator>=(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, GREATER_EQUAL);
+    return to_return;
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator==(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, EQUAL);
+    return to_return;
+}
+
+template <typename T>
+Matrix<bool> Matrix<T>::operator!=(const T &compare) const
+{
+    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
+    Matrix<bool> to_return(dims, false, m_Sharing, m_Layout, m_Memory);
+    compareRuns(to_return, *this, compare, NOT_EQUAL);
+    return to_return;
+}
+
+
+
+
+
+//all/any walk the runs so the padding of TILED buffers is never inspected.
+template <typename T>
+bool all(const Matrix<T> &mat)
+{
+    const T* elements = mat.elements();
+    for (int run = 0; run < mat.runCount(); run++)
+    {
+        if (!allRun(elements + mat.runOffset(run), mat.runLength(run)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool any(const Matrix<T> &mat)
+{
+    const T* elements = mat.elements();
+    for (int run = 0; run < mat.runCount(); run++)
+    {
+        if (anyRun(elements + mat.runOffset(run), mat.runLength(run)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+template <typename U>
+Matrix<T> Matrix<T>::apply(U operation) const
+{
+    Matrix operated(m_Dims, T(), m_Sharing, m_Layout, m_Memory);
+    transform(operated, *this, operation, SEQUENTIAL);
+    return operated;
+}
+
+
+template <typename T, typename F>
+Matrix<T> zip(const Matrix<T> &a, const Matrix<T> &b, F operation, Execution execution)
+{
+    a.checkDimensions(b);
+    Matrix<T> result(a.m_Dims, T(), a.m_Sharing, a.m_Layout, a.m_Memory);
+    Matrix<T>::transform(result, a, b, operation, execution);
+    return result;
+}
+
+template <typename T, typename F>
+Matrix<T> zip(const Matrix<T> &a, const Matrix<T> &b, const Matrix<T> &c, F operation, Execution execution)
+{
+    a.checkDimensions(b);
+    a.checkDimensions(c);
+    Matrix<T> result(a.m_Dims, T(), a.m_Sharing, a.m_Layout, a.m_Memory);
+    Matrix<T>::transform(result, a, b, c, operation, execution);
+    return result;
 }
 
-
-template <typename T>
-std::ostream &operator<<(std::ostream &os, const Matrix<T> &matrix)
+template <typename T, typename F>
+Matrix<T> &combine(Matrix<T> &a, const Matrix<T> &b, F operation, Execution execution)
 {
-    typename Matrix<T>::const_iterator it_begin = matrix.begin();
-    typename Matrix<T>::const_iterator it_end = matrix.end();
+    a.checkDimensions(b);
+    Matrix<T>::transform(a, a, b, operation, execution);
+    return a;
+}
 
-    return mtm::printMatrix(os, it_begin, it_end, matrix.width());
+template <typename T, typename F>
+Matrix<T> &combine(Matrix<T> &a, const Matrix<T> &b, const Matrix<T> &c, F operation, Execution execution)
+{
+    a.checkDimensions(b);
+    a.checkDimensions(c);
+    Matrix<T>::transform(a, a, b, c, operation, execution);
+    return a;
 }
 
 
 template <typename T>
-Matrix<bool> Matrix<T>::operator<(T compare) const
+int Matrix<T>::rowRun(int col_index) const
 {
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
-
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    switch (m_Layout)
     {
-
-        for (int j = 0; j < m_Dims.getCol(); j++)
-        {
-
-            if ( (m_Array[i][j]) < compare)
-            {
-                to_return(i,j) = true;
-            }
-        }
+        case ROW_MAJOR:
+            return m_Dims.getCol() - col_index;
+        case COLUMN_MAJOR:
+            return 1;
+        default:
+            return std::min(TILE_SIZE - col_index % TILE_SIZE, m_Dims.getCol() - col_index);
     }
-    return to_return;
 }
 
 template <typename T>
-Matrix<bool> Matrix<T>::operator>(T compare) const
+void Matrix<T>::place(Matrix &out, int row_index, int col_index, const Matrix &source, Execution execution)
 {
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
-
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    T* to = out.m_Storage->data;
+    const T* from = source.elements();
+    int rows = source.m_Dims.getRow();
+    int cols = source.m_Dims.getCol();
+    if (out.m_Layout == COLUMN_MAJOR && source.m_Layout == COLUMN_MAJOR)
     {
-
-        for (int j = 0; j < m_Dims.getCol(); j++)
+        parallelRows(cols, rows, execution, [&](int first, int last)
         {
-
-            if ( (m_Array[i][j]) > compare)
+            for (int j = first; j < last; j++)
             {
-                to_return(i,j) = true;
+                const T* column = from + source.offset(0, j);
+                std::copy(column, column + rows, to + out.offset(row_index, col_index + j));
             }
-        }
+        });
+        return;
     }
-    return to_return;
-}
-
-template <typename T>
-Matrix<bool> Matrix<T>::operator<=(T compare) const
-{
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
-
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    parallelRows(rows, cols, execution, [&](int first, int last)
     {
-
-        for (int j = 0; j < m_Dims.getCol(); j++)
+        for (int i = first; i < last; i++)
         {
-
-            if ( (m_Array[i][j]) <= compare)
+            int j = 0;
+            while (j < cols)
             {
-                to_return(i,j) = true;
+                int length = std::min(source.rowRun(j), out.rowRun(col_index + j));
+                const T* piece = from + source.offset(i, j);
+                std::copy(piece, piece + length, to + out.offset(row_index + i, col_index + j));
+                j += length;
             }
         }
-    }
-    return to_return;
+    });
 }
 
-
 template <typename T>
-Matrix<bool> Matrix<T>::operator>=(T compare) const
+Matrix<T> Matrix<T>::assemble(const std::vector< std::vector<const Matrix*> > &grid, Execution execution)
 {
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
-
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    if (grid.empty())
     {
-
-        for (int j = 0; j < m_Dims.getCol(); j++)
+        IllegalInitialization error;
+        throw error;
+    }
+    int rows = 0;
+    int cols = 0;
+    for (std::size_t r = 0; r < grid.size(); r++)
+    {
+        if (grid[r].empty())
         {
-
-            if ( (m_Array[i][j]) >= compare)
+            IllegalInitialization error;
+            throw error;
+        }
+        int row_width = 0;
+        for (std::size_t c = 0; c < grid[r].size(); c++)
+        {
+            if (grid[r][c]->m_Dims.getRow() != grid[r][0]->m_Dims.getRow())
             {
-                to_return(i,j) = true;
+                DimensionMismatch error(grid[r][0]->m_Dims, grid[r][c]->m_Dims);
+                throw error;
             }
+            row_width += grid[r][c]->m_Dims.getCol();
+        }
+        if (r > 0 && row_width != cols)
+        {
+            DimensionMismatch error(Dimensions(rows, cols), Dimensions(grid[r][0]->m_Dims.getRow(), row_width));
+            throw error;
         }
+        cols = row_width;
+        rows += grid[r][0]->m_Dims.getRow();
     }
-    return to_return;
+    const Matrix &first = *grid[0][0];
+    Matrix assembled(Dimensions(rows, cols), T(), first.m_Sharing, first.m_Layout, first.m_Memory);
+    int row_index = 0;
+    for (std::size_t r = 0; r < grid.size(); r++)
+    {
+        int col_index = 0;
+        for (std::size_t c = 0; c < grid[r].size(); c++)
+        {
+            place(assembled, row_index, col_index, *grid[r][c], execution);
+            col_index += grid[r][c]->m_Dims.getCol();
+        }
+        row_index += grid[r][0]->m_Dims.getRow();
+    }
+    return assembled;
 }
 
 template <typename T>
-Matrix<bool> Matrix<T>::operator==(T compare) const
+Matrix<T> hstack(const std::vector< Matrix<T> > &mats, Execution execution)
 {
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
-
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    std::vector< std::vector<const Matrix<T>*> > grid(1);
+    for (std::size_t k = 0; k < mats.size(); k++)
     {
+        grid[0].push_back(&mats[k]);
+    }
+    return Matrix<T>::assemble(grid, execution);
+}
 
-        for (int j = 0; j < m_Dims.getCol(); j++)
-        {
+template <typename T>
+Matrix<T> hstack(const Matrix<T> &a, const Matrix<T> &b, Execution execution)
+{
+    std::vector< std::vector<const Matrix<T>*> > grid(1);
+    grid[0].push_back(&a);
+    grid[0].push_back(&b);
+    return Matrix<T>::assemble(grid, execution);
+}
 
-            if ( (m_Array[i][j]) == compare)
-            {
-                to_return(i,j) = true;
-            }
-        }
+template <typename T>
+Matrix<T> vstack(const std::vector< Matrix<T> > &mats, Execution execution)
+{
+    std::vector< std::vector<const Matrix<T>*> > grid;
+    for (std::size_t k = 0; k < mats.size(); k++)
+    {
+        grid.push_back(std::vector<const Matrix<T>*>(1, &mats[k]));
     }
-    return to_return;
+    return Matrix<T>::assemble(grid, execution);
 }
 
 template <typename T>
-Matrix<bool> Matrix<T>::operator!=(T compare) const
+Matrix<T> vstack(const Matrix<T> &a, const Matrix<T> &b, Execution execution)
 {
-    mtm::Dimensions dims(m_Dims.getRow(), m_Dims.getCol());
-    Matrix<bool> to_return(dims, false);
+    std::vector< std::vector<const Matrix<T>*> > grid;
+    grid.push_back(std::vector<const Matrix<T>*>(1, &a));
+    grid.push_back(std::vector<const Matrix<T>*>(1, &b));
+    return Matrix<T>::assemble(grid, execution);
+}
 
-    for (int i = 0; i < m_Dims.getRow(); i++)
+template <typename T>
+Matrix<T> block(const std::vector< std::vector< Matrix<T> > > &blocks, Execution execution)
+{
+    std::vector< std::vector<const Matrix<T>*> > grid(blocks.size());
+    for (std::size_t r = 0; r < blocks.size(); r++)
     {
-
-        for (int j = 0; j < m_Dims.getCol(); j++)
+        for (std::size_t c = 0; c < blocks[r].size(); c++)
         {
-
-            if ( (m_Array[i][j]) != compare)
-            {
-                to_return(i,j) = true;
-            }
+            grid[r].push_back(&blocks[r][c]);
         }
     }
-    return to_return;
+    return Matrix<T>::assemble(grid, execution);
 }
 
-
-
-
-
 template <typename T>
-bool all(Matrix<T> mat)
+Matrix<T> blockDiagonal(const std::vector< Matrix<T> > &mats, const T &fill, Execution execution)
 {
-    for (int i = 0; i < mat.height(); i++)
+    if (mats.empty())
     {
-        for (int j = 0; j < mat.width(); j++)
-        {
-            if ( bool(mat.m_Array[i][j]) == false)
-            {
-                return false;
-            }
-        }
+        typename Matrix<T>::IllegalInitialization error;
+        throw error;
     }
-    return true;
+    int rows = 0;
+    int cols = 0;
+    for (std::size_t k = 0; k < mats.size(); k++)
+    {
+        rows += mats[k].m_Dims.getRow();
+        cols += mats[k].m_Dims.getCol();
+    }
+    Matrix<T> diagonal(Dimensions(rows, cols), fill, mats[0].m_Sharing, mats[0].m_Layout, mats[0].m_Memory);
+    int row_index = 0;
+    int col_index = 0;
+    for (std::size_t k = 0; k < mats.size(); k++)
+    {
+        Matrix<T>::place(diagonal, row_index, col_index, mats[k], execution);
+        row_index += mats[k].m_Dims.getRow();
+        col_index += mats[k].m_Dims.getCol();
+    }
+    return diagonal;
 }
 
+//Copies of a matrix large enough to be split are placed one after the other, each in parallel,
+//otherwise rows of copies are handed to the threads.
 template <typename T>
-bool any(Matrix<T> mat)
+Matrix<T> tile(const Matrix<T> &mat, int rows, int cols, Execution execution)
 {
-    for (int i = 0; i < mat.height(); i++)
+    if (rows <= 0 || cols <= 0)
+    {
+        typename Matrix<T>::IllegalInitialization error;
+        throw error;
+    }
+    int height = mat.m_Dims.getRow();
+    int width = mat.m_Dims.getCol();
+    Matrix<T> tiled(Dimensions(height * rows, width * cols), T(), mat.m_Sharing, mat.m_Layout, mat.m_Memory);
+    bool large = (long)height * width >= PARALLEL_THRESHOLD;
+    parallelRows(rows, large ? 1 : height * width * cols, execution, [&](int first, int last)
     {
-        for (int j = 0; j < mat.width(); j++)
+        for (int r = first; r < last; r++)
         {
-            if ( bool(mat.m_Array[i][j]) == true )
+            for (int c = 0; c < cols; c++)
             {
-                return true;
+                Matrix<T>::place(tiled, r * height, c * width, mat, large ? execution : SEQUENTIAL);
             }
         }
-    }
-    return false;
+    });
+    return tiled;
 }
 
 template <typename T>
-template <typename U>
-Matrix<T> Matrix<T>::apply(U operation) const
+Matrix<T> repeat(const Matrix<T> &mat, int rows, int cols, Execution execution)
 {
-    Matrix operated = *this;
-    for (int i = 0; i < m_Dims.getRow(); i++)
+    if (rows <= 0 || cols <= 0)
     {
-        for (int j = 0; j < m_Dims.getCol(); j++)
+        typename Matrix<T>::IllegalInitialization error;
+        throw error;
+    }
+    int height = mat.m_Dims.getRow();
+    int width = mat.m_Dims.getCol();
+    Matrix<T> repeated(Dimensions(height * rows, width * cols), T(), mat.m_Sharing, mat.m_Layout, mat.m_Memory);
+    T* to = repeated.m_Storage->data;
+    const T* from = mat.elements();
+    parallelRows(height * rows, width * cols, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
         {
-            operated.m_Array[i][j] = operation(operated.m_Array[i][j]);
+            for (int j = 0; j < width; j++)
+            {
+                const T &value = from[mat.offset(i / rows, j)];
+                int col_index = j * cols;
+                while (col_index < (j + 1) * cols)
+                {
+                    int length = std::min(repeated.rowRun(col_index), (j + 1) * cols - col_index);
+                    std::fill_n(to + repeated.offset(i, col_index), length, value);
+                    col_index += length;
+                }
+            }
         }
-    }
-    return operated;
+    });
+    return repeated;
 }
 
 
@@ -924,7 +3359,7 @@ Matrix<T>::iterator::iterator(const Matrix<T> &mat, int row, int col)
     col_num = mat.width();
     row_index = row;
     col_index = col;
-    matrix = mat.m_Array;
+    matrix = const_cast<Matrix<T> *>(&mat);
 }
 
 template <typename T>
@@ -935,7 +3370,19 @@ T &Matrix<T>::iterator::operator*() const
         AccessIllegalElement error;
         throw error;
     }
-    return matrix[row_index][col_index];
+    return matrix->exposeElements()[matrix->offset(row_index, col_index)];
+}
+
+template <typename T>
+const T &Matrix<T>::iterator::read() const
+{
+    if (row_index >= row_num || col_index >= col_num)
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    const Matrix<T> *source = matrix;
+    return source->elements()[source->offset(row_index, col_index)];
 }
 
 template <typename T>
@@ -998,9 +3445,9 @@ Matrix<T>::const_iterator::const_iterator(Matrix<T>::iterator init) : it(init)
 }
 
 template <typename T>
-T Matrix<T>::const_iterator::operator*() const
+const T &Matrix<T>::const_iterator::operator*() const
 {
-    return *it;
+    return it.read();
 }
 
 template <typename T>
@@ -1036,6 +3483,276 @@ typename Matrix<T>::const_iterator Matrix<T>::const_iterator::operator=(const co
     return const_iterator(it.it);
 }
 
+//block views and ranges
+template <typename T>
+template <typename E>
+Matrix<T>::BlockView<E>::BlockView(const Matrix<T> *matrix, E *data, int row, int col, int height, int width) :
+m_Matrix(matrix),
+m_Data(data),
+m_Row(row),
+m_Col(col),
+m_Height(height),
+m_Width(width)
+{
+}
+
+template <typename T>
+template <typename E>
+int Matrix<T>::BlockView<E>::row() const
+{
+    return m_Row;
+}
+
+template <typename T>
+template <typename E>
+int Matrix<T>::BlockView<E>::col() const
+{
+    return m_Col;
+}
+
+template <typename T>
+template <typename E>
+int Matrix<T>::BlockView<E>::height() const
+{
+    return m_Height;
+}
+
+template <typename T>
+template <typename E>
+int Matrix<T>::BlockView<E>::width() const
+{
+    return m_Width;
+}
+
+template <typename T>
+template <typename E>
+E &Matrix<T>::BlockView<E>::operator()(int row_index, int col_index) const
+{
+    if (row_index < 0 || col_index < 0 || row_index >= m_Height || col_index >= m_Width)
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    return m_Data[m_Matrix->offset(m_Row + row_index, m_Col + col_index)];
+}
+
+//Columns of a COLUMN_MAJOR matrix are read down their contiguous runs, everything else along the rows.
+template <typename T>
+template <typename E>
+void Matrix<T>::BlockView<E>::copyTo(typename std::remove_const<E>::type *destination) const
+{
+    if (m_Matrix->m_Layout == COLUMN_MAJOR)
+    {
+        for (int j = 0; j < m_Width; j++)
+        {
+            const T *column = m_Data + m_Matrix->offset(m_Row, m_Col + j);
+            for (int i = 0; i < m_Height; i++)
+            {
+                destination[(std::size_t)i * m_Width + j] = column[i];
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < m_Height; i++)
+    {
+        int j = 0;
+        while (j < m_Width)
+        {
+            int length = std::min(m_Matrix->rowRun(m_Col + j), m_Width - j);
+            const T *piece = m_Data + m_Matrix->offset(m_Row + i, m_Col + j);
+            std::copy(piece, piece + length, destination + (std::size_t)i * m_Width + j);
+            j += length;
+        }
+    }
+}
+
+template <typename T>
+template <typename E>
+void Matrix<T>::BlockView<E>::copyFrom(const T *source) const
+{
+    static_assert(!std::is_const<E>::value, "a ConstBlock is read only");
+    if (m_Matrix->m_Layout == COLUMN_MAJOR)
+    {
+        for (int j = 0; j < m_Width; j++)
+        {
+            T *column = m_Data + m_Matrix->offset(m_Row, m_Col + j);
+            for (int i = 0; i < m_Height; i++)
+            {
+                column[i] = source[(std::size_t)i * m_Width + j];
+            }
+        }
+        return;
+    }
+    for (int i = 0; i < m_Height; i++)
+    {
+        int j = 0;
+        while (j < m_Width)
+        {
+            int length = std::min(m_Matrix->rowRun(m_Col + j), m_Width - j);
+            const T *piece = source + (std::size_t)i * m_Width + j;
+            std::copy(piece, piece + length, m_Data + m_Matrix->offset(m_Row + i, m_Col + j));
+            j += length;
+        }
+    }
+}
+
+//Z order sorts the blocks by the bits of their row and column interleaved (row bits in the odd places).
+template <typename T>
+template <typename E>
+Matrix<T>::BlockRange<E>::BlockRange(const Matrix<T> *matrix, E *data, int block_height, int block_width,
+                                     BlockOrder order) :
+m_Matrix(matrix),
+m_Data(data),
+m_BlockHeight(block_height),
+m_BlockWidth(block_width),
+m_BlockCols((matrix->width() + block_width - 1) / block_width)
+{
+    int block_rows = (matrix->height() + block_height - 1) / block_height;
+    m_Order.reserve((std::size_t)block_rows * m_BlockCols);
+    if (order == COLUMN_MAJOR_BLOCKS)
+    {
+        for (int c = 0; c < m_BlockCols; c++)
+        {
+            for (int r = 0; r < block_rows; r++)
+            {
+                m_Order.push_back(r * m_BlockCols + c);
+            }
+        }
+        return;
+    }
+    for (int k = 0; k < block_rows * m_BlockCols; k++)
+    {
+        m_Order.push_back(k);
+    }
+    if (order == Z_ORDER_BLOCKS)
+    {
+        int block_cols = m_BlockCols;
+        std::vector< std::pair<unsigned long long, int> > keyed;
+        keyed.reserve(m_Order.size());
+        for (std::size_t k = 0; k < m_Order.size(); k++)
+        {
+            unsigned long long r = (unsigned long long)(m_Order[k] / block_cols);
+            unsigned long long c = (unsigned long long)(m_Order[k] % block_cols);
+            unsigned long long key = 0;
+            for (int bit = 0; bit < 31; bit++)
+            {
+                key |= ((c >> bit) & 1ULL) << (2 * bit);
+                key |= ((r >> bit) & 1ULL) << (2 * bit + 1);
+            }
+            keyed.push_back(std::make_pair(key, m_Order[k]));
+        }
+        std::sort(keyed.begin(), keyed.end());
+        for (std::size_t k = 0; k < keyed.size(); k++)
+        {
+            m_Order[k] = keyed[k].second;
+        }
+    }
+}
+
+template <typename T>
+template <typename E>
+int Matrix<T>::BlockRange<E>::size() const
+{
+    return (int)m_Order.size();
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockView<E> Matrix<T>::BlockRange<E>::operator[](int index) const
+{
+    if (index < 0 || index >= size())
+    {
+        AccessIllegalElement error;
+        throw error;
+    }
+    int row = m_Order[index] / m_BlockCols * m_BlockHeight;
+    int col = m_Order[index] % m_BlockCols * m_BlockWidth;
+    return BlockView<E>(m_Matrix, m_Data, row, col, std::min(m_BlockHeight, m_Matrix->height() - row),
+                        std::min(m_BlockWidth, m_Matrix->width() - col));
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockRange<E>::iterator Matrix<T>::BlockRange<E>::begin() const
+{
+    return iterator(this, 0);
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockRange<E>::iterator Matrix<T>::BlockRange<E>::end() const
+{
+    return iterator(this, size());
+}
+
+template <typename T>
+template <typename E>
+Matrix<T>::BlockRange<E>::iterator::iterator(const BlockRange *range, int index) :
+m_Range(range),
+m_Index(index)
+{
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockView<E> Matrix<T>::BlockRange<E>::iterator::operator*() const
+{
+    return (*m_Range)[m_Index];
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockRange<E>::iterator &Matrix<T>::BlockRange<E>::iterator::operator++()
+{
+    m_Index++;
+    return *this;
+}
+
+template <typename T>
+template <typename E>
+typename Matrix<T>::template BlockRange<E>::iterator Matrix<T>::BlockRange<E>::iterator::operator++(int)
+{
+    iterator previous = *this;
+    m_Index++;
+    return previous;
+}
+
+template <typename T>
+template <typename E>
+bool Matrix<T>::BlockRange<E>::iterator::operator==(const iterator &other) const
+{
+    return m_Range == other.m_Range && m_Index == other.m_Index;
+}
+
+template <typename T>
+template <typename E>
+bool Matrix<T>::BlockRange<E>::iterator::operator!=(const iterator &other) const
+{
+    return !(*this == other);
+}
+
+template <typename T>
+typename Matrix<T>::Blocks Matrix<T>::blocks(int block_height, int block_width, BlockOrder order)
+{
+    if (block_height <= 0 || block_width <= 0)
+    {
+        IllegalInitialization error;
+        throw error;
+    }
+    return Blocks(this, exposeElements(), block_height, block_width, order);
+}
+
+template <typename T>
+typename Matrix<T>::ConstBlocks Matrix<T>::blocks(int block_height, int block_width, BlockOrder order) const
+{
+    if (block_height <= 0 || block_width <= 0)
+    {
+        IllegalInitialization error;
+        throw error;
+    }
+    return ConstBlocks(this, elements(), block_height, block_width, order);
+}
+
 template <typename T>
 const char *Matrix<T>::AccessIllegalElement::what() const throw()
 {
@@ -0,0 +1,562 @@
+//
+//  MatrixConvolve.h
+//  Matrix
+//
+/*
+ This file exports 2D convolution and correlation of a matrix with a kernel (or a bank of kernels),
+ the building block of stencils such as box blur, Sobel and Laplacian filters.
+*/
+#ifndef MatrixConvolve_h
+#define MatrixConvolve_h
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "MatrixMultiply.h"
+#include "SummedArea.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Enum: BorderPolicy
+* ------------------------
+* Value a kernel reads when it reaches outside the matrix.
+* BORDER_ZERO - T() (zero padding).
+* BORDER_CLAMP - the nearest element on the edge (replicate).
+* BORDER_WRAP - the element on the opposite side (periodic / toroidal).
+*/
+enum BorderPolicy { BORDER_ZERO, BORDER_CLAMP, BORDER_WRAP };
+
+/**
+* Enum: ConvolutionAlgorithm
+* ------------------------
+* AUTOMATIC - IM2COL for banks of at least IM2COL_KERNELS kernels, otherwise SEPARABLE when the
+*             kernel is separable and DIRECT when it is not.
+* DIRECT - sliding window, every output accumulates kernel height * width products.
+* SEPARABLE - a kernel of rank one (outer product of a column and a row) is applied as a horizontal
+*             pass followed by a vertical pass, height + width products per output.
+*             Falls back to DIRECT when the kernel is not separable, or T is an integral type as wide
+*             as long long (the passes accumulate in a wider type, see Convolution::separated).
+* IM2COL - the windows are unfolded into the columns of a matrix which is multiplied by the kernels
+*          with multiplyBlocked, so a bank of kernels reads every window once.
+*/
+enum ConvolutionAlgorithm { AUTOMATIC, DIRECT, SEPARABLE, IM2COL };
+
+//Smallest bank AUTOMATIC hands to IM2COL, taken from bench/bench_convolve.cpp. For a single kernel the
+//unfolded copy costs more than the product saves at every kernel size, so DIRECT is kept.
+const int IM2COL_KERNELS = 16;
+
+
+/**
+* function: correlate / convolve
+* Usage: correlate(image, kernel)
+*        convolve(image, kernel, mtm::BORDER_CLAMP, mtm::AUTOMATIC, mtm::PARALLEL)
+* -----------------------------
+* Slides kernel over image and creates the matrix of the weighted sums, of the same dimensions as image.
+* The kernel element (kernel.height() / 2, kernel.width() / 2) is anchored on the output element.
+* correlate uses the kernel as given: out(i, j) = sum of kernel(a, b) * image(i + a - ah, j + b - aw).
+* convolve flips the kernel on both axes first (the mathematical convolution).
+* The result has image's SharingPolicy, Layout and MemoryPolicy.
+@param border - see BorderPolicy (default BORDER_ZERO).
+@param algorithm - see ConvolutionAlgorithm (default AUTOMATIC). All algorithms give the same result
+*                  up to floating point rounding.
+@param execution - PARALLEL splits the output rows into bands on the shared ThreadPool (default SEQUENTIAL).
+@return the filtered matrix.
+@remarks (assumptions) T supports + * and == (and / for separable integral kernels), T() is the additive identity.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<T> correlate(const Matrix<T> &image, const Matrix<T> &kernel, BorderPolicy border = BORDER_ZERO,
+                    ConvolutionAlgorithm algorithm = AUTOMATIC, Execution execution = SEQUENTIAL);
+
+template <typename T>
+Matrix<T> convolve(const Matrix<T> &image, const Matrix<T> &kernel, BorderPolicy border = BORDER_ZERO,
+                   ConvolutionAlgorithm algorithm = AUTOMATIC, Execution execution = SEQUENTIAL);
+
+/**
+* function: correlate (kernel bank)
+* Usage: correlate(image, kernels)
+* -----------------------------
+* Correlates image with every kernel of the bank, reading the image once for all of them when IM2COL is used.
+@return the filtered matrices, in the order of kernels.
+@exception DimensionMismatch if the kernels do not all have the dimensions of the first one.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+std::vector< Matrix<T> > correlate(const Matrix<T> &image, const std::vector< Matrix<T> > &kernels,
+                                   BorderPolicy border = BORDER_ZERO, ConvolutionAlgorithm algorithm = AUTOMATIC,
+                                   Execution execution = SEQUENTIAL);
+
+
+/**
+* function: boxKernel / sobelKernel / laplacianKernel
+* Usage: boxKernel<float>(3)
+*        sobelKernel<float>(true)
+*        laplacianKernel<float>()
+* -----------------------------
+@return size x size kernel of T(1) / T(size * size) (box blur, meant for floating point T),
+*       3x3 Sobel derivative along the columns (horizontal gradient) or, when vertical is true, along the rows,
+*       3x3 Laplacian (4 neighbours).
+*/
+template <typename T>
+Matrix<T> boxKernel(int size);
+
+template <typename T>
+Matrix<T> sobelKernel(bool vertical = false);
+
+template <typename T>
+Matrix<T> laplacianKernel();
+
+
+/**
+* Class: Convolution<T>
+* ------------------------
+* Kernel behind correlate: the image copied once into a row-major array padded on every side by the
+* reach of the kernel, filled according to the BorderPolicy, so the inner loops never test the borders.
+* Every algorithm writes row-major height x width outputs and processes bands of output rows
+* independently, so PARALLEL runs them on the shared ThreadPool without synchronization.
+*/
+template <typename T>
+class Convolution{
+private:
+    int m_Height;
+    int m_Width;
+    int m_KernelHeight;
+    int m_KernelWidth;
+    std::size_t m_Stride;
+    std::vector<T> m_Padded;
+
+    //output columns accumulated together in a local block (kept in registers / L1) by direct.
+    static const int BLOCK = 64;
+
+    //row of the padded array, and the element that fills it at index (of count) under border.
+    const T* paddedRow(int row) const;
+    static int source(int index, int count, BorderPolicy border);
+
+    static bool separable(const T* kernel, int height, int width, std::vector<T> &column, std::vector<T> &row,
+                          T &scale, std::true_type arithmetic);
+    static bool separable(const T*, int, int, std::vector<T> &, std::vector<T> &, T &, std::false_type arithmetic);
+
+public:
+    /**
+    * Constructor: Convolution
+    * Usage: Convolution<T> convolution(image, kernel_height, kernel_width, border);
+    * ---------------------------------------
+    @exception bad_alloc will be thrown if the padded copy can not be allocated.
+    */
+    Convolution(const Matrix<T> &image, int kernel_height, int kernel_width, BorderPolicy border);
+
+    /**
+    * static function: separable
+    * Usage: Convolution<T>::separable(kernel, height, width, column, row, scale)
+    * -----------------------------
+    * Checks whether the row-major kernel equals the outer product column * row / scale, exactly for
+    * integral types and up to rounding for floating point ones. Other types are never separable.
+    @return true (and fills column, row and scale) iff the kernel is separable.
+    */
+    static bool separable(const T* kernel, int height, int width, std::vector<T> &column, std::vector<T> &row,
+                          T &scale);
+
+    /**
+    * Method: direct / separated / unfolded
+    * Usage: convolution.direct(kernel, out, execution)
+    *        convolution.separated(column, row, scale, out, execution)
+    *        convolution.unfolded(kernels, count, outs, execution)
+    * -----------------------------
+    * Correlate the image with a row-major kernel (direct), with the separable kernel column * row / scale
+    * (separated) or with count row-major kernels stored one after the other (unfolded, im2col + multiplyBlocked).
+    * Every output is a row-major height x width array.
+    */
+    void direct(const T* kernel, T* out, Execution execution) const;
+    void separated(const std::vector<T> &column, const std::vector<T> &row, const T &scale, T* out,
+                   Execution execution) const;
+    void unfolded(const T* kernels, int count, T* const* outs, Execution execution) const;
+};
+
+
+
+template <typename T>
+Convolution<T>::Convolution(const Matrix<T> &image, int kernel_height, int kernel_width, BorderPolicy border) :
+m_Height(image.height()),
+m_Width(image.width()),
+m_KernelHeight(kernel_height),
+m_KernelWidth(kernel_width),
+m_Stride((std::size_t)image.width() + kernel_width - 1),
+m_Padded(m_Stride * (image.height() + kernel_height - 1), T())
+{
+    std::vector<T> rows((std::size_t)m_Height * m_Width);
+    image.copyTo(&rows[0]);
+    int top = kernel_height / 2;
+    int left = kernel_width / 2;
+    for (int i = 0; i < m_Height + kernel_height - 1; i++)
+    {
+        int source_row = source(i - top, m_Height, border);
+        if (source_row < 0)
+        {
+            continue;
+        }
+        const T* from = &rows[(std::size_t)source_row * m_Width];
+        T* to = &m_Padded[i * m_Stride];
+        std::copy(from, from + m_Width, to + left);
+        for (int j = 0; j < left; j++)
+        {
+            int source_col = source(j - left, m_Width, border);
+            to[j] = (source_col < 0) ? T() : from[source_col];
+        }
+        for (int j = left + m_Width; j < (int)m_Stride; j++)
+        {
+            int source_col = source(j - left, m_Width, border);
+            to[j] = (source_col < 0) ? T() : from[source_col];
+        }
+    }
+}
+
+//-1 stands for a T() (BORDER_ZERO outside the matrix).
+template <typename T>
+int Convolution<T>::source(int index, int count, BorderPolicy border)
+{
+    if (index >= 0 && index < count)
+    {
+        return index;
+    }
+    if (border == BORDER_CLAMP)
+    {
+        return (index < 0) ? 0 : count - 1;
+    }
+    if (border == BORDER_WRAP)
+    {
+        return ((index % count) + count) % count;
+    }
+    return -1;
+}
+
+template <typename T>
+const T* Convolution<T>::paddedRow(int row) const
+{
+    return &m_Padded[row * m_Stride];
+}
+
+template <typename T>
+const int Convolution<T>::BLOCK;
+
+template <typename T>
+bool Convolution<T>::separable(const T* kernel, int height, int width, std::vector<T> &column,
+                               std::vector<T> &row, T &scale)
+{
+    return separable(kernel, height, width, column, row, scale,
+                     std::integral_constant<bool, std::is_arithmetic<T>::value>());
+}
+
+template <typename T>
+bool Convolution<T>::separable(const T*, int, int, std::vector<T> &, std::vector<T> &, T &, std::false_type)
+{
+    return false;
+}
+
+//The row and column through the largest element (the pivot) are compared against every element.
+template <typename T>
+bool Convolution<T>::separable(const T* kernel, int height, int width, std::vector<T> &column,
+                               std::vector<T> &row, T &scale, std::true_type)
+{
+    if (height < 2 || width < 2)
+    {
+        return false;
+    }
+    std::size_t pivot = 0;
+    for (std::size_t k = 1; k < (std::size_t)height * width; k++)
+    {
+        if (std::abs((double)kernel[k]) > std::abs((double)kernel[pivot]))
+        {
+            pivot = k;
+        }
+    }
+    scale = kernel[pivot];
+    if (scale == T())
+    {
+        return false;
+    }
+    int pivot_row = (int)(pivot / width);
+    int pivot_col = (int)(pivot % width);
+    column.resize(height);
+    row.assign(kernel + pivot_row * width, kernel + (pivot_row + 1) * width);
+    for (int i = 0; i < height; i++)
+    {
+        column[i] = kernel[i * width + pivot_col];
+    }
+    double tolerance = std::is_floating_point<T>::value ?
+        16 * std::numeric_limits<T>::epsilon() * (double)scale * (double)scale : 0;
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            if (std::abs((double)kernel[i * width + j] * (double)scale - (double)column[i] * (double)row[j]) > tolerance)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Each output row is produced BLOCK columns at a time: the block of sums stays in a local array while
+//all kernel elements are applied to it, the contiguous inner loops vectorize.
+template <typename T>
+void Convolution<T>::direct(const T* kernel, T* out, Execution execution) const
+{
+    long work = (long)m_Width * m_KernelHeight * m_KernelWidth;
+    parallelRows(m_Height, (int)std::min<long>(work, 1 << 30), execution, [&](int first, int last)
+    {
+        T sums[BLOCK];
+        for (int i = first; i < last; i++)
+        {
+            for (int j_block = 0; j_block < m_Width; j_block += BLOCK)
+            {
+                int length = std::min(BLOCK, m_Width - j_block);
+                std::fill(sums, sums + length, T());
+                for (int a = 0; a < m_KernelHeight; a++)
+                {
+                    const T* in = paddedRow(i + a) + j_block;
+                    const T* weights = kernel + a * m_KernelWidth;
+                    for (int b = 0; b < m_KernelWidth; b++)
+                    {
+                        const T weight = weights[b];
+                        if (weight == T())
+                        {
+                            continue;
+                        }
+                        const T* window = in + b;
+                        for (int j = 0; j < length; j++)
+                        {
+                            sums[j] += weight * window[j];
+                        }
+                    }
+                }
+                std::copy(sums, sums + length, out + (std::size_t)i * m_Width + j_block);
+            }
+        }
+    });
+}
+
+//A band of output rows needs the horizontal pass of its rows plus the kernel height - 1 rows below,
+//every band computes them into its own buffer (recomputing the few shared rows) and then runs the vertical pass.
+//column * row is the kernel times scale, so both passes accumulate in SumOf<T>::type and only the quotient
+//by scale is narrowed back to T: an integral output that fits T never overflows on the way.
+template <typename T>
+void Convolution<T>::separated(const std::vector<T> &column, const std::vector<T> &row, const T &scale, T* out,
+                               Execution execution) const
+{
+    typedef typename SumOf<T>::type Sum;
+    long work = (long)m_Width * (m_KernelHeight + m_KernelWidth);
+    parallelRows(m_Height, (int)std::min<long>(work, 1 << 30), execution, [&](int first, int last)
+    {
+        int rows = last - first + m_KernelHeight - 1;
+        std::vector<Sum> horizontal((std::size_t)rows * m_Width, Sum());
+        std::vector<Sum> vertical(m_Width);
+        for (int r = 0; r < rows; r++)
+        {
+            const T* in = paddedRow(first + r);
+            Sum* to = &horizontal[(std::size_t)r * m_Width];
+            for (int b = 0; b < m_KernelWidth; b++)
+            {
+                const Sum weight = row[b];
+                const T* window = in + b;
+                for (int j = 0; j < m_Width; j++)
+                {
+                    to[j] += weight * Sum(window[j]);
+                }
+            }
+        }
+        for (int i = first; i < last; i++)
+        {
+            std::fill(vertical.begin(), vertical.end(), Sum());
+            for (int a = 0; a < m_KernelHeight; a++)
+            {
+                const Sum weight = column[a];
+                const Sum* from = &horizontal[(std::size_t)(i - first + a) * m_Width];
+                for (int j = 0; j < m_Width; j++)
+                {
+                    vertical[j] += weight * from[j];
+                }
+            }
+            T* to = out + (std::size_t)i * m_Width;
+            for (int j = 0; j < m_Width; j++)
+            {
+                to[j] = T(vertical[j] / Sum(scale));
+            }
+        }
+    });
+}
+
+//The windows of a chunk of output rows are unfolded into a (kernel elements) x (chunk elements) matrix,
+//row (a, b) holding the padded rows shifted by b. The kernels (count x kernel elements) times that matrix
+//gives the chunk of every output at once. Chunks are sized so the unfolded matrix stays in L2.
+template <typename T>
+void Convolution<T>::unfolded(const T* kernels, int count, T* const* outs, Execution execution) const
+{
+    int elements = m_KernelHeight * m_KernelWidth;
+    long work = (long)m_Width * elements * count;
+    parallelRows(m_Height, (int)std::min<long>(work, 1 << 30), execution, [&](int first, int last)
+    {
+        const std::size_t target = 64 * 1024;
+        int chunk = (int)std::max<std::size_t>(1, target / ((std::size_t)elements * m_Width));
+        std::vector<T> columns((std::size_t)elements * chunk * m_Width);
+        std::vector<T> products((std::size_t)count * chunk * m_Width);
+        for (int i = first; i < last; i += chunk)
+        {
+            int chunk_rows = std::min(chunk, last - i);
+            std::size_t width = (std::size_t)chunk_rows * m_Width;
+            for (int a = 0; a < m_KernelHeight; a++)
+            {
+                for (int b = 0; b < m_KernelWidth; b++)
+                {
+                    T* to = &columns[(std::size_t)(a * m_KernelWidth + b) * width];
+                    for (int r = 0; r < chunk_rows; r++)
+                    {
+                        const T* from = paddedRow(i + r + a) + b;
+                        std::copy(from, from + m_Width, to + (std::size_t)r * m_Width);
+                    }
+                }
+            }
+            multiplyBlocked(kernels, elements, &columns[0], width, &products[0], width, count, elements, (int)width);
+            for (int k = 0; k < count; k++)
+            {
+                const T* from = &products[(std::size_t)k * width];
+                std::copy(from, from + width, outs[k] + (std::size_t)i * m_Width);
+            }
+        }
+    });
+}
+
+
+template <typename T>
+std::vector< Matrix<T> > correlate(const Matrix<T> &image, const std::vector< Matrix<T> > &kernels,
+                                   BorderPolicy border, ConvolutionAlgorithm algorithm, Execution execution)
+{
+    std::vector< Matrix<T> > filtered;
+    if (kernels.empty())
+    {
+        return filtered;
+    }
+    int kernel_height = kernels[0].height();
+    int kernel_width = kernels[0].width();
+    int count = (int)kernels.size();
+    for (int k = 1; k < count; k++)
+    {
+        if (kernels[k].height() != kernel_height || kernels[k].width() != kernel_width)
+        {
+            typename Matrix<T>::DimensionMismatch error(Dimensions(kernel_height, kernel_width),
+                                                        Dimensions(kernels[k].height(), kernels[k].width()));
+            throw error;
+        }
+    }
+    int elements = kernel_height * kernel_width;
+    std::vector<T> weights((std::size_t)count * elements);
+    for (int k = 0; k < count; k++)
+    {
+        kernels[k].copyTo(&weights[(std::size_t)k * elements]);
+    }
+
+    Convolution<T> convolution(image, kernel_height, kernel_width, border);
+    std::size_t size = (std::size_t)image.height() * image.width();
+    std::vector<T> results((std::size_t)count * size);
+    std::vector<T*> outs(count);
+    for (int k = 0; k < count; k++)
+    {
+        outs[k] = &results[(std::size_t)k * size];
+    }
+
+    if (algorithm == IM2COL ||
+        (algorithm == AUTOMATIC && count >= IM2COL_KERNELS && elements > 1))
+    {
+        convolution.unfolded(&weights[0], count, &outs[0], execution);
+    }
+    else
+    {
+        std::vector<T> column, row;
+        T scale = T();
+        const bool widened = !std::is_integral<T>::value || sizeof(typename SumOf<T>::type) > sizeof(T);
+        for (int k = 0; k < count; k++)
+        {
+            const T* kernel = &weights[(std::size_t)k * elements];
+            if (algorithm != DIRECT && widened &&
+                Convolution<T>::separable(kernel, kernel_height, kernel_width, column, row, scale))
+            {
+                convolution.separated(column, row, scale, outs[k], execution);
+            }
+            else
+            {
+                convolution.direct(kernel, outs[k], execution);
+            }
+        }
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        filtered.push_back(Matrix<T>(Dimensions(image.height(), image.width()), T(), image.sharing(),
+                                     image.layout(), image.memory()));
+        filtered.back().copyFrom(outs[k]);
+    }
+    return filtered;
+}
+
+template <typename T>
+Matrix<T> correlate(const Matrix<T> &image, const Matrix<T> &kernel, BorderPolicy border,
+                    ConvolutionAlgorithm algorithm, Execution execution)
+{
+    return correlate(image, std::vector< Matrix<T> >(1, kernel), border, algorithm, execution)[0];
+}
+
+template <typename T>
+Matrix<T> convolve(const Matrix<T> &image, const Matrix<T> &kernel, BorderPolicy border,
+                   ConvolutionAlgorithm algorithm, Execution execution)
+{
+    Matrix<T> flipped(Dimensions(kernel.height(), kernel.width()));
+    for (int i = 0; i < kernel.height(); i++)
+    {
+        for (int j = 0; j < kernel.width(); j++)
+        {
+            flipped(kernel.height() - 1 - i, kernel.width() - 1 - j) = kernel(i, j);
+        }
+    }
+    return correlate(image, flipped, border, algorithm, execution);
+}
+
+
+template <typename T>
+Matrix<T> boxKernel(int size)
+{
+    return Matrix<T>(Dimensions(size, size), T(1) / T(size * size));
+}
+
+template <typename T>
+Matrix<T> sobelKernel(bool vertical)
+{
+    const int weights[3][3] = { { -1, 0, 1 }, { -2, 0, 2 }, { -1, 0, 1 } };
+    Matrix<T> kernel(Dimensions(3, 3));
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            kernel(i, j) = T(vertical ? weights[j][i] : weights[i][j]);
+        }
+    }
+    return kernel;
+}
+
+template <typename T>
+Matrix<T> laplacianKernel()
+{
+    Matrix<T> kernel(Dimensions(3, 3));
+    kernel(0, 1) = T(1);
+    kernel(1, 0) = T(1);
+    kernel(1, 1) = T(-4);
+    kernel(1, 2) = T(1);
+    kernel(2, 1) = T(1);
+    return kernel;
+}
+}
+
+#endif /* MatrixConvolve_h */
@@ -0,0 +1,1054 @@
+//
+//  MatrixDecompose.h
+//  Matrix
+//
+/*
+ This file exports spectral decompositions of real matrices: the symmetric eigendecomposition
+ (blocked Householder reduction to tridiagonal form followed by implicit QL iteration), the dominant
+ eigenpairs by subspace (block power) iteration, and a truncated SVD by randomized range finding.
+ The O(n^3) parts are products of multiplyBlocked, run on the shared ThreadPool when PARALLEL.
+*/
+#ifndef MatrixDecompose_h
+#define MatrixDecompose_h
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "MatrixMultiply.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+//Panel width of the tridiagonal reduction and block of reflectors applied at once when they are
+//accumulated: wide enough for the rank 2k updates to run at multiplyBlocked speed.
+const int DECOMPOSE_BLOCK = 32;
+
+//Vectors SymmetricEigen::dominant iterates beyond the k requested: the error of the k-th pair shrinks by
+//|lambda(k + extra + 1) / lambda(k)| per iteration instead of |lambda(k + 1) / lambda(k)|.
+const int DOMINANT_EXTRA_VECTORS = 8;
+
+
+/**
+* function: orthonormalizeRows
+* Usage: orthonormalizeRows(rows, count, length, random)
+* -----------------------------
+* Modified Gram-Schmidt, applied twice, on count contiguous rows of length elements: on return they are
+* orthonormal and span the same space. A row that is (numerically) dependent on the previous ones is
+* replaced by a random one, so rank deficient blocks still give count orthonormal rows.
+@param execution - PARALLEL projects the remaining rows out in bands on the shared ThreadPool.
+@remarks (assumptions) count <= length.
+*/
+template <typename T>
+void orthonormalizeRows(T* rows, int count, int length, std::mt19937 &random, Execution execution = SEQUENTIAL);
+
+
+/**
+* Class: SymmetricEigen<T>
+* ------------------------
+* Eigendecomposition a = V diag(values) V^T of a real symmetric matrix, T is float, double or long double.
+* values is a column (n x 1) in decreasing order, the columns of V the orthonormal eigenvectors, each with
+* its largest component (in absolute value) positive so the result does not depend on the algorithm's signs.
+* Only the lower triangle (and the diagonal) of a is read.
+*/
+template <typename T>
+class SymmetricEigen{
+private:
+    static_assert(std::is_floating_point<T>::value, "SymmetricEigen elements are float, double or long double");
+
+    Matrix<T> m_Values;
+    Matrix<T> m_Vectors;
+
+    SymmetricEigen(const Matrix<T> &values, const Matrix<T> &vectors);
+
+    static SymmetricEigen decompose(const Matrix<T> &a, Execution execution);
+
+    //throws DimensionMismatch unless a is square, then copies it to a full symmetric row-major array.
+    static std::vector<T> symmetricRows(const Matrix<T> &a);
+
+    //Reduces the n x n row-major symmetric a to tridiagonal form Q^T a Q: diagonal d, subdiagonal e
+    //(e[n - 1] = 0). Reflector k (I - tau[k] v v^T, v[k + 1] = 1) is left in column k below the subdiagonal.
+    static void tridiagonalize(T* a, int n, T* d, T* e, T* tau, Execution execution);
+
+    //q = the product of the reflectors left in a by tridiagonalize, applied DECOMPOSE_BLOCK at a time.
+    static void accumulate(const T* a, const T* tau, int n, T* q, Execution execution);
+
+    //Implicit QL iteration on the tridiagonal d, e: on return d holds the eigenvalues. The rotations of
+    //every sweep are applied to the rows of the n x n row-major z, unless z is NULL.
+    static void diagonalize(T* d, T* e, int n, T* z, Execution execution);
+
+    //full decomposition of the n x n row-major symmetric a, values decreasing, vectors in the columns of a.
+    static void solve(std::vector<T> &a, int n, std::vector<T> &values, Execution execution);
+
+public:
+    /**
+    * Constructor: SymmetricEigen
+    * Usage: SymmetricEigen<double> eigen(a);
+    *        SymmetricEigen<double> eigen(a, mtm::PARALLEL);
+    * ---------------------------------------
+    * Full decomposition of the n x n symmetric matrix a, in O(n^3).
+    @param execution - PARALLEL runs the rank 2k updates, the accumulation of the reflectors and the QL
+    *                  rotations on the shared ThreadPool (default SEQUENTIAL).
+    @exception DimensionMismatch if a is not square.
+    @exception NoConvergence if the QL iteration stalls (not expected for finite elements).
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    explicit SymmetricEigen(const Matrix<T> &a, Execution execution = SEQUENTIAL);
+
+    /**
+    * static function: eigenvalues
+    * Usage: SymmetricEigen<double>::eigenvalues(a)
+    * -----------------------------
+    * The eigenvalues alone: same reduction, but no eigenvectors are accumulated or rotated.
+    @return the n x 1 column of the eigenvalues in decreasing order.
+    @exception DimensionMismatch, NoConvergence, bad_alloc - as the constructor.
+    */
+    static Matrix<T> eigenvalues(const Matrix<T> &a, Execution execution = SEQUENTIAL);
+
+    /**
+    * static function: dominant
+    * Usage: SymmetricEigen<double>::dominant(a, k)
+    *        SymmetricEigen<double>::dominant(a, k, 1e-10, 500, mtm::PARALLEL)
+    * -----------------------------
+    * The k eigenpairs of largest magnitude, by subspace iteration with Rayleigh-Ritz projection: every
+    * iteration multiplies a block of k + DOMINANT_EXTRA_VECTORS vectors by a (O(n^2 k)), so for k << n it
+    * is much cheaper than the full decomposition when the spectrum decays. The start block is random with
+    * a fixed seed, results are reproducible.
+    @param tolerance - stop when |a x - lambda x| <= tolerance * |lambda_max| for the k pairs.
+    @param iterations - most products with a before NoConvergence is thrown.
+    @return values (k x 1) in decreasing order of magnitude and vectors (n x k).
+    @exception DimensionMismatch if a is not square.
+    @exception IllegalRank if k is not in [1, n].
+    @exception NoConvergence if tolerance is not reached within iterations.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    static SymmetricEigen dominant(const Matrix<T> &a, int k,
+                                   T tolerance = std::sqrt(std::numeric_limits<T>::epsilon()),
+                                   int iterations = 1000, Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: values / vectors
+    * Usage: eigen.values()
+    *        eigen.vectors()
+    * -----------------------------
+    @return the eigenvalues as a column, and the matching eigenvectors as the columns of a matrix.
+    */
+    const Matrix<T> &values() const;
+    const Matrix<T> &vectors() const;
+
+    /**
+    * Exception: IllegalRank
+    * thrown for a requested number of pairs that is not positive or exceeds the dimension.
+    */
+    struct IllegalRank : public std::exception
+    {
+        const char *what() const throw();
+    };
+
+    /**
+    * Exception: NoConvergence
+    * thrown when an iteration does not reach its tolerance within its iteration limit.
+    */
+    struct NoConvergence : public std::exception
+    {
+        const char *what() const throw();
+    };
+};
+
+
+/**
+* Class: TruncatedSVD<T>
+* ------------------------
+* Rank k approximation a ~ U diag(singular) V^T of an m x n matrix (randomized SVD of Halko, Martinsson and
+* Tropp): the range of a is sampled with k + oversampling random vectors, sharpened by power iterations
+* (a a^T) and orthonormalized into Q; the small matrix Q^T a is then decomposed exactly by one-sided
+* Jacobi rotations, which keep the relative accuracy of small singular values. The products with a and
+* a^T are the only O(mn) work, so tall (or wide) matrices with a decaying spectrum are cheap to compress.
+* With k + oversampling >= min(m, n) the decomposition is exact up to rounding.
+* U is m x k and V is n x k with orthonormal columns, singular is k x 1 in decreasing order. Each column
+* of U has its largest component (in absolute value) positive, V follows.
+*/
+template <typename T>
+class TruncatedSVD{
+private:
+    static_assert(std::is_floating_point<T>::value, "TruncatedSVD elements are float, double or long double");
+
+    Matrix<T> m_U;
+    Matrix<T> m_Singular;
+    Matrix<T> m_V;
+
+    TruncatedSVD(const Matrix<T> &u, const Matrix<T> &singular, const Matrix<T> &v);
+
+    static TruncatedSVD decompose(const Matrix<T> &a, int rank, int oversampling, int power_iterations,
+                                  Execution execution);
+
+    //Rotates the count rows of b (of length elements) until they are orthogonal, applying the same rotations
+    //to the count x count row-major j (so j b is invariant). Disjoint pairs of a round are rotated in parallel.
+    static void orthogonalizeRows(T* b, int count, int length, T* j, Execution execution);
+
+public:
+    /**
+    * Constructor: TruncatedSVD
+    * Usage: TruncatedSVD<double> svd(a, 10);
+    *        TruncatedSVD<double> svd(a, 10, 20, 3, mtm::PARALLEL);
+    * ---------------------------------------
+    @param rank - k, the number of singular triplets kept.
+    @param oversampling - extra random samples of the range (default 10), more give a better subspace.
+    @param power_iterations - products with a a^T applied to the samples (default 2), needed when the
+    *                         singular values decay slowly.
+    @param execution - PARALLEL runs the products and the rotations on the shared ThreadPool (default SEQUENTIAL).
+    @exception IllegalRank if rank is not in [1, min(m, n)] or oversampling / power_iterations are negative.
+    @exception NoConvergence if the Jacobi rotations do not converge (not expected for finite elements).
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    TruncatedSVD(const Matrix<T> &a, int rank, int oversampling = 10, int power_iterations = 2,
+                 Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: u / singularValues / v
+    * Usage: svd.u()
+    *        svd.singularValues()
+    *        svd.v()
+    * -----------------------------
+    @return the left singular vectors (m x k), the singular values (k x 1), the right singular vectors (n x k).
+    */
+    const Matrix<T> &u() const;
+    const Matrix<T> &singularValues() const;
+    const Matrix<T> &v() const;
+
+    /**
+    * Exception: IllegalRank
+    * thrown for a rank outside [1, min(m, n)], or negative oversampling or power iterations.
+    */
+    struct IllegalRank : public std::exception
+    {
+        const char *what() const throw();
+    };
+
+    /**
+    * Exception: NoConvergence
+    * thrown when the Jacobi sweeps do not orthogonalize the projected matrix.
+    */
+    struct NoConvergence : public std::exception
+    {
+        const char *what() const throw();
+    };
+};
+
+
+
+template <typename T>
+void orthonormalizeRows(T* rows, int count, int length, std::mt19937 &random, Execution execution)
+{
+    //a row keeping less than this fraction of its norm after the projections is taken as dependent.
+    const T dependent = T(64) * std::numeric_limits<T>::epsilon();
+    std::normal_distribution<double> gaussian;
+    std::vector<T> norms(count);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            T* row = rows + (std::size_t)i * length;
+            norms[i] = std::sqrt(std::inner_product(row, row + length, row, T()));
+        }
+        for (int i = 0; i < count; i++)
+        {
+            T* row = rows + (std::size_t)i * length;
+            T norm = std::sqrt(std::inner_product(row, row + length, row, T()));
+            if (!(norm > dependent * norms[i]))
+            {
+                for (int k = 0; k < length; k++)
+                {
+                    row[k] = (T)gaussian(random);
+                }
+                for (int again = 0; again < 2; again++)
+                {
+                    for (int previous = 0; previous < i; previous++)
+                    {
+                        const T* basis = rows + (std::size_t)previous * length;
+                        multiplyAddRun(-std::inner_product(row, row + length, basis, T()), basis, row, length);
+                    }
+                }
+                norm = std::sqrt(std::inner_product(row, row + length, row, T()));
+            }
+            std::transform(row, row + length, row, [norm](const T &x) { return x / norm; });
+            parallelRows(count - i - 1, length, execution, [&](int first, int last)
+            {
+                for (int r = i + 1 + first; r < i + 1 + last; r++)
+                {
+                    T* other = rows + (std::size_t)r * length;
+                    multiplyAddRun(-std::inner_product(other, other + length, row, T()), row, other, length);
+                }
+            });
+        }
+    }
+}
+
+
+template <typename T>
+SymmetricEigen<T>::SymmetricEigen(const Matrix<T> &values, const Matrix<T> &vectors) :
+m_Values(values),
+m_Vectors(vectors)
+{
+}
+
+template <typename T>
+SymmetricEigen<T>::SymmetricEigen(const Matrix<T> &a, Execution execution) :
+SymmetricEigen(decompose(a, execution))
+{
+}
+
+template <typename T>
+std::vector<T> SymmetricEigen<T>::symmetricRows(const Matrix<T> &a)
+{
+    if (a.height() != a.width())
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(a.height(), a.width()),
+                                                    Dimensions(a.width(), a.height()));
+        throw error;
+    }
+    int n = a.height();
+    std::vector<T> rows((std::size_t)n * n);
+    a.copyTo(&rows[0]);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = i + 1; j < n; j++)
+        {
+            rows[(std::size_t)i * n + j] = rows[(std::size_t)j * n + i];
+        }
+    }
+    return rows;
+}
+
+//Blocked reduction (LAPACK's sytrd / latrd): the reflectors of a panel only update its own columns,
+//the trailing matrix receives them at once as a -= V W^T + W V^T through multiplyBlocked.
+template <typename T>
+void SymmetricEigen<T>::tridiagonalize(T* a, int n, T* d, T* e, T* tau, Execution execution)
+{
+    int reflectors = std::max(0, n - 2);
+    for (int k0 = 0; k0 < reflectors; k0 += DECOMPOSE_BLOCK)
+    {
+        int nb = std::min(DECOMPOSE_BLOCK, reflectors - k0);
+        //rows k0 .. n - 1 of the panel's reflectors V and of W, its updates.
+        std::vector<T> v((std::size_t)(n - k0) * nb, T());
+        std::vector<T> w((std::size_t)(n - k0) * nb, T());
+        std::vector<T> vk(n);
+        std::vector<T> vt(nb);
+        std::vector<T> wt(nb);
+        for (int i = 0; i < nb; i++)
+        {
+            int k = k0 + i;
+            const T* v_k = &v[(std::size_t)(k - k0) * nb];
+            const T* w_k = &w[(std::size_t)(k - k0) * nb];
+            for (int r = k; r < n; r++)
+            {
+                const T* v_r = &v[(std::size_t)(r - k0) * nb];
+                const T* w_r = &w[(std::size_t)(r - k0) * nb];
+                T sum = T();
+                for (int j = 0; j < i; j++)
+                {
+                    sum += v_r[j] * w_k[j] + w_r[j] * v_k[j];
+                }
+                a[(std::size_t)r * n + k] -= sum;
+            }
+            d[k] = a[(std::size_t)k * n + k];
+
+            //reflector taking column k below the diagonal to (beta, 0, ..., 0).
+            T alpha = a[(std::size_t)(k + 1) * n + k];
+            T tail = T();
+            for (int r = k + 2; r < n; r++)
+            {
+                tail += a[(std::size_t)r * n + k] * a[(std::size_t)r * n + k];
+            }
+            tau[k] = T();
+            e[k] = alpha;
+            if (tail != T())
+            {
+                T beta = -std::copysign(std::sqrt(alpha * alpha + tail), alpha);
+                tau[k] = (beta - alpha) / beta;
+                e[k] = beta;
+                for (int r = k + 2; r < n; r++)
+                {
+                    a[(std::size_t)r * n + k] /= alpha - beta;
+                }
+            }
+            int length = n - k - 1;
+            vk[0] = T(1);
+            for (int r = 1; r < length; r++)
+            {
+                vk[r] = a[(std::size_t)(k + 1 + r) * n + k];
+            }
+            for (int r = 0; r < length; r++)
+            {
+                v[(std::size_t)(k + 1 + r - k0) * nb + i] = vk[r];
+            }
+            if (tau[k] == T())
+            {
+                continue;
+            }
+
+            //w = tau (S - V W^T - W V^T) v, S the trailing matrix as it was when the panel started.
+            for (int j = 0; j < i; j++)
+            {
+                vt[j] = T();
+                wt[j] = T();
+                for (int r = 0; r < length; r++)
+                {
+                    vt[j] += v[(std::size_t)(k + 1 + r - k0) * nb + j] * vk[r];
+                    wt[j] += w[(std::size_t)(k + 1 + r - k0) * nb + j] * vk[r];
+                }
+            }
+            const T scale = tau[k];
+            parallelRows(length, length, execution, [&](int first, int last)
+            {
+                for (int r = first; r < last; r++)
+                {
+                    const T* s_row = a + (std::size_t)(k + 1 + r) * n + k + 1;
+                    T sum = std::inner_product(s_row, s_row + length, &vk[0], T());
+                    const T* v_r = &v[(std::size_t)(k + 1 + r - k0) * nb];
+                    const T* w_r = &w[(std::size_t)(k + 1 + r - k0) * nb];
+                    for (int j = 0; j < i; j++)
+                    {
+                        sum -= v_r[j] * wt[j] + w_r[j] * vt[j];
+                    }
+                    w[(std::size_t)(k + 1 + r - k0) * nb + i] = scale * sum;
+                }
+            });
+            T dot = T();
+            for (int r = 0; r < length; r++)
+            {
+                dot += w[(std::size_t)(k + 1 + r - k0) * nb + i] * vk[r];
+            }
+            T correction = scale * dot / T(2);
+            for (int r = 0; r < length; r++)
+            {
+                w[(std::size_t)(k + 1 + r - k0) * nb + i] -= correction * vk[r];
+            }
+        }
+
+        //trailing matrix -= [V W] [W V]^T.
+        int start = k0 + nb;
+        int trailing = n - start;
+        std::vector<T> x((std::size_t)trailing * 2 * nb);
+        std::vector<T> y((std::size_t)2 * nb * trailing);
+        for (int r = 0; r < trailing; r++)
+        {
+            for (int j = 0; j < nb; j++)
+            {
+                T v_rj = v[(std::size_t)(start + r - k0) * nb + j];
+                T w_rj = w[(std::size_t)(start + r - k0) * nb + j];
+                x[(std::size_t)r * 2 * nb + j] = v_rj;
+                x[(std::size_t)r * 2 * nb + nb + j] = w_rj;
+                y[(std::size_t)j * trailing + r] = w_rj;
+                y[(std::size_t)(nb + j) * trailing + r] = v_rj;
+            }
+        }
+        parallelRows(trailing, trailing * nb, execution, [&](int first, int last)
+        {
+            std::vector<T> product((std::size_t)DECOMPOSE_BLOCK * trailing);
+            for (int band = first; band < last; band += DECOMPOSE_BLOCK)
+            {
+                int rows = std::min(DECOMPOSE_BLOCK, last - band);
+                multiplyBlocked(&x[(std::size_t)band * 2 * nb], 2 * nb, &y[0], trailing, &product[0], trailing,
+                                rows, 2 * nb, trailing);
+                for (int r = 0; r < rows; r++)
+                {
+                    T* a_row = a + (std::size_t)(start + band + r) * n + start;
+                    const T* p_row = &product[(std::size_t)r * trailing];
+                    for (int c = 0; c < trailing; c++)
+                    {
+                        a_row[c] -= p_row[c];
+                    }
+                }
+            }
+        });
+    }
+    if (n >= 2)
+    {
+        d[n - 2] = a[(std::size_t)(n - 2) * n + n - 2];
+        e[n - 2] = a[(std::size_t)(n - 1) * n + n - 2];
+    }
+    d[n - 1] = a[(std::size_t)(n - 1) * n + n - 1];
+    e[n - 1] = T();
+}
+
+//Blocks of reflectors H = I - V T V^T (T upper triangular, LAPACK's larft) are applied from the last to
+//the first, each to bands of columns of q: q -= V (T (V^T q)), three products of multiplyBlocked.
+template <typename T>
+void SymmetricEigen<T>::accumulate(const T* a, const T* tau, int n, T* q, Execution execution)
+{
+    std::fill(q, q + (std::size_t)n * n, T());
+    for (int i = 0; i < n; i++)
+    {
+        q[(std::size_t)i * n + i] = T(1);
+    }
+    int reflectors = std::max(0, n - 2);
+    if (reflectors == 0)
+    {
+        return;
+    }
+    const int band_width = 64;
+    for (int j0 = (reflectors - 1) / DECOMPOSE_BLOCK * DECOMPOSE_BLOCK; j0 >= 0; j0 -= DECOMPOSE_BLOCK)
+    {
+        int nb = std::min(DECOMPOSE_BLOCK, reflectors - j0);
+        int length = n - j0 - 1;
+        //vt (nb x length): the reflectors as rows, v (length x nb) as columns, both over rows j0 + 1 .. n - 1.
+        std::vector<T> vt((std::size_t)nb * length, T());
+        for (int i = 0; i < nb; i++)
+        {
+            int j = j0 + i;
+            vt[(std::size_t)i * length + i] = T(1);
+            for (int r = i + 1; r < length; r++)
+            {
+                vt[(std::size_t)i * length + r] = a[(std::size_t)(j0 + 1 + r) * n + j];
+            }
+        }
+        std::vector<T> v((std::size_t)length * nb);
+        transposeArray(&vt[0], nb, length, &v[0]);
+        std::vector<T> t((std::size_t)nb * nb, T());
+        for (int i = 0; i < nb; i++)
+        {
+            const T* v_i = &vt[(std::size_t)i * length];
+            std::vector<T> z(i);
+            for (int j = 0; j < i; j++)
+            {
+                z[j] = -tau[j0 + i] * std::inner_product(v_i, v_i + length, &vt[(std::size_t)j * length], T());
+            }
+            for (int r = 0; r < i; r++)
+            {
+                T sum = T();
+                for (int c = r; c < i; c++)
+                {
+                    sum += t[(std::size_t)r * nb + c] * z[c];
+                }
+                t[(std::size_t)r * nb + i] = sum;
+            }
+            t[(std::size_t)i * nb + i] = tau[j0 + i];
+        }
+        T* block = q + (std::size_t)(j0 + 1) * n + j0 + 1;
+        int bands = (length + band_width - 1) / band_width;
+        parallelRows(bands, length * band_width, execution, [&](int first, int last)
+        {
+            std::vector<T> projected((std::size_t)nb * band_width);
+            std::vector<T> scaled((std::size_t)nb * band_width);
+            std::vector<T> update((std::size_t)length * band_width);
+            for (int b = first; b < last; b++)
+            {
+                int c0 = b * band_width;
+                int width = std::min(band_width, length - c0);
+                multiplyBlocked(&vt[0], length, block + c0, n, &projected[0], width, nb, length, width);
+                multiplyBlocked(&t[0], nb, &projected[0], width, &scaled[0], width, nb, nb, width);
+                multiplyBlocked(&v[0], nb, &scaled[0], width, &update[0], width, length, nb, width);
+                for (int r = 0; r < length; r++)
+                {
+                    T* q_row = block + (std::size_t)r * n + c0;
+                    const T* u_row = &update[(std::size_t)r * width];
+                    for (int c = 0; c < width; c++)
+                    {
+                        q_row[c] -= u_row[c];
+                    }
+                }
+            }
+        });
+    }
+}
+
+//tql2 of EISPACK. The rotations of a sweep are recorded and then applied row by row to z, so every
+//row of z is read once per sweep and bands of rows are independent.
+template <typename T>
+void SymmetricEigen<T>::diagonalize(T* d, T* e, int n, T* z, Execution execution)
+{
+    const int max_sweeps = 60;
+    const T epsilon = std::numeric_limits<T>::epsilon();
+    std::vector<T> cosines(n);
+    std::vector<T> sines(n);
+    T shift = T();
+    T largest = T();
+    for (int l = 0; l < n; l++)
+    {
+        largest = std::max(largest, std::abs(d[l]) + std::abs(e[l]));
+        int m = l;
+        while (m < n - 1 && !(std::abs(e[m]) <= epsilon * largest))
+        {
+            m++;
+        }
+        int sweeps = 0;
+        while (m > l && std::abs(e[l]) > epsilon * largest)
+        {
+            if (++sweeps > max_sweeps)
+            {
+                NoConvergence error;
+                throw error;
+            }
+            T g = d[l];
+            T p = (d[l + 1] - g) / (T(2) * e[l]);
+            T r = std::copysign(std::hypot(p, T(1)), p);
+            d[l] = e[l] / (p + r);
+            d[l + 1] = e[l] * (p + r);
+            T next = d[l + 1];
+            T h = g - d[l];
+            for (int i = l + 2; i < n; i++)
+            {
+                d[i] -= h;
+            }
+            shift += h;
+            p = d[m];
+            T c = T(1);
+            T c2 = c;
+            T c3 = c;
+            T e_next = e[l + 1];
+            T s = T();
+            T s2 = T();
+            for (int i = m - 1; i >= l; i--)
+            {
+                c3 = c2;
+                c2 = c;
+                s2 = s;
+                g = c * e[i];
+                h = c * p;
+                r = std::hypot(p, e[i]);
+                e[i + 1] = s * r;
+                s = e[i] / r;
+                c = p / r;
+                p = c * d[i] - s * g;
+                d[i + 1] = h + s * (c * g + s * d[i]);
+                cosines[i] = c;
+                sines[i] = s;
+            }
+            p = -s * s2 * c3 * e_next * e[l] / next;
+            e[l] = s * p;
+            d[l] = c * p;
+            if (z != NULL)
+            {
+                parallelRows(n, m - l, execution, [&](int first, int last)
+                {
+                    for (int row = first; row < last; row++)
+                    {
+                        T* z_row = z + (std::size_t)row * n;
+                        for (int i = m - 1; i >= l; i--)
+                        {
+                            T rotated = z_row[i + 1];
+                            z_row[i + 1] = sines[i] * z_row[i] + cosines[i] * rotated;
+                            z_row[i] = cosines[i] * z_row[i] - sines[i] * rotated;
+                        }
+                    }
+                });
+            }
+        }
+        d[l] += shift;
+        e[l] = T();
+    }
+}
+
+template <typename T>
+void SymmetricEigen<T>::solve(std::vector<T> &a, int n, std::vector<T> &values, Execution execution)
+{
+    std::vector<T> d(n);
+    std::vector<T> e(n);
+    std::vector<T> tau(n);
+    tridiagonalize(&a[0], n, &d[0], &e[0], &tau[0], execution);
+    std::vector<T> z((std::size_t)n * n);
+    accumulate(&a[0], &tau[0], n, &z[0], execution);
+    diagonalize(&d[0], &e[0], n, &z[0], execution);
+
+    std::vector<int> order(n);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int x, int y) { return d[x] > d[y]; });
+    values.resize(n);
+    for (int j = 0; j < n; j++)
+    {
+        values[j] = d[order[j]];
+        int largest = 0;
+        for (int i = 1; i < n; i++)
+        {
+            if (std::abs(z[(std::size_t)i * n + order[j]]) > std::abs(z[(std::size_t)largest * n + order[j]]))
+            {
+                largest = i;
+            }
+        }
+        T sign = z[(std::size_t)largest * n + order[j]] < T() ? T(-1) : T(1);
+        for (int i = 0; i < n; i++)
+        {
+            a[(std::size_t)i * n + j] = sign * z[(std::size_t)i * n + order[j]];
+        }
+    }
+}
+
+template <typename T>
+SymmetricEigen<T> SymmetricEigen<T>::decompose(const Matrix<T> &a, Execution execution)
+{
+    std::vector<T> rows = symmetricRows(a);
+    int n = a.height();
+    std::vector<T> values;
+    solve(rows, n, values, execution);
+    Matrix<T> value_column(Dimensions(n, 1), T(), a.sharing(), a.layout(), a.memory());
+    value_column.copyFrom(&values[0]);
+    Matrix<T> vectors(Dimensions(n, n), T(), a.sharing(), a.layout(), a.memory());
+    vectors.copyFrom(&rows[0]);
+    return SymmetricEigen(value_column, vectors);
+}
+
+template <typename T>
+Matrix<T> SymmetricEigen<T>::eigenvalues(const Matrix<T> &a, Execution execution)
+{
+    std::vector<T> rows = symmetricRows(a);
+    int n = a.height();
+    std::vector<T> d(n);
+    std::vector<T> e(n);
+    std::vector<T> tau(n);
+    tridiagonalize(&rows[0], n, &d[0], &e[0], &tau[0], execution);
+    diagonalize(&d[0], &e[0], n, NULL, execution);
+    std::sort(d.begin(), d.end(), [](const T &x, const T &y) { return x > y; });
+    Matrix<T> values(Dimensions(n, 1), T(), a.sharing(), a.layout(), a.memory());
+    values.copyFrom(&d[0]);
+    return values;
+}
+
+//Subspace iteration: q holds the block as rows, z = a q^T is one multiplyBlocked product per iteration,
+//the Ritz pairs come from the small symmetric q z, solved with the full decomposition.
+template <typename T>
+SymmetricEigen<T> SymmetricEigen<T>::dominant(const Matrix<T> &a, int k, T tolerance, int iterations,
+                                              Execution execution)
+{
+    std::vector<T> rows = symmetricRows(a);
+    int n = a.height();
+    if (k < 1 || k > n)
+    {
+        IllegalRank error;
+        throw error;
+    }
+    int size = std::min(n, k + DOMINANT_EXTRA_VECTORS);
+    std::mt19937 random(5489u);
+    std::normal_distribution<double> gaussian;
+    std::vector<T> q((std::size_t)size * n);
+    for (std::size_t i = 0; i < q.size(); i++)
+    {
+        q[i] = (T)gaussian(random);
+    }
+    orthonormalizeRows(&q[0], size, n, random, execution);
+
+    std::vector<T> q_columns((std::size_t)n * size);
+    std::vector<T> z((std::size_t)n * size);
+    std::vector<T> projected((std::size_t)size * size);
+    std::vector<T> ritz;
+    std::vector<T> x((std::size_t)n * size);
+    std::vector<T> ax((std::size_t)n * size);
+    std::vector<int> order(size);
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        transposeArray(&q[0], size, n, &q_columns[0]);
+        multiplyBlocked(&rows[0], n, &q_columns[0], size, &z[0], size, n, n, size, execution);
+        multiplyBlocked(&q[0], n, &z[0], size, &projected[0], size, size, n, size);
+        for (int i = 0; i < size; i++)
+        {
+            for (int j = 0; j < i; j++)
+            {
+                T mean = (projected[(std::size_t)i * size + j] + projected[(std::size_t)j * size + i]) / T(2);
+                projected[(std::size_t)i * size + j] = mean;
+                projected[(std::size_t)j * size + i] = mean;
+            }
+        }
+        solve(projected, size, ritz, SEQUENTIAL);
+        multiplyBlocked(&q_columns[0], size, &projected[0], size, &x[0], size, n, size, size, execution);
+        multiplyBlocked(&z[0], size, &projected[0], size, &ax[0], size, n, size, size, execution);
+
+        for (int i = 0; i < size; i++)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&](int i, int j) { return std::abs(ritz[i]) > std::abs(ritz[j]); });
+        T bound = tolerance * std::abs(ritz[order[0]]);
+        bool converged = true;
+        for (int j = 0; j < k && converged; j++)
+        {
+            T residual = T();
+            for (int i = 0; i < n; i++)
+            {
+                T difference = ax[(std::size_t)i * size + order[j]] - ritz[order[j]] * x[(std::size_t)i * size + order[j]];
+                residual += difference * difference;
+            }
+            converged = std::sqrt(residual) <= bound;
+        }
+        if (converged)
+        {
+            Matrix<T> values(Dimensions(k, 1), T(), a.sharing(), a.layout(), a.memory());
+            Matrix<T> vectors(Dimensions(n, k), T(), a.sharing(), a.layout(), a.memory());
+            std::vector<T> vector_rows((std::size_t)n * k);
+            for (int j = 0; j < k; j++)
+            {
+                values(j, 0) = ritz[order[j]];
+                for (int i = 0; i < n; i++)
+                {
+                    vector_rows[(std::size_t)i * k + j] = x[(std::size_t)i * size + order[j]];
+                }
+            }
+            vectors.copyFrom(&vector_rows[0]);
+            return SymmetricEigen(values, vectors);
+        }
+        transposeArray(&z[0], n, size, &q[0]);
+        orthonormalizeRows(&q[0], size, n, random, execution);
+    }
+    NoConvergence error;
+    throw error;
+}
+
+template <typename T>
+const Matrix<T> &SymmetricEigen<T>::values() const
+{
+    return m_Values;
+}
+
+template <typename T>
+const Matrix<T> &SymmetricEigen<T>::vectors() const
+{
+    return m_Vectors;
+}
+
+template <typename T>
+const char *SymmetricEigen<T>::IllegalRank::what() const throw()
+{
+    return "Mtm decomposition error: Illegal rank";
+}
+
+template <typename T>
+const char *SymmetricEigen<T>::NoConvergence::what() const throw()
+{
+    return "Mtm decomposition error: No convergence";
+}
+
+
+template <typename T>
+TruncatedSVD<T>::TruncatedSVD(const Matrix<T> &u, const Matrix<T> &singular, const Matrix<T> &v) :
+m_U(u),
+m_Singular(singular),
+m_V(v)
+{
+}
+
+template <typename T>
+TruncatedSVD<T>::TruncatedSVD(const Matrix<T> &a, int rank, int oversampling, int power_iterations,
+                              Execution execution) :
+TruncatedSVD(decompose(a, rank, oversampling, power_iterations, execution))
+{
+}
+
+//Hestenes' one-sided Jacobi on rows, in round robin order: count - 1 rounds of count / 2 disjoint pairs
+//make a sweep, and sweeps repeat until none rotates.
+template <typename T>
+void TruncatedSVD<T>::orthogonalizeRows(T* b, int count, int length, T* j, Execution execution)
+{
+    const int max_sweeps = 60;
+    const T epsilon = std::numeric_limits<T>::epsilon();
+    int players = count + count % 2;
+    std::vector<int> seats(players);
+    for (int i = 0; i < players; i++)
+    {
+        seats[i] = i;
+    }
+    std::vector<char> rotated(players / 2);
+    for (int sweep = 0; sweep < max_sweeps; sweep++)
+    {
+        bool any_rotation = false;
+        for (int round = 0; round < players - 1; round++)
+        {
+            parallelRows(players / 2, length, execution, [&](int first, int last)
+            {
+                for (int pair = first; pair < last; pair++)
+                {
+                    rotated[pair] = 0;
+                    int p = std::min(seats[pair], seats[players - 1 - pair]);
+                    int q = std::max(seats[pair], seats[players - 1 - pair]);
+                    if (q >= count)
+                    {
+                        continue;
+                    }
+                    T* b_p = b + (std::size_t)p * length;
+                    T* b_q = b + (std::size_t)q * length;
+                    T alpha = std::inner_product(b_p, b_p + length, b_p, T());
+                    T beta = std::inner_product(b_q, b_q + length, b_q, T());
+                    T gamma = std::inner_product(b_p, b_p + length, b_q, T());
+                    if (!(std::abs(gamma) > epsilon * std::sqrt(alpha) * std::sqrt(beta)))
+                    {
+                        continue;
+                    }
+                    T zeta = (beta - alpha) / (T(2) * gamma);
+                    T t = (zeta < T() ? T(-1) : T(1)) / (std::abs(zeta) + std::hypot(T(1), zeta));
+                    T c = T(1) / std::hypot(T(1), t);
+                    T s = c * t;
+                    for (int k = 0; k < length; k++)
+                    {
+                        T x = b_p[k];
+                        b_p[k] = c * x - s * b_q[k];
+                        b_q[k] = s * x + c * b_q[k];
+                    }
+                    T* j_p = j + (std::size_t)p * count;
+                    T* j_q = j + (std::size_t)q * count;
+                    for (int k = 0; k < count; k++)
+                    {
+                        T x = j_p[k];
+                        j_p[k] = c * x - s * j_q[k];
+                        j_q[k] = s * x + c * j_q[k];
+                    }
+                    rotated[pair] = 1;
+                }
+            });
+            any_rotation = any_rotation || std::find(rotated.begin(), rotated.end(), 1) != rotated.end();
+            std::rotate(seats.begin() + 1, seats.end() - 1, seats.end());
+        }
+        if (!any_rotation)
+        {
+            return;
+        }
+    }
+    NoConvergence error;
+    throw error;
+}
+
+template <typename T>
+TruncatedSVD<T> TruncatedSVD<T>::decompose(const Matrix<T> &a, int rank, int oversampling, int power_iterations,
+                                           Execution execution)
+{
+    int m = a.height();
+    int n = a.width();
+    if (rank < 1 || rank > std::min(m, n) || oversampling < 0 || power_iterations < 0)
+    {
+        IllegalRank error;
+        throw error;
+    }
+    int samples = std::min(rank + oversampling, std::min(m, n));
+    std::vector<T> rows((std::size_t)m * n);
+    std::vector<T> transposed_rows((std::size_t)n * m);
+    a.copyTo(&rows[0]);
+    a.transpose().copyTo(&transposed_rows[0]);
+
+    //q (samples x m) spans the sampled range as rows.
+    std::mt19937 random(5489u);
+    std::normal_distribution<double> gaussian;
+    std::vector<T> omega((std::size_t)n * samples);
+    for (std::size_t i = 0; i < omega.size(); i++)
+    {
+        omega[i] = (T)gaussian(random);
+    }
+    std::vector<T> y((std::size_t)m * samples);
+    std::vector<T> q((std::size_t)samples * m);
+    std::vector<T> q_columns((std::size_t)m * samples);
+    std::vector<T> w((std::size_t)n * samples);
+    std::vector<T> w_rows((std::size_t)samples * n);
+    multiplyBlocked(&rows[0], n, &omega[0], samples, &y[0], samples, m, n, samples, execution);
+    transposeArray(&y[0], m, samples, &q[0]);
+    orthonormalizeRows(&q[0], samples, m, random, execution);
+    for (int iteration = 0; iteration < power_iterations; iteration++)
+    {
+        transposeArray(&q[0], samples, m, &q_columns[0]);
+        multiplyBlocked(&transposed_rows[0], m, &q_columns[0], samples, &w[0], samples, n, m, samples, execution);
+        transposeArray(&w[0], n, samples, &w_rows[0]);
+        orthonormalizeRows(&w_rows[0], samples, n, random, execution);
+        transposeArray(&w_rows[0], samples, n, &w[0]);
+        multiplyBlocked(&rows[0], n, &w[0], samples, &y[0], samples, m, n, samples, execution);
+        transposeArray(&y[0], m, samples, &q[0]);
+        orthonormalizeRows(&q[0], samples, m, random, execution);
+    }
+
+    //b = q a (samples x n) as rows, computed as (a^T q^T)^T to split the work over the n rows of a^T.
+    transposeArray(&q[0], samples, m, &q_columns[0]);
+    multiplyBlocked(&transposed_rows[0], m, &q_columns[0], samples, &w[0], samples, n, m, samples, execution);
+    std::vector<T> &b = w_rows;
+    transposeArray(&w[0], n, samples, &b[0]);
+    std::vector<T> j((std::size_t)samples * samples, T());
+    for (int i = 0; i < samples; i++)
+    {
+        j[(std::size_t)i * samples + i] = T(1);
+    }
+    orthogonalizeRows(&b[0], samples, n, &j[0], execution);
+
+    //j b = diag(sigma) V^T with orthogonal j, so a ~ q^T b = (q^T j^T) diag(sigma) V^T.
+    std::vector<T> sigma(samples);
+    std::vector<int> order(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        const T* b_i = &b[(std::size_t)i * n];
+        sigma[i] = std::sqrt(std::inner_product(b_i, b_i + n, b_i, T()));
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int x, int z) { return sigma[x] > sigma[z]; });
+    std::vector<T> j_columns((std::size_t)samples * samples);
+    transposeArray(&j[0], samples, samples, &j_columns[0]);
+    std::vector<T> left((std::size_t)m * samples);
+    multiplyBlocked(&q_columns[0], samples, &j_columns[0], samples, &left[0], samples, m, samples, samples,
+                    execution);
+
+    std::vector<T> u_rows((std::size_t)m * rank);
+    std::vector<T> v_rows((std::size_t)n * rank);
+    std::vector<T> singular(rank);
+    for (int c = 0; c < rank; c++)
+    {
+        int source = order[c];
+        singular[c] = sigma[source];
+        int largest = 0;
+        for (int i = 1; i < m; i++)
+        {
+            if (std::abs(left[(std::size_t)i * samples + source]) > std::abs(left[(std::size_t)largest * samples + source]))
+            {
+                largest = i;
+            }
+        }
+        T sign = left[(std::size_t)largest * samples + source] < T() ? T(-1) : T(1);
+        for (int i = 0; i < m; i++)
+        {
+            u_rows[(std::size_t)i * rank + c] = sign * left[(std::size_t)i * samples + source];
+        }
+        T scale = sigma[source] > T() ? sign / sigma[source] : T();
+        for (int i = 0; i < n; i++)
+        {
+            v_rows[(std::size_t)i * rank + c] = scale * b[(std::size_t)source * n + i];
+        }
+    }
+    Matrix<T> u(Dimensions(m, rank), T(), a.sharing(), a.layout(), a.memory());
+    Matrix<T> singular_column(Dimensions(rank, 1), T(), a.sharing(), a.layout(), a.memory());
+    Matrix<T> v(Dimensions(n, rank), T(), a.sharing(), a.layout(), a.memory());
+    u.copyFrom(&u_rows[0]);
+    singular_column.copyFrom(&singular[0]);
+    v.copyFrom(&v_rows[0]);
+    return TruncatedSVD(u, singular_column, v);
+}
+
+template <typename T>
+const Matrix<T> &TruncatedSVD<T>::u() const
+{
+    return m_U;
+}
+
+template <typename T>
+const Matrix<T> &TruncatedSVD<T>::singularValues() const
+{
+    return m_Singular;
+}
+
+template <typename T>
+const Matrix<T> &TruncatedSVD<T>::v() const
+{
+    return m_V;
+}
+
+template <typename T>
+const char *TruncatedSVD<T>::IllegalRank::what() const throw()
+{
+    return "Mtm decomposition error: Illegal rank";
+}
+
+template <typename T>
+const char *TruncatedSVD<T>::NoConvergence::what() const throw()
+{
+    return "Mtm decomposition error: No convergence";
+}
+}
+
+#endif /* MatrixDecompose_h */
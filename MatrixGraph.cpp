@@ -0,0 +1,99 @@
+#include "MatrixGraph.h"
+
+//Adding the rows of a whole group of 64 pivots at once only lets a row see paths through later pivots of
+//the group earlier than Warshall's order would, which never adds a pair that is not in the closure.
+void mtm::closeBitRows(std::uint64_t* rows, int n, int words, Execution execution)
+{
+    for (int k_first = 0; k_first < n; k_first += 64)
+    {
+        int k_last = std::min(n, k_first + 64);
+        int word = k_first / 64;
+        for (int k = k_first; k < k_last; k++)
+        {
+            const std::uint64_t* pivot = rows + (std::size_t)k * words;
+            for (int i = k_first; i < k_last; i++)
+            {
+                std::uint64_t* row = rows + (std::size_t)i * words;
+                if (i != k && ((row[word] >> (k % 64)) & 1))
+                {
+                    for (int w = 0; w < words; w++)
+                    {
+                        row[w] |= pivot[w];
+                    }
+                }
+            }
+        }
+        parallelRows(n, words * 64, execution, [&](int first, int last)
+        {
+            for (int i = first; i < last; i++)
+            {
+                if (i >= k_first && i < k_last)
+                {
+                    continue;
+                }
+                std::uint64_t* row = rows + (std::size_t)i * words;
+                for (int k = k_first; k < k_last; k++)
+                {
+                    if ((row[word] >> (k % 64)) & 1)
+                    {
+                        const std::uint64_t* pivot = rows + (std::size_t)k * words;
+                        for (int w = 0; w < words; w++)
+                        {
+                            row[w] |= pivot[w];
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+std::vector<std::uint64_t> mtm::reachBitRows(const std::uint64_t* rows, int words, int source)
+{
+    std::vector<std::uint64_t> reached(words, 0);
+    std::vector<int> frontier(1, source);
+    reached[source / 64] |= (std::uint64_t)1 << (source % 64);
+    std::vector<std::uint64_t> next(words);
+    while (!frontier.empty())
+    {
+        std::fill(next.begin(), next.end(), 0);
+        for (std::size_t f = 0; f < frontier.size(); f++)
+        {
+            const std::uint64_t* row = rows + (std::size_t)frontier[f] * words;
+            for (int w = 0; w < words; w++)
+            {
+                next[w] |= row[w];
+            }
+        }
+        frontier.clear();
+        for (int w = 0; w < words; w++)
+        {
+            std::uint64_t added = next[w] & ~reached[w];
+            reached[w] |= added;
+            for (int bit = 0; added != 0; bit++, added >>= 1)
+            {
+                if (added & 1)
+                {
+                    frontier.push_back(w * 64 + bit);
+                }
+            }
+        }
+    }
+    return reached;
+}
+
+mtm::Matrix<bool> mtm::unpackRows(const std::uint64_t* rows, int n, int words, int width, SharingPolicy sharing,
+                                  Layout layout, MemoryPolicy memory)
+{
+    std::unique_ptr<bool[]> elements = scratchElements<bool>((std::size_t)n * width);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            elements[(std::size_t)i * width + j] = (rows[(std::size_t)i * words + j / 64] >> (j % 64)) & 1;
+        }
+    }
+    Matrix<bool> result(Dimensions(n, width), false, sharing, layout, memory);
+    result.copyFrom(elements.get());
+    return result;
+}
@@ -0,0 +1,403 @@
+//
+//  MatrixGraph.h
+//  Matrix
+//
+/*
+ This file exports graph algorithms on dense adjacency matrices: the matrix product over a semiring
+ (min-plus, or-and, ...) with the blocked kernel of MatrixMultiply.h, all pairs shortest paths by blocked
+ Floyd-Warshall, and the transitive closure and reachability on rows packed 64 vertices to a word.
+ Row i of an adjacency matrix holds the edges leaving vertex i.
+*/
+#ifndef MatrixGraph_h
+#define MatrixGraph_h
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Struct: PlusTimes<T> / MinPlus<T> / OrAnd<T>
+* ------------------------
+* Semirings for semiringMultiply: zero() is the identity of plus and annihilates times.
+* PlusTimes - the ordinary product.
+* MinPlus - shortest paths: plus is the minimum, times adds lengths, zero() is unreachable<T>().
+* OrAnd - reachability: plus is ||, times is &&, zero() is false.
+*/
+template <typename T>
+struct PlusTimes{
+    static T zero() { return T(); }
+    static T plus(const T &a, const T &b) { return a + b; }
+    static T times(const T &a, const T &b) { return a * b; }
+};
+
+template <typename T>
+struct MinPlus{
+    static T zero() { return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                                   : std::numeric_limits<T>::max(); }
+    static T plus(const T &a, const T &b) { return (b < a) ? b : a; }
+    static T times(const T &a, const T &b) { return (a == zero() || b == zero()) ? zero() : a + b; }
+};
+
+template <typename T>
+struct OrAnd{
+    static T zero() { return T(); }
+    static T plus(const T &a, const T &b) { return a || b; }
+    static T times(const T &a, const T &b) { return a && b; }
+};
+
+/**
+* function: unreachable
+* Usage: Matrix<int> weights(Dimensions(n, n), mtm::unreachable<int>());
+* -----------------------------
+@return the length floydWarshall gives a missing edge: infinity for floating point T, else the largest T.
+*/
+template <typename T>
+T unreachable();
+
+//Side of the tiles of floydWarshall: three tiles of doubles stay in the L1 / L2 cache.
+const int GRAPH_TILE = 64;
+
+
+/**
+* function: semiringAccumulate
+* Usage: semiringAccumulate<MinPlus<int>>(a, lda, b, ldb, c, ldc, n, m, p)
+* -----------------------------
+* Kernel behind semiringMultiply and floydWarshall, on row-major arrays with explicit row strides:
+* c (n x p) = c + a (n x m) * b (m x p) with the plus and times of S, blocked over m and p like
+* multiplyBlocked. Rows of c are updated one at a time: with four (as multiplyBlocked does) the compiler no
+* longer vectorizes the selects of min-plus. c must not overlap a or b.
+*/
+template <typename S, typename T>
+void semiringAccumulate(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                        int n, int m, int p);
+
+/**
+* function: semiringMultiply
+* Usage: semiringMultiply<mtm::MinPlus<int>>(a, b)
+*        semiringMultiply<mtm::OrAnd<bool>>(a, b, mtm::PARALLEL)
+* -----------------------------
+* Creates the product of a and b over the semiring S: element (i, j) is the plus over k of times(a(i, k), b(k, j)).
+* The result has a's SharingPolicy and Layout.
+@param execution - PARALLEL splits the rows of the result between the threads of the shared ThreadPool.
+@return new matrix of dimensions (a.height(), b.width()).
+@exception DimensionMismatch if a.width() != b.height().
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename S, typename T>
+Matrix<T> semiringMultiply(const Matrix<T> &a, const Matrix<T> &b, Execution execution = SEQUENTIAL);
+
+/**
+* function: floydWarshall
+* Usage: floydWarshall(weights)
+*        floydWarshall(weights, mtm::PARALLEL)
+* -----------------------------
+* All pairs shortest paths: creates the matrix of the lengths of the shortest paths from vertex i to vertex j,
+* unreachable<T>() if there is none, over the edge lengths weights(i, j) (unreachable<T>() for a missing edge).
+* The diagonal starts at min(weights(i, i), 0). The matrix is processed in GRAPH_TILE x GRAPH_TILE tiles:
+* for every diagonal tile the tile itself, then its tile row and column, then all the other tiles with
+* the min-plus semiringAccumulate. The result has weights' SharingPolicy and Layout.
+@param execution - PARALLEL runs the tiles of the second and third phases on the shared ThreadPool.
+@remarks a negative element on the diagonal of the result marks a vertex on a negative cycle, the other
+*        lengths are then meaningless. Finite path lengths must fit in T.
+@exception DimensionMismatch if weights is not square.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<T> floydWarshall(const Matrix<T> &weights, Execution execution = SEQUENTIAL);
+
+/**
+* function: transitiveClosure
+* Usage: transitiveClosure(adjacency)
+*        transitiveClosure(adjacency, mtm::PARALLEL)
+* -----------------------------
+* Creates the matrix whose element (i, j) is true if there is a path of one or more edges from vertex i to
+* vertex j, an edge being an element of adjacency other than T() (so true in a Matrix<bool>).
+* Warshall's algorithm on the packed rows: 64 vertices at a time, the 64 rows of those vertices are closed
+* among themselves, then every other row takes the OR of the rows of the vertices it reaches among them.
+@param execution - PARALLEL splits the rows between the threads of the shared ThreadPool.
+@exception DimensionMismatch if adjacency is not square.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<bool> transitiveClosure(const Matrix<T> &adjacency, Execution execution = SEQUENTIAL);
+
+/**
+* function: reachableFrom
+* Usage: reachableFrom(adjacency, source)
+* -----------------------------
+* Breadth first search on the packed rows: creates a 1 x n matrix whose element j is true if vertex j can be
+* reached from source, source itself included.
+@exception DimensionMismatch if adjacency is not square.
+@exception AccessIllegalElement if source is not a vertex.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<bool> reachableFrom(const Matrix<T> &adjacency, int source, Execution execution = SEQUENTIAL);
+
+/**
+* function: closeBitRows / reachBitRows
+* Usage: closeBitRows(rows, n, words, execution)
+*        reachBitRows(rows, words, source)
+* -----------------------------
+* The kernels of transitiveClosure and reachableFrom, on n rows of words 64 bit words each (bit j % 64 of
+* word j / 64 of row i is the edge i -> j). closeBitRows closes the rows in place, reachBitRows returns the
+* packed row of the vertices reachable from source.
+*/
+void closeBitRows(std::uint64_t* rows, int n, int words, Execution execution);
+std::vector<std::uint64_t> reachBitRows(const std::uint64_t* rows, int words, int source);
+
+/**
+* function: packRows / unpackRows
+* Usage: packRows(adjacency, words, execution)
+*        unpackRows(rows, n, words, width, sharing, layout, memory)
+* -----------------------------
+* Between an adjacency matrix and its packed rows: packRows reads GRAPH_TILE rows at a time through
+* Matrix::blocks, unpackRows creates a Matrix<bool> of n rows and width columns with the given policies.
+*/
+template <typename T>
+std::vector<std::uint64_t> packRows(const Matrix<T> &adjacency, int words, Execution execution);
+Matrix<bool> unpackRows(const std::uint64_t* rows, int n, int words, int width, SharingPolicy sharing, Layout layout,
+                        MemoryPolicy memory);
+
+//Floyd-Warshall on one tile: c (rows x cols) = min(c, a (rows x depth) + b (depth x cols)) with the
+//vertices of the depth range taken one after the other, so c may be a or b.
+template <typename T>
+void floydWarshallTile(const T* a, const T* b, T* c, std::size_t ld, int rows, int cols, int depth);
+
+//throws DimensionMismatch unless mat is square.
+template <typename T>
+void checkSquare(const Matrix<T> &mat);
+
+
+
+template <typename T>
+T unreachable()
+{
+    return MinPlus<T>::zero();
+}
+
+template <typename T>
+void checkSquare(const Matrix<T> &mat)
+{
+    if (mat.height() != mat.width())
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(mat.height(), mat.width()),
+                                                    Dimensions(mat.width(), mat.height()));
+        throw error;
+    }
+}
+
+template <typename S, typename T>
+void semiringAccumulate(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                        int n, int m, int p)
+{
+    const int depth_block = 256;
+    const int width_block = 512;
+    for (int k_block = 0; k_block < m; k_block += depth_block)
+    {
+        int k_end = std::min(m, k_block + depth_block);
+        for (int j_block = 0; j_block < p; j_block += width_block)
+        {
+            int length = std::min(p, j_block + width_block) - j_block;
+            for (int i = 0; i < n; i++)
+            {
+                T* c_row = c + i * ldc + j_block;
+                for (int k = k_block; k < k_end; k++)
+                {
+                    const T scale = a[i * lda + k];
+                    const T* b_row = b + k * ldb + j_block;
+                    for (int j = 0; j < length; j++)
+                    {
+                        c_row[j] = S::plus(c_row[j], S::times(scale, b_row[j]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename S, typename T>
+Matrix<T> semiringMultiply(const Matrix<T> &a, const Matrix<T> &b, Execution execution)
+{
+    if (a.width() != b.height())
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(a.height(), a.width()),
+                                                    Dimensions(b.height(), b.width()));
+        throw error;
+    }
+    int n = a.height();
+    int m = a.width();
+    int p = b.width();
+    Matrix<T> product(Dimensions(n, p), S::zero(), a.sharing(), a.layout(), a.memory());
+    std::unique_ptr<T[]> packed_a = scratchElements<T>((std::size_t)n * m);
+    std::unique_ptr<T[]> packed_b = scratchElements<T>((std::size_t)m * p);
+    std::unique_ptr<T[]> packed_c = scratchElements<T>((std::size_t)n * p);
+    a.copyTo(packed_a.get());
+    b.copyTo(packed_b.get());
+    std::fill(packed_c.get(), packed_c.get() + (std::size_t)n * p, S::zero());
+    int work = (int)std::min<long long>((long long)m * p / 64 + 1, 1 << 30);
+    parallelRows(n, work, execution, [&](int first, int last)
+    {
+        semiringAccumulate<S>(packed_a.get() + (std::size_t)first * m, m, packed_b.get(), p,
+                              packed_c.get() + (std::size_t)first * p, p, last - first, m, p);
+    });
+    product.copyFrom(packed_c.get());
+    return product;
+}
+
+template <typename T>
+void floydWarshallTile(const T* a, const T* b, T* c, std::size_t ld, int rows, int cols, int depth)
+{
+    const T infinity = unreachable<T>();
+    for (int k = 0; k < depth; k++)
+    {
+        const T* b_row = b + k * ld;
+        for (int i = 0; i < rows; i++)
+        {
+            const T a_ik = a[i * ld + k];
+            if (a_ik == infinity)
+            {
+                continue;
+            }
+            T* c_row = c + i * ld;
+            for (int j = 0; j < cols; j++)
+            {
+                const T through = MinPlus<T>::times(a_ik, b_row[j]);
+                c_row[j] = (through < c_row[j]) ? through : c_row[j];
+            }
+        }
+    }
+}
+
+//The distances live in one row-major array. Phase 2 and 3 tiles of the same diagonal tile write disjoint
+//tiles and read only the diagonal tile row and column, so each phase runs as one parallelRows.
+template <typename T>
+Matrix<T> floydWarshall(const Matrix<T> &weights, Execution execution)
+{
+    checkSquare(weights);
+    int n = weights.height();
+    std::unique_ptr<T[]> owned = scratchElements<T>((std::size_t)n * n);
+    T* distance = owned.get();
+    weights.copyTo(distance);
+    for (int i = 0; i < n; i++)
+    {
+        distance[(std::size_t)i * n + i] = std::min(distance[(std::size_t)i * n + i], T());
+    }
+    int tiles = (n + GRAPH_TILE - 1) / GRAPH_TILE;
+    for (int k_tile = 0; k_tile < tiles; k_tile++)
+    {
+        int k_first = k_tile * GRAPH_TILE;
+        int depth = std::min(GRAPH_TILE, n - k_first);
+        T* pivot = distance + (std::size_t)k_first * n + k_first;
+        floydWarshallTile(pivot, pivot, pivot, n, depth, depth, depth);
+        parallelRows(2 * tiles, GRAPH_TILE * depth, execution, [&](int first, int last)
+        {
+            for (int t = first; t < last; t++)
+            {
+                int other = (t < tiles) ? t : t - tiles;
+                if (other == k_tile)
+                {
+                    continue;
+                }
+                int other_first = other * GRAPH_TILE;
+                int size = std::min(GRAPH_TILE, n - other_first);
+                if (t < tiles)
+                {
+                    T* row_tile = distance + (std::size_t)k_first * n + other_first;
+                    floydWarshallTile(pivot, row_tile, row_tile, n, depth, size, depth);
+                }
+                else
+                {
+                    T* column_tile = distance + (std::size_t)other_first * n + k_first;
+                    floydWarshallTile(column_tile, pivot, column_tile, n, size, depth, depth);
+                }
+            }
+        });
+        parallelRows(tiles, n * depth, execution, [&](int first, int last)
+        {
+            for (int i_tile = first; i_tile < last; i_tile++)
+            {
+                if (i_tile == k_tile)
+                {
+                    continue;
+                }
+                int i_first = i_tile * GRAPH_TILE;
+                int rows = std::min(GRAPH_TILE, n - i_first);
+                const T* column = distance + (std::size_t)i_first * n + k_first;
+                const T* row = distance + (std::size_t)k_first * n;
+                T* band = distance + (std::size_t)i_first * n;
+                semiringAccumulate<MinPlus<T> >(column, n, row, n, band, n, rows, depth, k_first);
+                semiringAccumulate<MinPlus<T> >(column, n, row + k_first + depth, n, band + k_first + depth, n,
+                                                rows, depth, n - k_first - depth);
+            }
+        });
+    }
+    Matrix<T> result(Dimensions(n, n), T(), weights.sharing(), weights.layout(), weights.memory());
+    result.copyFrom(distance);
+    return result;
+}
+
+template <typename T>
+std::vector<std::uint64_t> packRows(const Matrix<T> &adjacency, int words, Execution execution)
+{
+    int n = adjacency.height();
+    std::vector<std::uint64_t> rows((std::size_t)n * words, 0);
+    typename Matrix<T>::ConstBlocks bands = adjacency.blocks(GRAPH_TILE, n);
+    parallelRows(bands.size(), GRAPH_TILE * n, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> buffer = scratchElements<T>((std::size_t)GRAPH_TILE * n);
+        for (int b = first; b < last; b++)
+        {
+            typename Matrix<T>::ConstBlock band = bands[b];
+            band.copyTo(buffer.get());
+            for (int i = 0; i < band.height(); i++)
+            {
+                std::uint64_t* row = &rows[(std::size_t)(band.row() + i) * words];
+                const T* elements = buffer.get() + (std::size_t)i * n;
+                for (int j = 0; j < n; j++)
+                {
+                    if (elements[j] != T())
+                    {
+                        row[j / 64] |= (std::uint64_t)1 << (j % 64);
+                    }
+                }
+            }
+        }
+    });
+    return rows;
+}
+
+template <typename T>
+Matrix<bool> transitiveClosure(const Matrix<T> &adjacency, Execution execution)
+{
+    checkSquare(adjacency);
+    int n = adjacency.height();
+    int words = (n + 63) / 64;
+    std::vector<std::uint64_t> rows = packRows(adjacency, words, execution);
+    closeBitRows(rows.data(), n, words, execution);
+    return unpackRows(rows.data(), n, words, n, adjacency.sharing(), adjacency.layout(), adjacency.memory());
+}
+
+template <typename T>
+Matrix<bool> reachableFrom(const Matrix<T> &adjacency, int source, Execution execution)
+{
+    checkSquare(adjacency);
+    int n = adjacency.height();
+    if (source < 0 || source >= n)
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+    int words = (n + 63) / 64;
+    std::vector<std::uint64_t> rows = packRows(adjacency, words, execution);
+    std::vector<std::uint64_t> reached = reachBitRows(rows.data(), words, source);
+    return unpackRows(&reached[0], 1, words, n, adjacency.sharing(), adjacency.layout(), adjacency.memory());
+}
+}
+
+#endif /* MatrixGraph_h */
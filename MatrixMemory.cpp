@@ -0,0 +1,109 @@
+#include "MatrixMemory.h"
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    const std::size_t HUGE_PAGE = 2 * 1024 * 1024;
+    const int MPOL_INTERLEAVE_MODE = 3;
+
+    //Parses the node list of /sys/devices/system/node/online, e.g. "0-1,3".
+    std::vector<int> onlineNodes()
+    {
+        std::vector<int> nodes;
+        std::ifstream file("/sys/devices/system/node/online");
+        std::string list;
+        if (!(file >> list))
+        {
+            return nodes;
+        }
+        std::size_t position = 0;
+        while (position < list.size())
+        {
+            std::size_t comma = list.find(',', position);
+            std::string range = list.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+            std::size_t dash = range.find('-');
+            int first = std::atoi(range.c_str());
+            int last = (dash == std::string::npos) ? first : std::atoi(range.c_str() + dash + 1);
+            for (int node = first; node <= last; node++)
+            {
+                nodes.push_back(node);
+            }
+            position = (comma == std::string::npos) ? list.size() : comma + 1;
+        }
+        return nodes;
+    }
+}
+
+int mtm::numaNodes()
+{
+    static int nodes = (int)onlineNodes().size();
+    return nodes > 0 ? nodes : 1;
+}
+
+#ifdef __linux__
+
+//The mapping is over allocated by one huge page and trimmed, so it starts on a huge page boundary.
+void* mtm::allocatePages(std::size_t bytes, MemoryPolicy policy)
+{
+    std::size_t length = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    void* mapping = mmap(NULL, length + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+    char* start = static_cast<char*>(mapping);
+    char* aligned = start + (HUGE_PAGE - (std::size_t)start % HUGE_PAGE) % HUGE_PAGE;
+    if (aligned != start)
+    {
+        munmap(start, aligned - start);
+    }
+    std::size_t tail = (start + length + HUGE_PAGE) - (aligned + length);
+    if (tail > 0)
+    {
+        munmap(aligned + length, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+    if (policy == INTERLEAVED && numaNodes() > 1)
+    {
+        std::vector<int> nodes = onlineNodes();
+        std::vector<unsigned long> mask(nodes.back() / (8 * sizeof(unsigned long)) + 1, 0);
+        for (std::size_t i = 0; i < nodes.size(); i++)
+        {
+            mask[nodes[i] / (8 * sizeof(unsigned long))] |= 1UL << (nodes[i] % (8 * sizeof(unsigned long)));
+        }
+        syscall(SYS_mbind, aligned, length, MPOL_INTERLEAVE_MODE, &mask[0],
+                (unsigned long)(mask.size() * 8 * sizeof(unsigned long) + 1), 0UL);
+    }
+    return aligned;
+}
+
+void mtm::releasePages(void* memory, std::size_t bytes)
+{
+    std::size_t length = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    munmap(memory, length);
+}
+
+#else
+
+void* mtm::allocatePages(std::size_t bytes, MemoryPolicy)
+{
+    return std::calloc(bytes, 1);
+}
+
+void mtm::releasePages(void* memory, std::size_t)
+{
+    std::free(memory);
+}
+
+#endif
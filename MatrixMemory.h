@@ -0,0 +1,60 @@
+//
+//  MatrixMemory.h
+//  Matrix
+//
+/*
+ This file exports the page level allocation used for large matrix buffers:
+ transparent huge pages and NUMA placement (Linux only, other systems fall back to calloc).
+*/
+#ifndef MatrixMemory_h
+#define MatrixMemory_h
+#include <cstddef>
+namespace mtm{
+
+/**
+* Enum: MemoryPolicy
+* ------------------------
+* How the buffer of a large matrix (at least LARGE_ALLOCATION bytes) is placed in memory.
+* Smaller buffers always come from the regular heap.
+* DEFAULT_MEMORY - regular heap allocation, pages land on the node of the thread touching them first.
+* HUGE_PAGES - page aligned mapping advised to use 2MB transparent huge pages (fewer TLB misses).
+* FIRST_TOUCH - HUGE_PAGES, and the elements are initialized (and copied) in parallel by the ThreadPool
+*               workers: a parallel fill that spreads the pages over the nodes of the workers. Which
+*               worker touches which band is not fixed, and later PARALLEL operations split the rows
+*               their own way, so no band is guaranteed to be local to the thread processing it.
+* INTERLEAVED - HUGE_PAGES, and the pages are spread round robin over all NUMA nodes, which evens
+*               out the bandwidth when any thread may touch any part of the matrix.
+*/
+enum MemoryPolicy { DEFAULT_MEMORY, HUGE_PAGES, FIRST_TOUCH, INTERLEAVED };
+
+//Buffers below this size ignore the MemoryPolicy.
+const std::size_t LARGE_ALLOCATION = 2 * 1024 * 1024;
+
+/**
+* function: allocatePages
+* Usage: allocatePages(bytes, policy)
+* -----------------------------
+* Maps bytes of zero filled memory placed according to policy. The huge page and NUMA requests are
+* advice: if the system refuses them the memory is still returned.
+@return the memory, or NULL if it could not be mapped.
+*/
+void* allocatePages(std::size_t bytes, MemoryPolicy policy);
+
+/**
+* function: releasePages
+* Usage: releasePages(memory, bytes)
+* -----------------------------
+* Unmaps memory returned by allocatePages(bytes, ...).
+*/
+void releasePages(void* memory, std::size_t bytes);
+
+/**
+* function: numaNodes
+* Usage: numaNodes()
+* -----------------------------
+@return number of NUMA nodes online (1 when unknown).
+*/
+int numaNodes();
+}
+
+#endif /* MatrixMemory_h */
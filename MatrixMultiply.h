@@ -0,0 +1,470 @@
+//
+//  MatrixMultiply.h
+//  Matrix
+//
+/*
+ This file exports matrix multiplication: a cache blocked conventional kernel and a
+ Strassen-Winograd path for large square matrices.
+*/
+#ifndef MatrixMultiply_h
+#define MatrixMultiply_h
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Enum: MultiplyAlgorithm
+* ------------------------
+* CONVENTIONAL - blocked O(n^3) product.
+* STRASSEN - Strassen-Winograd recursion (7 half size products per level) down to STRASSEN_CUTOFF,
+*            used for square matrices larger than the cutoff, otherwise falls back to CONVENTIONAL.
+*/
+enum MultiplyAlgorithm { CONVENTIONAL, STRASSEN };
+
+//Sub products of this size or smaller are handed to the blocked kernel. Chosen from bench/bench_multiply.cpp:
+//below it the extra additions and copies of a recursion level cost more than the saved product.
+const int STRASSEN_CUTOFF = 128;
+
+
+/**
+* function: multiplyBlocked
+* Usage: multiplyBlocked(a, lda, b, ldb, c, ldc, n, m, p)
+* -----------------------------
+* Kernel behind multiply, working on row-major arrays with explicit row strides (leading dimensions):
+* c (n x p) = a (n x m) * b (m x p). c is overwritten and must not overlap a or b.
+* The product is blocked over m and p so the touched parts of b stay in cache, and four rows of c
+* are updated together so every loaded element of b is used four times.
+@param execution - PARALLEL splits the rows of c between the threads of the shared ThreadPool.
+*/
+template <typename T>
+void multiplyBlocked(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                     int n, int m, int p, Execution execution = SEQUENTIAL);
+
+
+/**
+* function: multiplyAddRun / multiplyAddRows
+* Usage: multiplyAddRun(scale, b, c, length)
+*        multiplyAddRows(scales, b, c, length)
+* -----------------------------
+* Inner loops of multiplyBlocked: c[j] += scale * b[j], and c[t][j] += scales[t] * b[j] for four rows t.
+* The float and double overloads of CpuDispatch.h run them with the vector instructions of the processor.
+*/
+template <typename T>
+void multiplyAddRun(const T &scale, const T* b, T* c, int length);
+template <typename T>
+void multiplyAddRows(const T* scales, const T* b, T* const* c, int length);
+
+
+/**
+* function: multiply
+* Usage: multiply(a, b)
+*        multiply(a, b, mtm::STRASSEN, mtm::PARALLEL)
+* -----------------------------
+* Creates the matrix product a*b. The result has a's SharingPolicy and Layout.
+@param algorithm - see MultiplyAlgorithm (default CONVENTIONAL).
+@param execution - PARALLEL uses the shared ThreadPool: row bands for CONVENTIONAL, the seven
+*                  top level sub products for STRASSEN (default SEQUENTIAL).
+@return new matrix of dimensions (a.height(), b.width()).
+@remarks (assumptions) T supports + - * and T() is the additive identity.
+@exception DimensionMismatch if a.width() != b.height().
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<T> multiply(const Matrix<T> &a, const Matrix<T> &b, MultiplyAlgorithm algorithm = CONVENTIONAL,
+                   Execution execution = SEQUENTIAL);
+
+
+/**
+* Class: StrassenWinograd<T>
+* ------------------------
+* Strassen-Winograd product of two n x n row-major arrays.
+* All the temporaries of every recursion level are carved out of one arena allocated up front.
+* Sequential levels use the two temporaries schedule of Boyer, Dumas, Pernet and Zhou, which needs
+* 2(n/2)^2 elements per level. The top level of a PARALLEL product keeps all seven sub products
+* in separate buffers so they can run as independent tasks.
+*/
+template <typename T>
+class StrassenWinograd{
+private:
+    int m_Size;
+    int m_Cutoff;
+    std::vector<T> m_Arena;
+
+    //arena elements needed by a sequential product of size n.
+    static std::size_t sequentialWorkspace(int n, int cutoff);
+
+    //c = a + b and c = a - b on h x h blocks.
+    static void add(T* c, std::size_t ldc, const T* a, std::size_t lda, const T* b, std::size_t ldb, int h);
+    static void subtract(T* c, std::size_t ldc, const T* a, std::size_t lda, const T* b, std::size_t ldb, int h);
+
+    static void sequential(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                           int n, int cutoff, T* workspace);
+    void parallel(const T* a, const T* b, T* c);
+
+public:
+    /**
+    * Constructor: StrassenWinograd
+    * Usage: StrassenWinograd<T> product(size, cutoff, execution);
+    * ---------------------------------------
+    @param size the side of the square operands, must allow halving down to the cutoff: size = s * 2^k with s <= cutoff.
+    @param execution whether the workspace is sized for the parallel top level.
+    @exception bad_alloc will be thrown if the arena can not be allocated.
+    */
+    StrassenWinograd(int size, int cutoff, Execution execution);
+
+    /**
+    * static function: paddedSize
+    * Usage: StrassenWinograd<T>::paddedSize(n, cutoff)
+    * -----------------------------
+    @return the smallest size >= n of the form s * 2^k with s <= cutoff, the operands are zero padded to it.
+    */
+    static int paddedSize(int n, int cutoff);
+
+    /**
+    * Method: multiply
+    * Usage: product.multiply(a, b, c, execution)
+    * -----------------------------
+    * c = a * b for size x size row-major arrays.
+    */
+    void multiply(const T* a, const T* b, T* c, Execution execution);
+};
+
+
+
+template <typename T>
+void multiplyAddRun(const T &scale, const T* b, T* c, int length)
+{
+    for (int j = 0; j < length; j++)
+    {
+        c[j] += scale * b[j];
+    }
+}
+
+template <typename T>
+void multiplyAddRows(const T* scales, const T* b, T* const* c, int length)
+{
+    T* c0 = c[0];
+    T* c1 = c[1];
+    T* c2 = c[2];
+    T* c3 = c[3];
+    for (int j = 0; j < length; j++)
+    {
+        const T b_j = b[j];
+        c0[j] += scales[0] * b_j;
+        c1[j] += scales[1] * b_j;
+        c2[j] += scales[2] * b_j;
+        c3[j] += scales[3] * b_j;
+    }
+}
+
+
+template <typename T>
+void multiplyBlocked(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                     int n, int m, int p, Execution execution)
+{
+    const int depth_block = 256;
+    const int width_block = 512;
+    int work = (int)std::min<long long>((long long)m * p / 64 + 1, 1 << 30);
+    parallelRows(n, work, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            std::fill(c + i * ldc, c + i * ldc + p, T());
+        }
+        for (int k_block = 0; k_block < m; k_block += depth_block)
+        {
+            int k_end = std::min(m, k_block + depth_block);
+            for (int j_block = 0; j_block < p; j_block += width_block)
+            {
+                int j_end = std::min(p, j_block + width_block);
+                int i = first;
+                for (; i + 4 <= last; i += 4)
+                {
+                    T* c_rows[4] = { c + i * ldc + j_block, c + (i + 1) * ldc + j_block,
+                                     c + (i + 2) * ldc + j_block, c + (i + 3) * ldc + j_block };
+                    for (int k = k_block; k < k_end; k++)
+                    {
+                        const T scales[4] = { a[i * lda + k], a[(i + 1) * lda + k], a[(i + 2) * lda + k],
+                                              a[(i + 3) * lda + k] };
+                        multiplyAddRows(scales, b + k * ldb + j_block, c_rows, j_end - j_block);
+                    }
+                }
+                for (; i < last; i++)
+                {
+                    T* c_row = c + i * ldc + j_block;
+                    for (int k = k_block; k < k_end; k++)
+                    {
+                        multiplyAddRun(a[i * lda + k], b + k * ldb + j_block, c_row, j_end - j_block);
+                    }
+                }
+            }
+        }
+    });
+}
+
+
+template <typename T>
+Matrix<T> multiply(const Matrix<T> &a, const Matrix<T> &b, MultiplyAlgorithm algorithm, Execution execution)
+{
+    if (a.width() != b.height())
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(a.height(), a.width()),
+                                                    Dimensions(b.height(), b.width()));
+        throw error;
+    }
+    int n = a.height();
+    int m = a.width();
+    int p = b.width();
+    Matrix<T> product(Dimensions(n, p), T(), a.sharing(), a.layout(), a.memory());
+
+    if (algorithm == STRASSEN && n == m && m == p && n > STRASSEN_CUTOFF)
+    {
+        int size = StrassenWinograd<T>::paddedSize(n, STRASSEN_CUTOFF);
+        std::vector<T> packed_a((std::size_t)size * size, T());
+        std::vector<T> packed_b((std::size_t)size * size, T());
+        std::vector<T> packed_c((std::size_t)size * size, T());
+        std::vector<T> rows((std::size_t)n * n);
+        a.copyTo(&rows[0]);
+        for (int i = 0; i < n; i++)
+        {
+            std::copy(&rows[(std::size_t)i * n], &rows[(std::size_t)i * n] + n, &packed_a[(std::size_t)i * size]);
+        }
+        b.copyTo(&rows[0]);
+        for (int i = 0; i < n; i++)
+        {
+            std::copy(&rows[(std::size_t)i * n], &rows[(std::size_t)i * n] + n, &packed_b[(std::size_t)i * size]);
+        }
+        StrassenWinograd<T> strassen(size, STRASSEN_CUTOFF, execution);
+        strassen.multiply(&packed_a[0], &packed_b[0], &packed_c[0], execution);
+        for (int i = 0; i < n; i++)
+        {
+            std::copy(&packed_c[(std::size_t)i * size], &packed_c[(std::size_t)i * size] + n, &rows[(std::size_t)i * n]);
+        }
+        product.copyFrom(&rows[0]);
+        return product;
+    }
+
+    std::vector<T> packed_a((std::size_t)n * m);
+    std::vector<T> packed_b((std::size_t)m * p);
+    std::vector<T> packed_c((std::size_t)n * p);
+    a.copyTo(&packed_a[0]);
+    b.copyTo(&packed_b[0]);
+    multiplyBlocked(&packed_a[0], m, &packed_b[0], p, &packed_c[0], p, n, m, p, execution);
+    product.copyFrom(&packed_c[0]);
+    return product;
+}
+
+
+template <typename T>
+int StrassenWinograd<T>::paddedSize(int n, int cutoff)
+{
+    int levels = 0;
+    while (((n - 1) >> levels) + 1 > cutoff)
+    {
+        levels++;
+    }
+    return (((n - 1) >> levels) + 1) << levels;
+}
+
+template <typename T>
+std::size_t StrassenWinograd<T>::sequentialWorkspace(int n, int cutoff)
+{
+    std::size_t total = 0;
+    for (; n > cutoff && n % 2 == 0; n /= 2)
+    {
+        total += 2 * (std::size_t)(n / 2) * (n / 2);
+    }
+    return total;
+}
+
+//The parallel top level needs S1-S4, T1-T4 and P1, P6, P7 (P2-P5 go straight into the quadrants of c),
+//plus a private sequential workspace for each of the seven sub products.
+template <typename T>
+StrassenWinograd<T>::StrassenWinograd(int size, int cutoff, Execution execution) :
+m_Size(size),
+m_Cutoff(cutoff)
+{
+    std::size_t h = size / 2;
+    if (execution == PARALLEL && size > cutoff && size % 2 == 0)
+    {
+        m_Arena.resize(11 * h * h + 7 * sequentialWorkspace((int)h, cutoff));
+    }
+    else
+    {
+        m_Arena.resize(sequentialWorkspace(size, cutoff));
+    }
+}
+
+template <typename T>
+void StrassenWinograd<T>::add(T* c, std::size_t ldc, const T* a, std::size_t lda, const T* b, std::size_t ldb, int h)
+{
+    for (int i = 0; i < h; i++)
+    {
+        T* c_row = c + i * ldc;
+        const T* a_row = a + i * lda;
+        const T* b_row = b + i * ldb;
+        for (int j = 0; j < h; j++)
+        {
+            c_row[j] = a_row[j] + b_row[j];
+        }
+    }
+}
+
+template <typename T>
+void StrassenWinograd<T>::subtract(T* c, std::size_t ldc, const T* a, std::size_t lda, const T* b, std::size_t ldb,
+                                   int h)
+{
+    for (int i = 0; i < h; i++)
+    {
+        T* c_row = c + i * ldc;
+        const T* a_row = a + i * lda;
+        const T* b_row = b + i * ldb;
+        for (int j = 0; j < h; j++)
+        {
+            c_row[j] = a_row[j] - b_row[j];
+        }
+    }
+}
+
+template <typename T>
+void StrassenWinograd<T>::multiply(const T* a, const T* b, T* c, Execution execution)
+{
+    if (m_Arena.empty())
+    {
+        multiplyBlocked(a, m_Size, b, m_Size, c, m_Size, m_Size, m_Size, m_Size, execution);
+        return;
+    }
+    if (execution == PARALLEL && m_Size > m_Cutoff && m_Size % 2 == 0)
+    {
+        parallel(a, b, c);
+        return;
+    }
+    sequential(a, m_Size, b, m_Size, c, m_Size, m_Size, m_Cutoff, &m_Arena[0]);
+}
+
+//Schedule of table 1 in "Memory efficient scheduling of Strassen-Winograd's matrix multiplication algorithm",
+//X and Y are the two temporaries, the products are written straight into the quadrants of c.
+template <typename T>
+void StrassenWinograd<T>::sequential(const T* a, std::size_t lda, const T* b, std::size_t ldb, T* c, std::size_t ldc,
+                                     int n, int cutoff, T* workspace)
+{
+    if (n <= cutoff || n % 2 != 0)
+    {
+        multiplyBlocked(a, lda, b, ldb, c, ldc, n, n, n);
+        return;
+    }
+    int h = n / 2;
+    const T* a11 = a;
+    const T* a12 = a + h;
+    const T* a21 = a + h * lda;
+    const T* a22 = a21 + h;
+    const T* b11 = b;
+    const T* b12 = b + h;
+    const T* b21 = b + h * ldb;
+    const T* b22 = b21 + h;
+    T* c11 = c;
+    T* c12 = c + h;
+    T* c21 = c + h * ldc;
+    T* c22 = c21 + h;
+    std::size_t ld = h;
+    T* x = workspace;
+    T* y = x + ld * h;
+    T* rest = y + ld * h;
+
+    subtract(x, ld, a11, lda, a21, lda, h);                     //S3 = A11 - A21
+    subtract(y, ld, b22, ldb, b12, ldb, h);                     //T3 = B22 - B12
+    sequential(x, ld, y, ld, c21, ldc, h, cutoff, rest);        //P7 = S3 T3
+    add(x, ld, a21, lda, a22, lda, h);                          //S1 = A21 + A22
+    subtract(y, ld, b12, ldb, b11, ldb, h);                     //T1 = B12 - B11
+    sequential(x, ld, y, ld, c22, ldc, h, cutoff, rest);        //P5 = S1 T1
+    subtract(x, ld, x, ld, a11, lda, h);                        //S2 = S1 - A11
+    subtract(y, ld, b22, ldb, y, ld, h);                        //T2 = B22 - T1
+    sequential(x, ld, y, ld, c12, ldc, h, cutoff, rest);        //P6 = S2 T2
+    subtract(x, ld, a12, lda, x, ld, h);                        //S4 = A12 - S2
+    sequential(x, ld, b22, ldb, c11, ldc, h, cutoff, rest);     //P3 = S4 B22
+    sequential(a11, lda, b11, ldb, x, ld, h, cutoff, rest);     //P1 = A11 B11
+    add(c12, ldc, x, ld, c12, ldc, h);                          //U2 = P1 + P6
+    add(c21, ldc, c12, ldc, c21, ldc, h);                       //U3 = U2 + P7
+    add(c12, ldc, c12, ldc, c22, ldc, h);                       //U4 = U2 + P5
+    add(c22, ldc, c21, ldc, c22, ldc, h);                       //U7 = U3 + P5
+    add(c12, ldc, c12, ldc, c11, ldc, h);                       //U5 = U4 + P3
+    subtract(y, ld, y, ld, b21, ldb, h);                        //T4 = T2 - B21
+    sequential(a22, lda, y, ld, c11, ldc, h, cutoff, rest);     //P4 = A22 T4
+    subtract(c21, ldc, c21, ldc, c11, ldc, h);                  //U6 = U3 - P4
+    sequential(a12, lda, b21, ldb, c11, ldc, h, cutoff, rest);  //P2 = A12 B21
+    add(c11, ldc, x, ld, c11, ldc, h);                          //U1 = P1 + P2
+}
+
+template <typename T>
+void StrassenWinograd<T>::parallel(const T* a, const T* b, T* c)
+{
+    int h = m_Size / 2;
+    std::size_t n = m_Size;
+    std::size_t ld = h;
+    std::size_t block = ld * h;
+    const T* a11 = a;
+    const T* a12 = a + h;
+    const T* a21 = a + h * n;
+    const T* a22 = a21 + h;
+    const T* b11 = b;
+    const T* b12 = b + h;
+    const T* b21 = b + h * n;
+    const T* b22 = b21 + h;
+    T* c11 = c;
+    T* c12 = c + h;
+    T* c21 = c + h * n;
+    T* c22 = c21 + h;
+    T* s1 = &m_Arena[0];
+    T* s2 = s1 + block;
+    T* s3 = s2 + block;
+    T* s4 = s3 + block;
+    T* t1 = s4 + block;
+    T* t2 = t1 + block;
+    T* t3 = t2 + block;
+    T* t4 = t3 + block;
+    T* p1 = t4 + block;
+    T* p6 = p1 + block;
+    T* p7 = p6 + block;
+    T* workspaces = p7 + block;
+    std::size_t workspace = sequentialWorkspace(h, m_Cutoff);
+
+    add(s1, ld, a21, n, a22, n, h);
+    subtract(s2, ld, s1, ld, a11, n, h);
+    subtract(s3, ld, a11, n, a21, n, h);
+    subtract(s4, ld, a12, n, s2, ld, h);
+    subtract(t1, ld, b12, n, b11, n, h);
+    subtract(t2, ld, b22, n, t1, ld, h);
+    subtract(t3, ld, b22, n, b12, n, h);
+    subtract(t4, ld, t2, ld, b21, n, h);
+
+    const T* lhs[7] = { a11, a12, s4, a22, s1, s2, s3 };
+    std::size_t lhs_ld[7] = { n, n, ld, n, ld, ld, ld };
+    const T* rhs[7] = { b11, b21, b22, t4, t1, t2, t3 };
+    std::size_t rhs_ld[7] = { n, n, n, ld, ld, ld, ld };
+    T* out[7] = { p1, c11, c12, c21, c22, p6, p7 };
+    std::size_t out_ld[7] = { ld, n, n, n, n, ld, ld };
+    int cutoff = m_Cutoff;
+    ThreadPool::instance().parallelFor(0, 7, 1, [&](int first, int last)
+    {
+        for (int product = first; product < last; product++)
+        {
+            sequential(lhs[product], lhs_ld[product], rhs[product], rhs_ld[product], out[product], out_ld[product],
+                       h, cutoff, workspaces + product * workspace);
+        }
+    });
+
+    //c11 = P2, c12 = P3, c21 = P4, c22 = P5 at this point.
+    add(p6, ld, p1, ld, p6, ld, h);         //U2 = P1 + P6
+    add(c12, n, c12, n, p6, ld, h);         //U2 + P3
+    add(c12, n, c12, n, c22, n, h);         //U5 = U2 + P3 + P5
+    add(p7, ld, p6, ld, p7, ld, h);         //U3 = U2 + P7
+    subtract(c21, n, p7, ld, c21, n, h);    //U6 = U3 - P4
+    add(c22, n, p7, ld, c22, n, h);         //U7 = U3 + P5
+    add(c11, n, p1, ld, c11, n, h);         //U1 = P1 + P2
+}
+}
+
+#endif /* MatrixMultiply_h */
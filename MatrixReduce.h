@@ -0,0 +1,263 @@
+//
+//  MatrixReduce.h
+//  Matrix
+//
+/*
+ This file exports reductions of whole matrices (sum, norms and the dot product of two matrices) that
+ return bit identical floating point results whatever the number of threads. The matrix is cut into
+ blocks of REDUCTION_CHUNK elements that depend only on its dimensions, every block is summed in a fixed
+ order, and the block sums are combined by a fixed pairwise tree. FAST mode drops that guarantee: each
+ thread keeps one running sum over the blocks it takes, and the threads' sums are added as they finish.
+ any / all need no such mode, their result does not depend on the order of evaluation.
+*/
+#ifndef MatrixReduce_h
+#define MatrixReduce_h
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "SummedArea.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Enum: ReductionMode
+* ------------------------
+* REPRODUCIBLE - fixed blocks, each summed in a fixed order, combined by a fixed pairwise tree: the same
+*                result with SEQUENTIAL, PARALLEL and any pool size, and for every Layout (default).
+* FAST - per thread running sums combined in completion order: the rounding of a floating point result
+*        may change from run to run with PARALLEL.
+*/
+enum ReductionMode { REPRODUCIBLE, FAST };
+
+//Elements of one reduction block, the unit of work handed to a thread, and its height: 64 x 64 blocks
+//read well in every Layout, and a matrix of fewer rows gets wider blocks.
+const int REDUCTION_CHUNK = 4096;
+const int REDUCTION_BLOCK_HEIGHT = 64;
+
+
+/**
+* function: sum
+* Usage: sum(mat)
+*        sum(mat, mtm::REPRODUCIBLE, mtm::PARALLEL)
+* -----------------------------
+@return the sum of the elements of mat, as SumOf<T>::type (long long for integral T, so the sum of a
+*       Matrix<bool> is its number of true elements).
+@param mode - see ReductionMode (default REPRODUCIBLE). Integral sums are exact in both modes.
+@param execution - PARALLEL sums the blocks on the shared ThreadPool (default SEQUENTIAL).
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+typename SumOf<T>::type sum(const Matrix<T> &mat, ReductionMode mode = REPRODUCIBLE, Execution execution = SEQUENTIAL);
+
+/**
+* function: dot
+* Usage: dot(a, b)
+*        dot(a, b, mtm::FAST, mtm::PARALLEL)
+* -----------------------------
+@return the sum of the products of the matching elements of a and b (the Frobenius inner product).
+@exception DimensionMismatch if the dimensions of a and b differ.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+typename SumOf<T>::type dot(const Matrix<T> &a, const Matrix<T> &b, ReductionMode mode = REPRODUCIBLE,
+                            Execution execution = SEQUENTIAL);
+
+/**
+* function: norm1 / frobeniusNorm / maxNorm
+* Usage: frobeniusNorm(mat)
+*        norm1(mat, mtm::REPRODUCIBLE, mtm::PARALLEL)
+* -----------------------------
+* Entrywise norms of a floating point matrix: the sum of the absolute values, the square root of the sum
+* of the squares, and the largest absolute value (which is exact, so it has no mode). A NaN element makes
+* every norm NaN.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+T norm1(const Matrix<T> &mat, ReductionMode mode = REPRODUCIBLE, Execution execution = SEQUENTIAL);
+
+template <typename T>
+T frobeniusNorm(const Matrix<T> &mat, ReductionMode mode = REPRODUCIBLE, Execution execution = SEQUENTIAL);
+
+template <typename T>
+T maxNorm(const Matrix<T> &mat, Execution execution = SEQUENTIAL);
+
+/**
+* function: reduceBlocks
+* Usage: reduceBlocks<A>(a, b, term, mode, execution)
+* -----------------------------
+* The driver of the reductions above: the sum of term(x, y, k) over the REDUCTION_CHUNK blocks of a (and
+* the matching blocks of b unless it is NULL), where x (y) holds the elements of a block of a (b) in
+* row-major order and k runs over them. Within a block the terms are added into four interleaved partial
+* sums, which are then added pairwise.
+*/
+template <typename A, typename T, typename F>
+A reduceBlocks(const Matrix<T> &a, const Matrix<T> *b, F term, ReductionMode mode, Execution execution);
+
+
+
+//the sum of partial[0..count) as a balanced binary tree, so the result depends on count only.
+template <typename A>
+A pairwiseSum(const A *partial, int count)
+{
+    if (count == 1)
+    {
+        return partial[0];
+    }
+    int half = count / 2;
+    return pairwiseSum(partial, half) + pairwiseSum(partial + half, count - half);
+}
+
+//the terms of one block, into four partial sums.
+template <typename A, typename T, typename F>
+A sumBlock(const T *x, const T *y, int count, F term)
+{
+    A lanes[4] = { A(), A(), A(), A() };
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        lanes[0] += term(x, y, k);
+        lanes[1] += term(x, y, k + 1);
+        lanes[2] += term(x, y, k + 2);
+        lanes[3] += term(x, y, k + 3);
+    }
+    for (; k < count; k++)
+    {
+        lanes[k % 4] += term(x, y, k);
+    }
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+//Both modes read the same blocks through ConstBlock::copyTo. REPRODUCIBLE keeps one sum per block and
+//adds them with pairwiseSum, FAST keeps one sum per band of blocks and adds the bands under a lock.
+template <typename A, typename T, typename F>
+A reduceBlocks(const Matrix<T> &a, const Matrix<T> *b, F term, ReductionMode mode, Execution execution)
+{
+    if (a.size() == 0)
+    {
+        return A();
+    }
+    int block_height = std::min(a.height(), REDUCTION_BLOCK_HEIGHT);
+    int block_width = std::min(a.width(), REDUCTION_CHUNK / block_height);
+    typename Matrix<T>::ConstBlocks a_blocks = a.blocks(block_height, block_width);
+    typename Matrix<T>::ConstBlocks b_blocks = (b != NULL ? *b : a).blocks(block_height, block_width);
+    int count = a_blocks.size();
+    std::vector<A> partial((mode == REPRODUCIBLE) ? count : 0);
+    A total = A();
+    std::mutex total_mutex;
+    parallelRows(count, block_height * block_width, execution, [&](int first, int last)
+    {
+        std::size_t elements = (std::size_t)block_height * block_width;
+        std::unique_ptr<T[]> x = scratchElements<T>(elements);
+        std::unique_ptr<T[]> y = scratchElements<T>((b != NULL) ? elements : 1);
+        A band = A();
+        for (int k = first; k < last; k++)
+        {
+            typename Matrix<T>::ConstBlock block = a_blocks[k];
+            block.copyTo(x.get());
+            if (b != NULL)
+            {
+                b_blocks[k].copyTo(y.get());
+            }
+            A block_sum = sumBlock<A>(x.get(), (b != NULL) ? y.get() : NULL, block.height() * block.width(), term);
+            if (mode == REPRODUCIBLE)
+            {
+                partial[k] = block_sum;
+            }
+            else
+            {
+                band += block_sum;
+            }
+        }
+        if (mode == FAST)
+        {
+            std::lock_guard<std::mutex> lock(total_mutex);
+            total += band;
+        }
+    });
+    return (mode == REPRODUCIBLE) ? pairwiseSum(&partial[0], count) : total;
+}
+
+template <typename T>
+typename SumOf<T>::type sum(const Matrix<T> &mat, ReductionMode mode, Execution execution)
+{
+    typedef typename SumOf<T>::type Sum;
+    return reduceBlocks<Sum>(mat, (const Matrix<T> *)NULL, [](const T *x, const T *, int k) { return Sum(x[k]); },
+                             mode, execution);
+}
+
+template <typename T>
+typename SumOf<T>::type dot(const Matrix<T> &a, const Matrix<T> &b, ReductionMode mode, Execution execution)
+{
+    typedef typename SumOf<T>::type Sum;
+    if (a.height() != b.height() || a.width() != b.width())
+    {
+        typename Matrix<T>::DimensionMismatch error(Dimensions(a.height(), a.width()), Dimensions(b.height(), b.width()));
+        throw error;
+    }
+    return reduceBlocks<Sum>(a, &b, [](const T *x, const T *y, int k) { return Sum(x[k]) * Sum(y[k]); }, mode,
+                             execution);
+}
+
+template <typename T>
+T norm1(const Matrix<T> &mat, ReductionMode mode, Execution execution)
+{
+    static_assert(std::is_floating_point<T>::value, "norms are taken of float, double or long double matrices");
+    return reduceBlocks<T>(mat, (const Matrix<T> *)NULL, [](const T *x, const T *, int k) { return std::fabs(x[k]); },
+                           mode, execution);
+}
+
+template <typename T>
+T frobeniusNorm(const Matrix<T> &mat, ReductionMode mode, Execution execution)
+{
+    static_assert(std::is_floating_point<T>::value, "norms are taken of float, double or long double matrices");
+    return std::sqrt(reduceBlocks<T>(mat, (const Matrix<T> *)NULL,
+                                     [](const T *x, const T *, int k) { return x[k] * x[k]; }, mode, execution));
+}
+
+template <typename T>
+T maxNorm(const Matrix<T> &mat, Execution execution)
+{
+    static_assert(std::is_floating_point<T>::value, "norms are taken of float, double or long double matrices");
+    if (mat.size() == 0)
+    {
+        return T();
+    }
+    //a NaN replaces the maximum, and stays: it compares false with everything, so nothing replaces it
+    int block_height = std::min(mat.height(), REDUCTION_BLOCK_HEIGHT);
+    typename Matrix<T>::ConstBlocks blocks = mat.blocks(block_height, std::min(mat.width(), REDUCTION_CHUNK / block_height));
+    std::vector<T> partial(blocks.size(), T());
+    parallelRows(blocks.size(), REDUCTION_CHUNK, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> x = scratchElements<T>(REDUCTION_CHUNK);
+        for (int k = first; k < last; k++)
+        {
+            typename Matrix<T>::ConstBlock block = blocks[k];
+            block.copyTo(x.get());
+            for (int e = 0; e < block.height() * block.width(); e++)
+            {
+                T value = (T)std::fabs(x[e]);
+                if (value > partial[k] || value != value)
+                {
+                    partial[k] = value;
+                }
+            }
+        }
+    });
+    T largest = partial[0];
+    for (std::size_t k = 1; k < partial.size(); k++)
+    {
+        if (partial[k] > largest || partial[k] != partial[k])
+        {
+            largest = partial[k];
+        }
+    }
+    return largest;
+}
+}
+
+#endif /* MatrixReduce_h */
@@ -0,0 +1,31 @@
+#include "MatrixSort.h"
+
+//Knuth's iterative form of Batcher's merge exchange on the next power of two, keeping the pairs inside length.
+std::vector< std::pair<int, int> > mtm::sortingNetwork(int length)
+{
+    int padded = 1;
+    while (padded < length)
+    {
+        padded *= 2;
+    }
+    std::vector< std::pair<int, int> > network;
+    for (int merged = 1; merged < padded; merged *= 2)
+    {
+        for (int distance = merged; distance >= 1; distance /= 2)
+        {
+            for (int start = distance % merged; start + distance < padded; start += 2 * distance)
+            {
+                for (int i = 0; i < std::min(distance, padded - start - distance); i++)
+                {
+                    int first = start + i;
+                    int second = start + i + distance;
+                    if (first / (2 * merged) == second / (2 * merged) && second < length)
+                    {
+                        network.push_back(std::make_pair(first, second));
+                    }
+                }
+            }
+        }
+    }
+    return network;
+}
@@ -0,0 +1,441 @@
+//
+//  MatrixSort.h
+//  Matrix
+//
+/*
+ This file exports ranking along the rows or the columns of a matrix: sort, argsort, partialSort,
+ topK / argTopK and unique. Every line (row or column) is handled independently, lines are split between
+ the threads of the shared ThreadPool when PARALLEL. Short lines of arithmetic elements are sorted by a
+ sorting network run on a batch of lines at once, so every compare-exchange is a vectorizable min / max
+ over the batch instead of a branch per element.
+*/
+#ifndef MatrixSort_h
+#define MatrixSort_h
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Enum: SortAxis
+* ------------------------
+* EACH_ROW - every row is ranked on its own (the elements move along the row).
+* EACH_COLUMN - every column is ranked on its own (the elements move along the column).
+*/
+enum SortAxis { EACH_ROW, EACH_COLUMN };
+
+/**
+* Enum: SortOrder
+* ------------------------
+* ASCENDING - smallest first (by operator<).
+* DESCENDING - largest first.
+*/
+enum SortOrder { ASCENDING, DESCENDING };
+
+//Longest line sorted by a sorting network (for arithmetic elements), from bench/bench_sort.cpp: on doubles
+//the network is 2 to 3 times faster than std::sort up to 128 elements, its O(n log^2 n) pairs catch up after.
+//Longer lines go to std::sort.
+const int SORT_NETWORK_LENGTH = 128;
+
+//Lines a sorting network is run on at once: the compare-exchange of one pair of positions is a loop over
+//this many lanes.
+const int SORT_NETWORK_BATCH = 64;
+
+
+/**
+* function: sort
+* Usage: sort(mat)
+*        sort(mat, mtm::EACH_COLUMN, mtm::DESCENDING, mtm::PARALLEL)
+* -----------------------------
+* Sorts every row (or every column) of mat in place. Lines of at most SORT_NETWORK_LENGTH arithmetic
+* elements are sorted by a sorting network, longer ones (and other element types) by std::sort.
+@param axis - see SortAxis (default EACH_ROW).
+@param order - see SortOrder (default ASCENDING).
+@param execution - PARALLEL splits the lines between the threads of the shared ThreadPool (default SEQUENTIAL).
+@remarks (assumptions) operator< is a strict weak order on the elements (so no NaN), as for std::sort.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+void sort(Matrix<T> &mat, SortAxis axis = EACH_ROW, SortOrder order = ASCENDING, Execution execution = SEQUENTIAL);
+
+/**
+* function: argsort
+* Usage: argsort(mat)
+*        argsort(mat, mtm::EACH_COLUMN, mtm::DESCENDING)
+* -----------------------------
+* The permutation that sorts every line: element k of a line of the result is the index (column for
+* EACH_ROW, row for EACH_COLUMN) of the k-th element of the sorted line. The sort is stable, equal
+* elements keep their order.
+@return matrix of the dimensions of mat, with its SharingPolicy, Layout and MemoryPolicy.
+@remarks (assumptions) as sort.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<int> argsort(const Matrix<T> &mat, SortAxis axis = EACH_ROW, SortOrder order = ASCENDING,
+                    Execution execution = SEQUENTIAL);
+
+/**
+* function: partialSort
+* Usage: partialSort(mat, k)
+*        partialSort(mat, k, mtm::EACH_ROW, mtm::DESCENDING, mtm::PARALLEL)
+* -----------------------------
+* Rearranges every line in place so its first k elements are the k first ones of the sorted line, in
+* order. The remaining elements follow in an unspecified order. O(length log k) per line.
+@exception AccessIllegalElement if k is not in [1, line length].
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+void partialSort(Matrix<T> &mat, int k, SortAxis axis = EACH_ROW, SortOrder order = ASCENDING,
+                 Execution execution = SEQUENTIAL);
+
+/**
+* function: topK / argTopK
+* Usage: topK(mat, k)
+*        argTopK(mat, k, mtm::EACH_COLUMN, mtm::PARALLEL)
+* -----------------------------
+* The k largest elements of every line in decreasing order, and their indices (ties go to the smaller index).
+@return a (height x k) matrix for EACH_ROW or a (k x width) one for EACH_COLUMN, with mat's SharingPolicy,
+*       Layout and MemoryPolicy.
+@exception AccessIllegalElement if k is not in [1, line length].
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+Matrix<T> topK(const Matrix<T> &mat, int k, SortAxis axis = EACH_ROW, Execution execution = SEQUENTIAL);
+
+template <typename T>
+Matrix<int> argTopK(const Matrix<T> &mat, int k, SortAxis axis = EACH_ROW, Execution execution = SEQUENTIAL);
+
+/**
+* function: unique
+* Usage: unique(mat)
+*        unique(mat, mtm::EACH_COLUMN, mtm::PARALLEL)
+* -----------------------------
+* Sorts every line in place into its distinct elements in increasing order, followed by the repeated
+* copies (also in increasing order). Two elements are equal when neither is less than the other.
+@return the number of distinct elements of every line (height entries for EACH_ROW, width for EACH_COLUMN).
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename T>
+std::vector<int> unique(Matrix<T> &mat, SortAxis axis = EACH_ROW, Execution execution = SEQUENTIAL);
+
+
+/**
+* function: sortingNetwork
+* Usage: sortingNetwork(length)
+* -----------------------------
+* Batcher's odd-even merge sort network on length positions, as the ordered list of the compare-exchange
+* pairs (first < second). The network of the next power of two is generated and the pairs reaching past
+* length dropped: they would only compare against padding that is already in place.
+*/
+std::vector< std::pair<int, int> > sortingNetwork(int length);
+
+/**
+* function: sortLineBatch
+* Usage: sortLineBatch(lines, count, length, network, order, lanes)
+* -----------------------------
+* Sorts count (at most SORT_NETWORK_BATCH) contiguous lines of length elements with network, after
+* gathering position k of every line into lane k (lanes + k * SORT_NETWORK_BATCH) of the scratch lanes,
+* of length * SORT_NETWORK_BATCH elements.
+*/
+template <typename T>
+void sortLineBatch(T* lines, int count, int length, const std::vector< std::pair<int, int> > &network,
+                   SortOrder order, T* lanes);
+
+
+//the lines of mat along axis, one after the other.
+template <typename T>
+std::unique_ptr<T[]> readLines(const Matrix<T> &mat, SortAxis axis)
+{
+    std::unique_ptr<T[]> lines = scratchElements<T>(mat.size());
+    if (axis == EACH_ROW)
+    {
+        mat.copyTo(lines.get());
+    }
+    else
+    {
+        mat.transpose().copyTo(lines.get());
+    }
+    return lines;
+}
+
+//writes lines (of mat's rows or columns) back into mat.
+template <typename T>
+void writeLines(Matrix<T> &mat, SortAxis axis, const T* lines)
+{
+    if (axis == EACH_ROW)
+    {
+        mat.copyFrom(lines);
+        return;
+    }
+    std::unique_ptr<T[]> rows = scratchElements<T>(mat.size());
+    transposeArray(lines, mat.width(), mat.height(), rows.get());
+    mat.copyFrom(rows.get());
+}
+
+//a (count x length) matrix for EACH_ROW, its transpose for EACH_COLUMN, from count lines of length elements.
+template <typename T, typename U>
+Matrix<T> fromLines(const Matrix<U> &mat, SortAxis axis, const T* lines, int count, int length)
+{
+    Dimensions dims = (axis == EACH_ROW) ? Dimensions(count, length) : Dimensions(length, count);
+    Matrix<T> result(dims, T(), mat.sharing(), mat.layout(), mat.memory());
+    if (axis == EACH_ROW)
+    {
+        result.copyFrom(lines);
+        return result;
+    }
+    std::unique_ptr<T[]> rows = scratchElements<T>((std::size_t)count * length);
+    transposeArray(lines, count, length, rows.get());
+    result.copyFrom(rows.get());
+    return result;
+}
+
+//throws AccessIllegalElement unless k is in [1, line length].
+template <typename T>
+void checkRank(const Matrix<T> &mat, int k, SortAxis axis)
+{
+    if (k < 1 || k > ((axis == EACH_ROW) ? mat.width() : mat.height()))
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+}
+
+//sorts count contiguous lines of length elements, by std::sort.
+template <typename T>
+void sortLines(T* lines, int count, int length, SortOrder order, Execution execution, std::false_type)
+{
+    parallelRows(count, length * 8, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            T* line = lines + (std::size_t)i * length;
+            if (order == ASCENDING)
+            {
+                std::sort(line, line + length);
+            }
+            else
+            {
+                std::sort(line, line + length, [](const T &a, const T &b) { return b < a; });
+            }
+        }
+    });
+}
+
+//by sortLineBatch when the lines are short enough.
+template <typename T>
+void sortLines(T* lines, int count, int length, SortOrder order, Execution execution, std::true_type)
+{
+    if (length > SORT_NETWORK_LENGTH)
+    {
+        sortLines(lines, count, length, order, execution, std::false_type());
+        return;
+    }
+    std::vector< std::pair<int, int> > network = sortingNetwork(length);
+    int batches = (count + SORT_NETWORK_BATCH - 1) / SORT_NETWORK_BATCH;
+    parallelRows(batches, SORT_NETWORK_BATCH * (int)network.size(), execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> lanes = scratchElements<T>((std::size_t)length * SORT_NETWORK_BATCH);
+        for (int b = first; b < last; b++)
+        {
+            int batch = std::min(SORT_NETWORK_BATCH, count - b * SORT_NETWORK_BATCH);
+            sortLineBatch(lines + (std::size_t)b * SORT_NETWORK_BATCH * length, batch, length, network, order,
+                          lanes.get());
+        }
+    });
+}
+
+
+template <typename T>
+void sortLineBatch(T* lines, int count, int length, const std::vector< std::pair<int, int> > &network,
+                   SortOrder order, T* lanes)
+{
+    for (int i = 0; i < count; i++)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            lanes[k * SORT_NETWORK_BATCH + i] = lines[(std::size_t)i * length + k];
+        }
+    }
+    for (std::size_t p = 0; p < network.size(); p++)
+    {
+        T* low = lanes + ((order == ASCENDING) ? network[p].first : network[p].second) * SORT_NETWORK_BATCH;
+        T* high = lanes + ((order == ASCENDING) ? network[p].second : network[p].first) * SORT_NETWORK_BATCH;
+        for (int i = 0; i < count; i++)
+        {
+            T a = low[i];
+            T b = high[i];
+            bool swap = b < a;
+            low[i] = swap ? b : a;
+            high[i] = swap ? a : b;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        for (int k = 0; k < length; k++)
+        {
+            lines[(std::size_t)i * length + k] = lanes[k * SORT_NETWORK_BATCH + i];
+        }
+    }
+}
+
+template <typename T>
+void sort(Matrix<T> &mat, SortAxis axis, SortOrder order, Execution execution)
+{
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    sortLines(lines.get(), (int)(mat.size() / length), length, order, execution,
+              std::integral_constant<bool, std::is_arithmetic<T>::value>());
+    writeLines(mat, axis, lines.get());
+}
+
+template <typename T>
+Matrix<int> argsort(const Matrix<T> &mat, SortAxis axis, SortOrder order, Execution execution)
+{
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    int count = (int)(mat.size() / length);
+    std::vector<int> indices(mat.size());
+    parallelRows(count, length * 8, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            const T* line = lines.get() + (std::size_t)i * length;
+            int* index = &indices[(std::size_t)i * length];
+            for (int k = 0; k < length; k++)
+            {
+                index[k] = k;
+            }
+            if (order == ASCENDING)
+            {
+                std::stable_sort(index, index + length, [line](int a, int b) { return line[a] < line[b]; });
+            }
+            else
+            {
+                std::stable_sort(index, index + length, [line](int a, int b) { return line[b] < line[a]; });
+            }
+        }
+    });
+    return fromLines(mat, axis, &indices[0], count, length);
+}
+
+template <typename T>
+void partialSort(Matrix<T> &mat, int k, SortAxis axis, SortOrder order, Execution execution)
+{
+    checkRank(mat, k, axis);
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    int count = (int)(mat.size() / length);
+    parallelRows(count, length * 4, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            T* line = lines.get() + (std::size_t)i * length;
+            if (order == ASCENDING)
+            {
+                std::partial_sort(line, line + k, line + length);
+            }
+            else
+            {
+                std::partial_sort(line, line + k, line + length, [](const T &a, const T &b) { return b < a; });
+            }
+        }
+    });
+    writeLines(mat, axis, lines.get());
+}
+
+//the indices are ranked rather than the elements, so ties are broken by index.
+template <typename T>
+Matrix<int> argTopK(const Matrix<T> &mat, int k, SortAxis axis, Execution execution)
+{
+    checkRank(mat, k, axis);
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    int count = (int)(mat.size() / length);
+    std::vector<int> top((std::size_t)count * k);
+    parallelRows(count, length * 4, execution, [&](int first, int last)
+    {
+        std::vector<int> index(length);
+        for (int i = first; i < last; i++)
+        {
+            const T* line = lines.get() + (std::size_t)i * length;
+            for (int j = 0; j < length; j++)
+            {
+                index[j] = j;
+            }
+            std::partial_sort(index.begin(), index.begin() + k, index.end(), [line](int a, int b)
+            {
+                return line[b] < line[a] || (!(line[a] < line[b]) && a < b);
+            });
+            std::copy(index.begin(), index.begin() + k, top.begin() + (std::ptrdiff_t)i * k);
+        }
+    });
+    return fromLines(mat, axis, &top[0], count, k);
+}
+
+template <typename T>
+Matrix<T> topK(const Matrix<T> &mat, int k, SortAxis axis, Execution execution)
+{
+    checkRank(mat, k, axis);
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    int count = (int)(mat.size() / length);
+    std::unique_ptr<T[]> top = scratchElements<T>((std::size_t)count * k);
+    parallelRows(count, length * 4, execution, [&](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            T* line = lines.get() + (std::size_t)i * length;
+            std::partial_sort(line, line + k, line + length, [](const T &a, const T &b) { return b < a; });
+            std::copy(line, line + k, top.get() + (std::size_t)i * k);
+        }
+    });
+    return fromLines(mat, axis, top.get(), count, k);
+}
+
+template <typename T>
+std::vector<int> unique(Matrix<T> &mat, SortAxis axis, Execution execution)
+{
+    std::unique_ptr<T[]> lines = readLines(mat, axis);
+    int length = (axis == EACH_ROW) ? mat.width() : mat.height();
+    int count = (int)(mat.size() / length);
+    sortLines(lines.get(), count, length, ASCENDING, execution,
+              std::integral_constant<bool, std::is_arithmetic<T>::value>());
+    std::vector<int> distinct(count);
+    parallelRows(count, length, execution, [&](int first, int last)
+    {
+        std::unique_ptr<T[]> repeated = scratchElements<T>(length);
+        for (int i = first; i < last; i++)
+        {
+            T* line = lines.get() + (std::size_t)i * length;
+            int kept = 1;
+            int copies = 0;
+            for (int j = 1; j < length; j++)
+            {
+                if (line[kept - 1] < line[j])
+                {
+                    if (kept != j)
+                    {
+                        line[kept] = std::move(line[j]);
+                    }
+                    kept++;
+                }
+                else
+                {
+                    repeated[copies++] = std::move(line[j]);
+                }
+            }
+            std::move(repeated.get(), repeated.get() + copies, line + kept);
+            distinct[i] = kept;
+        }
+    });
+    writeLines(mat, axis, lines.get());
+    return distinct;
+}
+}
+
+#endif /* MatrixSort_h */
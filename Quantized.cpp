@@ -0,0 +1,118 @@
+#include "Quantized.h"
+#include <cstring>
+
+namespace {
+    //rows of both operands are zero padded to a multiple of this, the vector loops need no tail.
+    const int INT8_BLOCK = 32;
+
+    void checkProduct(const mtm::Matrix<std::int8_t>& a, const mtm::Matrix<std::int8_t>& b)
+    {
+        if (a.width() != b.height())
+        {
+            mtm::Matrix<std::int8_t>::DimensionMismatch error(mtm::Dimensions(a.height(), a.width()),
+                                                             mtm::Dimensions(b.height(), b.width()));
+            throw error;
+        }
+    }
+}
+
+//a is copied into padded rows, b transposed into padded rows (and rounded up to four of them).
+void mtm::multiplyInt8(const std::int8_t* a, const std::int8_t* b, std::int32_t* c, int n, int m, int p,
+                       Execution execution)
+{
+    int padded = (m + INT8_BLOCK - 1) / INT8_BLOCK * INT8_BLOCK;
+    int columns = (p + 3) / 4 * 4;
+    std::vector<std::int8_t> rows((std::size_t)n * padded, 0);
+    std::vector<std::int8_t> transposed((std::size_t)columns * padded, 0);
+    std::vector<std::int32_t> sums(columns, 0);
+    for (int i = 0; i < n; i++)
+    {
+        std::memcpy(&rows[(std::size_t)i * padded], a + (std::size_t)i * m, m);
+    }
+    for (int k = 0; k < m; k++)
+    {
+        const std::int8_t* b_row = b + (std::size_t)k * p;
+        for (int j = 0; j < p; j++)
+        {
+            transposed[(std::size_t)j * padded + k] = b_row[j];
+            sums[j] += b_row[j];
+        }
+    }
+    const std::int8_t* packed_a = &rows[0];
+    const std::int8_t* packed_b = &transposed[0];
+    const std::int32_t* b_sums = &sums[0];
+    int work = (int)std::min<long long>((long long)padded * columns / 64 + 1, 1 << 30);
+    parallelRows(n, work, execution, [=](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            const std::int8_t* a_row = packed_a + (std::size_t)i * padded;
+            std::int32_t* c_row = c + (std::size_t)i * p;
+            for (int j = 0; j < columns; j += 4)
+            {
+                const std::int8_t* b_rows[4];
+                for (int t = 0; t < 4; t++)
+                {
+                    b_rows[t] = packed_b + (std::size_t)(j + t) * padded;
+                }
+                std::int32_t dots[4];
+                dotInt8Rows(a_row, b_rows, b_sums + j, padded, dots);
+                for (int t = 0; t < 4 && j + t < p; t++)
+                {
+                    c_row[j + t] = dots[t];
+                }
+            }
+        }
+    });
+}
+
+void mtm::multiplyInt8Reference(const std::int8_t* a, const std::int8_t* b, std::int32_t* c, int n, int m, int p)
+{
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < p; j++)
+        {
+            std::int32_t sum = 0;
+            for (int k = 0; k < m; k++)
+            {
+                sum += (std::int32_t)a[(std::size_t)i * m + k] * b[(std::size_t)k * p + j];
+            }
+            c[(std::size_t)i * p + j] = sum;
+        }
+    }
+}
+
+mtm::Matrix<std::int32_t> mtm::multiplyInt8(const Matrix<std::int8_t>& a, const Matrix<std::int8_t>& b,
+                                            Execution execution)
+{
+    checkProduct(a, b);
+    int n = a.height();
+    int m = a.width();
+    int p = b.width();
+    std::vector<std::int8_t> packed_a((std::size_t)n * m);
+    std::vector<std::int8_t> packed_b((std::size_t)m * p);
+    std::vector<std::int32_t> packed_c((std::size_t)n * p);
+    a.copyTo(&packed_a[0]);
+    b.copyTo(&packed_b[0]);
+    multiplyInt8(&packed_a[0], &packed_b[0], &packed_c[0], n, m, p, execution);
+    Matrix<std::int32_t> product(Dimensions(n, p), 0, a.sharing(), a.layout(), a.memory());
+    product.copyFrom(&packed_c[0]);
+    return product;
+}
+
+mtm::Matrix<std::int32_t> mtm::multiplyInt8Reference(const Matrix<std::int8_t>& a, const Matrix<std::int8_t>& b)
+{
+    checkProduct(a, b);
+    int n = a.height();
+    int m = a.width();
+    int p = b.width();
+    std::vector<std::int8_t> packed_a((std::size_t)n * m);
+    std::vector<std::int8_t> packed_b((std::size_t)m * p);
+    std::vector<std::int32_t> packed_c((std::size_t)n * p);
+    a.copyTo(&packed_a[0]);
+    b.copyTo(&packed_b[0]);
+    multiplyInt8Reference(&packed_a[0], &packed_b[0], &packed_c[0], n, m, p);
+    Matrix<std::int32_t> product(Dimensions(n, p), 0, a.sharing(), a.layout(), a.memory());
+    product.copyFrom(&packed_c[0]);
+    return product;
+}
@@ -0,0 +1,379 @@
+//
+//  Quantized.h
+//  Matrix
+//
+/*
+ This file exports 8 bit quantized matrices (Matrix<int8_t> or Matrix<uint8_t> with a scale and a zero
+ point), their conversions from and to Matrix<float>, and the int8 x int8 -> int32 product they are
+ multiplied with. The product kernel is dotInt8Rows of CpuDispatch.h (vpdpbusd with AVX-512 VNNI,
+ vpmaddwd with AVX2), multiplyInt8Reference is the plain loop the vector kernels are checked against.
+*/
+#ifndef Quantized_h
+#define Quantized_h
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* function: multiplyInt8 / multiplyInt8Reference
+* Usage: multiplyInt8(a, b)
+*        multiplyInt8(a, b, mtm::PARALLEL)
+*        multiplyInt8Reference(a, b)
+* -----------------------------
+* Exact integer product of int8 matrices, accumulated in int32 (no saturation: any inner dimension below
+* 2^31 / 128^2 = 131072 is exact). The result has a's SharingPolicy, Layout and MemoryPolicy.
+@param execution - PARALLEL splits the rows of the result between the threads of the shared ThreadPool.
+@return new matrix of dimensions (a.height(), b.width()), equal for both functions.
+@exception DimensionMismatch if a.width() != b.height().
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+Matrix<std::int32_t> multiplyInt8(const Matrix<std::int8_t> &a, const Matrix<std::int8_t> &b,
+                                  Execution execution = SEQUENTIAL);
+Matrix<std::int32_t> multiplyInt8Reference(const Matrix<std::int8_t> &a, const Matrix<std::int8_t> &b);
+
+/**
+* function: multiplyInt8 (arrays)
+* Usage: multiplyInt8(a, b, c, n, m, p)
+*        multiplyInt8Reference(a, b, c, n, m, p)
+* -----------------------------
+* Kernels behind the matrix versions, on row-major arrays: c (n x p) = a (n x m) * b (m x p).
+* b is packed transposed so every result element is a contiguous dot product, computed four columns
+* at a time to reuse the loaded row of a.
+*/
+void multiplyInt8(const std::int8_t* a, const std::int8_t* b, std::int32_t* c, int n, int m, int p,
+                  Execution execution = SEQUENTIAL);
+void multiplyInt8Reference(const std::int8_t* a, const std::int8_t* b, std::int32_t* c, int n, int m, int p);
+
+
+/**
+* Class: Quantized<Q>
+* ------------------------
+* Affine quantized matrix: element (i, j) stands for the real value scale * (values(i, j) - zero_point).
+* Q is std::int8_t or std::uint8_t. The zero point is a value of Q, so the real 0 is represented exactly.
+*/
+template <typename Q>
+class Quantized{
+private:
+    static_assert(std::is_same<Q, std::int8_t>::value || std::is_same<Q, std::uint8_t>::value,
+                  "Quantized elements are std::int8_t or std::uint8_t");
+
+    Matrix<Q> m_Values;
+    float m_Scale;
+    int m_ZeroPoint;
+
+    static void checkParameters(float scale, int zero_point);
+
+public:
+    /**
+    * Constructor: Quantized
+    * Usage: Quantized<Q> quantized(values, scale, zero_point);
+    * ---------------------------------------
+    * Wraps already quantized values (sharing them under their SharingPolicy).
+    @exception IllegalQuantization if scale is not positive and finite or zero_point is not a value of Q.
+    */
+    Quantized(const Matrix<Q> &values, float scale, int zero_point);
+
+    /**
+    * static function: quantize
+    * Usage: Quantized<Q>::quantize(mat)
+    *        Quantized<Q>::quantize(mat, scale, zero_point, mtm::PARALLEL)
+    * -----------------------------
+    * Rounds every element of mat to the nearest representable value, saturating outside the range.
+    * Without parameters they are chosen from the smallest and largest elements of mat (and 0), so
+    * that range spreads over all the values of Q.
+    @param execution - PARALLEL converts bands of rows on the shared ThreadPool (default SEQUENTIAL).
+    @exception IllegalQuantization if scale is not positive and finite or zero_point is not a value of Q.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    static Quantized quantize(const Matrix<float> &mat, Execution execution = SEQUENTIAL);
+    static Quantized quantize(const Matrix<float> &mat, float scale, int zero_point,
+                              Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: dequantize
+    * Usage: quantized.dequantize()
+    * -----------------------------
+    @return the real values scale * (values - zero_point) as a Matrix<float>.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    Matrix<float> dequantize(Execution execution = SEQUENTIAL) const;
+
+    const Matrix<Q> &values() const;
+    float scale() const;
+    int zeroPoint() const;
+    int height() const;
+    int width() const;
+
+    /**
+    * Exception: IllegalQuantization
+    * thrown for a scale that is not positive and finite, or a zero point outside the range of Q.
+    */
+    struct IllegalQuantization : public std::exception
+    {
+        const char *what() const throw();
+    };
+};
+
+
+/**
+* function: multiply (quantized)
+* Usage: multiply(a, b)
+*        multiply(a, b, mtm::PARALLEL)
+* -----------------------------
+* Real valued product of two quantized matrices. The integer part runs through multiplyInt8 (uint8 values
+* are first shifted by 128 into int8, with their zero point), the zero points are then removed with the row
+* sums of a and the column sums of b:
+* sum (a - za)(b - zb) = sum a*b - zb * sum a - za * sum b + m * za * zb.
+* The correction terms are added in int64 (each of them alone reaches 128^2 * m), so the integer result is
+* exact for any inner dimension below 131072, the bound of multiplyInt8.
+@return new Matrix<float> of dimensions (a.height(), b.width()).
+@exception DimensionMismatch if a.width() != b.height().
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename Q>
+Matrix<float> multiply(const Quantized<Q> &a, const Quantized<Q> &b, Execution execution = SEQUENTIAL);
+
+/**
+* function: add (quantized)
+* Usage: add(a, b, scale, zero_point)
+* -----------------------------
+* Elementwise sum of two quantized matrices, requantized to the given output parameters.
+@return new Quantized<Q> of a's dimensions.
+@exception DimensionMismatch if the matrices are not of the same dimensions.
+@exception IllegalQuantization if scale is not positive and finite or zero_point is not a value of Q.
+@exception bad_alloc will be thrown if memory allocation failed.
+*/
+template <typename Q>
+Quantized<Q> add(const Quantized<Q> &a, const Quantized<Q> &b, float scale, int zero_point,
+                 Execution execution = SEQUENTIAL);
+
+
+
+template <typename Q>
+void Quantized<Q>::checkParameters(float scale, int zero_point)
+{
+    if (!(scale > 0) || !std::isfinite(scale) || zero_point < std::numeric_limits<Q>::min() ||
+        zero_point > std::numeric_limits<Q>::max())
+    {
+        IllegalQuantization error;
+        throw error;
+    }
+}
+
+template <typename Q>
+Quantized<Q>::Quantized(const Matrix<Q> &values, float scale, int zero_point) :
+m_Values((checkParameters(scale, zero_point), values)),
+m_Scale(scale),
+m_ZeroPoint(zero_point)
+{}
+
+//The range always contains 0 (so does every zero padded or ReLU output), and an all zero matrix gets scale 1.
+template <typename Q>
+Quantized<Q> Quantized<Q>::quantize(const Matrix<float> &mat, Execution execution)
+{
+    std::vector<float> rows((std::size_t)mat.height() * mat.width());
+    mat.copyTo(&rows[0]);
+    float low = 0;
+    float high = 0;
+    for (std::size_t k = 0; k < rows.size(); k++)
+    {
+        low = std::min(low, rows[k]);
+        high = std::max(high, rows[k]);
+    }
+    const float q_min = std::numeric_limits<Q>::min();
+    const float q_max = std::numeric_limits<Q>::max();
+    float scale = (high > low) ? (high - low) / (q_max - q_min) : 1.0f;
+    int zero_point = (int)std::lround(q_min - low / scale);
+    zero_point = std::max((int)q_min, std::min((int)q_max, zero_point));
+    return quantize(mat, scale, zero_point, execution);
+}
+
+template <typename Q>
+Quantized<Q> Quantized<Q>::quantize(const Matrix<float> &mat, float scale, int zero_point, Execution execution)
+{
+    checkParameters(scale, zero_point);
+    std::size_t count = (std::size_t)mat.height() * mat.width();
+    std::vector<float> rows(count);
+    std::vector<Q> quantized(count);
+    mat.copyTo(&rows[0]);
+    const float* from = &rows[0];
+    Q* to = &quantized[0];
+    int width = mat.width();
+    const float inverse = 1.0f / scale;
+    const float offset = (float)zero_point;
+    parallelRows(mat.height(), width, execution, [=](int first, int last)
+    {
+        const float q_min = std::numeric_limits<Q>::min();
+        const float q_max = std::numeric_limits<Q>::max();
+        for (std::size_t k = (std::size_t)first * width; k < (std::size_t)last * width; k++)
+        {
+            float value = std::nearbyint(from[k] * inverse) + offset;
+            to[k] = (Q)std::max(q_min, std::min(q_max, value));
+        }
+    });
+    Matrix<Q> values(Dimensions(mat.height(), width), Q(), mat.sharing(), mat.layout(), mat.memory());
+    values.copyFrom(to);
+    return Quantized(values, scale, zero_point);
+}
+
+template <typename Q>
+Matrix<float> Quantized<Q>::dequantize(Execution execution) const
+{
+    std::size_t count = (std::size_t)height() * width();
+    std::vector<Q> rows(count);
+    std::vector<float> real(count);
+    m_Values.copyTo(&rows[0]);
+    const Q* from = &rows[0];
+    float* to = &real[0];
+    int cols = width();
+    const float scale = m_Scale;
+    const int zero_point = m_ZeroPoint;
+    parallelRows(height(), cols, execution, [=](int first, int last)
+    {
+        for (std::size_t k = (std::size_t)first * cols; k < (std::size_t)last * cols; k++)
+        {
+            to[k] = scale * (float)((int)from[k] - zero_point);
+        }
+    });
+    Matrix<float> result(Dimensions(height(), cols), 0.0f, m_Values.sharing(), m_Values.layout(),
+                         m_Values.memory());
+    result.copyFrom(to);
+    return result;
+}
+
+template <typename Q>
+const Matrix<Q> &Quantized<Q>::values() const
+{
+    return m_Values;
+}
+
+template <typename Q>
+float Quantized<Q>::scale() const
+{
+    return m_Scale;
+}
+
+template <typename Q>
+int Quantized<Q>::zeroPoint() const
+{
+    return m_ZeroPoint;
+}
+
+template <typename Q>
+int Quantized<Q>::height() const
+{
+    return m_Values.height();
+}
+
+template <typename Q>
+int Quantized<Q>::width() const
+{
+    return m_Values.width();
+}
+
+template <typename Q>
+const char *Quantized<Q>::IllegalQuantization::what() const throw()
+{
+    return "Mtm quantization error: Illegal scale or zero point";
+}
+
+
+//Subtracting 128 from uint8 values and zero point leaves every q - zero_point, and so the product, unchanged.
+template <typename Q>
+Matrix<float> multiply(const Quantized<Q> &a, const Quantized<Q> &b, Execution execution)
+{
+    if (a.width() != b.height())
+    {
+        typename Matrix<float>::DimensionMismatch error(Dimensions(a.height(), a.width()),
+                                                        Dimensions(b.height(), b.width()));
+        throw error;
+    }
+    const int shift = std::is_signed<Q>::value ? 0 : 128;
+    int n = a.height();
+    int m = a.width();
+    int p = b.width();
+    std::vector<Q> rows_a((std::size_t)n * m);
+    std::vector<Q> rows_b((std::size_t)m * p);
+    a.values().copyTo(&rows_a[0]);
+    b.values().copyTo(&rows_b[0]);
+    std::vector<std::int8_t> int_a((std::size_t)n * m);
+    std::vector<std::int8_t> int_b((std::size_t)m * p);
+    std::vector<std::int32_t> row_sums(n, 0);
+    std::vector<std::int32_t> col_sums(p, 0);
+    for (int i = 0; i < n; i++)
+    {
+        for (int k = 0; k < m; k++)
+        {
+            std::int8_t value = (std::int8_t)((int)rows_a[(std::size_t)i * m + k] - shift);
+            int_a[(std::size_t)i * m + k] = value;
+            row_sums[i] += value;
+        }
+    }
+    for (int k = 0; k < m; k++)
+    {
+        for (int j = 0; j < p; j++)
+        {
+            std::int8_t value = (std::int8_t)((int)rows_b[(std::size_t)k * p + j] - shift);
+            int_b[(std::size_t)k * p + j] = value;
+            col_sums[j] += value;
+        }
+    }
+
+    std::vector<std::int32_t> products((std::size_t)n * p);
+    multiplyInt8(&int_a[0], &int_b[0], &products[0], n, m, p, execution);
+    std::vector<float> real((std::size_t)n * p);
+    const int zero_a = a.zeroPoint() - shift;
+    const int zero_b = b.zeroPoint() - shift;
+    const std::int64_t constant = (std::int64_t)m * zero_a * zero_b;
+    const float scale = a.scale() * b.scale();
+    for (int i = 0; i < n; i++)
+    {
+        const std::int64_t row_term = constant - (std::int64_t)zero_b * row_sums[i];
+        for (int j = 0; j < p; j++)
+        {
+            std::size_t index = (std::size_t)i * p + j;
+            real[index] = scale * (float)(products[index] + row_term - (std::int64_t)zero_a * col_sums[j]);
+        }
+    }
+    const Matrix<Q> &values = a.values();
+    Matrix<float> product(Dimensions(n, p), 0.0f, values.sharing(), values.layout(), values.memory());
+    product.copyFrom(&real[0]);
+    return product;
+}
+
+template <typename Q>
+Quantized<Q> add(const Quantized<Q> &a, const Quantized<Q> &b, float scale, int zero_point, Execution execution)
+{
+    const Matrix<Q> &values_a = a.values();
+    const Matrix<Q> &values_b = b.values();
+    if (a.height() != b.height() || a.width() != b.width())
+    {
+        typename Matrix<Q>::DimensionMismatch error(Dimensions(a.height(), a.width()),
+                                                    Dimensions(b.height(), b.width()));
+        throw error;
+    }
+    const float scale_a = a.scale() / scale;
+    const float scale_b = b.scale() / scale;
+    const float zero_a = (float)a.zeroPoint();
+    const float zero_b = (float)b.zeroPoint();
+    const float offset = (float)zero_point;
+    Matrix<Q> sum = zip(values_a, values_b, [=](Q x, Q y)
+    {
+        float value = std::nearbyint(scale_a * ((float)x - zero_a) + scale_b * ((float)y - zero_b)) + offset;
+        const float q_min = std::numeric_limits<Q>::min();
+        const float q_max = std::numeric_limits<Q>::max();
+        return (Q)std::max(q_min, std::min(q_max, value));
+    }, execution);
+    return Quantized<Q>(sum, scale, zero_point);
+}
+}
+
+#endif /* Quantized_h */
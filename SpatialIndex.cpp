@@ -0,0 +1,348 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+
+namespace {
+    typedef std::pair<long long, int> Candidate;
+
+    //GridPoint::distance, without the int overflow of far apart points.
+    long long distance(const mtm::GridPoint& center, long long row, long long col)
+    {
+        return std::llabs(row - center.row) + std::llabs(col - center.col);
+    }
+
+    //the coordinates of point in the rotated grid, in which the Manhattan ball is a square.
+    long long rotatedRow(const mtm::GridPoint& point)
+    {
+        return (long long)point.row + point.col;
+    }
+
+    long long rotatedCol(const mtm::GridPoint& point)
+    {
+        return (long long)point.row - point.col;
+    }
+
+    //keeps the k smallest (distance, id) pairs in a max heap.
+    void consider(std::vector<Candidate>& best, std::size_t k, long long distance, int id)
+    {
+        Candidate candidate(distance, id);
+        if (best.size() < k)
+        {
+            best.push_back(candidate);
+            std::push_heap(best.begin(), best.end());
+        }
+        else if (candidate < best.front())
+        {
+            std::pop_heap(best.begin(), best.end());
+            best.back() = candidate;
+            std::push_heap(best.begin(), best.end());
+        }
+    }
+}
+
+std::size_t mtm::SpatialIndex::KeyHash::operator()(const Key& key) const
+{
+    unsigned long long mixed = ((unsigned long long)key.first * 0x9E3779B97F4A7C15ULL) ^ (unsigned long long)key.second;
+    mixed *= 0xC2B2AE3D27D4EB4FULL;
+    return (std::size_t)(mixed ^ (mixed >> 32));
+}
+
+mtm::SpatialIndex::SpatialIndex(int bucket_size) : m_BucketSize(bucket_size < 1 ? 1 : bucket_size) {}
+
+//floor division, so negative coordinates get their own buckets.
+long long mtm::SpatialIndex::bucketOf(long long coordinate) const
+{
+    return (coordinate >= 0) ? coordinate / m_BucketSize : -((-coordinate - 1) / m_BucketSize) - 1;
+}
+
+mtm::SpatialIndex::Key mtm::SpatialIndex::key(long long bucket_row, long long bucket_col)
+{
+    return Key(bucket_row, bucket_col);
+}
+
+std::size_t mtm::SpatialIndex::add(Grid& grid, long long row, long long col, int id)
+{
+    Bucket& bucket = grid[key(bucketOf(row), bucketOf(col))];
+    Member member = { id, row, col };
+    bucket.push_back(member);
+    return bucket.size() - 1;
+}
+
+//The last member of the bucket fills the hole, its entry learns its new slot.
+void mtm::SpatialIndex::erase(Grid& grid, long long row, long long col, std::size_t slot, bool rotated)
+{
+    Grid::iterator found = grid.find(key(bucketOf(row), bucketOf(col)));
+    Bucket& bucket = found->second;
+    if (slot + 1 != bucket.size())
+    {
+        bucket[slot] = bucket.back();
+        Entry& moved = m_Entries.find(bucket[slot].id)->second;
+        (rotated ? moved.rotated_slot : moved.board_slot) = slot;
+    }
+    bucket.pop_back();
+    if (bucket.empty())
+    {
+        grid.erase(found);
+    }
+}
+
+const mtm::SpatialIndex::Entry& mtm::SpatialIndex::entry(int id) const
+{
+    std::unordered_map<int, Entry>::const_iterator found = m_Entries.find(id);
+    if (found == m_Entries.end())
+    {
+        IdNotFound error;
+        throw error;
+    }
+    return found->second;
+}
+
+void mtm::SpatialIndex::insert(int id, const GridPoint& point)
+{
+    if (m_Entries.count(id) != 0)
+    {
+        IdAlreadyExists error;
+        throw error;
+    }
+    Entry entry = { point, 0, 0 };
+    m_Entries.insert(std::make_pair(id, entry));
+    try{
+        Entry& stored = m_Entries.find(id)->second;
+        stored.board_slot = add(m_Board, point.row, point.col, id);
+        try{
+            stored.rotated_slot = add(m_Rotated, rotatedRow(point), rotatedCol(point), id);
+        }catch(...){
+            erase(m_Board, point.row, point.col, stored.board_slot, false);
+            throw;
+        }
+    }catch(...){
+        m_Entries.erase(id);
+        throw;
+    }
+}
+
+//A point staying in its buckets is updated in place. Otherwise it is added to the new buckets before
+//leaving the old ones, so a failed allocation leaves the index unchanged.
+void mtm::SpatialIndex::move(int id, const GridPoint& point)
+{
+    std::unordered_map<int, Entry>::iterator found = m_Entries.find(id);
+    if (found == m_Entries.end())
+    {
+        IdNotFound error;
+        throw error;
+    }
+    Entry& moved = found->second;
+    GridPoint old = moved.point;
+    bool same_board = bucketOf(old.row) == bucketOf(point.row) && bucketOf(old.col) == bucketOf(point.col);
+    long long old_u = rotatedRow(old), old_v = rotatedCol(old);
+    long long u = rotatedRow(point), v = rotatedCol(point);
+    bool same_rotated = bucketOf(old_u) == bucketOf(u) && bucketOf(old_v) == bucketOf(v);
+    std::size_t board_slot = moved.board_slot;
+    std::size_t rotated_slot = moved.rotated_slot;
+    if (!same_board)
+    {
+        board_slot = add(m_Board, point.row, point.col, id);
+    }
+    if (!same_rotated)
+    {
+        try{
+            rotated_slot = add(m_Rotated, u, v, id);
+        }catch(...){
+            if (!same_board)
+            {
+                erase(m_Board, point.row, point.col, board_slot, false);
+            }
+            throw;
+        }
+    }
+
+    if (same_board)
+    {
+        Member& member = m_Board.find(key(bucketOf(point.row), bucketOf(point.col)))->second[board_slot];
+        member.row = point.row;
+        member.col = point.col;
+    }
+    else
+    {
+        erase(m_Board, old.row, old.col, moved.board_slot, false);
+        moved.board_slot = board_slot;
+    }
+    if (same_rotated)
+    {
+        Member& member = m_Rotated.find(key(bucketOf(u), bucketOf(v)))->second[rotated_slot];
+        member.row = u;
+        member.col = v;
+    }
+    else
+    {
+        erase(m_Rotated, old_u, old_v, moved.rotated_slot, true);
+        moved.rotated_slot = rotated_slot;
+    }
+    moved.point = point;
+}
+
+void mtm::SpatialIndex::remove(int id)
+{
+    const Entry& removed = entry(id);
+    GridPoint point = removed.point;
+    std::size_t board_slot = removed.board_slot;
+    std::size_t rotated_slot = removed.rotated_slot;
+    erase(m_Board, point.row, point.col, board_slot, false);
+    erase(m_Rotated, rotatedRow(point), rotatedCol(point), rotated_slot, true);
+    m_Entries.erase(id);
+}
+
+bool mtm::SpatialIndex::contains(int id) const
+{
+    return m_Entries.count(id) != 0;
+}
+
+mtm::GridPoint mtm::SpatialIndex::position(int id) const
+{
+    return entry(id).point;
+}
+
+int mtm::SpatialIndex::size() const
+{
+    return (int)m_Entries.size();
+}
+
+//In rotated coordinates the ball is the square [u - radius, u + radius] x [v - radius, v + radius]. The
+//bucket span is compared with the number of buckets one side at a time, so it can not overflow.
+std::vector<int> mtm::SpatialIndex::within(const GridPoint& center, int radius) const
+{
+    std::vector<int> ids;
+    if (radius < 0 || m_Entries.empty())
+    {
+        return ids;
+    }
+    long long u = rotatedRow(center);
+    long long v = rotatedCol(center);
+    long long first_u = bucketOf(u - radius);
+    long long last_u = bucketOf(u + radius);
+    long long first_v = bucketOf(v - radius);
+    long long last_v = bucketOf(v + radius);
+    long long existing = (long long)m_Rotated.size();
+
+    if (last_u - first_u + 1 > existing || last_v - first_v + 1 > existing ||
+        (last_u - first_u + 1) * (last_v - first_v + 1) > existing)
+    {
+        for (Grid::const_iterator it = m_Rotated.begin(); it != m_Rotated.end(); ++it)
+        {
+            for (std::size_t m = 0; m < it->second.size(); m++)
+            {
+                const Member& member = it->second[m];
+                if (std::llabs(member.row - u) <= radius && std::llabs(member.col - v) <= radius)
+                {
+                    ids.push_back(member.id);
+                }
+            }
+        }
+        return ids;
+    }
+
+    for (long long bu = first_u; bu <= last_u; bu++)
+    {
+        bool inside_u = bu * m_BucketSize >= u - radius && (bu + 1) * m_BucketSize - 1 <= u + radius;
+        for (long long bv = first_v; bv <= last_v; bv++)
+        {
+            Grid::const_iterator found = m_Rotated.find(key(bu, bv));
+            if (found == m_Rotated.end())
+            {
+                continue;
+            }
+            const Bucket& bucket = found->second;
+            bool inside = inside_u && bv * m_BucketSize >= v - radius && (bv + 1) * m_BucketSize - 1 <= v + radius;
+            for (std::size_t m = 0; m < bucket.size(); m++)
+            {
+                if (inside || (std::llabs(bucket[m].row - u) <= radius && std::llabs(bucket[m].col - v) <= radius))
+                {
+                    ids.push_back(bucket[m].id);
+                }
+            }
+        }
+    }
+    return ids;
+}
+
+//Rings of buckets at growing Chebyshev (bucket) distance from the bucket of center. Every cell of ring r
+//is at least (r - 1) * bucket size + 1 away, so the search stops once the k-th best is closer than that.
+std::vector<int> mtm::SpatialIndex::nearest(const GridPoint& center, int k) const
+{
+    std::vector<int> ids;
+    if (k <= 0 || m_Entries.empty())
+    {
+        return ids;
+    }
+    std::size_t wanted = std::min((std::size_t)k, m_Entries.size());
+    std::vector<Candidate> best;
+    best.reserve(wanted);
+    long long center_row = bucketOf(center.row);
+    long long center_col = bucketOf(center.col);
+    std::size_t seen = 0;
+
+    for (long long ring = 0; seen < m_Entries.size(); ring++)
+    {
+        if (best.size() == wanted && ring > 0 &&
+            best.front().first < (ring - 1) * m_BucketSize + 1)
+        {
+            break;
+        }
+        if (8LL * ring > (long long)m_Board.size())
+        {
+            //the remaining rings are mostly empty, visit the remaining buckets directly.
+            for (Grid::const_iterator it = m_Board.begin(); it != m_Board.end(); ++it)
+            {
+                const Key& bucket = it->first;
+                if (std::max(std::llabs(bucket.first - center_row), std::llabs(bucket.second - center_col)) < ring)
+                {
+                    continue;
+                }
+                for (std::size_t m = 0; m < it->second.size(); m++)
+                {
+                    const Member& member = it->second[m];
+                    consider(best, wanted, distance(center, member.row, member.col), member.id);
+                }
+            }
+            break;
+        }
+        for (long long bucket_row = center_row - ring; bucket_row <= center_row + ring; bucket_row++)
+        {
+            bool edge = (bucket_row == center_row - ring || bucket_row == center_row + ring);
+            long long step = edge ? 1 : 2 * ring;
+            for (long long bucket_col = center_col - ring; bucket_col <= center_col + ring; bucket_col += step)
+            {
+                Grid::const_iterator found = m_Board.find(key(bucket_row, bucket_col));
+                if (found == m_Board.end())
+                {
+                    continue;
+                }
+                const Bucket& bucket = found->second;
+                seen += bucket.size();
+                for (std::size_t m = 0; m < bucket.size(); m++)
+                {
+                    consider(best, wanted, distance(center, bucket[m].row, bucket[m].col), bucket[m].id);
+                }
+            }
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for (std::size_t i = 0; i < best.size(); i++)
+    {
+        ids.push_back(best[i].second);
+    }
+    return ids;
+}
+
+const char* mtm::SpatialIndex::IdAlreadyExists::what() const throw()
+{
+    return "Mtm spatial index error: The id is already in the index";
+}
+
+const char* mtm::SpatialIndex::IdNotFound::what() const throw()
+{
+    return "Mtm spatial index error: The id is not in the index";
+}
@@ -0,0 +1,145 @@
+//
+//  SpatialIndex.h
+//  Matrix
+//
+/*
+ This file exports SpatialIndex, which answers "which units are near this GridPoint" under the
+ Manhattan distance without scanning every unit.
+*/
+#ifndef SpatialIndex_h
+#define SpatialIndex_h
+#include <cstddef>
+#include <exception>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Auxiliaries.h"
+namespace mtm{
+
+/**
+* Class: SpatialIndex
+* ------------------------
+* Set of points (GridPoint, any int coordinates) identified by int ids, supporting incremental updates and
+* neighbourhood queries under GridPoint::distance. Every point is kept in two uniform bucket grids:
+* - the board grid, square buckets of bucket_size x bucket_size cells, searched ring by ring around the
+*   query point by nearest.
+* - the rotated grid, on the coordinates (row + col, row - col) in which the Manhattan ball of radius r is
+*   the axis aligned square of half side r. within visits only the buckets overlapping that square and
+*   takes the buckets lying inside it without testing their points.
+* Both grids only store non empty buckets, so sparse sets over huge coordinate ranges stay small.
+* Queries cost the points of the visited buckets, when a query would visit more buckets than exist it
+* scans the existing ones instead.
+*/
+class SpatialIndex{
+private:
+    //coordinates of the grid the member is in: (row, col) on the board, (row + col, row - col) rotated,
+    //which takes 33 bits.
+    struct Member
+    {
+        int id;
+        long long row;
+        long long col;
+    };
+    typedef std::vector<Member> Bucket;
+
+    struct Entry
+    {
+        GridPoint point;
+        std::size_t board_slot;
+        std::size_t rotated_slot;
+    };
+
+    //bucket coordinates (bucket row, bucket col).
+    typedef std::pair<long long, long long> Key;
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const;
+    };
+    typedef std::unordered_map<Key, Bucket, KeyHash> Grid;
+
+    int m_BucketSize;
+    std::unordered_map<int, Entry> m_Entries;
+    Grid m_Board;
+    Grid m_Rotated;
+
+    long long bucketOf(long long coordinate) const;
+    static Key key(long long bucket_row, long long bucket_col);
+
+    //adds / removes the member at (row, col) of grid, returning its slot / fixing the slot of the member moved into the hole.
+    std::size_t add(Grid &grid, long long row, long long col, int id);
+    void erase(Grid &grid, long long row, long long col, std::size_t slot, bool rotated);
+
+    const Entry &entry(int id) const;
+
+public:
+    /**
+    * Constructor: SpatialIndex
+    * Usage: SpatialIndex index;
+    *        SpatialIndex index(bucket_size);
+    * ---------------------------------------
+    @param bucket_size side of the buckets in cells (default 32), values below 1 are treated as 1.
+    *      Best around the typical query radius.
+    */
+    explicit SpatialIndex(int bucket_size = 32);
+
+    /**
+    * Method: insert / move / remove
+    * Usage: index.insert(id, point)
+    *        index.move(id, point)
+    *        index.remove(id)
+    * -----------------------------
+    * Adds a point, changes the position of a point, or removes it, in constant expected time.
+    @exception IdAlreadyExists - insert of an id already in the index.
+    @exception IdNotFound - move or remove of an id not in the index.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    void insert(int id, const GridPoint &point);
+    void move(int id, const GridPoint &point);
+    void remove(int id);
+
+    /**
+    * Method: contains / position / size
+    * Usage: index.contains(id)
+    *        index.position(id)
+    *        index.size()
+    * -----------------------------
+    @return whether id is in the index, its current point, the number of points.
+    @exception IdNotFound - position of an id not in the index.
+    */
+    bool contains(int id) const;
+    GridPoint position(int id) const;
+    int size() const;
+
+    /**
+    * Method: within
+    * Usage: index.within(center, radius)
+    * -----------------------------
+    @return ids of all the points at distance at most radius from center, in no particular order.
+    */
+    std::vector<int> within(const GridPoint &center, int radius) const;
+
+    /**
+    * Method: nearest
+    * Usage: index.nearest(center, k)
+    * -----------------------------
+    @return ids of the k points closest to center (all of them if there are fewer), by increasing
+    *       distance, ties broken by increasing id.
+    */
+    std::vector<int> nearest(const GridPoint &center, int k) const;
+
+    /**
+    * Exception: IdAlreadyExists / IdNotFound
+    * thrown by insert of a known id, and by move, remove or position of an unknown id.
+    */
+    struct IdAlreadyExists : public std::exception
+    {
+        const char *what() const throw();
+    };
+    struct IdNotFound : public std::exception
+    {
+        const char *what() const throw();
+    };
+};
+}
+
+#endif /* SpatialIndex_h */
@@ -0,0 +1,355 @@
+//
+//  SummedArea.h
+//  Matrix
+//
+/*
+ This file exports prefix sum structures answering rectangular range sums of a matrix in constant
+ (SummedAreaTable) or logarithmic (FenwickTable, which also takes point updates) time.
+*/
+#ifndef SummedArea_h
+#define SummedArea_h
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "Matrix.h"
+#include "ThreadPool.h"
+namespace mtm{
+
+/**
+* Struct: SumOf<T>
+* ------------------------
+* Type the range sums of a Matrix<T> are kept in: long long for integral T (bool included, so the sum of
+* a mask is the number of true elements and small integer types do not overflow), T otherwise.
+*/
+template <typename T>
+struct SumOf{
+    typedef typename std::conditional<std::is_integral<T>::value, long long, T>::type type;
+};
+
+
+/**
+* Class: SummedAreaTable<T>
+* ------------------------
+* Integral image of a matrix: entry (i, j) holds the sum of the elements above and to the left of
+* (i, j), so the sum of any rectangle takes four lookups. The table is built in two passes that are
+* contiguous row sweeps (prefix sums along every row, then adding every row to the one below it), both
+* split into bands on the shared ThreadPool when PARALLEL.
+* The table is a snapshot, later changes of the matrix are not seen (see FenwickTable).
+*/
+template <typename T>
+class SummedAreaTable{
+public:
+    typedef typename SumOf<T>::type Sum;
+
+private:
+    int m_Height;
+    int m_Width;
+    std::size_t m_Stride;
+    //(height + 1) x (width + 1), the first row and column are 0.
+    std::vector<Sum> m_Table;
+
+    void checkRange(int first_row, int first_col, int last_row, int last_col) const;
+
+public:
+    /**
+    * Constructor: SummedAreaTable
+    * Usage: SummedAreaTable<T> table(mat);
+    *        SummedAreaTable<T> table(mat, mtm::PARALLEL);
+    * ---------------------------------------
+    @param execution - PARALLEL builds the table with the shared ThreadPool (default SEQUENTIAL).
+    @remarks (assumptions) Sum is constructible from T, supports + and -, Sum() is the additive identity.
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    explicit SummedAreaTable(const Matrix<T> &mat, Execution execution = SEQUENTIAL);
+
+    /**
+    * Method: sum / mean
+    * Usage: table.sum(first_row, first_col, last_row, last_col)
+    *        table.mean(first_row, first_col, last_row, last_col)
+    * -----------------------------
+    * Sum (for a Matrix<bool>: the number of true elements) and mean of the rectangle of rows
+    * first_row..last_row and columns first_col..last_col, bounds included, in constant time.
+    @exception AccessIllegalElement if the rectangle is empty or not inside the matrix.
+    */
+    Sum sum(int first_row, int first_col, int last_row, int last_col) const;
+    double mean(int first_row, int first_col, int last_row, int last_col) const;
+
+    int height() const;
+    int width() const;
+};
+
+
+/**
+* Class: FenwickTable<T>
+* ------------------------
+* Two dimensional Fenwick (binary indexed) tree over a matrix, for data that keeps changing: point updates
+* and rectangle sums both take O(log(height) * log(width)). Built in linear time.
+*/
+template <typename T>
+class FenwickTable{
+public:
+    typedef typename SumOf<T>::type Sum;
+
+private:
+    int m_Height;
+    int m_Width;
+    std::size_t m_Stride;
+    //(height + 1) x (width + 1), 1 based.
+    std::vector<Sum> m_Tree;
+    //current elements, so set can turn a value into a difference.
+    std::vector<Sum> m_Values;
+
+    //sum of the elements of rows < rows and columns < cols.
+    Sum prefix(int rows, int cols) const;
+    void checkElement(int row, int col) const;
+
+public:
+    /**
+    * Constructor: FenwickTable
+    * Usage: FenwickTable<T> table(mat);
+    * ---------------------------------------
+    @exception bad_alloc will be thrown if memory allocation failed.
+    */
+    explicit FenwickTable(const Matrix<T> &mat);
+
+    /**
+    * Method: add / set
+    * Usage: table.add(row, col, delta)
+    *        table.set(row, col, value)
+    * -----------------------------
+    * Adds delta to an element, or replaces it by value.
+    @exception AccessIllegalElement if (row, col) is not inside the matrix.
+    */
+    void add(int row, int col, const Sum &delta);
+    void set(int row, int col, const Sum &value);
+
+    /**
+    * Method: sum / mean
+    * Usage: table.sum(first_row, first_col, last_row, last_col)
+    *        table.mean(first_row, first_col, last_row, last_col)
+    * -----------------------------
+    * Same as SummedAreaTable::sum / mean, on the current elements.
+    @exception AccessIllegalElement if the rectangle is empty or not inside the matrix.
+    */
+    Sum sum(int first_row, int first_col, int last_row, int last_col) const;
+    double mean(int first_row, int first_col, int last_row, int last_col) const;
+
+    int height() const;
+    int width() const;
+};
+
+
+
+template <typename T>
+SummedAreaTable<T>::SummedAreaTable(const Matrix<T> &mat, Execution execution) :
+m_Height(mat.height()),
+m_Width(mat.width()),
+m_Stride((std::size_t)mat.width() + 1),
+m_Table(m_Stride * (mat.height() + 1), Sum())
+{
+    std::unique_ptr<T[]> rows = scratchElements<T>((std::size_t)m_Height * m_Width);
+    mat.copyTo(rows.get());
+    const T* elements = rows.get();
+    Sum* table = &m_Table[0];
+    int width = m_Width;
+    std::size_t stride = m_Stride;
+    parallelRows(m_Height, m_Width, execution, [elements, table, width, stride](int first, int last)
+    {
+        for (int i = first; i < last; i++)
+        {
+            const T* from = elements + (std::size_t)i * width;
+            Sum* to = table + (i + 1) * stride + 1;
+            Sum running = Sum();
+            for (int j = 0; j < width; j++)
+            {
+                running = running + Sum(from[j]);
+                to[j] = running;
+            }
+        }
+    });
+    int height = m_Height;
+    parallelRows(m_Width, m_Height, execution, [table, height, stride](int first, int last)
+    {
+        for (int i = 2; i <= height; i++)
+        {
+            Sum* row = table + i * stride + 1;
+            const Sum* above = row - stride;
+            for (int j = first; j < last; j++)
+            {
+                row[j] = row[j] + above[j];
+            }
+        }
+    });
+}
+
+template <typename T>
+void SummedAreaTable<T>::checkRange(int first_row, int first_col, int last_row, int last_col) const
+{
+    if (first_row < 0 || first_col < 0 || last_row >= m_Height || last_col >= m_Width ||
+        first_row > last_row || first_col > last_col)
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+}
+
+template <typename T>
+typename SummedAreaTable<T>::Sum SummedAreaTable<T>::sum(int first_row, int first_col, int last_row,
+                                                         int last_col) const
+{
+    checkRange(first_row, first_col, last_row, last_col);
+    const Sum* top = &m_Table[first_row * m_Stride];
+    const Sum* bottom = &m_Table[(last_row + 1) * m_Stride];
+    return bottom[last_col + 1] - bottom[first_col] - top[last_col + 1] + top[first_col];
+}
+
+template <typename T>
+double SummedAreaTable<T>::mean(int first_row, int first_col, int last_row, int last_col) const
+{
+    double count = (double)(last_row - first_row + 1) * (last_col - first_col + 1);
+    return (double)sum(first_row, first_col, last_row, last_col) / count;
+}
+
+template <typename T>
+int SummedAreaTable<T>::height() const
+{
+    return m_Height;
+}
+
+template <typename T>
+int SummedAreaTable<T>::width() const
+{
+    return m_Width;
+}
+
+
+//Linear construction: every node adds itself to its parent, first along the rows, then along the columns.
+template <typename T>
+FenwickTable<T>::FenwickTable(const Matrix<T> &mat) :
+m_Height(mat.height()),
+m_Width(mat.width()),
+m_Stride((std::size_t)mat.width() + 1),
+m_Tree(m_Stride * (mat.height() + 1), Sum()),
+m_Values((std::size_t)mat.height() * mat.width())
+{
+    std::unique_ptr<T[]> rows = scratchElements<T>((std::size_t)m_Height * m_Width);
+    mat.copyTo(rows.get());
+    for (std::size_t k = 0; k < m_Values.size(); k++)
+    {
+        m_Values[k] = Sum(rows[k]);
+    }
+    for (int i = 1; i <= m_Height; i++)
+    {
+        Sum* row = &m_Tree[i * m_Stride];
+        const Sum* values = &m_Values[(std::size_t)(i - 1) * m_Width];
+        for (int j = 1; j <= m_Width; j++)
+        {
+            row[j] = row[j] + values[j - 1];
+            int parent = j + (j & -j);
+            if (parent <= m_Width)
+            {
+                row[parent] = row[parent] + row[j];
+            }
+        }
+    }
+    for (int i = 1; i <= m_Height; i++)
+    {
+        int parent = i + (i & -i);
+        if (parent > m_Height)
+        {
+            continue;
+        }
+        Sum* to = &m_Tree[parent * m_Stride];
+        const Sum* from = &m_Tree[i * m_Stride];
+        for (int j = 1; j <= m_Width; j++)
+        {
+            to[j] = to[j] + from[j];
+        }
+    }
+}
+
+template <typename T>
+void FenwickTable<T>::checkElement(int row, int col) const
+{
+    if (row < 0 || col < 0 || row >= m_Height || col >= m_Width)
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+}
+
+template <typename T>
+void FenwickTable<T>::add(int row, int col, const Sum &delta)
+{
+    checkElement(row, col);
+    Sum &value = m_Values[(std::size_t)row * m_Width + col];
+    value = value + delta;
+    for (int i = row + 1; i <= m_Height; i += i & -i)
+    {
+        Sum* tree_row = &m_Tree[i * m_Stride];
+        for (int j = col + 1; j <= m_Width; j += j & -j)
+        {
+            tree_row[j] = tree_row[j] + delta;
+        }
+    }
+}
+
+template <typename T>
+void FenwickTable<T>::set(int row, int col, const Sum &value)
+{
+    checkElement(row, col);
+    add(row, col, value - m_Values[(std::size_t)row * m_Width + col]);
+}
+
+template <typename T>
+typename FenwickTable<T>::Sum FenwickTable<T>::prefix(int rows, int cols) const
+{
+    Sum total = Sum();
+    for (int i = rows; i > 0; i -= i & -i)
+    {
+        const Sum* tree_row = &m_Tree[i * m_Stride];
+        for (int j = cols; j > 0; j -= j & -j)
+        {
+            total = total + tree_row[j];
+        }
+    }
+    return total;
+}
+
+template <typename T>
+typename FenwickTable<T>::Sum FenwickTable<T>::sum(int first_row, int first_col, int last_row,
+                                                   int last_col) const
+{
+    if (first_row > last_row || first_col > last_col)
+    {
+        typename Matrix<T>::AccessIllegalElement error;
+        throw error;
+    }
+    checkElement(first_row, first_col);
+    checkElement(last_row, last_col);
+    return prefix(last_row + 1, last_col + 1) - prefix(first_row, last_col + 1) -
+           prefix(last_row + 1, first_col) + prefix(first_row, first_col);
+}
+
+template <typename T>
+double FenwickTable<T>::mean(int first_row, int first_col, int last_row, int last_col) const
+{
+    double count = (double)(last_row - first_row + 1) * (last_col - first_col + 1);
+    return (double)sum(first_row, first_col, last_row, last_col) / count;
+}
+
+template <typename T>
+int FenwickTable<T>::height() const
+{
+    return m_Height;
+}
+
+template <typename T>
+int FenwickTable<T>::width() const
+{
+    return m_Width;
+}
+}
+
+#endif /* SummedArea_h */
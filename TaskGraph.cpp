@@ -0,0 +1,74 @@
+#include "TaskGraph.h"
+
+void mtm::TaskNode::whenDone(const std::function<void()> &continuation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!done)
+        {
+            continuations.push_back(continuation);
+            return;
+        }
+    }
+    continuation();
+}
+
+//The continuations run outside the lock, they may register continuations on other tasks.
+void mtm::TaskNode::finish()
+{
+    std::vector< std::function<void()> > waiting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+        waiting.swap(continuations);
+    }
+    for (std::size_t i = 0; i < waiting.size(); i++)
+    {
+        waiting[i]();
+    }
+}
+
+mtm::TaskGraph::TaskGraph(ThreadPool &pool) : m_Pool(pool), m_Running(0) {}
+
+mtm::TaskGraph::~TaskGraph()
+{
+    wait();
+}
+
+int mtm::TaskGraph::record(const std::vector<int> &inputs, bool running)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Inputs.push_back(inputs);
+    if (running)
+    {
+        m_Running++;
+    }
+    return (int)m_Inputs.size() - 1;
+}
+
+void mtm::TaskGraph::finished()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (--m_Running == 0)
+    {
+        m_Idle.notify_all();
+    }
+}
+
+void mtm::TaskGraph::wait()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this]() { return m_Running == 0; });
+}
+
+int mtm::TaskGraph::size() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return (int)m_Inputs.size();
+}
+
+std::vector<int> mtm::TaskGraph::inputs(int task) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Inputs[task];
+}
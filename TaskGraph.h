@@ -0,0 +1,249 @@
+//
+//  TaskGraph.h
+//  Matrix
+//
+/*
+ This file exports TaskGraph and Task, which run independent matrix operations concurrently on the
+ shared ThreadPool and start every operation as soon as the tasks it reads from are done.
+*/
+#ifndef TaskGraph_h
+#define TaskGraph_h
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <coroutine>
+#endif
+#include "ThreadPool.h"
+namespace mtm{
+
+class TaskGraph;
+
+//Completion bookkeeping shared by all tasks, whatever their result type.
+//Continuations registered before the task finished run on the thread that finishes it,
+//the ones registered afterwards run at once on the registering thread.
+struct TaskNode{
+    int id;
+    std::mutex mutex;
+    bool done;
+    std::vector< std::function<void()> > continuations;
+
+    explicit TaskNode(int id) : id(id), done(false) {}
+    void whenDone(const std::function<void()> &continuation);
+    void finish();
+};
+
+template <typename T>
+struct TaskState : TaskNode{
+    std::promise<T> promise;
+    std::shared_future<T> result;
+
+    explicit TaskState(int id) : TaskNode(id), result(promise.get_future().share()) {}
+};
+
+
+/**
+* Class: Task
+* ------------------------
+* Handle to the future result of an operation scheduled on a TaskGraph. Handles are cheap to copy,
+* all copies refer to the same result. Pass a Task to TaskGraph::run to make a later operation
+* depend on it instead of waiting for it.
+* With C++20 a Task can also be co_await'ed, the coroutine is resumed by the thread that finishes it.
+*/
+template <typename T>
+class Task{
+private:
+    std::shared_ptr< TaskState<T> > m_State;
+
+    explicit Task(const std::shared_ptr< TaskState<T> > &state) : m_State(state) {}
+    friend class TaskGraph;
+
+public:
+    //handle to no task, only assignable.
+    Task() {}
+
+    /**
+    * Method: get / wait / ready
+    * Usage: task.get()
+    *        task.wait()
+    *        task.ready()
+    * -----------------------------
+    * get waits for the result and returns it, wait only waits, ready never blocks.
+    * Do not call get or wait from inside an operation of the same graph, pass the task as an input instead.
+    @return reference to the result (get), whether the result is available (ready).
+    @exception whatever the operation (or one of the operations it depends on) threw, rethrown by get.
+    */
+    const T &get() const { return m_State->result.get(); }
+    void wait() const { m_State->result.wait(); }
+    bool ready() const
+    {
+        std::lock_guard<std::mutex> lock(m_State->mutex);
+        return m_State->done;
+    }
+
+    //the result as a std::shared_future, for code that already waits on futures.
+    std::shared_future<T> future() const { return m_State->result; }
+
+    //position of this task in its graph, see TaskGraph::inputs.
+    int id() const { return m_State->id; }
+
+    //the completion bookkeeping, used by TaskGraph to chain operations.
+    TaskNode &node() const { return *m_State; }
+
+#if __cplusplus >= 202002L
+    bool await_ready() const { return ready(); }
+    void await_suspend(std::coroutine_handle<> handle) const
+    {
+        m_State->whenDone([handle]() { handle.resume(); });
+    }
+    const T &await_resume() const { return get(); }
+#endif
+};
+
+
+/**
+* Class: TaskGraph
+* ------------------------
+* Records operations and the tasks each one reads from (a dependency DAG, inputs always exist before
+* the operations using them) and runs every operation on the ThreadPool once all its inputs are done.
+* Independent operations run concurrently, nothing blocks a worker while it waits for an input, and a
+* consumer only waits for the tasks it calls get on.
+* Example:
+*        TaskGraph graph;
+*        Task< Matrix<int> > a = graph.value(mat);
+*        Task< Matrix<int> > t = graph.run([](const Matrix<int> &m) { return m.transpose(); }, a);
+*        Task< Matrix<int> > n = graph.run([](const Matrix<int> &m) { return -m; }, a);
+*        Task< Matrix<int> > s = graph.run([](const Matrix<int> &x, const Matrix<int> &y) { return x + y; }, t, n);
+*        s.get();
+* Operations receive their inputs by const reference and must return a value. An exception thrown by
+* an operation is stored in its task and reaches every task depending on it.
+* All methods are thread safe, including run called from inside an operation.
+*/
+class TaskGraph{
+private:
+    ThreadPool &m_Pool;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Idle;
+    int m_Running;
+    std::vector< std::vector<int> > m_Inputs;
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    //registers a new task reading from inputs, returns its id.
+    int record(const std::vector<int> &inputs, bool running);
+    void finished();
+
+public:
+    /**
+    * Constructor: TaskGraph
+    * Usage: TaskGraph graph;
+    *        TaskGraph graph(pool);
+    * ---------------------------------------
+    @param pool the pool running the operations (default the shared ThreadPool::instance()).
+    */
+    explicit TaskGraph(ThreadPool &pool = ThreadPool::instance());
+
+    /**
+    * Destructor: ~TaskGraph
+    * -------------------
+    * Waits for all the scheduled operations, the tasks stay valid afterwards.
+    */
+    ~TaskGraph();
+
+    /**
+    * Method: value
+    * Usage: graph.value(mat)
+    * -----------------------------
+    @return a finished task holding a copy (or the moved value) of result, to feed existing values into the graph.
+    */
+    template <typename T>
+    Task<typename std::decay<T>::type> value(T &&result);
+
+    /**
+    * Method: run
+    * Usage: graph.run(operation)
+    *        graph.run(operation, task1, task2, ...)
+    * -----------------------------
+    * Schedules operation(task1.get(), task2.get(), ...) to run on the pool once all the given tasks are done.
+    @return task of the value operation returns.
+    @exception bad_alloc - may be thrown when the task can not be recorded.
+    */
+    template <typename F, typename... A>
+    Task<typename std::decay<typename std::result_of<F(const A&...)>::type>::type>
+    run(F operation, const Task<A>&... inputs);
+
+    /**
+    * Method: wait
+    * Usage: graph.wait()
+    * -----------------------------
+    * Blocks until every operation scheduled so far (and any it scheduled) has finished.
+    */
+    void wait();
+
+    /**
+    * Method: size / inputs
+    * Usage: graph.size()
+    *        graph.inputs(task.id())
+    * -----------------------------
+    @return number of tasks recorded (size), ids of the tasks the given task reads from (inputs).
+    */
+    int size() const;
+    std::vector<int> inputs(int task) const;
+};
+
+
+
+template <typename T>
+Task<typename std::decay<T>::type> TaskGraph::value(T &&result)
+{
+    typedef typename std::decay<T>::type Result;
+    std::shared_ptr< TaskState<Result> > state = std::make_shared< TaskState<Result> >(record(std::vector<int>(), false));
+    state->promise.set_value(std::forward<T>(result));
+    state->finish();
+    return Task<Result>(state);
+}
+
+//Every input gets a continuation counting down the inputs still running. The extra count held by run
+//itself keeps the operation from starting before all continuations are registered.
+template <typename F, typename... A>
+Task<typename std::decay<typename std::result_of<F(const A&...)>::type>::type>
+TaskGraph::run(F operation, const Task<A>&... inputs)
+{
+    typedef typename std::decay<typename std::result_of<F(const A&...)>::type>::type Result;
+    std::vector<int> ids = { inputs.id()... };
+    std::shared_ptr< TaskState<Result> > state = std::make_shared< TaskState<Result> >(record(ids, true));
+    TaskGraph* graph = this;
+    std::function<void()> job = [graph, state, operation, inputs...]()
+    {
+        try{
+            state->promise.set_value(operation(inputs.get()...));
+        }catch(...){
+            state->promise.set_exception(std::current_exception());
+        }
+        state->finish();
+        graph->finished();
+    };
+    std::shared_ptr< std::atomic<int> > waiting = std::make_shared< std::atomic<int> >((int)ids.size() + 1);
+    std::function<void()> launch = [graph, job, waiting]()
+    {
+        if (waiting->fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            graph->m_Pool.submit(job);
+        }
+    };
+    int registered[] = { 0, (inputs.node().whenDone(launch), 0)... };
+    (void)registered;
+    launch();
+    return Task<Result>(state);
+}
+}
+
+#endif /* TaskGraph_h */
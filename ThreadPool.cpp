@@ -0,0 +1,67 @@
+#include "ThreadPool.h"
+
+namespace {
+    thread_local bool is_pool_worker = false;
+}
+
+mtm::ThreadPool::ThreadPool(unsigned int threads) : m_Stopping(false)
+{
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        m_Workers.push_back(std::thread(&ThreadPool::work, this));
+    }
+}
+
+mtm::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Ready.notify_all();
+    for (unsigned int i = 0; i < m_Workers.size(); i++)
+    {
+        m_Workers[i].join();
+    }
+}
+
+mtm::ThreadPool& mtm::ThreadPool::instance()
+{
+    static ThreadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+unsigned int mtm::ThreadPool::size() const
+{
+    return (unsigned int)m_Workers.size();
+}
+
+bool mtm::ThreadPool::isWorker()
+{
+    return is_pool_worker;
+}
+
+//Worker loop: sleeps until a task is queued, runs it, and exits once the pool is stopping and drained.
+void mtm::ThreadPool::work()
+{
+    is_pool_worker = true;
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Ready.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Tasks.empty())
+            {
+                return;
+            }
+            task = m_Tasks.front();
+            m_Tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,242 @@
+//
+//  ThreadPool.h
+//  Matrix
+//
+/*
+ This file exports the shared worker pool used by the parallel matrix operations.
+*/
+#ifndef ThreadPool_h
+#define ThreadPool_h
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+namespace mtm{
+
+/**
+* Enum: Execution
+* ------------------------
+* Selects whether an operation runs on the calling thread only (SEQUENTIAL) or is split
+* between the calling thread and the shared ThreadPool (PARALLEL).
+*/
+enum Execution { SEQUENTIAL, PARALLEL };
+
+/**
+* Class: ThreadPool
+* ------------------------
+* Fixed set of worker threads consuming a FIFO task queue.
+* One process wide instance is created on first use (see instance()), every parallel
+* matrix operation shares it so nested libraries do not oversubscribe the machine.
+*/
+class ThreadPool{
+private:
+    std::vector<std::thread> m_Workers;
+    std::queue< std::function<void()> > m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Ready;
+    bool m_Stopping;
+
+    void work();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+public:
+    /**
+    * Constructor: ThreadPool
+    * Usage: ThreadPool pool(threads);
+    * ---------------------------------------
+    @param threads number of workers to start, 0 is treated as 1.
+    */
+    explicit ThreadPool(unsigned int threads);
+
+    /**
+    * Destructor: ~ThreadPool
+    * -------------------
+    * Finishes the queued tasks and joins all workers.
+    */
+    ~ThreadPool();
+
+    /**
+    * static function: instance
+    * Usage: ThreadPool::instance()
+    * -----------------------------
+    @return the shared pool, sized by std::thread::hardware_concurrency().
+    */
+    static ThreadPool& instance();
+
+    /**
+    * Method: size
+    * Usage: pool.size()
+    * -----------------------------
+    @return number of worker threads.
+    */
+    unsigned int size() const;
+
+    /**
+    * static function: isWorker
+    * Usage: ThreadPool::isWorker()
+    * -----------------------------
+    @return true iff the calling thread is a worker of some pool. Parallel loops started from
+    *       a worker run inline, so a task never blocks a worker waiting for other tasks.
+    */
+    static bool isWorker();
+
+    /**
+    * Method: submit
+    * Usage: pool.submit(task)
+    * -----------------------------
+    * Queues task() for execution on one of the workers.
+    @param task callable object taking no arguments.
+    @return future holding the result (or the exception) of task().
+    */
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F task);
+
+    /**
+    * Method: parallelFor
+    * Usage: pool.parallelFor(begin, end, grain, body)
+    * -----------------------------
+    * Splits [begin, end) into consecutive chunks of grain indices and calls body(first, last)
+    * once per chunk. The chunk boundaries only depend on grain, never on the number of threads,
+    * so callers that combine per chunk results in chunk order get the same answer on any machine.
+    * The calling thread takes part in the work and returns after all chunks are done.
+    @param grain number of indices per chunk, values below 1 are treated as 1.
+    @exception the first exception thrown by body is rethrown in the calling thread.
+    */
+    template <typename F>
+    void parallelFor(int begin, int end, int grain, F body);
+};
+
+
+/**
+* function: parallelRows
+* Usage: parallelRows(rows, cols, execution, body)
+* -----------------------------
+* Runs body(first_row, last_row) over [0, rows), splitting the rows into bands on the shared
+* pool when execution is PARALLEL and the matrix is large enough to pay for the hand off.
+@param cols the row length, used only to estimate the amount of work.
+*/
+template <typename F>
+void parallelRows(int rows, int cols, Execution execution, F body);
+
+//Matrices smaller than this (in elements) are always processed on the calling thread.
+const long PARALLEL_THRESHOLD = 1L << 15;
+
+
+
+template <typename F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F task)
+{
+    typedef typename std::result_of<F()>::type Result;
+    std::shared_ptr< std::packaged_task<Result()> > packaged =
+        std::make_shared< std::packaged_task<Result()> >(task);
+    std::future<Result> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.push([packaged]() { (*packaged)(); });
+    }
+    m_Ready.notify_one();
+    return result;
+}
+
+
+//Shared bookkeeping of one parallelFor call. Helpers keep it alive through shared_ptr so a helper
+//that starts after the caller returned only finds an exhausted counter and never touches body.
+struct ParallelForState{
+    std::atomic<int> next;
+    int chunks;
+    int done;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+    explicit ParallelForState(int chunks) : next(0), chunks(chunks), done(0) {}
+};
+
+template <typename F>
+void ThreadPool::parallelFor(int begin, int end, int grain, F body)
+{
+    if (end <= begin)
+    {
+        return;
+    }
+    if (grain < 1)
+    {
+        grain = 1;
+    }
+    int chunks = (end - begin - 1) / grain + 1;
+    if (chunks == 1 || isWorker() || size() <= 1)
+    {
+        for (int first = begin; first < end; first += grain)
+        {
+            body(first, (end - first > grain) ? first + grain : end);
+        }
+        return;
+    }
+
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>(chunks);
+    F* shared_body = &body;
+    std::function<void()> run = [state, shared_body, begin, end, grain]()
+    {
+        for (int chunk = state->next++; chunk < state->chunks; chunk = state->next++)
+        {
+            int first = begin + chunk * grain;
+            try{
+                (*shared_body)(first, (end - first > grain) ? first + grain : end);
+            }catch(...){
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error)
+                {
+                    state->error = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (++state->done == state->chunks)
+            {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    unsigned int helpers = (unsigned int)(chunks - 1) < size() ? (unsigned int)(chunks - 1) : size();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (unsigned int i = 0; i < helpers; i++)
+        {
+            m_Tasks.push(run);
+        }
+    }
+    m_Ready.notify_all();
+
+    run();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->done == state->chunks; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+
+template <typename F>
+void parallelRows(int rows, int cols, Execution execution, F body)
+{
+    if (execution == SEQUENTIAL || (long)rows * cols < PARALLEL_THRESHOLD)
+    {
+        body(0, rows);
+        return;
+    }
+    ThreadPool& pool = ThreadPool::instance();
+    int bands = 4 * (int)pool.size();
+    pool.parallelFor(0, rows, (rows + bands - 1) / bands, body);
+}
+}
+
+#endif /* ThreadPool_h */
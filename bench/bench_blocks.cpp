@@ -0,0 +1,86 @@
+//
+//  bench_blocks.cpp
+//  Matrix
+//
+/*
+ Measures a blocked kernel (every block copied to a buffer, scaled and written back) through
+ Matrix::blocks in each BlockOrder and with the blocks handed to the shared ThreadPool, against the same
+ work through the element iterator, for each Layout.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_blocks.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_blocks
+ run with:
+ ./bench_blocks [side, default 4096] [block side, default 64] [repetitions, default 3]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void scale(mtm::Matrix<float>::Block block, std::vector<float> &buffer)
+{
+    block.copyTo(&buffer[0]);
+    for (int k = 0; k < block.height() * block.width(); k++)
+    {
+        buffer[k] = buffer[k] * 0.5f + 1.0f;
+    }
+    block.copyFrom(&buffer[0]);
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int block_side = (argc > 2) ? std::atoi(argv[2]) : 64;
+    int repetitions = (argc > 3) ? std::atoi(argv[3]) : 3;
+    const char* layouts[] = { "ROW_MAJOR", "COLUMN_MAJOR", "TILED" };
+    std::cout << "side: " << side << ", blocks: " << block_side << " x " << block_side << std::endl;
+    std::cout << "layout        iterator(ms)  row blocks(ms)  column blocks(ms)  Z blocks(ms)  Z parallel(ms)" << std::endl;
+    for (int l = 0; l < 3; l++)
+    {
+        mtm::Matrix<float> mat(mtm::Dimensions(side, side), 1.0f, mtm::DEEP_COPY, (mtm::Layout)l);
+        double best[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+        std::vector<float> buffer((std::size_t)block_side * block_side);
+        for (int r = 0; r < repetitions; r++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (mtm::Matrix<float>::iterator it = mat.begin(); it != mat.end(); ++it)
+            {
+                *it = *it * 0.5f + 1.0f;
+            }
+            best[0] = std::min(best[0], seconds(start));
+            for (int o = 0; o < 3; o++)
+            {
+                start = std::chrono::steady_clock::now();
+                mtm::Matrix<float>::Blocks blocks = mat.blocks(block_side, block_side, (mtm::BlockOrder)o);
+                for (mtm::Matrix<float>::Blocks::iterator it = blocks.begin(); it != blocks.end(); ++it)
+                {
+                    scale(*it, buffer);
+                }
+                best[1 + o] = std::min(best[1 + o], seconds(start));
+            }
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<float>::Blocks blocks = mat.blocks(block_side, block_side, mtm::Z_ORDER_BLOCKS);
+            mtm::parallelRows(blocks.size(), block_side * block_side, mtm::PARALLEL, [&](int first, int last)
+            {
+                std::vector<float> local((std::size_t)block_side * block_side);
+                for (int k = first; k < last; k++)
+                {
+                    scale(blocks[k], local);
+                }
+            });
+            best[4] = std::min(best[4], seconds(start));
+        }
+        std::cout << std::left << std::setw(12) << layouts[l] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << best[0] * 1e3 << std::setw(16) << best[1] * 1e3 << std::setw(19) << best[2] * 1e3
+                  << std::setw(14) << best[3] * 1e3 << std::setw(16) << best[4] * 1e3 << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+//
+//  bench_compressed.cpp
+//  Matrix
+//
+/*
+ Compresses a diagonal bool mask, a mostly constant int grid and 4 bit int noise, and measures the size
+ of every Compressed matrix, compression, decompression, sum and any against the dense matrix, and the
+ cost of scattered writes (one tile decompressed per write) followed by recompress.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_compressed.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_compressed
+ run with:
+ ./bench_compressed [side, default 4096] [repetitions, default 3]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "Compressed.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+static void measure(const char* name, const mtm::Matrix<T> &dense, int repetitions)
+{
+    double best[6] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+    long long checks[2] = { 0, 0 };
+    std::size_t bytes = 0;
+    std::mt19937 random(1);
+    for (int r = 0; r < repetitions; r++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mtm::Compressed<T> compressed(dense);
+        best[0] = std::min(best[0], seconds(start));
+        bytes = compressed.bytes();
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<T> back = compressed.decompress();
+        best[1] = std::min(best[1], seconds(start));
+        start = std::chrono::steady_clock::now();
+        checks[0] = compressed.sum();
+        best[2] = std::min(best[2], seconds(start));
+        start = std::chrono::steady_clock::now();
+        long long dense_sum = 0;
+        for (typename mtm::Matrix<T>::const_iterator it = dense.begin(); it != dense.end(); ++it)
+        {
+            dense_sum += (long long)*it;
+        }
+        checks[1] = dense_sum;
+        best[3] = std::min(best[3], seconds(start));
+        start = std::chrono::steady_clock::now();
+        volatile bool found = any(compressed) && all(compressed.map([](T x) { return x == x; }));
+        (void)found;
+        best[4] = std::min(best[4], seconds(start));
+        start = std::chrono::steady_clock::now();
+        for (int w = 0; w < 1000; w++)
+        {
+            compressed((int)(random() % dense.height()), (int)(random() % dense.width())) = T(1);
+        }
+        compressed.recompress();
+        best[5] = std::min(best[5], seconds(start));
+    }
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(9) << 100.0 * bytes / (dense.size() * sizeof(T)) << std::setw(12) << best[0] * 1e3
+              << std::setw(14) << best[1] * 1e3 << std::setw(10) << best[2] * 1e3 << std::setw(12) << best[3] * 1e3
+              << std::setw(16) << best[4] * 1e3 << std::setw(18) << best[5] * 1e3
+              << ((checks[0] == checks[1]) ? "" : "  SUMS DIFFER") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 3;
+    mtm::Matrix<bool> mask(mtm::Dimensions(side, side), false);
+    mtm::Matrix<int> grid(mtm::Dimensions(side, side), 7);
+    mtm::Matrix<int> noise(mtm::Dimensions(side, side), 0);
+    std::mt19937 random(2);
+    for (int i = 0; i < side; i++)
+    {
+        mask(i, i) = true;
+        for (int j = 0; j < side; j++)
+        {
+            noise(i, j) = (int)(random() % 16);
+            if (i % 100 == 0)
+            {
+                grid(i, j) = i;
+            }
+        }
+    }
+    std::cout << "side: " << side << std::endl;
+    std::cout << "matrix    size(%)  compress(ms)  decompress(ms)  sum(ms)  dense sum(ms)  any/all map(ms)  1000 writes(ms)"
+              << std::endl;
+    measure("mask", mask, repetitions);
+    measure("grid", grid, repetitions);
+    measure("noise", noise, repetitions);
+    return 0;
+}
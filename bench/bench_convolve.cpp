@@ -0,0 +1,86 @@
+//
+//  bench_convolve.cpp
+//  Matrix
+//
+/*
+ Times the convolution algorithms on a float image for growing kernel sizes and kernel bank sizes.
+ The bank size at which IM2COL overtakes DIRECT is the IM2COL_KERNELS threshold of MatrixConvolve.h,
+ the separable column shows the gain of SEPARABLE on a rank one kernel of the same size.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_convolve.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_convolve
+ run with:
+ ./bench_convolve [image side, default 1024]
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "MatrixConvolve.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static mtm::Matrix<float> randomMatrix(int height, int width)
+{
+    mtm::Matrix<float> mat(mtm::Dimensions(height, width));
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            mat(i, j) = std::rand() / (float)RAND_MAX;
+        }
+    }
+    return mat;
+}
+
+static double timeBank(const mtm::Matrix<float> &image, const std::vector< mtm::Matrix<float> > &kernels,
+                       mtm::ConvolutionAlgorithm algorithm)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mtm::correlate(image, kernels, mtm::BORDER_CLAMP, algorithm);
+    return seconds(start);
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 1024;
+    mtm::Matrix<float> image = randomMatrix(side, side);
+
+    std::cout << "kernel      direct    im2col  separable" << std::endl;
+    for (int k = 3; k <= 15; k += 2)
+    {
+        std::vector< mtm::Matrix<float> > kernel(1, randomMatrix(k, k));
+        mtm::Matrix<float> column = randomMatrix(k, 1);
+        mtm::Matrix<float> rank_one(mtm::Dimensions(k, k));
+        for (int i = 0; i < k; i++)
+        {
+            for (int j = 0; j < k; j++)
+            {
+                rank_one(i, j) = column(i, 0) * column(j, 0);
+            }
+        }
+        std::cout << std::setw(2) << k << "x" << std::setw(2) << k << std::fixed << std::setprecision(3)
+                  << std::setw(12) << timeBank(image, kernel, mtm::DIRECT)
+                  << std::setw(10) << timeBank(image, kernel, mtm::IM2COL)
+                  << std::setw(11) << timeBank(image, std::vector< mtm::Matrix<float> >(1, rank_one), mtm::SEPARABLE)
+                  << std::endl;
+    }
+
+    std::cout << std::endl << "bank of 3x3  direct    im2col" << std::endl;
+    for (int count = 1; count <= 16; count *= 2)
+    {
+        std::vector< mtm::Matrix<float> > kernels;
+        for (int k = 0; k < count; k++)
+        {
+            kernels.push_back(randomMatrix(3, 3));
+        }
+        std::cout << std::setw(12) << count << std::fixed << std::setprecision(3)
+                  << std::setw(8) << timeBank(image, kernels, mtm::DIRECT)
+                  << std::setw(10) << timeBank(image, kernels, mtm::IM2COL) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+//
+//  bench_decompose.cpp
+//  Matrix
+//
+/*
+ Measures the decompositions of MatrixDecompose.h on principal component data: a tall matrix whose
+ columns have decaying scales, and its covariance. Times the full symmetric eigendecomposition (sequential
+ and parallel), the eigenvalues alone, the 10 dominant pairs by subspace iteration and the rank 10
+ randomized SVD of the data, with the largest residual |a v - lambda v| (or |a v - sigma u|) of each, relative to the largest
+ lambda (or sigma).
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_decompose.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_decompose
+ run with:
+ ./bench_decompose [columns, default 512] [rows, default 20000]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "MatrixDecompose.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//largest |a x_j - scale_j y_j| over the columns j of x, divided by |scale_0|.
+static double residual(const mtm::Matrix<double> &a, const mtm::Matrix<double> &x, const mtm::Matrix<double> &scales,
+                       const mtm::Matrix<double> &y)
+{
+    mtm::Matrix<double> ax = mtm::multiply(a, x);
+    double largest = 0;
+    for (int j = 0; j < x.width(); j++)
+    {
+        double sum = 0;
+        for (int i = 0; i < ax.height(); i++)
+        {
+            double difference = ax(i, j) - scales(j, 0) * y(i, j);
+            sum += difference * difference;
+        }
+        largest = std::max(largest, std::sqrt(sum));
+    }
+    return largest / std::abs(scales(0, 0));
+}
+
+static void report(const char* name, double time, double error)
+{
+    std::cout << std::left << std::setw(34) << name << std::right << std::setw(10) << std::fixed
+              << std::setprecision(3) << time << " s" << std::setw(14) << std::scientific << std::setprecision(2)
+              << error << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int columns = (argc > 1) ? std::atoi(argv[1]) : 512;
+    int rows = (argc > 2) ? std::atoi(argv[2]) : 20000;
+    const int k = 10;
+    std::mt19937 random(1);
+    std::normal_distribution<double> gaussian;
+    mtm::Matrix<double> data(mtm::Dimensions(rows, columns), 0.0);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < columns; j++)
+        {
+            data(i, j) = gaussian(random) * std::pow(0.9, j);
+        }
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mtm::Matrix<double> covariance = mtm::multiply(data.transpose(), data, mtm::CONVENTIONAL, mtm::PARALLEL);
+    for (int i = 0; i < columns; i++)
+    {
+        for (int j = 0; j < columns; j++)
+        {
+            covariance(i, j) /= rows;
+        }
+    }
+    std::cout << rows << " x " << columns << " data, covariance in " << std::fixed << std::setprecision(3)
+              << seconds(start) << " s" << std::endl;
+    std::cout << std::left << std::setw(34) << "decomposition" << std::right << std::setw(12) << "time"
+              << std::setw(14) << "residual" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    mtm::SymmetricEigen<double> full(covariance);
+    double time = seconds(start);
+    report("eigen (sequential)", time, residual(covariance, full.vectors(), full.values(), full.vectors()));
+    start = std::chrono::steady_clock::now();
+    mtm::SymmetricEigen<double> parallel(covariance, mtm::PARALLEL);
+    time = seconds(start);
+    report("eigen (parallel)", time, residual(covariance, parallel.vectors(), parallel.values(), parallel.vectors()));
+
+    start = std::chrono::steady_clock::now();
+    mtm::Matrix<double> values = mtm::SymmetricEigen<double>::eigenvalues(covariance, mtm::PARALLEL);
+    time = seconds(start);
+    double difference = 0;
+    for (int i = 0; i < columns; i++)
+    {
+        difference = std::max(difference, std::abs(values(i, 0) - full.values()(i, 0)));
+    }
+    report("eigenvalues only", time, difference);
+
+    start = std::chrono::steady_clock::now();
+    mtm::SymmetricEigen<double> dominant = mtm::SymmetricEigen<double>::dominant(covariance, k, 1e-10, 1000,
+                                                                                 mtm::PARALLEL);
+    time = seconds(start);
+    report("dominant 10 (subspace)", time, residual(covariance, dominant.vectors(), dominant.values(),
+                                                    dominant.vectors()));
+
+    start = std::chrono::steady_clock::now();
+    mtm::TruncatedSVD<double> svd(data, k, 10, 2, mtm::PARALLEL);
+    time = seconds(start);
+    report("truncated SVD 10 of the data", time, residual(data, svd.v(), svd.singularValues(), svd.u()));
+    double spread = 0;
+    for (int j = 0; j < k; j++)
+    {
+        double sigma = svd.singularValues()(j, 0);
+        spread = std::max(spread, std::abs(sigma * sigma / rows - full.values()(j, 0)) / full.values()(j, 0));
+    }
+    std::cout << "largest relative difference of sigma^2 / rows and the covariance eigenvalues: "
+              << std::scientific << std::setprecision(2) << spread << std::endl;
+    return 0;
+}
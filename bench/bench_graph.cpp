@@ -0,0 +1,141 @@
+//
+//  bench_graph.cpp
+//  Matrix
+//
+/*
+ Measures blocked Floyd-Warshall against the textbook triple loop over a row-major array, the packed
+ transitiveClosure against Warshall's algorithm on bytes, and the min-plus semiringMultiply, sequentially
+ and on the shared ThreadPool, on random graphs of growing size.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_graph.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixGraph.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_graph
+ run with:
+ ./bench_graph [largest vertex count, default 2048] [edges per vertex, default 8]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "MatrixGraph.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int largest = (argc > 1) ? std::atoi(argv[1]) : 2048;
+    int degree = (argc > 2) ? std::atoi(argv[2]) : 8;
+    const int infinity = mtm::unreachable<int>();
+    std::cout << "vertices  loop FW(ms)  blocked FW(ms)  parallel FW(ms)  byte closure(ms)  packed closure(ms)"
+              << "  parallel closure(ms)  min-plus(ms)" << std::endl;
+    for (int n = 256; n <= largest; n *= 2)
+    {
+        std::mt19937 generator(n);
+        mtm::Matrix<int> weights(mtm::Dimensions(n, n), infinity);
+        mtm::Matrix<bool> adjacency(mtm::Dimensions(n, n), false);
+        for (int i = 0; i < n; i++)
+        {
+            for (int e = 0; e < degree; e++)
+            {
+                int j = (int)(generator() % n);
+                weights(i, j) = 1 + (int)(generator() % 100);
+                adjacency(i, j) = true;
+            }
+        }
+        double times[7];
+
+        std::vector<int> distance((std::size_t)n * n);
+        weights.copyTo(&distance[0]);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; i++)
+        {
+            distance[(std::size_t)i * n + i] = 0;
+        }
+        for (int k = 0; k < n; k++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                int through_k = distance[(std::size_t)i * n + k];
+                if (through_k == infinity)
+                {
+                    continue;
+                }
+                for (int j = 0; j < n; j++)
+                {
+                    int k_j = distance[(std::size_t)k * n + j];
+                    if (k_j != infinity && through_k + k_j < distance[(std::size_t)i * n + j])
+                    {
+                        distance[(std::size_t)i * n + j] = through_k + k_j;
+                    }
+                }
+            }
+        }
+        times[0] = seconds(start);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<int> blocked = mtm::floydWarshall(weights);
+        times[1] = seconds(start);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<int> parallel = mtm::floydWarshall(weights, mtm::PARALLEL);
+        times[2] = seconds(start);
+
+        std::vector<unsigned char> reach((std::size_t)n * n);
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                reach[(std::size_t)i * n + j] = adjacency(i, j);
+            }
+        }
+        start = std::chrono::steady_clock::now();
+        for (int k = 0; k < n; k++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (reach[(std::size_t)i * n + k])
+                {
+                    for (int j = 0; j < n; j++)
+                    {
+                        reach[(std::size_t)i * n + j] |= reach[(std::size_t)k * n + j];
+                    }
+                }
+            }
+        }
+        times[3] = seconds(start);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<bool> closure = mtm::transitiveClosure(adjacency);
+        times[4] = seconds(start);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<bool> parallel_closure = mtm::transitiveClosure(adjacency, mtm::PARALLEL);
+        times[5] = seconds(start);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<int> two_steps = mtm::semiringMultiply<mtm::MinPlus<int> >(weights, weights, mtm::PARALLEL);
+        times[6] = seconds(start);
+
+        for (int i = 0; i < n; i += 7)
+        {
+            for (int j = 0; j < n; j += 5)
+            {
+                if (blocked(i, j) != distance[(std::size_t)i * n + j] || parallel(i, j) != blocked(i, j) ||
+                    closure(i, j) != (reach[(std::size_t)i * n + j] != 0) || parallel_closure(i, j) != closure(i, j) ||
+                    two_steps(i, j) < blocked(i, j))
+                {
+                    std::cout << "mismatch at " << i << ", " << j << std::endl;
+                    return 1;
+                }
+            }
+        }
+        std::cout << std::setw(8) << n << std::fixed << std::setprecision(2);
+        const int widths[7] = { 13, 16, 17, 18, 20, 22, 14 };
+        for (int t = 0; t < 7; t++)
+        {
+            std::cout << std::setw(widths[t]) << times[t] * 1e3;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
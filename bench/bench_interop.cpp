@@ -0,0 +1,97 @@
+//
+//  bench_interop.cpp
+//  Matrix
+//
+/*
+ Measures bringing a filled row-major buffer into a Matrix<float>: element by element through operator(),
+ with copyFrom, with Matrix::Adopt on a dense and on a padded buffer, and with Matrix::Wrap, and handing
+ the elements back out through data() against copyTo.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_interop.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_interop
+ run with:
+ ./bench_interop [side, default 4096] [row padding, default 16] [repetitions, default 5]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//a freshly allocated and filled buffer, as a reader would hand it over.
+static float* incoming(int side, std::size_t stride)
+{
+    float* buffer = new float[(std::size_t)side * stride];
+    for (std::size_t k = 0; k < (std::size_t)side * stride; k++)
+    {
+        buffer[k] = (float)(k % 1000);
+    }
+    return buffer;
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int padding = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int repetitions = (argc > 3) ? std::atoi(argv[3]) : 5;
+    mtm::Dimensions dims(side, side);
+    std::size_t padded = (std::size_t)side + padding;
+    const char* names[] = { "operator()", "copyFrom", "Adopt", "Adopt padded", "Wrap", "copyTo", "data()" };
+    double best[7] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+    double checksum = 0;
+    for (int r = 0; r < repetitions; r++)
+    {
+        float* buffer = incoming(side, side);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> by_element(dims);
+        for (int i = 0; i < side; i++)
+        {
+            for (int j = 0; j < side; j++)
+            {
+                by_element(i, j) = buffer[(std::size_t)i * side + j];
+            }
+        }
+        best[0] = std::min(best[0], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> copied(dims);
+        copied.copyFrom(buffer);
+        best[1] = std::min(best[1], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> adopted = mtm::Matrix<float>::Adopt(buffer, dims, side, [](float* p) { delete[] p; });
+        best[2] = std::min(best[2], seconds(start));
+
+        float* padded_buffer = incoming(side, padded);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> adopted_padded = mtm::Matrix<float>::Adopt(padded_buffer, dims, padded,
+                                                                      [](float* p) { delete[] p; });
+        best[3] = std::min(best[3], seconds(start));
+
+        std::vector<float> borrowed((std::size_t)side * side, 1.0f);
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> wrapped = mtm::Matrix<float>::Wrap(&borrowed[0], dims, side);
+        best[4] = std::min(best[4], seconds(start));
+
+        std::vector<float> out((std::size_t)side * side);
+        start = std::chrono::steady_clock::now();
+        adopted.copyTo(&out[0]);
+        best[5] = std::min(best[5], seconds(start));
+        start = std::chrono::steady_clock::now();
+        const float* view = static_cast<const mtm::Matrix<float>&>(adopted_padded).data();
+        best[6] = std::min(best[6], seconds(start));
+        checksum += out[side] + view[side] + by_element(1, 0) + copied(1, 0) + wrapped(1, 0);
+    }
+    std::cout << "side: " << side << ", padding: " << padding << ", checksum: " << checksum << std::endl;
+    for (int k = 0; k < 7; k++)
+    {
+        std::cout << std::left << std::setw(14) << names[k] << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << best[k] * 1e3 << " ms" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+//
+//  bench_memory.cpp
+//  Matrix
+//
+/*
+ Measures allocation and element wise throughput (operator+, apply, and zip sequentially and in
+ parallel) of a large matrix for every MemoryPolicy. Huge pages cut TLB misses of the streaming loops,
+ FIRST_TOUCH and INTERLEAVED only differ from HUGE_PAGES on machines with more than one NUMA node.
+ operator+ and apply run on the calling thread, so they show the cost of remote pages for one thread.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_memory.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_memory
+ run with:
+ ./bench_memory [side, default 4096] [repetitions, default 5]
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 5;
+    const mtm::MemoryPolicy policies[] = { mtm::DEFAULT_MEMORY, mtm::HUGE_PAGES, mtm::FIRST_TOUCH, mtm::INTERLEAVED };
+    const char* names[] = { "default", "huge pages", "first touch", "interleaved" };
+    double gigabytes = 3.0 * side * side * sizeof(double) / 1e9;
+    double unary_gigabytes = 2.0 * side * side * sizeof(double) / 1e9;
+
+    std::cout << "numa nodes: " << mtm::numaNodes() << ", threads: " << mtm::ThreadPool::instance().size()
+              << ", side: " << side << std::endl;
+    std::cout << "policy        allocate(s)  a+b GB/s  apply GB/s  sequential zip GB/s  parallel zip GB/s" << std::endl;
+    for (int p = 0; p < 4; p++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mtm::Matrix<double> a(mtm::Dimensions(side, side), 1.0, mtm::DEEP_COPY, mtm::ROW_MAJOR, policies[p]);
+        mtm::Matrix<double> b(mtm::Dimensions(side, side), 2.0, mtm::DEEP_COPY, mtm::ROW_MAJOR, policies[p]);
+        double allocation = seconds(start);
+
+        double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+        for (int r = 0; r < repetitions; r++)
+        {
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<double> sum = a + b;
+            best[0] = std::min(best[0], seconds(start));
+
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<double> scaled = a.apply([](double x) { return 2.0 * x; });
+            best[3] = std::min(best[3], seconds(start));
+
+            for (int e = 0; e < 2; e++)
+            {
+                start = std::chrono::steady_clock::now();
+                mtm::Matrix<double> product = mtm::zip(a, b, [](double x, double y) { return x * y; },
+                                                       e == 0 ? mtm::SEQUENTIAL : mtm::PARALLEL);
+                best[1 + e] = std::min(best[1 + e], seconds(start));
+            }
+        }
+        std::cout << std::left << std::setw(14) << names[p] << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << allocation << std::setw(10) << gigabytes / best[0]
+                  << std::setw(12) << unary_gigabytes / best[3]
+                  << std::setw(21) << gigabytes / best[1] << std::setw(19) << gigabytes / best[2] << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+//
+//  bench_multiply.cpp
+//  Matrix
+//
+/*
+ Compares the conventional blocked product with Strassen-Winograd for several recursion cutoffs.
+ The smallest size at which a cutoff beats the conventional kernel is the crossover point that
+ STRASSEN_CUTOFF in MatrixMultiply.h is based on.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_multiply.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_multiply
+ run with:
+ ./bench_multiply [largest size, default 2048]
+*/
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "MatrixMultiply.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int largest = (argc > 1) ? std::atoi(argv[1]) : 2048;
+    const int cutoffs[] = { 64, 128, 256, 512 };
+    const int cutoff_count = sizeof(cutoffs) / sizeof(cutoffs[0]);
+    mtm::Execution executions[] = { mtm::SEQUENTIAL, mtm::PARALLEL };
+
+    std::cout << "size  execution   conventional";
+    for (int c = 0; c < cutoff_count; c++)
+    {
+        std::cout << "  cutoff " << std::setw(4) << cutoffs[c];
+    }
+    std::cout << std::endl;
+
+    for (int n = 256; n <= largest; n *= 2)
+    {
+        std::vector<double> a((std::size_t)n * n), b((std::size_t)n * n), c((std::size_t)n * n);
+        for (std::size_t k = 0; k < a.size(); k++)
+        {
+            a[k] = std::rand() / (double)RAND_MAX;
+            b[k] = std::rand() / (double)RAND_MAX;
+        }
+        for (int e = 0; e < 2; e++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            mtm::multiplyBlocked(&a[0], n, &b[0], n, &c[0], n, n, n, n, executions[e]);
+            std::cout << std::setw(4) << n << "  " << std::setw(10) << (e == 0 ? "sequential" : "parallel")
+                      << std::setw(13) << std::fixed << std::setprecision(3) << seconds(start);
+            for (int k = 0; k < cutoff_count; k++)
+            {
+                if (cutoffs[k] >= n)
+                {
+                    std::cout << std::setw(13) << "-";
+                    continue;
+                }
+                mtm::StrassenWinograd<double> strassen(n, cutoffs[k], executions[e]);
+                start = std::chrono::steady_clock::now();
+                strassen.multiply(&a[0], &b[0], &c[0], executions[e]);
+                std::cout << std::setw(13) << seconds(start);
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
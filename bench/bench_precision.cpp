@@ -0,0 +1,108 @@
+//
+//  bench_precision.cpp
+//  Matrix
+//
+/*
+ Measures the conversions of Matrix::cast between float, Half and BFloat16, and a streaming sum over
+ float storage against the same sum over Half and BFloat16 storage (converted back to float run by run),
+ which reads half the bytes.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_precision.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_precision
+ run with:
+ ./bench_precision [side, default 4096] [repetitions, default 5]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "HalfFloat.h"
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//sums a row-major matrix of 16 bit elements, converting 1024 elements at a time into a float buffer.
+template <typename H>
+static double stagedSum(const mtm::Matrix<H> &mat, std::vector<float> &buffer)
+{
+    const H* elements = &mat(0, 0);
+    std::size_t count = (std::size_t)mat.height() * mat.width();
+    double total = 0;
+    for (std::size_t start = 0; start < count; start += buffer.size())
+    {
+        int length = (int)std::min(buffer.size(), count - start);
+        mtm::convertRun(elements + start, &buffer[0], length);
+        float partial = 0;
+        for (int k = 0; k < length; k++)
+        {
+            partial += buffer[k];
+        }
+        total += partial;
+    }
+    return total;
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 5;
+    double count = (double)side * side;
+    mtm::Matrix<float> values(mtm::Dimensions(side, side), 0.5f);
+#ifdef __F16C__
+    std::cout << "F16C conversions, side: " << side << std::endl;
+#else
+    std::cout << "scalar conversions, side: " << side << std::endl;
+#endif
+
+    double best[7] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+    double check = 0;
+    std::vector<float> buffer(1024);
+    for (int r = 0; r < repetitions; r++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mtm::Matrix<mtm::Half> half = values.cast<mtm::Half>();
+        best[0] = std::min(best[0], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> from_half = half.cast<float>();
+        best[1] = std::min(best[1], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<mtm::BFloat16> brain = values.cast<mtm::BFloat16>();
+        best[2] = std::min(best[2], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> from_brain = brain.cast<float>();
+        best[3] = std::min(best[3], seconds(start));
+
+        start = std::chrono::steady_clock::now();
+        const float* elements = &values(0, 0);
+        float partial = 0;
+        for (std::size_t k = 0; k < (std::size_t)count; k++)
+        {
+            partial += elements[k];
+        }
+        check += partial;
+        best[4] = std::min(best[4], seconds(start));
+        start = std::chrono::steady_clock::now();
+        check += stagedSum(half, buffer);
+        best[5] = std::min(best[5], seconds(start));
+        start = std::chrono::steady_clock::now();
+        check += stagedSum(brain, buffer);
+        best[6] = std::min(best[6], seconds(start));
+        check += from_half(0, 0) + from_brain(0, 0);
+    }
+
+    const char* names[] = { "float -> Half", "Half -> float", "float -> BFloat16", "BFloat16 -> float",
+                            "sum float", "sum Half", "sum BFloat16" };
+    std::cout << "operation              time(ms)  elements/ns" << std::endl;
+    for (int i = 0; i < 7; i++)
+    {
+        std::cout << std::left << std::setw(21) << names[i] << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << best[i] * 1e3 << std::setw(13) << count / best[i] / 1e9 << std::endl;
+    }
+    std::cout << "(checksum " << check << ")" << std::endl;
+    return 0;
+}
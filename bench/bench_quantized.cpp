@@ -0,0 +1,74 @@
+//
+//  bench_quantized.cpp
+//  Matrix
+//
+/*
+ Measures the int8 x int8 -> int32 product of multiplyInt8 against its reference loop and against the
+ float product of multiply, on square matrices.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_quantized.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp Quantized.cpp ThreadPool.cpp -o bench_quantized
+ run with:
+ ./bench_quantized [side, default 512] [repetitions, default 3]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "MatrixMultiply.h"
+#include "Quantized.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 512;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 3;
+    mtm::Matrix<float> a(mtm::Dimensions(side, side), 0.0f);
+    mtm::Matrix<float> b(mtm::Dimensions(side, side), 0.0f);
+    std::srand(1);
+    for (int i = 0; i < side; i++)
+    {
+        for (int j = 0; j < side; j++)
+        {
+            a(i, j) = (float)(std::rand() % 2001 - 1000) / 1000;
+            b(i, j) = (float)(std::rand() % 2001 - 1000) / 1000;
+        }
+    }
+    mtm::Quantized<std::int8_t> quantized_a = mtm::Quantized<std::int8_t>::quantize(a);
+    mtm::Quantized<std::int8_t> quantized_b = mtm::Quantized<std::int8_t>::quantize(b);
+    double operations = 2.0 * side * side * side;
+
+    double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+    bool equal = true;
+    for (int r = 0; r < repetitions; r++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mtm::Matrix<std::int32_t> reference = mtm::multiplyInt8Reference(quantized_a.values(), quantized_b.values());
+        best[0] = std::min(best[0], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<std::int32_t> fast = mtm::multiplyInt8(quantized_a.values(), quantized_b.values());
+        best[1] = std::min(best[1], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> real = mtm::multiply(quantized_a, quantized_b);
+        best[2] = std::min(best[2], seconds(start));
+        start = std::chrono::steady_clock::now();
+        mtm::Matrix<float> product = mtm::multiply(a, b);
+        best[3] = std::min(best[3], seconds(start));
+        equal = equal && all(fast - reference == 0);
+    }
+
+    const char* names[] = { "int8 reference", "int8 multiplyInt8", "quantized multiply", "float multiply" };
+    std::cout << "side: " << side << ", kernels equal: " << (equal ? "yes" : "NO") << std::endl;
+    std::cout << "product               time(ms)   GOP/s" << std::endl;
+    for (int i = 0; i < 4; i++)
+    {
+        std::cout << std::left << std::setw(20) << names[i] << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(11) << best[i] * 1e3 << std::setw(8) << operations / best[i] / 1e9 << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+//
+//  bench_reduce.cpp
+//  Matrix
+//
+/*
+ Measures sum, dot and frobeniusNorm of a Matrix<double> in REPRODUCIBLE and FAST mode, sequentially and
+ on the shared ThreadPool, against a plain loop over the element iterator, for each Layout, and checks
+ that every REPRODUCIBLE result is bit identical to the sequential row-major one.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_reduce.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_reduce
+ run with:
+ ./bench_reduce [side, default 4096] [repetitions, default 5]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include "MatrixReduce.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool identical(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 5;
+    const char* layouts[] = { "ROW_MAJOR", "COLUMN_MAJOR", "TILED" };
+    const char* kinds[] = { "sum", "dot", "frobenius" };
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+    mtm::Matrix<double> a(mtm::Dimensions(side, side), 0.0);
+    mtm::Matrix<double> b(mtm::Dimensions(side, side), 0.0);
+    for (int i = 0; i < side; i++)
+    {
+        for (int j = 0; j < side; j++)
+        {
+            a(i, j) = distribution(generator) * 1e8;
+            b(i, j) = distribution(generator);
+        }
+    }
+    double expected[3] = { mtm::sum(a), mtm::dot(a, b), mtm::frobeniusNorm(a) };
+    bool reproducible = true;
+    volatile double sink = 0;
+    std::cout << "side: " << side << ", threads: " << mtm::ThreadPool::instance().size() << std::endl;
+    std::cout << "layout        kind       loop(ms)  fast(ms)  reproducible(ms)  fast parallel(ms)  reproducible parallel(ms)"
+              << std::endl;
+    for (int l = 0; l < 3; l++)
+    {
+        const mtm::Matrix<double> x = a.toLayout((mtm::Layout)l);
+        const mtm::Matrix<double> y = b.toLayout((mtm::Layout)l);
+        for (int kind = 0; kind < 3; kind++)
+        {
+            double best[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+            for (int r = 0; r < repetitions; r++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                double loop = 0;
+                mtm::Matrix<double>::const_iterator other = y.begin();
+                for (mtm::Matrix<double>::const_iterator it = x.begin(); it != x.end(); ++it, ++other)
+                {
+                    loop += (kind == 0) ? *it : (kind == 1) ? *it * *other : *it * *it;
+                }
+                best[0] = std::min(best[0], seconds(start));
+                for (int run = 0; run < 4; run++)
+                {
+                    mtm::ReductionMode mode = (run % 2 == 0) ? mtm::FAST : mtm::REPRODUCIBLE;
+                    mtm::Execution execution = (run < 2) ? mtm::SEQUENTIAL : mtm::PARALLEL;
+                    start = std::chrono::steady_clock::now();
+                    double result = (kind == 0) ? mtm::sum(x, mode, execution)
+                                  : (kind == 1) ? mtm::dot(x, y, mode, execution)
+                                  : mtm::frobeniusNorm(x, mode, execution);
+                    best[run + 1] = std::min(best[run + 1], seconds(start));
+                    if (mode == mtm::REPRODUCIBLE && !identical(result, expected[kind]))
+                    {
+                        reproducible = false;
+                    }
+                }
+                sink = loop;
+            }
+            std::cout << std::left << std::setw(14) << layouts[l] << std::setw(11) << kinds[kind] << std::right
+                      << std::fixed << std::setprecision(2) << std::setw(8) << best[0] * 1e3 << std::setw(10)
+                      << best[1] * 1e3 << std::setw(18) << best[2] * 1e3 << std::setw(19) << best[3] * 1e3
+                      << std::setw(27) << best[4] * 1e3 << std::endl;
+        }
+    }
+    std::cout << "reproducible results bit identical: " << (reproducible ? "yes" : "NO") << std::endl;
+    return (reproducible || sink == 0.5) ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+//
+//  bench_resize.cpp
+//  Matrix
+//
+/*
+ Measures streaming row appends: appendRow on a ROW_MAJOR matrix (geometric capacity growth), the same with
+ the final size reserved up front, appendCol on a COLUMN_MAJOR matrix, and the old way of growing by one
+ row, a new matrix per row filled from the previous one, for int and std::string elements.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_resize.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_resize
+ run with:
+ ./bench_resize [rows, default 100000] [width, default 64]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, int rows, double time)
+{
+    std::cout << std::left << std::setw(40) << name << std::right << std::setw(10) << rows << std::setw(12)
+              << std::fixed << std::setprecision(4) << time << " s" << std::setw(12) << std::setprecision(1)
+              << time / rows * 1e9 << " ns/row" << std::endl;
+}
+
+template <typename T>
+static void measure(const char* type, int rows, int width, const T &value)
+{
+    std::cout << type << " elements, width " << width << std::endl;
+    std::vector<T> row(width, value);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mtm::Matrix<T> appended(mtm::Dimensions(1, width), value);
+    for (int i = 1; i < rows; i++)
+    {
+        appended.appendRow(row);
+    }
+    report("appendRow (ROW_MAJOR)", rows, seconds(start));
+
+    start = std::chrono::steady_clock::now();
+    mtm::Matrix<T> reserved(mtm::Dimensions(1, width), value);
+    reserved.reserve(mtm::Dimensions(rows, width));
+    for (int i = 1; i < rows; i++)
+    {
+        reserved.appendRow(row);
+    }
+    report("appendRow after reserve", rows, seconds(start));
+
+    std::vector<T> column(width, value);
+    start = std::chrono::steady_clock::now();
+    mtm::Matrix<T> columns(mtm::Dimensions(width, 1), value, mtm::DEEP_COPY, mtm::COLUMN_MAJOR);
+    for (int i = 1; i < rows; i++)
+    {
+        columns.appendCol(column);
+    }
+    report("appendCol (COLUMN_MAJOR)", rows, seconds(start));
+
+    //rebuilding is quadratic, it only gets a slice of the rows.
+    int rebuilt_rows = std::min(rows, 1000);
+    start = std::chrono::steady_clock::now();
+    mtm::Matrix<T> rebuilt(mtm::Dimensions(1, width), value);
+    for (int i = 1; i < rebuilt_rows; i++)
+    {
+        mtm::Matrix<T> grown(mtm::Dimensions(i + 1, width), value);
+        for (int r = 0; r < i; r++)
+        {
+            for (int j = 0; j < width; j++)
+            {
+                grown(r, j) = rebuilt(r, j);
+            }
+        }
+        rebuilt = std::move(grown);
+    }
+    report("new matrix per row (copy)", rebuilt_rows, seconds(start));
+}
+
+int main(int argc, char** argv)
+{
+    int rows = (argc > 1) ? std::atoi(argv[1]) : 100000;
+    int width = (argc > 2) ? std::atoi(argv[2]) : 64;
+    measure<int>("int", rows, width, 7);
+    measure<std::string>("std::string", rows / 10, width, std::string(32, 'x'));
+    return 0;
+}
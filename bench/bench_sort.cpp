@@ -0,0 +1,91 @@
+//
+//  bench_sort.cpp
+//  Matrix
+//
+/*
+ Measures sort along the rows of tall matrices of doubles for growing row lengths, against std::sort on
+ every row (the crossover behind SORT_NETWORK_LENGTH), and sort along the columns, argsort and topK.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_sort.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp MatrixSort.cpp ThreadPool.cpp -o bench_sort
+ run with:
+ ./bench_sort [elements, default 4194304] [repetitions, default 3]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "MatrixSort.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int elements = (argc > 1) ? std::atoi(argv[1]) : 1 << 22;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 3;
+    const int lengths[] = { 2, 4, 8, 16, 32, 64, 128, 256, 1024 };
+    std::cout << "elements: " << elements << std::endl;
+    std::cout << "length  std::sort(ms)  sort(ms)  sort par(ms)  columns(ms)  argsort(ms)  topK 4(ms)" << std::endl;
+    std::srand(1);
+    for (int l = 0; l < 9; l++)
+    {
+        int length = lengths[l];
+        int rows = elements / length;
+        mtm::Matrix<double> source(mtm::Dimensions(rows, length), 0.0);
+        for (int i = 0; i < rows; i++)
+        {
+            for (int j = 0; j < length; j++)
+            {
+                source(i, j) = (double)std::rand() / RAND_MAX;
+            }
+        }
+        mtm::Matrix<double> columns = source.transpose().toLayout(mtm::ROW_MAJOR);
+        double best[6] = { 1e30, 1e30, 1e30, 1e30, 1e30, 1e30 };
+        for (int r = 0; r < repetitions; r++)
+        {
+            mtm::Matrix<double> baseline = source;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            std::vector<double> lines(baseline.size());
+            baseline.copyTo(&lines[0]);
+            for (int i = 0; i < rows; i++)
+            {
+                std::sort(lines.begin() + (std::ptrdiff_t)i * length, lines.begin() + (std::ptrdiff_t)(i + 1) * length);
+            }
+            baseline.copyFrom(&lines[0]);
+            best[0] = std::min(best[0], seconds(start));
+
+            mtm::Matrix<double> sorted = source;
+            start = std::chrono::steady_clock::now();
+            sort(sorted);
+            best[1] = std::min(best[1], seconds(start));
+            if (!all(sorted - baseline == 0.0))
+            {
+                std::cout << "sort differs from std::sort" << std::endl;
+                return 1;
+            }
+            sorted = source;
+            start = std::chrono::steady_clock::now();
+            sort(sorted, mtm::EACH_ROW, mtm::ASCENDING, mtm::PARALLEL);
+            best[2] = std::min(best[2], seconds(start));
+            sorted = columns;
+            start = std::chrono::steady_clock::now();
+            sort(sorted, mtm::EACH_COLUMN);
+            best[3] = std::min(best[3], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<int> order = argsort(source);
+            best[4] = std::min(best[4], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<double> top = topK(source, std::min(4, length));
+            best[5] = std::min(best[5], seconds(start));
+        }
+        std::cout << std::setw(6) << length << std::fixed << std::setprecision(2) << std::setw(15) << best[0] * 1e3
+                  << std::setw(10) << best[1] * 1e3 << std::setw(14) << best[2] * 1e3 << std::setw(13) << best[3] * 1e3
+                  << std::setw(13) << best[4] * 1e3 << std::setw(12) << best[5] * 1e3 << std::endl;
+    }
+    return 0;
+}
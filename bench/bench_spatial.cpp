@@ -0,0 +1,92 @@
+//
+//  bench_spatial.cpp
+//  Matrix
+//
+/*
+ Compares SpatialIndex radius and nearest queries with a linear scan over every point, and times
+ incremental moves, for a growing number of points spread over a square board.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -I. bench/bench_spatial.cpp Auxiliaries.cpp SpatialIndex.cpp -o bench_spatial
+ run with:
+ ./bench_spatial [largest number of points, default 1000000]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "SpatialIndex.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int largest = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    const int queries = 200;
+    const int radius = 20;
+    const int k = 10;
+
+    std::cout << "points   scan radius(ms)  index radius(ms)  index nearest(ms)  move(us)" << std::endl;
+    for (int n = 10000; n <= largest; n *= 10)
+    {
+        int side = (int)std::sqrt((double)n) * 4;
+        std::vector<mtm::GridPoint> points;
+        mtm::SpatialIndex index(radius);
+        for (int id = 0; id < n; id++)
+        {
+            points.push_back(mtm::GridPoint(std::rand() % side, std::rand() % side));
+            index.insert(id, points.back());
+        }
+        std::vector<mtm::GridPoint> centers;
+        for (int q = 0; q < queries; q++)
+        {
+            centers.push_back(mtm::GridPoint(std::rand() % side, std::rand() % side));
+        }
+
+        std::size_t found = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++)
+        {
+            for (int id = 0; id < n; id++)
+            {
+                found += mtm::GridPoint::distance(points[id], centers[q]) <= radius;
+            }
+        }
+        double scan = seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++)
+        {
+            found += index.within(centers[q], radius).size();
+        }
+        double within = seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++)
+        {
+            found += index.nearest(centers[q], k).size();
+        }
+        double nearest = seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int id = 0; id < n; id++)
+        {
+            mtm::GridPoint& point = points[id];
+            point = mtm::GridPoint(point.row + std::rand() % 3 - 1, point.col + std::rand() % 3 - 1);
+            index.move(id, point);
+        }
+        double move = seconds(start);
+
+        std::cout << std::setw(7) << n << std::fixed << std::setprecision(3)
+                  << std::setw(17) << scan * 1000 / queries << std::setw(18) << within * 1000 / queries
+                  << std::setw(19) << nearest * 1000 / queries << std::setw(10) << move * 1e6 / n
+                  << (found == 0 ? " " : "") << std::endl;
+    }
+    return 0;
+}
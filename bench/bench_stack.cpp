@@ -0,0 +1,75 @@
+//
+//  bench_stack.cpp
+//  Matrix
+//
+/*
+ Measures hstack, vstack and tile on square pieces in every Layout, against filling a preconstructed
+ matrix element by element through operator().
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O3 -march=native -DNDEBUG -pthread -I. bench/bench_stack.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp ThreadPool.cpp -o bench_stack
+ run with:
+ ./bench_stack [side, default 2048] [repetitions, default 3]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "Matrix.h"
+
+static double seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    int side = (argc > 1) ? std::atoi(argv[1]) : 2048;
+    int repetitions = (argc > 2) ? std::atoi(argv[2]) : 3;
+    const char* layouts[] = { "ROW_MAJOR", "COLUMN_MAJOR", "TILED" };
+    std::cout << "side: " << side << std::endl;
+    std::cout << "layout        loop(ms)  hstack(ms)  hstack par(ms)  vstack(ms)  tile 2x2(ms)" << std::endl;
+    for (int l = 0; l < 3; l++)
+    {
+        mtm::Layout layout = (mtm::Layout)l;
+        mtm::Matrix<float> a(mtm::Dimensions(side, side), 1.0f, mtm::DEEP_COPY, layout);
+        mtm::Matrix<float> b(mtm::Dimensions(side, side), 2.0f, mtm::DEEP_COPY, layout);
+        double best[5] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+        for (int r = 0; r < repetitions; r++)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            mtm::Matrix<float> manual(mtm::Dimensions(side, 2 * side), 0.0f, mtm::DEEP_COPY, layout);
+            for (int i = 0; i < side; i++)
+            {
+                for (int j = 0; j < side; j++)
+                {
+                    manual(i, j) = a(i, j);
+                    manual(i, side + j) = b(i, j);
+                }
+            }
+            best[0] = std::min(best[0], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<float> horizontal = hstack(a, b);
+            best[1] = std::min(best[1], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<float> parallel = hstack(a, b, mtm::PARALLEL);
+            best[2] = std::min(best[2], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<float> vertical = vstack(a, b);
+            best[3] = std::min(best[3], seconds(start));
+            start = std::chrono::steady_clock::now();
+            mtm::Matrix<float> tiled = tile(a, 2, 2, mtm::PARALLEL);
+            best[4] = std::min(best[4], seconds(start));
+            if (!all(horizontal - manual == 0.0f) || !all(parallel - manual == 0.0f))
+            {
+                std::cout << "hstack differs from the loop" << std::endl;
+                return 1;
+            }
+        }
+        std::cout << std::left << std::setw(12) << layouts[l] << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(10) << best[0] * 1e3 << std::setw(12) << best[1] * 1e3 << std::setw(16) << best[2] * 1e3
+                  << std::setw(12) << best[3] * 1e3 << std::setw(14) << best[4] * 1e3 << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+//  check_dispatch.cpp
+//  Matrix
+//
+/*
+ Runs the dispatched kernels of CpuDispatch.h through the Matrix operations using them (sums,
+ comparisons, any / all, transposes, layout changes, float, double and int8 products) under every
+ instruction set the processor supports, and checks that every variant gives the bytes of the generic
+ one. Sizes are odd so the vector loops end with tails. Exits with 1 on a difference.
+
+ compile with (from the repository root):
+ g++ -std=c++11 -O2 -pthread -I. bench/check_dispatch.cpp Auxiliaries.cpp CpuDispatch.cpp MatrixMemory.cpp Quantized.cpp ThreadPool.cpp -o check_dispatch
+ run with:
+ ./check_dispatch
+*/
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CpuDispatch.h"
+#include "MatrixMultiply.h"
+#include "Quantized.h"
+
+typedef std::vector<std::pair<std::string, std::string> > Results;
+
+template <typename T>
+static void record(Results &results, const std::string &name, const mtm::Matrix<T> &mat)
+{
+    std::size_t size = (std::size_t)mat.height() * mat.width();
+    std::unique_ptr<T[]> rows(new T[size]);
+    mat.copyTo(rows.get());
+    std::string bytes(reinterpret_cast<const char*>(rows.get()), size * sizeof(T));
+    results.push_back(std::make_pair(name, bytes));
+}
+
+static void record(Results &results, const std::string &name, bool value)
+{
+    results.push_back(std::make_pair(name, std::string(1, value ? '1' : '0')));
+}
+
+//values in [-range, range], with some zeros, and NaN for the floating types when special is set.
+template <typename T>
+static mtm::Matrix<T> randomMatrix(int rows, int cols, mtm::Layout layout, int range, bool special)
+{
+    mtm::Matrix<T> mat(mtm::Dimensions(rows, cols), T(), mtm::DEEP_COPY, layout);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            int value = std::rand() % (2 * range + 1) - range;
+            mat(i, j) = (T)value / (std::numeric_limits<T>::is_integer ? 1 : 7);
+            if (special && std::numeric_limits<T>::has_quiet_NaN && std::rand() % 17 == 0)
+            {
+                mat(i, j) = std::numeric_limits<T>::quiet_NaN();
+            }
+        }
+    }
+    return mat;
+}
+
+template <typename T>
+static void elementwise(Results &results, const std::string &type, mtm::Layout layout)
+{
+    const int shapes[][2] = { { 1, 1 }, { 3, 5 }, { 37, 29 }, { 64, 67 }, { 129, 33 } };
+    for (int s = 0; s < 5; s++)
+    {
+        std::string name = type + " " + std::to_string(shapes[s][0]) + "x" + std::to_string(shapes[s][1]) +
+                           " layout " + std::to_string((int)layout);
+        mtm::Matrix<T> a = randomMatrix<T>(shapes[s][0], shapes[s][1], layout, 5, true);
+        mtm::Matrix<T> b = randomMatrix<T>(shapes[s][0], shapes[s][1], layout, 5, false);
+        record(results, name + " a + b", a + b);
+        const T value = (T)1;
+        record(results, name + " <", a < value);
+        record(results, name + " >", a > value);
+        record(results, name + " <=", a <= value);
+        record(results, name + " >=", a >= value);
+        record(results, name + " ==", a == value);
+        record(results, name + " !=", a != value);
+        mtm::Matrix<bool> mask = b < (T)0;
+        record(results, name + " any", any(b));
+        record(results, name + " all", all(b));
+        record(results, name + " any mask", any(mask));
+        record(results, name + " all mask", all(b != (T)100));
+        record(results, name + " transpose", b.transpose());
+        record(results, name + " to column major", b.toLayout(mtm::COLUMN_MAJOR));
+        record(results, name + " to row major", b.toLayout(mtm::COLUMN_MAJOR).toLayout(mtm::ROW_MAJOR));
+    }
+}
+
+template <typename T>
+static void products(Results &results, const std::string &type)
+{
+    const int shapes[][3] = { { 1, 1, 1 }, { 5, 7, 3 }, { 67, 45, 83 }, { 130, 300, 70 } };
+    for (int s = 0; s < 4; s++)
+    {
+        mtm::Matrix<T> a = randomMatrix<T>(shapes[s][0], shapes[s][1], mtm::ROW_MAJOR, 100, false);
+        mtm::Matrix<T> b = randomMatrix<T>(shapes[s][1], shapes[s][2], mtm::TILED, 100, false);
+        record(results, type + " product " + std::to_string(s), multiply(a, b));
+    }
+    mtm::Matrix<T> a = randomMatrix<T>(300, 300, mtm::ROW_MAJOR, 100, false);
+    mtm::Matrix<T> b = randomMatrix<T>(300, 300, mtm::ROW_MAJOR, 100, false);
+    record(results, type + " strassen", multiply(a, b, mtm::STRASSEN));
+}
+
+static Results runAll()
+{
+    std::srand(12345);
+    Results results;
+    const mtm::Layout layouts[] = { mtm::ROW_MAJOR, mtm::COLUMN_MAJOR, mtm::TILED };
+    for (int l = 0; l < 3; l++)
+    {
+        elementwise<float>(results, "float", layouts[l]);
+        elementwise<double>(results, "double", layouts[l]);
+        elementwise<int>(results, "int", layouts[l]);
+    }
+    products<float>(results, "float");
+    products<double>(results, "double");
+
+    const int shapes[][3] = { { 1, 1, 1 }, { 3, 33, 5 }, { 17, 64, 9 }, { 40, 97, 130 }, { 8, 1000, 7 } };
+    for (int s = 0; s < 5; s++)
+    {
+        mtm::Matrix<std::int8_t> a(mtm::Dimensions(shapes[s][0], shapes[s][1]), 0);
+        mtm::Matrix<std::int8_t> b(mtm::Dimensions(shapes[s][1], shapes[s][2]), 0);
+        for (int i = 0; i < a.height(); i++)
+        {
+            for (int j = 0; j < a.width(); j++)
+            {
+                a(i, j) = (std::int8_t)(std::rand() % 256 - 128);
+            }
+        }
+        for (int i = 0; i < b.height(); i++)
+        {
+            for (int j = 0; j < b.width(); j++)
+            {
+                b(i, j) = (std::int8_t)(std::rand() % 256 - 128);
+            }
+        }
+        std::string name = "int8 product " + std::to_string(s);
+        record(results, name, mtm::multiplyInt8(a, b));
+        record(results, name + " reference", mtm::multiplyInt8Reference(a, b));
+    }
+    return results;
+}
+
+int main()
+{
+    std::vector<mtm::InstructionSet> variants = mtm::supportedInstructionSets();
+    std::cout << "detected: " << mtm::instructionSetName(mtm::detectedInstructionSet()) << std::endl;
+    mtm::setInstructionSet(mtm::GENERIC_ISA);
+    Results expected = runAll();
+    bool identical = true;
+    for (std::size_t v = 0; v < variants.size(); v++)
+    {
+        mtm::setInstructionSet(variants[v]);
+        Results results = runAll();
+        int differences = 0;
+        for (std::size_t r = 0; r < results.size(); r++)
+        {
+            if (results[r].second != expected[r].second)
+            {
+                if (differences++ < 5)
+                {
+                    std::cout << "  " << mtm::instructionSetName(variants[v]) << " differs: " << results[r].first
+                              << std::endl;
+                }
+            }
+        }
+        std::cout << mtm::instructionSetName(variants[v]) << ": " << results.size() << " results, "
+                  << (differences == 0 ? "identical" : "DIFFERENT") << std::endl;
+        identical = identical && differences == 0;
+    }
+    int reference_checks = 0;
+    for (std::size_t r = 0; r + 1 < expected.size(); r++)
+    {
+        if (expected[r].first.find("int8 product") == 0 && expected[r + 1].first == expected[r].first + " reference")
+        {
+            identical = identical && expected[r].second == expected[r + 1].second;
+            reference_checks++;
+        }
+    }
+    std::cout << "int8 products equal to the reference loop: " << reference_checks << " checked" << std::endl;
+    return identical ? 0 : 1;
+}
@@ -1,6 +1,28 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
+#include <vector>
+#include "Compressed.h"
+#include "GridBoard.h"
+#include "HalfFloat.h"
+#include "InternedString.h"
 #include "Matrix.h"
+#include "MatrixConvolve.h"
+#include "MatrixDecompose.h"
+#include "MatrixGraph.h"
+#include "MatrixMultiply.h"
+#include "MatrixReduce.h"
+#include "MatrixSort.h"
+#include "Quantized.h"
+#include "SpatialIndex.h"
+#include "SummedArea.h"
+#include "TaskGraph.h"
 
 class Square { 
     public: 
@@ -9,6 +31,180 @@ class Square {
     } 
 }; 
 
+class Max { 
+    public: 
+        int operator()(int val1, int val2){ 
+          return val1 > val2 ? val1 : val2; 
+    } 
+}; 
+
+//Compressed<T> against the matrix it encodes. palette holds two close values, then the smallest and the
+//largest value of T: the tiles get a constant, runs, packed codes and (range permitting) dense elements.
+template <typename T>
+void testCompressed(const char* name, const T palette[4], std::mt19937 &random)
+{
+    mtm::Matrix<T> mat(mtm::Dimensions(70,45),palette[0]);
+    mtm::Matrix<T> other(mtm::Dimensions(70,45),palette[0]);
+    for (int i = 0; i < 70; i++)
+    {
+        for (int j = 0; j < 45; j++)
+        {
+            if (i < 32)
+            {
+                mat(i,j) = (j < 32) ? palette[0] : palette[(i / 4) % 2];
+            }
+            else
+            {
+                mat(i,j) = palette[random() % ((i < 64 && j < 32) ? 2 : 4)];
+            }
+            other(i,j) = palette[random() % 4];
+        }
+    }
+    mtm::Compressed<T> compressed(mat);
+    const mtm::Compressed<T> &view = compressed;
+    mtm::Compressed<T> second(other, mtm::PARALLEL);
+    mtm::Matrix<T> back = compressed.decompress(mtm::PARALLEL);
+    bool round_trip = true, mapped = true, zipped = true;
+    typename mtm::Compressed<T>::Sum total = 0;
+    T low = mat(0,0), high = mat(0,0);
+    bool any_set = false, all_set = true;
+    mtm::Compressed<bool> is_first = view.map([=](T x) { return x == palette[0]; }, mtm::PARALLEL);
+    mtm::Compressed<int> as_int = view.map([](T x) { return (int)(x % 3); });
+    mtm::Compressed<bool> less = mtm::zip(compressed, second, [](T x, T y) { return x < y; });
+    for (int i = 0; i < 70; i++)
+    {
+        for (int j = 0; j < 45; j++)
+        {
+            T x = mat(i,j);
+            round_trip = round_trip && back(i,j) == x && view(i,j) == x;
+            mapped = mapped && is_first(i,j) == (x == palette[0]) && as_int(i,j) == (int)(x % 3);
+            zipped = zipped && less(i,j) == (x < other(i,j));
+            total += (typename mtm::Compressed<T>::Sum)x;
+            low = std::min(low, x);
+            high = std::max(high, x);
+            any_set = any_set || x != T();
+            all_set = all_set && x != T();
+        }
+    }
+    bool reduced = compressed.sum() == total && compressed.sum(mtm::PARALLEL) == total &&
+        compressed.minimum() == low && compressed.maximum(mtm::PARALLEL) == high &&
+        mtm::any(compressed) == any_set && mtm::all(compressed) == all_set;
+    mtm::Compressed<T> constant(mtm::Matrix<T>(mtm::Dimensions(40,40),palette[3]));
+    mtm::Compressed<T> zeros(mtm::Matrix<T>(mtm::Dimensions(40,40),T()));
+    reduced = reduced && mtm::any(constant) == (palette[3] != T()) && mtm::all(constant) == (palette[3] != T()) &&
+        !mtm::any(zeros) && !mtm::all(zeros);
+    compressed(5,7) = palette[3];
+    mtm::TileEncoding written = view.encoding(5,7);
+    bool rewritten = view(5,7) == palette[3] && view(5,8) == palette[0] && view.encoding(40,0) == mtm::PACKED_TILE;
+    compressed.recompress(mtm::PARALLEL);
+    mtm::TileEncoding recompressed = view.encoding(5,7);
+    rewritten = rewritten && view(5,7) == palette[3] && view(31,31) == palette[0];
+    compressed(5,7) = palette[0];
+    compressed.recompress();
+    rewritten = rewritten && view.encoding(5,7) == mtm::CONSTANT_TILE && compressed.decompress()(5,7) == palette[0];
+    std::cout<<"compressed "<<name<<" "<<view.encoding(0,0)<<view.encoding(0,40)<<view.encoding(40,0)<<
+        view.encoding(40,40)<<" "<<round_trip<<" "<<reduced<<" "<<mapped<<" "<<zipped<<" "<<written<<" "<<
+        recompressed<<" "<<rewritten<<std::endl;
+}
+
+//line index of mat along axis (a row for EACH_ROW, a column for EACH_COLUMN), for the brute force checks.
+template <typename T>
+std::vector<T> lineOf(const mtm::Matrix<T> &mat, mtm::SortAxis axis, int index)
+{
+    std::vector<T> line;
+    int length = (axis == mtm::EACH_ROW) ? mat.width() : mat.height();
+    for (int k = 0; k < length; k++)
+    {
+        line.push_back((axis == mtm::EACH_ROW) ? mat(index,k) : mat(k,index));
+    }
+    return line;
+}
+
+//sort, argsort, partialSort, topK, argTopK and unique of mat on both axes and in both orders, against
+//std::stable_sort of every line.
+template <typename T>
+void testSort(const char* name, const mtm::Matrix<T> &mat)
+{
+    bool sorted = true, ranked = true, partial = true, top = true, distinct = true;
+    for (int a = 0; a < 2; a++)
+    {
+        mtm::SortAxis axis = a ? mtm::EACH_COLUMN : mtm::EACH_ROW;
+        int length = a ? mat.height() : mat.width();
+        int count = a ? mat.width() : mat.height();
+        int k = std::min(3, length);
+        for (int o = 0; o < 2; o++)
+        {
+            mtm::SortOrder order = o ? mtm::DESCENDING : mtm::ASCENDING;
+            mtm::Execution execution = (a == o) ? mtm::SEQUENTIAL : mtm::PARALLEL;
+            mtm::Matrix<T> result = mat;
+            mtm::sort(result, axis, order, execution);
+            mtm::Matrix<int> indices = mtm::argsort(mat, axis, order, execution);
+            mtm::Matrix<T> partly = mat;
+            mtm::partialSort(partly, k, axis, order, execution);
+            for (int i = 0; i < count; i++)
+            {
+                std::vector<T> line = lineOf(mat, axis, i);
+                std::vector<int> index;
+                for (int j = 0; j < length; j++)
+                {
+                    index.push_back(j);
+                }
+                std::stable_sort(index.begin(), index.end(), [&](int x, int y)
+                {
+                    return o ? line[y] < line[x] : line[x] < line[y];
+                });
+                std::vector<T> result_line = lineOf(result, axis, i), partly_line = lineOf(partly, axis, i);
+                std::vector<int> indices_line = lineOf(indices, axis, i);
+                for (int j = 0; j < length; j++)
+                {
+                    sorted = sorted && result_line[j] == line[index[j]];
+                    ranked = ranked && indices_line[j] == index[j];
+                    partial = partial && (j >= k || partly_line[j] == line[index[j]]);
+                }
+            }
+        }
+        mtm::Matrix<T> largest = mtm::topK(mat, k, axis, a ? mtm::PARALLEL : mtm::SEQUENTIAL);
+        mtm::Matrix<int> largest_at = mtm::argTopK(mat, k, axis);
+        mtm::Matrix<T> deduplicated = mat;
+        std::vector<int> counts = mtm::unique(deduplicated, axis, a ? mtm::SEQUENTIAL : mtm::PARALLEL);
+        top = top && (a ? largest.height() : largest.width()) == k;
+        distinct = distinct && (int)counts.size() == count;
+        for (int i = 0; i < count; i++)
+        {
+            std::vector<T> line = lineOf(mat, axis, i);
+            std::vector<int> index;
+            for (int j = 0; j < length; j++)
+            {
+                index.push_back(j);
+            }
+            std::stable_sort(index.begin(), index.end(), [&](int x, int y) { return line[y] < line[x]; });
+            std::vector<T> largest_line = lineOf(largest, axis, i);
+            std::vector<int> largest_at_line = lineOf(largest_at, axis, i);
+            for (int j = 0; j < k; j++)
+            {
+                top = top && largest_line[j] == line[index[j]] && largest_at_line[j] == index[j];
+            }
+            std::vector<T> ascending = line, kept, repeated;
+            std::sort(ascending.begin(), ascending.end());
+            for (int j = 0; j < length; j++)
+            {
+                if (j == 0 || ascending[j - 1] < ascending[j])
+                {
+                    kept.push_back(ascending[j]);
+                }
+                else
+                {
+                    repeated.push_back(ascending[j]);
+                }
+            }
+            kept.insert(kept.end(), repeated.begin(), repeated.end());
+            distinct = distinct && counts[i] == (int)(length - repeated.size()) &&
+                lineOf(deduplicated, axis, i) == kept;
+        }
+    }
+    std::cout<<"sort "<<name<<" "<<mat.height()<<"x"<<mat.width()<<" "<<sorted<<ranked<<partial<<top<<distinct<<std::endl;
+}
+
 int main(){
     mtm::Dimensions dim_1(2,3);
     mtm::Dimensions dim_2(-2,3);
@@ -59,4 +255,1716 @@ int main(){
     } catch(mtm::Matrix<int>::AccessIllegalElement& e){
         std::cout<<e.what()<<std::endl;
     }
+    try{
+        mtm::Matrix<int> mat_1(dim_1,2);
+        mtm::Matrix<int> mat_2 = mtm::Matrix<int>::Diagonal(2,5);
+        mat_1(1,2) = 7;
+        std::cout<<mtm::zip(mat_1,-mat_1,Max());
+        mtm::combine(mat_1,mat_1,mat_1,[](int a, int b, int c){ return a*b-c; });
+        std::cout<<mat_1;
+        mtm::zip(mat_1,mat_2,Max());
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> original(dim_1,1,mtm::COPY_ON_WRITE);
+        mtm::Matrix<int> by_element(original);
+        mtm::Matrix<int> by_iterator(original);
+        mtm::Matrix<int> by_add(original);
+        by_element(0,1) = 5;
+        *by_iterator.begin() = 6;
+        by_add += 2;
+        std::cout<<original<<by_element<<by_iterator<<by_add;
+        mtm::Matrix<int> shared(original);
+        const mtm::Matrix<int> &view_1 = original, &view_2 = shared;
+        std::cout<<(view_1.data() == view_2.data())<<" ";
+        shared.setSharing(mtm::DEEP_COPY);
+        std::cout<<(view_1.data() == view_2.data())<<std::endl;
+        shared(1,2) = 9;
+        std::cout<<original(1,2)<<" "<<shared(1,2)<<std::endl;
+        original += mtm::Matrix<int>(dim_3);
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const char* layout_names[] = {"ROW_MAJOR", "COLUMN_MAJOR", "TILED"};
+        for (int l = 0; l < 3; l++)
+        {
+            mtm::Layout layout = (mtm::Layout)l;
+            mtm::Matrix<int> mat_1(mtm::Dimensions(33,70),0,mtm::DEEP_COPY,layout);
+            for (int i = 0; i < 33; i++)
+            {
+                for (int j = 0; j < 70; j++)
+                {
+                    mat_1(i,j) = i*100+j;
+                }
+            }
+            const mtm::Matrix<int> mat_2 = mat_1.transpose();
+            bool transposed = (mat_2.height() == 70 && mat_2.width() == 33);
+            for (int i = 0; i < 33; i++)
+            {
+                for (int j = 0; j < 70; j++)
+                {
+                    transposed = transposed && mat_2(j,i) == mat_1(i,j);
+                }
+            }
+            std::cout<<layout_names[l]<<" "<<mat_1(32,69)<<" "<<mat_1(31,33)<<" transpose "<<
+                layout_names[mat_2.layout()]<<" "<<transposed<<" iterator";
+            int visited = 0;
+            for (mtm::Matrix<int>::iterator it = mat_1.begin(); it != mat_1.end(); ++it, ++visited)
+            {
+                if (visited < 3 || visited == 2309)
+                {
+                    std::cout<<" "<<*it;
+                }
+            }
+            std::cout<<" ("<<visited<<") round trips";
+            for (int other = 0; other < 3; other++)
+            {
+                const mtm::Matrix<int> converted = mat_1.toLayout((mtm::Layout)other);
+                const mtm::Matrix<int> back = converted.toLayout(layout);
+                std::cout<<" "<<(converted.layout() == other && mtm::all(mtm::zip(mat_1,converted,
+                    [](int a, int b) { return int(a == b); })) && mtm::all(mtm::zip(mat_1,back,
+                    [](int a, int b) { return int(a == b); })));
+            }
+            std::cout<<std::endl;
+        }
+        mtm::Matrix<int>(dim_1,0,mtm::DEEP_COPY,mtm::TILED)(2,0);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const int sizes[][3] = {{7,5,3}, {129,129,129}, {200,200,200}, {255,255,255}};
+        for (int s = 0; s < 4; s++)
+        {
+            int n = sizes[s][0], m = sizes[s][1], p = sizes[s][2];
+            mtm::Matrix<int> mat_1(mtm::Dimensions(n,m)), mat_2(mtm::Dimensions(m,p));
+            for (int i = 0; i < n; i++)
+            {
+                for (int k = 0; k < m; k++)
+                {
+                    mat_1(i,k) = (i*7+k*3)%11-5;
+                }
+            }
+            for (int k = 0; k < m; k++)
+            {
+                for (int j = 0; j < p; j++)
+                {
+                    mat_2(k,j) = (k*5+j*2)%13-6;
+                }
+            }
+            std::cout<<"multiply "<<n<<"x"<<m<<"x"<<p;
+            for (int run = 0; run < 4; run++)
+            {
+                const mtm::Matrix<int> product = mtm::multiply(mat_1, mat_2,
+                    run < 2 ? mtm::CONVENTIONAL : mtm::STRASSEN, run % 2 ? mtm::PARALLEL : mtm::SEQUENTIAL);
+                bool equal = (product.height() == n && product.width() == p);
+                for (int i = 0; i < n; i++)
+                {
+                    for (int j = 0; j < p; j++)
+                    {
+                        int expected = 0;
+                        for (int k = 0; k < m; k++)
+                        {
+                            expected += mat_1(i,k)*mat_2(k,j);
+                        }
+                        equal = equal && product(i,j) == expected;
+                    }
+                }
+                std::cout<<" "<<equal;
+            }
+            std::cout<<std::endl;
+        }
+        mtm::multiply(mtm::Matrix<int>(dim_1), mtm::Matrix<int>(dim_1), mtm::STRASSEN);
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        for (int e = 0; e < 2; e++)
+        {
+            mtm::Execution execution = (mtm::Execution)e;
+            mtm::ThreadPool pool(execution == mtm::SEQUENTIAL ? 1 : 4);
+            mtm::TaskGraph graph(pool);
+            std::mutex log_mutex;
+            std::vector<char> log;
+            auto step = [&](char name)
+            {
+                std::lock_guard<std::mutex> lock(log_mutex);
+                log.push_back(name);
+            };
+            std::cout<<"task graph "<<(e ? "PARALLEL" : "SEQUENTIAL");
+            for (int round = 0; round < 2; round++)
+            {
+                log.clear();
+                mtm::Task< mtm::Matrix<int> > a = graph.value(mtm::Matrix<int>(dim_1,round+1));
+                mtm::Task< mtm::Matrix<int> > b = graph.run([&](const mtm::Matrix<int> &m)
+                    { step('b'); return mtm::zip(m,m,[](int x, int y) { return x+y; },execution); }, a);
+                mtm::Task< mtm::Matrix<int> > c = graph.run([&](const mtm::Matrix<int> &m)
+                    { step('c'); return -m; }, a);
+                mtm::Task< mtm::Matrix<int> > d = graph.run([&](const mtm::Matrix<int> &x, const mtm::Matrix<int> &y)
+                    { step('d'); return mtm::zip(x,y,[](int u, int v) { return u*v; },execution); }, b, c);
+                graph.wait();
+                std::vector<char>::iterator last = std::find(log.begin(), log.end(), 'd');
+                bool ordered = log.size() == 3 && last == log.end()-1 && b.ready() && c.ready();
+                std::cout<<" "<<ordered<<" "<<d.get()(1,2);
+            }
+            std::cout<<" "<<graph.size()<<std::endl;
+        }
+        mtm::TaskGraph graph;
+        mtm::Task< mtm::Matrix<int> > a = graph.value(mtm::Matrix<int>(dim_1,1));
+        mtm::Task< mtm::Matrix<int> > b = graph.run([&](const mtm::Matrix<int> &m)
+            { return mtm::zip(m,mtm::Matrix<int>(dim_3),[](int x, int y) { return x+y; }); }, a);
+        mtm::Task< mtm::Matrix<int> > c = graph.run([](const mtm::Matrix<int> &m) { return m+1; }, a);
+        mtm::Task< mtm::Matrix<int> > d = graph.run([](const mtm::Matrix<int> &x, const mtm::Matrix<int> &y)
+            { return x+y; }, b, c);
+        std::cout<<c.get()(0,0)<<std::endl;
+        d.get();
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const int column[] = {3,5,2}, row[] = {4,1,7,2};
+        mtm::Matrix<int> kernel(mtm::Dimensions(3,4));
+        for (int a = 0; a < 3; a++)
+        {
+            for (int b = 0; b < 4; b++)
+            {
+                kernel(a,b) = column[a]*row[b];
+            }
+        }
+        const int scales[] = {1, 1000000};
+        for (int scale : scales)
+        {
+            mtm::Matrix<int> image(mtm::Dimensions(9,13));
+            for (int i = 0; i < 9; i++)
+            {
+                for (int j = 0; j < 13; j++)
+                {
+                    image(i,j) = ((i*13+j*7)%17-8)*scale;
+                }
+            }
+            const mtm::Matrix<int>& source = image;
+            const char* names[] = {"BORDER_ZERO", "BORDER_CLAMP", "BORDER_WRAP"};
+            for (int border = 0; border < 3; border++)
+            {
+                mtm::BorderPolicy policy = (mtm::BorderPolicy)border;
+                mtm::Matrix<int> expected(mtm::Dimensions(9,13));
+                for (int i = 0; i < 9; i++)
+                {
+                    for (int j = 0; j < 13; j++)
+                    {
+                        long long total = 0;
+                        for (int a = 0; a < 3; a++)
+                        {
+                            for (int b = 0; b < 4; b++)
+                            {
+                                int y = i+a-1, x = j+b-2;
+                                bool inside = y >= 0 && y < 9 && x >= 0 && x < 13;
+                                if (policy == mtm::BORDER_CLAMP)
+                                {
+                                    y = std::min(std::max(y,0),8);
+                                    x = std::min(std::max(x,0),12);
+                                }
+                                else if (policy == mtm::BORDER_WRAP)
+                                {
+                                    y = (y+9)%9;
+                                    x = (x+13)%13;
+                                }
+                                else if (!inside)
+                                {
+                                    continue;
+                                }
+                                total += (long long)column[a]*row[b]*source(y,x);
+                            }
+                        }
+                        expected(i,j) = (int)total;
+                    }
+                }
+                std::cout<<"correlate "<<names[border];
+                for (int algorithm = mtm::DIRECT; algorithm <= mtm::IM2COL; algorithm++)
+                {
+                    for (int e = 0; e < 2; e++)
+                    {
+                        const mtm::Matrix<int> result = mtm::correlate(image,kernel,policy,
+                            (mtm::ConvolutionAlgorithm)algorithm,(mtm::Execution)e);
+                        bool equal = true;
+                        for (int i = 0; i < 9; i++)
+                        {
+                            for (int j = 0; j < 13; j++)
+                            {
+                                equal = equal && result(i,j) == expected(i,j);
+                            }
+                        }
+                        std::cout<<" "<<equal;
+                    }
+                }
+                std::cout<<" "<<expected(4,6)<<std::endl;
+            }
+        }
+        std::vector< mtm::Matrix<int> > bank;
+        bank.push_back(mtm::Matrix<int>(mtm::Dimensions(3,3),1));
+        bank.push_back(mtm::Matrix<int>(dim_1,1));
+        mtm::correlate(mtm::Matrix<int>(dim_3),bank);
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<char> board(dim_1,'.');
+        board(0,1) = 'X';
+        board(1,2) = 'O';
+        std::string buffer;
+        mtm::formatGameBoard(buffer,board.data(),board.data()+board.size(),board.width());
+        std::cout<<buffer<<std::endl;
+        std::ostringstream printed;
+        mtm::printGameBoard(printed,board.data(),board.data()+board.size(),board.width());
+        std::cout<<(printed.str() == buffer)<<" "<<buffer.size()<<std::endl;
+        const char column[] = {'a','b'};
+        mtm::formatGameBoard(buffer,column,column+2,1);
+        std::cout<<buffer<<std::endl;
+        mtm::formatGameBoard(buffer,column,column,4);
+        std::cout<<buffer<<" "<<buffer.size()<<std::endl;
+        board(2,0) = 'X';
+    } catch(mtm::Matrix<char>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const int shapes[][2] = {{1,1},{1,9},{8,1},{7,11}};
+        for (const int* shape : shapes)
+        {
+            int height = shape[0], width = shape[1];
+            mtm::Matrix<int> mat(mtm::Dimensions(height,width));
+            std::vector<long long> values;
+            for (int i = 0; i < height; i++)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    mat(i,j) = (i*31+j*17)%23 < 3 ? 2000000000 : (i*31+j*17)%23-11;
+                    values.push_back(mat(i,j));
+                }
+            }
+            mtm::SummedAreaTable<int> table(mat);
+            mtm::SummedAreaTable<int> parallel_table(mat,mtm::PARALLEL);
+            mtm::FenwickTable<int> tree(mat);
+            auto brute = [&](int first_row, int first_col, int last_row, int last_col)
+            {
+                long long total = 0;
+                for (int i = first_row; i <= last_row; i++)
+                {
+                    for (int j = first_col; j <= last_col; j++)
+                    {
+                        total += values[i*width+j];
+                    }
+                }
+                return total;
+            };
+            auto matches = [&](bool fenwick_only)
+            {
+                bool equal = true;
+                for (int first_row = 0; first_row < height; first_row++)
+                for (int last_row = first_row; last_row < height; last_row++)
+                for (int first_col = 0; first_col < width; first_col++)
+                for (int last_col = first_col; last_col < width; last_col++)
+                {
+                    long long expected = brute(first_row,first_col,last_row,last_col);
+                    equal = equal && tree.sum(first_row,first_col,last_row,last_col) == expected;
+                    if (!fenwick_only)
+                    {
+                        equal = equal && table.sum(first_row,first_col,last_row,last_col) == expected &&
+                                parallel_table.sum(first_row,first_col,last_row,last_col) == expected;
+                    }
+                }
+                return equal;
+            };
+            std::cout<<"summed area "<<height<<"x"<<width<<" "<<matches(false);
+            for (int k = 0; k < 12; k++)
+            {
+                int i = (k*5)%height, j = (k*7)%width;
+                if (k%2 == 0)
+                {
+                    tree.add(i,j,k-6);
+                    values[i*width+j] += k-6;
+                }
+                else
+                {
+                    tree.set(i,j,-k*1000000000LL);
+                    values[i*width+j] = -k*1000000000LL;
+                }
+            }
+            std::cout<<" "<<matches(true)<<" "<<table.sum(0,0,height-1,width-1)<<" "<<
+                tree.sum(0,0,height-1,width-1)<<" "<<table.mean(0,0,0,0)<<std::endl;
+        }
+        mtm::FenwickTable<int> tree(mtm::Matrix<int>(dim_1,1));
+        std::cout<<tree.sum(1,2,1,2)<<std::endl;
+        tree.sum(1,2,1,1);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::SummedAreaTable<int> table(mtm::Matrix<int>(dim_1,1));
+        std::cout<<table.sum(0,0,1,2)<<std::endl;
+        table.sum(1,0,0,2);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const float one = 1.0f, ulp = std::ldexp(1.0f,-10), tiny = std::ldexp(1.0f,-24);
+        const float halves[] = {one+ulp/2, one+3*ulp/2, -(one+ulp/2), tiny, tiny/2, 3*tiny/2, tiny*1023,
+                                65504.0f, 65519.0f, 65520.0f, 1e6f, -1e6f, std::ldexp(1.0f,-14)};
+        std::cout<<std::hex;
+        for (float value : halves)
+        {
+            std::cout<<mtm::Half(value).bits()<<" ";
+        }
+        std::cout<<std::endl;
+        const float bulp = std::ldexp(1.0f,-7);
+        const float brains[] = {one+bulp/2, one+3*bulp/2, 3.4e38f, -3.4e38f, 1e-40f, std::ldexp(1.0f,-133)};
+        for (float value : brains)
+        {
+            std::cout<<mtm::BFloat16(value).bits()<<" ";
+        }
+        std::cout<<std::endl;
+        const float nan = std::nanf("");
+        std::cout<<mtm::Half(nan).bits()<<" "<<mtm::Half(mtm::Half::fromBits(0x7e01)).bits()<<" "<<
+            mtm::Half(mtm::Half::fromBits(0xfe01)).bits()<<" "<<mtm::BFloat16(nan).bits()<<" "<<
+            mtm::BFloat16(mtm::BFloat16::fromBits(0xffa1)).bits()<<std::dec<<std::endl;
+        std::cout<<std::isnan((float)mtm::Half(nan))<<" "<<std::isnan((float)mtm::BFloat16::fromBits(0x7f81))<<" "<<
+            (float)mtm::Half::fromBits(0x0001)<<" "<<(float)mtm::Half::fromBits(0x7c00)<<" "<<
+            (float)mtm::Half::fromBits(0xfc00)<<" "<<(float)mtm::Half(65504.0f)<<std::endl;
+        mtm::Matrix<float> floats(mtm::Dimensions(5,7));
+        for (int k = 0; k < 35; k++)
+        {
+            floats(k/7,k%7) = (k < 13) ? halves[k] : (k == 13 ? nan : -std::ldexp(float(k),k-30)-ulp/2);
+        }
+        const mtm::Matrix<mtm::Half> narrow = floats.cast<mtm::Half>();
+        const mtm::Matrix<mtm::BFloat16> brain = floats.cast<mtm::BFloat16>(mtm::PARALLEL);
+        const mtm::Matrix<float> wide = narrow.cast<float>();
+        bool rounded = true;
+        for (int k = 0; k < 35; k++)
+        {
+            const float value = floats(k/7,k%7);
+            rounded = rounded && narrow(k/7,k%7).bits() == mtm::Half(value).bits() &&
+                      brain(k/7,k%7).bits() == mtm::BFloat16(value).bits() &&
+                      (std::isnan(value) ? std::isnan(wide(k/7,k%7)) : wide(k/7,k%7) == (float)mtm::Half(value));
+        }
+        std::cout<<"cast "<<rounded<<std::endl;
+        const mtm::Matrix<mtm::Half> halfs(dim_1,mtm::Half(1.5f));
+        const mtm::Matrix<mtm::BFloat16> bfloats(dim_1,mtm::BFloat16(2.5f));
+        auto by_float = halfs+mtm::Matrix<float>(dim_1,1e-4f);
+        auto by_double = mtm::Matrix<double>(dim_1,1e-9)+halfs;
+        auto by_brain = halfs-bfloats;
+        auto by_scalar = bfloats+1e-3;
+        std::cout<<std::is_same<decltype(by_float),mtm::Matrix<float> >::value<<" "<<
+            std::is_same<decltype(by_double),mtm::Matrix<double> >::value<<" "<<
+            std::is_same<decltype(by_brain),mtm::Matrix<float> >::value<<" "<<
+            std::is_same<decltype(by_scalar),mtm::Matrix<double> >::value<<" "<<
+            std::is_same<decltype(halfs.cast<double>()),mtm::Matrix<double> >::value<<" "<<
+            (by_float(1,2) == 1.5f+1e-4f)<<" "<<(by_double(0,0) == 1.5+1e-9)<<" "<<by_brain(0,1)<<std::endl;
+        halfs+mtm::Matrix<float>(dim_3);
+    } catch(mtm::Matrix<mtm::Half>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        auto distance = [](const mtm::Matrix<double> &x, const mtm::Matrix<double> &y)
+        {
+            double total = 0;
+            for (int i = 0; i < x.height(); i++)
+            {
+                for (int j = 0; j < x.width(); j++)
+                {
+                    total += (x(i,j)-y(i,j))*(x(i,j)-y(i,j));
+                }
+            }
+            return std::sqrt(total);
+        };
+        auto norm = [&](const mtm::Matrix<double> &x)
+        {
+            return distance(x,mtm::Matrix<double>(mtm::Dimensions(x.height(),x.width()),0.0));
+        };
+        auto orthonormal = [&](const mtm::Matrix<double> &columns)
+        {
+            mtm::Matrix<double> identity = mtm::Matrix<double>::Diagonal(columns.width(),1.0);
+            return distance(mtm::multiply(columns.transpose(),columns),identity) < 1e-10;
+        };
+        auto scaled = [](const mtm::Matrix<double> &columns, const mtm::Matrix<double> &factors)
+        {
+            mtm::Matrix<double> result = columns;
+            for (int i = 0; i < result.height(); i++)
+            {
+                for (int j = 0; j < result.width(); j++)
+                {
+                    result(i,j) *= factors(j,0);
+                }
+            }
+            return result;
+        };
+        const int n = 13;
+        mtm::Matrix<double> a(mtm::Dimensions(n,n));
+        for (int i = 0; i < n; i++)
+        {
+            for (int j = 0; j <= i; j++)
+            {
+                a(i,j) = a(j,i) = 1.0/(1+i-j) + ((i*7+j*3)%5)*0.25 + (i == j ? i : 0);
+            }
+        }
+        const double scale = norm(a);
+        for (int e = 0; e < 2; e++)
+        {
+            mtm::SymmetricEigen<double> eigen(a,(mtm::Execution)e);
+            const mtm::Matrix<double> &values = eigen.values();
+            const mtm::Matrix<double> &vectors = eigen.vectors();
+            bool decreasing = true;
+            for (int i = 1; i < n; i++)
+            {
+                decreasing = decreasing && values(i-1,0) >= values(i,0);
+            }
+            double residual = distance(mtm::multiply(a,vectors),scaled(vectors,values));
+            mtm::Matrix<double> alone = mtm::SymmetricEigen<double>::eigenvalues(a,(mtm::Execution)e);
+            std::cout<<"eigen "<<(residual < 1e-10*scale)<<" "<<orthonormal(vectors)<<" "<<decreasing<<" "<<
+                (distance(alone,values) < 1e-10*scale)<<std::endl;
+        }
+        const int blocked[] = {65, 97};
+        for (int size = 0; size < 2; size++)
+        {
+            //Q D Q^T with Q the product of two Householder reflectors: a dense matrix of known spectrum, large
+            //enough for the tridiagonal reduction to take more than one panel of DECOMPOSE_BLOCK reflectors.
+            const int m = blocked[size];
+            mtm::Matrix<double> q = mtm::Matrix<double>::Diagonal(m,1.0);
+            for (int r = 0; r < 2; r++)
+            {
+                std::vector<double> v(m);
+                double length = 0;
+                for (int i = 0; i < m; i++)
+                {
+                    v[i] = ((i*(r ? 13 : 29)+r*5)%11)-5.0;
+                    length += v[i]*v[i];
+                }
+                mtm::Matrix<double> reflector = mtm::Matrix<double>::Diagonal(m,1.0);
+                for (int i = 0; i < m; i++)
+                {
+                    for (int j = 0; j < m; j++)
+                    {
+                        reflector(i,j) -= 2*v[i]*v[j]/length;
+                    }
+                }
+                q = mtm::multiply(q,reflector);
+            }
+            mtm::Matrix<double> spectrum(mtm::Dimensions(m,1),0.0);
+            std::vector<double> expected(m);
+            for (int i = 0; i < m; i++)
+            {
+                spectrum(i,0) = expected[i] = (i*37)%m - m/3.0;
+            }
+            std::sort(expected.begin(), expected.end(), [](double x, double y) { return y < x; });
+            mtm::Matrix<double> big = mtm::multiply(scaled(q,spectrum),q.transpose());
+            for (int i = 0; i < m; i++)
+            {
+                for (int j = 0; j < i; j++)
+                {
+                    big(i,j) = big(j,i);
+                }
+            }
+            const double big_scale = norm(big);
+            for (int e = 0; e < 2; e++)
+            {
+                mtm::SymmetricEigen<double> eigen(big,(mtm::Execution)e);
+                const mtm::Matrix<double> &values = eigen.values();
+                const mtm::Matrix<double> &vectors = eigen.vectors();
+                double spectrum_error = 0;
+                for (int i = 0; i < m; i++)
+                {
+                    spectrum_error = std::max(spectrum_error, std::abs(values(i,0)-expected[i]));
+                }
+                double residual = distance(mtm::multiply(big,vectors),scaled(vectors,values));
+                std::cout<<"eigen "<<m<<" "<<(residual < 1e-10*big_scale)<<" "<<orthonormal(vectors)<<" "<<
+                    (spectrum_error < 1e-10*big_scale)<<std::endl;
+            }
+        }
+        mtm::SymmetricEigen<double> top = mtm::SymmetricEigen<double>::dominant(a,3,1e-10);
+        double top_residual = distance(mtm::multiply(a,top.vectors()),scaled(top.vectors(),top.values()));
+        std::cout<<"dominant "<<(top_residual < 1e-8*scale)<<" "<<orthonormal(top.vectors())<<" "<<
+            (std::abs(top.values()(0,0)-mtm::SymmetricEigen<double>(a).values()(0,0)) < 1e-8*scale)<<std::endl;
+
+        mtm::Matrix<double> tall(mtm::Dimensions(17,9));
+        mtm::Matrix<double> low(mtm::Dimensions(17,9),0.0);
+        for (int i = 0; i < 17; i++)
+        {
+            for (int j = 0; j < 9; j++)
+            {
+                tall(i,j) = std::sin(i*1.3+j*0.7) + ((i+2*j)%4)*0.5;
+                for (int r = 1; r <= 3; r++)
+                {
+                    low(i,j) += std::cos(r*(i+1)*0.37)*std::sin(r*(j+1)*0.53)/r;
+                }
+            }
+        }
+        for (int e = 0; e < 2; e++)
+        {
+            mtm::TruncatedSVD<double> full(tall,9,10,2,(mtm::Execution)e);
+            mtm::TruncatedSVD<double> three(low,3,10,2,(mtm::Execution)e);
+            double full_error = distance(mtm::multiply(scaled(full.u(),full.singularValues()),full.v().transpose()),tall);
+            double low_error = distance(mtm::multiply(scaled(three.u(),three.singularValues()),three.v().transpose()),low);
+            std::cout<<"svd "<<(full_error < 1e-10*norm(tall))<<" "<<orthonormal(full.u())<<" "<<
+                orthonormal(full.v())<<" "<<(low_error < 1e-10*norm(low))<<" "<<orthonormal(three.u())<<
+                " "<<orthonormal(three.v())<<std::endl;
+        }
+        mtm::TruncatedSVD<double> wide(tall.transpose(),10);
+    } catch(mtm::TruncatedSVD<double>::IllegalRank& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<double> hilbert(mtm::Dimensions(6,6));
+        for (int i = 0; i < 6; i++)
+        {
+            for (int j = 0; j < 6; j++)
+            {
+                hilbert(i,j) = 1.0/(1+i+j);
+            }
+        }
+        std::cout<<mtm::SymmetricEigen<double>::dominant(hilbert,2).values().height()<<std::endl;
+        mtm::SymmetricEigen<double>::dominant(hilbert,2,1e-30,2);
+    } catch(mtm::SymmetricEigen<double>::NoConvergence& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::SymmetricEigen<double>::dominant(mtm::Matrix<double>::Diagonal(4,2.0),5);
+    } catch(mtm::SymmetricEigen<double>::IllegalRank& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::SymmetricEigen<double> eigen(mtm::Matrix<double>(dim_1,1.0));
+    } catch(mtm::Matrix<double>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const char* layout_names[] = {"ROW_MAJOR", "COLUMN_MAJOR", "TILED"};
+        for (int l = 0; l < 3; l++)
+        {
+            mtm::Layout layout = (mtm::Layout)l;
+            mtm::Matrix<int> mat(mtm::Dimensions(5,7),0,mtm::COPY_ON_WRITE,layout);
+            std::vector< std::vector<int> > model(5,std::vector<int>(7));
+            for (int i = 0; i < 5; i++)
+            {
+                for (int j = 0; j < 7; j++)
+                {
+                    mat(i,j) = model[i][j] = i*100+j;
+                }
+            }
+            const mtm::Matrix<int> shared = mat;
+            const std::vector< std::vector<int> > original = model;
+            auto same = [](const mtm::Matrix<int> &m, const std::vector< std::vector<int> > &rows)
+            {
+                bool equal = m.height() == (int)rows.size() && m.width() == (int)rows[0].size();
+                for (int i = 0; equal && i < m.height(); i++)
+                {
+                    for (int j = 0; j < m.width(); j++)
+                    {
+                        equal = equal && m(i,j) == rows[i][j];
+                    }
+                }
+                return equal;
+            };
+            std::cout<<"resize "<<layout_names[l];
+            mat.reserve(mtm::Dimensions(40,40));
+            std::cout<<" "<<(mat.capacity() >= 1600)<<" "<<same(mat,model);
+            for (int k = 0; k < 30; k++)
+            {
+                std::vector<int> row(model[0].size());
+                for (int j = 0; j < (int)row.size(); j++)
+                {
+                    row[j] = -k*100-j;
+                }
+                mat.appendRow(row);
+                model.push_back(row);
+            }
+            std::cout<<" "<<same(mat,model);
+            for (int k = 0; k < 30; k++)
+            {
+                std::vector<int> column(model.size());
+                for (int i = 0; i < (int)column.size(); i++)
+                {
+                    column[i] = 5000+k*100+i;
+                    model[i].push_back(column[i]);
+                }
+                mat.appendCol(column);
+            }
+            std::cout<<" "<<same(mat,model)<<" "<<mat.height()<<"x"<<mat.width();
+            mtm::Matrix<int> block(mtm::Dimensions(3,mat.width()),7);
+            mat.insertRows(4,block);
+            model.insert(model.begin()+4,3,std::vector<int>(model[0].size(),7));
+            mat.insertRows(mat.height(),block);
+            model.insert(model.end(),3,std::vector<int>(model[0].size(),7));
+            std::cout<<" "<<same(mat,model);
+            mat.eraseRows(0,2);
+            model.erase(model.begin(),model.begin()+2);
+            mat.eraseRows(30,6);
+            model.erase(model.begin()+30,model.begin()+36);
+            std::cout<<" "<<same(mat,model);
+            mat.resize(mtm::Dimensions(41,33),-1);
+            model.resize(41,std::vector<int>(33,-1));
+            for (std::vector<int> &row : model)
+            {
+                row.resize(33,-1);
+            }
+            std::cout<<" "<<same(mat,model);
+            mat.resize(mtm::Dimensions(3,2));
+            model.resize(3);
+            for (std::vector<int> &row : model)
+            {
+                row.resize(2);
+            }
+            mat.shrinkToFit();
+            std::cout<<" "<<same(mat,model)<<" "<<(mat.capacity() < 1600)<<" "<<same(shared,original)<<std::endl;
+        }
+        mtm::Matrix<int> mat(dim_1,1,mtm::COPY_ON_WRITE,mtm::TILED);
+        mtm::Matrix<int> copy = mat;
+        mat.appendCol(std::vector<int>(2,5));
+        std::cout<<mat.width()<<" "<<copy.width()<<" "<<mat(1,3)<<std::endl;
+        mat.appendRow(std::vector<int>(3,5));
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> mat(dim_1,1,mtm::DEEP_COPY,mtm::TILED);
+        mat.insertRows(0,mtm::Matrix<int>(dim_3));
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> mat(dim_3,1,mtm::COPY_ON_WRITE,mtm::COLUMN_MAJOR);
+        mat.eraseRows(2,2);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> mat(dim_3,1,mtm::COPY_ON_WRITE,mtm::TILED);
+        mat.insertRows(4,mtm::Matrix<int>(dim_3));
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> mat(dim_3,1);
+        mtm::Matrix<int> copy(mat);
+        mat.resize(mtm::Dimensions(4,0));
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> mat(dim_3,1,mtm::COPY_ON_WRITE);
+        mtm::Matrix<int> copy(mat);
+        try{
+            mat.eraseRows(0,3);
+        } catch(mtm::Matrix<int>::IllegalInitialization& e){
+            std::cout<<e.what()<<" "<<mat.height()<<" "<<copy.height()<<std::endl;
+        }
+        mat.reserve(dim_2);
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        auto filled = [](int height, int width, int tag, mtm::Layout layout)
+        {
+            mtm::Matrix<int> mat(mtm::Dimensions(height,width),0,mtm::DEEP_COPY,layout);
+            for (int i = 0; i < height; i++)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    mat(i,j) = tag*100000+i*100+j;
+                }
+            }
+            return mat;
+        };
+        const char* layout_names[] = {"ROW_MAJOR", "COLUMN_MAJOR", "TILED"};
+        for (int l = 0; l < 3; l++)
+        {
+            mtm::Layout layout = (mtm::Layout)l, other = (mtm::Layout)((l+1)%3);
+            const mtm::Matrix<int> a = filled(33,5,1,layout), b = filled(33,40,2,other), c = filled(33,1,3,layout);
+            const mtm::Matrix<int> d = filled(7,46,4,other), e = filled(2,2,5,layout);
+            const mtm::Matrix<int> base = filled(33,70,6,layout);
+            std::cout<<"stack "<<layout_names[l];
+            for (int x = 0; x < 2; x++)
+            {
+                mtm::Execution execution = (mtm::Execution)x;
+                const mtm::Matrix<int> wide = mtm::hstack(std::vector< mtm::Matrix<int> >{a,b,c},execution);
+                const mtm::Matrix<int> tall = mtm::vstack(wide,d,execution);
+                const mtm::Matrix<int> grid = mtm::block(std::vector< std::vector< mtm::Matrix<int> > >{{a,b,c},{d}},
+                                                         execution);
+                const mtm::Matrix<int> diagonal = mtm::blockDiagonal(std::vector< mtm::Matrix<int> >{a,e,d},-1,execution);
+                const mtm::Matrix<int> tiled = mtm::tile(base,4,4,execution);
+                const mtm::Matrix<int> repeated = mtm::repeat(base,3,5,execution);
+                bool stacked = wide.height() == 33 && wide.width() == 46 && tall.height() == 40 &&
+                               wide.layout() == layout && grid.height() == 40 && grid.width() == 46;
+                for (int i = 0; i < 40; i++)
+                {
+                    for (int j = 0; j < 46; j++)
+                    {
+                        int expected = (i >= 33) ? d(i-33,j) : (j < 5) ? a(i,j) : (j < 45) ? b(i,j-5) : c(i,0);
+                        stacked = stacked && tall(i,j) == expected && grid(i,j) == expected &&
+                                  (i >= 33 || wide(i,j) == expected);
+                    }
+                }
+                bool diagonal_equal = diagonal.height() == 42 && diagonal.width() == 53;
+                for (int i = 0; diagonal_equal && i < 42; i++)
+                {
+                    for (int j = 0; j < 53; j++)
+                    {
+                        int expected = -1;
+                        if (i < 33 && j < 5)
+                        {
+                            expected = a(i,j);
+                        }
+                        else if (i >= 33 && i < 35 && j >= 5 && j < 7)
+                        {
+                            expected = e(i-33,j-5);
+                        }
+                        else if (i >= 35 && j >= 7)
+                        {
+                            expected = d(i-35,j-7);
+                        }
+                        diagonal_equal = diagonal_equal && diagonal(i,j) == expected;
+                    }
+                }
+                bool tiled_equal = tiled.height() == 132 && tiled.width() == 280;
+                for (int i = 0; tiled_equal && i < 132; i++)
+                {
+                    for (int j = 0; j < 280; j++)
+                    {
+                        tiled_equal = tiled_equal && tiled(i,j) == base(i%33,j%70);
+                    }
+                }
+                bool repeated_equal = repeated.height() == 99 && repeated.width() == 350;
+                for (int i = 0; repeated_equal && i < 99; i++)
+                {
+                    for (int j = 0; j < 350; j++)
+                    {
+                        repeated_equal = repeated_equal && repeated(i,j) == base(i/3,j/5);
+                    }
+                }
+                std::cout<<" "<<stacked<<diagonal_equal<<tiled_equal<<repeated_equal;
+            }
+            std::cout<<std::endl;
+        }
+        mtm::Matrix<int> mat(dim_1,1);
+        std::cout<<mtm::vstack(mat,mtm::Matrix<int>(dim_1,2)).height()<<std::endl;
+        mtm::hstack(mat,mtm::Matrix<int>(dim_3));
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::vstack(mtm::Matrix<int>(dim_1),mtm::Matrix<int>(dim_3));
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::block(std::vector< std::vector< mtm::Matrix<int> > >{{mtm::Matrix<int>(dim_1),mtm::Matrix<int>(dim_1)},
+                                                                  {mtm::Matrix<int>(dim_3)}});
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::cout<<mtm::tile(mtm::Matrix<int>(dim_1),1,1).width()<<std::endl;
+        mtm::repeat(mtm::Matrix<int>(dim_1),2,0);
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::hstack(std::vector< mtm::Matrix<int> >());
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const char* layout_names[] = {"ROW_MAJOR", "COLUMN_MAJOR", "TILED"};
+        const int shapes[][2] = {{8,16},{32,32},{33,70},{40,3}};
+        for (int l = 0; l < 3; l++)
+        {
+            mtm::Matrix<int> mat(mtm::Dimensions(33,70),0,mtm::COPY_ON_WRITE,(mtm::Layout)l);
+            for (int i = 0; i < 33; i++)
+            {
+                for (int j = 0; j < 70; j++)
+                {
+                    mat(i,j) = i*100+j;
+                }
+            }
+            const mtm::Matrix<int> shared = mat;
+            std::cout<<"blocks "<<layout_names[l];
+            for (const int* shape : shapes)
+            {
+                std::vector<int> seen(33*70,0);
+                std::vector<int> buffer(shape[0]*shape[1]);
+                bool read = true;
+                int previous = -1;
+                bool row_ordered = true;
+                for (mtm::Matrix<int>::ConstBlock block : shared.blocks(shape[0],shape[1]))
+                {
+                    int expected_height = std::min(shape[0],33-block.row());
+                    int expected_width = std::min(shape[1],70-block.col());
+                    read = read && block.height() == expected_height && block.width() == expected_width;
+                    block.copyTo(&buffer[0]);
+                    for (int i = 0; i < block.height(); i++)
+                    {
+                        for (int j = 0; j < block.width(); j++)
+                        {
+                            seen[(block.row()+i)*70+block.col()+j]++;
+                            read = read && block(i,j) == (block.row()+i)*100+block.col()+j &&
+                                   buffer[i*block.width()+j] == block(i,j);
+                        }
+                    }
+                    row_ordered = row_ordered && block.row()*70+block.col() > previous;
+                    previous = block.row()*70+block.col();
+                }
+                mtm::Matrix<int>::Blocks blocks = mat.blocks(shape[0],shape[1],mtm::COLUMN_MAJOR_BLOCKS);
+                previous = -1;
+                bool column_ordered = true;
+                for (int k = 0; k < blocks.size(); k++)
+                {
+                    mtm::Matrix<int>::Block block = blocks[k];
+                    column_ordered = column_ordered && block.col()*33+block.row() > previous;
+                    previous = block.col()*33+block.row();
+                    for (int i = 0; i < block.height(); i++)
+                    {
+                        for (int j = 0; j < block.width(); j++)
+                        {
+                            buffer[i*block.width()+j] = -block(i,j);
+                        }
+                    }
+                    block.copyFrom(&buffer[0]);
+                }
+                bool written = true;
+                for (int i = 0; i < 33; i++)
+                {
+                    for (int j = 0; j < 70; j++)
+                    {
+                        written = written && mat(i,j) == -(i*100+j) && shared(i,j) == i*100+j;
+                        mat(i,j) = i*100+j;
+                    }
+                }
+                std::cout<<" "<<(std::count(seen.begin(),seen.end(),1) == 33*70)<<read<<row_ordered<<column_ordered<<written;
+            }
+            std::cout<<std::endl;
+        }
+        const mtm::Matrix<int> grid(mtm::Dimensions(20,10),0);
+        std::cout<<"z order";
+        for (mtm::Matrix<int>::ConstBlock block : grid.blocks(4,2,mtm::Z_ORDER_BLOCKS))
+        {
+            std::cout<<" "<<block.row()/4<<block.col()/2;
+        }
+        std::cout<<std::endl;
+        mtm::Matrix<int>::ConstBlocks edge = grid.blocks(7,4);
+        std::cout<<edge.size()<<" "<<edge[edge.size()-1].height()<<"x"<<edge[edge.size()-1].width()<<std::endl;
+        edge[edge.size()-1](6,0);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int>(dim_1).blocks(2,0);
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> adjacency(mtm::Dimensions(70,70),0,mtm::COPY_ON_WRITE,mtm::COLUMN_MAJOR,mtm::HUGE_PAGES);
+        for (int i = 0; i + 1 < 70; i++)
+        {
+            adjacency(i,i+1) = 1;
+        }
+        const mtm::Matrix<bool> closure = mtm::transitiveClosure(adjacency);
+        const mtm::Matrix<bool> reached = mtm::reachableFrom(adjacency,3);
+        std::cout<<"closure "<<(closure.memory() == mtm::HUGE_PAGES)<<" "<<(closure.layout() == mtm::COLUMN_MAJOR)<<" "<<
+            (closure.sharing() == mtm::COPY_ON_WRITE)<<" "<<closure(0,69)<<closure(69,0)<<" "<<
+            (reached.memory() == mtm::HUGE_PAGES)<<" "<<reached(0,2)<<reached(0,69)<<std::endl;
+        mtm::reachableFrom(adjacency,70);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        int deleted = 0;
+        auto release = [&deleted](int* buffer) { deleted++; delete[] buffer; };
+        int* owned = new int[6];
+        for (int k = 0; k < 6; k++)
+        {
+            owned[k] = k;
+        }
+        {
+            mtm::Matrix<int> adopted = mtm::Matrix<int>::Adopt(owned,dim_1,3,release,mtm::ROW_MAJOR,mtm::COPY_ON_WRITE);
+            const mtm::Matrix<int> last = adopted;
+            {
+                const mtm::Matrix<int> copy = adopted;
+                std::cout<<"adopt "<<(copy.data() == owned)<<" "<<copy(1,2)<<" "<<deleted;
+            }
+            adopted = mtm::Matrix<int>(dim_1,0);
+            std::cout<<" "<<deleted<<" "<<last(1,0);
+        }
+        std::cout<<" "<<deleted<<std::endl;
+        int* padded = new int[5*4];
+        for (int j = 0; j < 4; j++)
+        {
+            for (int i = 0; i < 5; i++)
+            {
+                padded[j*5+i] = (i < 3) ? i*10+j : -7;
+            }
+        }
+        {
+            mtm::Matrix<int> columns = mtm::Matrix<int>::Adopt(padded,mtm::Dimensions(3,4),5,release,mtm::COLUMN_MAJOR);
+            bool read = columns.capacity() == 18 && columns.rowStride() == 1 && columns.colStride() == 3;
+            for (int i = 0; i < 3; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    read = read && columns(i,j) == i*10+j;
+                }
+            }
+            columns.appendCol(std::vector<int>(3,9));
+            columns.appendCol(std::vector<int>(3,8));
+            std::cout<<"padded "<<read<<" "<<(columns.data() == padded)<<" "<<deleted;
+            columns.appendCol(std::vector<int>(3,7));
+            std::cout<<" "<<(columns.data() != padded)<<" "<<deleted<<" "<<columns(2,3)<<columns(2,4)<<columns(2,5)<<
+                columns(2,6);
+        }
+        std::cout<<" "<<deleted<<std::endl;
+        int borrowed[6] = {1,2,3,4,5,6};
+        {
+            mtm::Matrix<int> wrapped = mtm::Matrix<int>::Wrap(borrowed,dim_1,3);
+            wrapped(1,1) = 50;
+            for (int& element : wrapped)
+            {
+                element += 1;
+            }
+            mtm::Matrix<int> shared = mtm::Matrix<int>::Wrap(borrowed,dim_3,3,mtm::COLUMN_MAJOR,mtm::COPY_ON_WRITE);
+            const mtm::Matrix<int> copy = shared;
+            shared(0,0) = -1;
+            std::cout<<"wrap "<<borrowed[0]<<" "<<borrowed[4]<<" "<<borrowed[5]<<" "<<(copy.data() == borrowed)<<" "<<
+                shared(0,0)<<" "<<copy(1,1)<<std::endl;
+        }
+        std::cout<<borrowed[0]<<" "<<deleted<<std::endl;
+        int* rejected = new int[4];
+        std::fill(rejected,rejected+4,11);
+        try{
+            mtm::Matrix<int>::Adopt(rejected,mtm::Dimensions(2,2),1,release);
+        } catch(mtm::Matrix<int>::IllegalInitialization& e){
+            std::cout<<e.what()<<" "<<deleted<<" "<<rejected[3]<<std::endl;
+        }
+        try{
+            mtm::Matrix<int>::Adopt(rejected,mtm::Dimensions(2,2),2,release,mtm::TILED);
+        } catch(mtm::Matrix<int>::IllegalInitialization& e){
+            std::cout<<e.what()<<" "<<deleted<<" "<<rejected[3]<<std::endl;
+        }
+        try{
+            mtm::Matrix<int>::Adopt(rejected,mtm::Dimensions(0,2),2,release);
+        } catch(mtm::Matrix<int>::IllegalInitialization& e){
+            std::cout<<e.what()<<" "<<deleted<<" "<<rejected[3]<<std::endl;
+        }
+        delete[] rejected;
+        mtm::Matrix<int>::Wrap(borrowed,dim_3,3);
+    } catch(mtm::Matrix<int>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const mtm::MemoryPolicy policies[] = {mtm::HUGE_PAGES, mtm::FIRST_TOUCH, mtm::INTERLEAVED};
+        const char* policy_names[] = {"HUGE_PAGES", "FIRST_TOUCH", "INTERLEAVED"};
+        for (int p = 0; p < 3; p++)
+        {
+            mtm::Matrix<double> mat(mtm::Dimensions(1024,1024),0.0,mtm::DEEP_COPY,mtm::ROW_MAJOR,policies[p]);
+            double counter = 0;
+            for (double& element : mat)
+            {
+                element = counter++;
+            }
+            mat.resize(mtm::Dimensions(10,1024));
+            mat.shrinkToFit();
+            bool kept = mat.capacity() == 10*1024 && mat.memory() == policies[p];
+            for (int i = 0; i < 10; i++)
+            {
+                kept = kept && mat(i,0) == i*1024 && mat(i,1023) == i*1024+1023;
+            }
+            mat.reserve(mtm::Dimensions(1024,1024));
+            mat.appendRow(std::vector<double>(1024,-1.0));
+            const mtm::Matrix<double> copy = mat;
+            mat.resize(mtm::Dimensions(2,3));
+            mat.shrinkToFit();
+            std::cout<<"memory "<<policy_names[p]<<" "<<kept<<" "<<copy.height()<<" "<<copy(9,5)<<" "<<copy(10,5)<<" "<<
+                mat(1,2)<<" "<<mat.capacity()<<std::endl;
+        }
+        mtm::Matrix<double>(mtm::Dimensions(1,1),0.0,mtm::DEEP_COPY,mtm::ROW_MAJOR,mtm::HUGE_PAGES).resize(dim_2);
+    } catch(mtm::Matrix<double>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::SpatialIndex index(4);
+        std::map<int, mtm::GridPoint> points;
+        std::mt19937 random(2024);
+        auto coordinate = [&random]()
+        {
+            unsigned int draw = random();
+            if (draw % 16 == 0)
+            {
+                return (draw % 32 == 0) ? INT_MAX - (int)(draw % 7) : INT_MIN + (int)(draw % 7);
+            }
+            return (int)(draw % 401) - 200;
+        };
+        auto brute_within = [&points](const mtm::GridPoint &center, int radius)
+        {
+            std::vector<int> ids;
+            for (const std::pair<const int, mtm::GridPoint> &point : points)
+            {
+                long long distance = std::llabs((long long)point.second.row - center.row) +
+                                     std::llabs((long long)point.second.col - center.col);
+                if (distance <= radius)
+                {
+                    ids.push_back(point.first);
+                }
+            }
+            return ids;
+        };
+        auto brute_nearest = [&points](const mtm::GridPoint &center, int k)
+        {
+            std::vector< std::pair<long long, int> > ranked;
+            for (const std::pair<const int, mtm::GridPoint> &point : points)
+            {
+                ranked.push_back(std::make_pair(std::llabs((long long)point.second.row - center.row) +
+                                                std::llabs((long long)point.second.col - center.col), point.first));
+            }
+            std::sort(ranked.begin(), ranked.end());
+            std::vector<int> ids;
+            for (int i = 0; i < k && i < (int)ranked.size(); i++)
+            {
+                ids.push_back(ranked[i].second);
+            }
+            return ids;
+        };
+        bool within_equal = true, nearest_equal = true;
+        int queries = 0;
+        for (int step = 0; step < 3000; step++)
+        {
+            int id = random() % 150;
+            mtm::GridPoint point(coordinate(), coordinate());
+            if (points.count(id) == 0)
+            {
+                index.insert(id, point);
+                points.insert(std::make_pair(id, point));
+            }
+            else if (random() % 3 != 0)
+            {
+                index.move(id, point);
+                points.find(id)->second = point;
+            }
+            else
+            {
+                index.remove(id);
+                points.erase(id);
+            }
+            if (step % 10 == 0)
+            {
+                mtm::GridPoint center(coordinate(), coordinate());
+                int radius = (step % 70 == 0) ? INT_MAX : (int)(random() % 120);
+                std::vector<int> found = index.within(center, radius);
+                std::sort(found.begin(), found.end());
+                within_equal = within_equal && found == brute_within(center, radius);
+                int k = random() % 12;
+                nearest_equal = nearest_equal && index.nearest(center, k) == brute_nearest(center, k);
+                queries++;
+            }
+        }
+        std::cout<<"spatial index "<<within_equal<<" "<<nearest_equal<<" "<<queries<<" "<<
+            (index.size() == (int)points.size())<<std::endl;
+        mtm::SpatialIndex small;
+        small.insert(1, mtm::GridPoint(5,5));
+        small.insert(2, mtm::GridPoint(-3,7));
+        std::cout<<small.within(mtm::GridPoint(1,0), INT_MAX).size()<<" "<<
+            small.within(mtm::GridPoint(1000000000,1000000000), 2000000000).size()<<" "<<
+            small.within(mtm::GridPoint(5,5), 0).size()<<" "<<small.nearest(mtm::GridPoint(-3,6), 5)[0]<<std::endl;
+        small.move(3, mtm::GridPoint(0,0));
+    } catch(mtm::SpatialIndex::IdNotFound& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::SpatialIndex index;
+        index.insert(7, mtm::GridPoint(INT_MIN,INT_MAX));
+        std::cout<<index.position(7).row<<" "<<index.nearest(mtm::GridPoint(INT_MAX,INT_MIN), 1)[0]<<std::endl;
+        index.insert(7, mtm::GridPoint(0,0));
+    } catch(mtm::SpatialIndex::IdAlreadyExists& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        const mtm::MemoryPolicy policies[] = {mtm::HUGE_PAGES, mtm::FIRST_TOUCH, mtm::INTERLEAVED};
+        const char* policy_names[] = {"HUGE_PAGES", "FIRST_TOUCH", "INTERLEAVED"};
+        const mtm::SharingPolicy sharings[] = {mtm::DEEP_COPY, mtm::COPY_ON_WRITE};
+        for (int p = 0; p < 3; p++)
+        {
+            bool values = true, kept = true, detached = true;
+            for (int s = 0; s < 2; s++)
+            {
+                mtm::Matrix<double> zeros(mtm::Dimensions(1024,1024),0.0,sharings[s],mtm::ROW_MAJOR,policies[p]);
+                mtm::Matrix<double> halves(mtm::Dimensions(1024,1024),0.5,sharings[s],mtm::COLUMN_MAJOR,policies[p]);
+                for (const double& element : static_cast<const mtm::Matrix<double>&>(zeros))
+                {
+                    values = values && element == 0;
+                }
+                for (const double& element : static_cast<const mtm::Matrix<double>&>(halves))
+                {
+                    values = values && element == 0.5;
+                }
+                mtm::Matrix<double> copy = halves;
+                const mtm::Matrix<double>& shared = copy;
+                const mtm::Matrix<double>& original = halves;
+                bool same_buffer = shared.data() == original.data();
+                detached = detached && same_buffer == (sharings[s] == mtm::COPY_ON_WRITE);
+                copy(1023,1023) = 2;
+                detached = detached && shared.data() != original.data() && halves(1023,1023) == 0.5;
+                mtm::Matrix<double> sum = zeros + copy;
+                mtm::Matrix<double> doubled = halves.apply([](double x) { return 2*x; });
+                mtm::Matrix<double> flipped = copy.transpose();
+                values = values && sum(0,0) == 0.5 && sum(1023,1023) == 2 && doubled(512,17) == 1 &&
+                    flipped(1023,1023) == 2 && flipped(0,1) == 0.5;
+                kept = kept && zeros.memory() == policies[p] && copy.memory() == policies[p] &&
+                    sum.memory() == policies[p] && doubled.memory() == policies[p] && flipped.memory() == policies[p];
+                zeros = mtm::Matrix<double>(dim_3,1.0);
+                halves = zeros;
+                values = values && halves(2,1) == 1 && copy(0,0) == 0.5;
+            }
+            mtm::Matrix<std::string> words(mtm::Dimensions(256,512),std::string("page"),mtm::DEEP_COPY,mtm::ROW_MAJOR,
+                policies[p]);
+            mtm::Matrix<std::string> words_copy = words;
+            words(255,511) = "moved";
+            values = values && words_copy(255,511) == "page" && words(255,511) == "moved" &&
+                words_copy.memory() == policies[p];
+            std::cout<<"allocation "<<policy_names[p]<<" "<<values<<" "<<kept<<" "<<detached<<std::endl;
+        }
+        mtm::Matrix<double>(dim_2,0.0,mtm::COPY_ON_WRITE,mtm::ROW_MAJOR,mtm::FIRST_TOUCH);
+    } catch(mtm::Matrix<double>::IllegalInitialization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(39);
+        mtm::Matrix<float> real(mtm::Dimensions(7,9),0.0f,mtm::DEEP_COPY,mtm::COLUMN_MAJOR);
+        for (int i = 0; i < 7; i++)
+        {
+            for (int j = 0; j < 9; j++)
+            {
+                real(i,j) = (float)((int)(random() % 801) - 300) / 100.0f;
+            }
+        }
+        real(3,4) = 0;
+        mtm::Quantized<std::int8_t> signed_values = mtm::Quantized<std::int8_t>::quantize(real);
+        mtm::Quantized<std::uint8_t> unsigned_values = mtm::Quantized<std::uint8_t>::quantize(real, mtm::PARALLEL);
+        mtm::Matrix<float> signed_real = signed_values.dequantize();
+        mtm::Matrix<float> unsigned_real = unsigned_values.dequantize(mtm::PARALLEL);
+        bool close = true;
+        for (int i = 0; i < 7; i++)
+        {
+            for (int j = 0; j < 9; j++)
+            {
+                close = close && std::fabs(signed_real(i,j) - real(i,j)) <= signed_values.scale() * 0.5001f &&
+                    std::fabs(unsigned_real(i,j) - real(i,j)) <= unsigned_values.scale() * 0.5001f;
+            }
+        }
+        mtm::Quantized<std::int8_t> saturated = mtm::Quantized<std::int8_t>::quantize(real, 0.01f, 10);
+        int lowest = 0, highest = 0;
+        for (std::int8_t value : saturated.values())
+        {
+            lowest = std::min(lowest, (int)value);
+            highest = std::max(highest, (int)value);
+        }
+        std::cout<<"quantize "<<close<<" "<<signed_real(3,4)<<" "<<unsigned_real(3,4)<<" "<<
+            (signed_real.layout() == mtm::COLUMN_MAJOR)<<" "<<(int)saturated.values()(3,4)<<" "<<lowest<<" "<<
+            highest<<std::endl;
+
+        bool products_equal = true;
+        const int shapes[][3] = {{1,1,1}, {3,5,2}, {7,33,6}, {16,64,17}, {5,200,9}};
+        for (int shape = 0; shape < 5; shape++)
+        {
+            int n = shapes[shape][0], m = shapes[shape][1], p = shapes[shape][2];
+            mtm::Matrix<std::int8_t> a(mtm::Dimensions(n,m),0);
+            mtm::Matrix<std::int8_t> b(mtm::Dimensions(m,p),0);
+            mtm::Matrix<std::uint8_t> ua(mtm::Dimensions(n,m),0);
+            mtm::Matrix<std::uint8_t> ub(mtm::Dimensions(m,p),0);
+            for (int k = 0; k < n*m; k++)
+            {
+                a(k / m, k % m) = (std::int8_t)((int)(random() % 256) - 128);
+                ua(k / m, k % m) = (std::uint8_t)(random() % 256);
+            }
+            for (int k = 0; k < m*p; k++)
+            {
+                b(k / p, k % p) = (std::int8_t)((int)(random() % 256) - 128);
+                ub(k / p, k % p) = (std::uint8_t)(random() % 256);
+            }
+            int zero_a = (int)(random() % 256) - 128, zero_b = (int)(random() % 256) - 128;
+            int zero_ua = random() % 256, zero_ub = random() % 256;
+            mtm::Matrix<float> product = mtm::multiply(mtm::Quantized<std::int8_t>(a, 1.0f, zero_a),
+                mtm::Quantized<std::int8_t>(b, 1.0f, zero_b));
+            mtm::Matrix<float> unsigned_product = mtm::multiply(mtm::Quantized<std::uint8_t>(ua, 1.0f, zero_ua),
+                mtm::Quantized<std::uint8_t>(ub, 1.0f, zero_ub), mtm::PARALLEL);
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < p; j++)
+                {
+                    long long expected = 0, unsigned_expected = 0;
+                    for (int k = 0; k < m; k++)
+                    {
+                        expected += (long long)(a(i,k) - zero_a) * (b(k,j) - zero_b);
+                        unsigned_expected += (long long)(ua(i,k) - zero_ua) * (ub(k,j) - zero_ub);
+                    }
+                    products_equal = products_equal && product(i,j) == (float)expected &&
+                        unsigned_product(i,j) == (float)unsigned_expected;
+                }
+            }
+        }
+        const int long_inner = 40000;
+        mtm::Quantized<std::uint8_t> low_row(mtm::Matrix<std::uint8_t>(mtm::Dimensions(1,long_inner),0), 0.5f, 255);
+        mtm::Quantized<std::uint8_t> low_col(mtm::Matrix<std::uint8_t>(mtm::Dimensions(long_inner,1),0), 2.0f, 255);
+        float long_product = mtm::multiply(low_row, low_col)(0,0);
+        std::cout<<"quantized multiply "<<products_equal<<" "<<(long_product == (float)(255.0 * 255.0 * long_inner))<<
+            std::endl;
+
+        mtm::Quantized<std::int8_t> other = mtm::Quantized<std::int8_t>::quantize(real.apply([](float x) { return -x / 2; }));
+        mtm::Quantized<std::int8_t> sum = mtm::add(signed_values, other, 0.05f, -20, mtm::PARALLEL);
+        mtm::Matrix<float> first = signed_values.dequantize(), second = other.dequantize(), total = sum.dequantize();
+        bool sums_close = true;
+        for (int i = 0; i < 7; i++)
+        {
+            for (int j = 0; j < 9; j++)
+            {
+                float expected = std::max(-5.4f, std::min(7.35f, first(i,j) + second(i,j)));
+                sums_close = sums_close && std::fabs(total(i,j) - expected) <= 0.025f + 1e-5f;
+            }
+        }
+        std::cout<<"quantized add "<<sums_close<<" "<<sum.scale()<<" "<<sum.zeroPoint()<<std::endl;
+        mtm::add(signed_values, mtm::Quantized<std::int8_t>::quantize(real.transpose()), 0.05f, 0);
+    } catch(mtm::Matrix<std::int8_t>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Quantized<std::uint8_t>(mtm::Matrix<std::uint8_t>(dim_1,0), 1.0f, 256);
+    } catch(mtm::Quantized<std::uint8_t>::IllegalQuantization& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(47);
+        const double scales[] = {1e-6, 1e-3, 1, 1e3, 1e6, 1e9};
+        const int shapes[][2] = {{1,1}, {3,5}, {64,64}, {100,150}, {201,333}, {7,5000}, {5000,3}};
+        const mtm::Layout layouts[] = {mtm::ROW_MAJOR, mtm::COLUMN_MAJOR, mtm::TILED};
+        bool identical = true, fast_close = true, largest_equal = true;
+        for (int shape = 0; shape < 7; shape++)
+        {
+            mtm::Dimensions dims(shapes[shape][0], shapes[shape][1]);
+            mtm::Matrix<double> x(dims,0.0), y(dims,0.0);
+            double largest = 0;
+            for (int i = 0; i < dims.getRow(); i++)
+            {
+                for (int j = 0; j < dims.getCol(); j++)
+                {
+                    x(i,j) = ((int)(random() % 2001) - 1000) * scales[random() % 6];
+                    y(i,j) = ((int)(random() % 2001) - 1000) * scales[random() % 6];
+                    largest = std::max(largest, std::fabs(x(i,j)));
+                }
+            }
+            double expected[4] = {mtm::sum(x), mtm::dot(x, y), mtm::norm1(x), mtm::frobeniusNorm(x)};
+            for (int l = 0; l < 3; l++)
+            {
+                mtm::Matrix<double> a = x.toLayout(layouts[l]), b = y.toLayout(layouts[l]);
+                for (int e = 0; e < 2; e++)
+                {
+                    mtm::Execution execution = e ? mtm::PARALLEL : mtm::SEQUENTIAL;
+                    identical = identical && mtm::sum(a, mtm::REPRODUCIBLE, execution) == expected[0] &&
+                        mtm::dot(a, b, mtm::REPRODUCIBLE, execution) == expected[1] &&
+                        mtm::norm1(a, mtm::REPRODUCIBLE, execution) == expected[2] &&
+                        mtm::frobeniusNorm(a, mtm::REPRODUCIBLE, execution) == expected[3];
+                    largest_equal = largest_equal && mtm::maxNorm(a, execution) == largest;
+                    double fast[4] = {mtm::sum(a, mtm::FAST, execution), mtm::dot(a, b, mtm::FAST, execution),
+                        mtm::norm1(a, mtm::FAST, execution), mtm::frobeniusNorm(a, mtm::FAST, execution)};
+                    double magnitude[4] = {expected[2], mtm::norm1(a) * mtm::maxNorm(b), expected[2], expected[3]};
+                    for (int r = 0; r < 4; r++)
+                    {
+                        fast_close = fast_close && std::fabs(fast[r] - expected[r]) <= 1e-12 * magnitude[r];
+                    }
+                }
+            }
+        }
+        mtm::Matrix<int> counts(mtm::Dimensions(300,300),0,mtm::DEEP_COPY,mtm::TILED);
+        long long count_total = 0;
+        for (int i = 0; i < 300; i++)
+        {
+            for (int j = 0; j < 300; j++)
+            {
+                counts(i,j) = (int)(random() % 2000001) - 1000000;
+                count_total += counts(i,j);
+            }
+        }
+        std::cout<<"reduce "<<identical<<" "<<fast_close<<" "<<largest_equal<<" "<<
+            (mtm::sum(counts, mtm::FAST, mtm::PARALLEL) == count_total)<<std::endl;
+        mtm::Matrix<double> holes(mtm::Dimensions(130,70),1.0);
+        bool propagated = true;
+        const int positions[][2] = {{0,0}, {64,13}, {129,69}};
+        for (int p = 0; p < 3; p++)
+        {
+            mtm::Matrix<double> hole = holes;
+            hole(positions[p][0], positions[p][1]) = std::nan("");
+            hole(129 - positions[p][0], 69 - positions[p][1]) = 5;
+            propagated = propagated && std::isnan(mtm::maxNorm(hole)) && std::isnan(mtm::maxNorm(hole, mtm::PARALLEL)) &&
+                std::isnan(mtm::norm1(hole)) && std::isnan(mtm::sum(hole, mtm::FAST, mtm::PARALLEL));
+        }
+        std::cout<<"nan "<<propagated<<" "<<mtm::maxNorm(holes)<<std::endl;
+        mtm::dot(holes, holes.transpose());
+    } catch(mtm::Matrix<double>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(45);
+        const int ints[4] = {-3, -2, INT_MIN, INT_MAX};
+        const signed char chars[4] = {-3, -2, SCHAR_MIN, SCHAR_MAX};
+        const unsigned long long longs[4] = {0, 1, 0, ULLONG_MAX};
+        const bool bools[4] = {false, true, false, true};
+        testCompressed("int", ints, random);
+        testCompressed("signed char", chars, random);
+        testCompressed("unsigned long long", longs, random);
+        testCompressed("bool", bools, random);
+        const mtm::Compressed<int> compressed(mtm::Matrix<int>(dim_1,1));
+        compressed(2,0);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(44);
+        const int shapes[][2] = {{9,1}, {3,5}, {130,64}, {40,128}, {129,7}, {5,300}};
+        const std::string words[] = {"pear", "apple", "fig", "apple pie", "", "Fig"};
+        for (int shape = 0; shape < 6; shape++)
+        {
+            mtm::Dimensions dims(shapes[shape][0], shapes[shape][1]);
+            mtm::Layout layout = (shape % 2) ? mtm::COLUMN_MAJOR : mtm::ROW_MAJOR;
+            mtm::Matrix<int> ints(dims,0,mtm::DEEP_COPY,layout);
+            mtm::Matrix<double> doubles(dims,0.0,mtm::COPY_ON_WRITE,layout);
+            mtm::Matrix<bool> bools(dims,false,mtm::DEEP_COPY,mtm::TILED);
+            mtm::Matrix<std::string> strings(dims,std::string(),mtm::DEEP_COPY,layout);
+            for (int i = 0; i < dims.getRow(); i++)
+            {
+                for (int j = 0; j < dims.getCol(); j++)
+                {
+                    ints(i,j) = (int)(random() % 21) - 10;
+                    doubles(i,j) = ((int)(random() % 2001) - 1000) / 8.0;
+                    bools(i,j) = random() % 2;
+                    strings(i,j) = words[random() % 6];
+                }
+            }
+            testSort("int", ints);
+            testSort("double", doubles);
+            testSort("bool", bools);
+            testSort("string", strings);
+        }
+        mtm::topK(mtm::Matrix<int>(dim_1,0), 4);
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(48);
+        const int sizes[] = {1, 5, 64, 65, 150};
+        bool int_paths = true, double_paths = true;
+        for (int s = 0; s < 5; s++)
+        {
+            int n = sizes[s];
+            const int missing = mtm::unreachable<int>();
+            mtm::Layout layout = (s % 2) ? mtm::COLUMN_MAJOR : mtm::ROW_MAJOR;
+            mtm::Matrix<int> weights(mtm::Dimensions(n,n),missing,mtm::DEEP_COPY,layout);
+            std::vector<int> paths((std::size_t)n * n, missing);
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    if (random() % 8 == 0 || (i == j && random() % 2 == 0))
+                    {
+                        weights(i,j) = random() % 100;
+                        paths[(std::size_t)i * n + j] = weights(i,j);
+                    }
+                }
+                paths[(std::size_t)i * n + i] = std::min(paths[(std::size_t)i * n + i], 0);
+            }
+            for (int k = 0; k < n; k++)
+            {
+                for (int i = 0; i < n; i++)
+                {
+                    for (int j = 0; j < n; j++)
+                    {
+                        int first = paths[(std::size_t)i * n + k], second = paths[(std::size_t)k * n + j];
+                        if (first != missing && second != missing && first + second < paths[(std::size_t)i * n + j])
+                        {
+                            paths[(std::size_t)i * n + j] = first + second;
+                        }
+                    }
+                }
+            }
+            mtm::Matrix<double> real_weights(mtm::Dimensions(n,n),mtm::unreachable<double>());
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    if (weights(i,j) != missing)
+                    {
+                        real_weights(i,j) = weights(i,j);
+                    }
+                }
+            }
+            mtm::Matrix<int> sequential = mtm::floydWarshall(weights);
+            mtm::Matrix<int> parallel = mtm::floydWarshall(weights, mtm::PARALLEL);
+            mtm::Matrix<double> real_paths = mtm::floydWarshall(real_weights, mtm::PARALLEL);
+            int_paths = int_paths && sequential.layout() == weights.layout();
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    int expected = paths[(std::size_t)i * n + j];
+                    int_paths = int_paths && sequential(i,j) == expected && parallel(i,j) == expected;
+                    double_paths = double_paths && (expected == missing ? std::isinf(real_paths(i,j)) :
+                        real_paths(i,j) == expected);
+                }
+            }
+        }
+        std::cout<<"floyd warshall "<<int_paths<<" "<<double_paths<<std::endl;
+
+        const int products[][3] = {{1,1,1}, {7,70,3}, {65,130,67}, {64,64,64}};
+        bool min_plus = true, or_and = true;
+        for (int shape = 0; shape < 4; shape++)
+        {
+            int n = products[shape][0], m = products[shape][1], p = products[shape][2];
+            const int missing = mtm::MinPlus<int>::zero();
+            mtm::Matrix<int> a(mtm::Dimensions(n,m),missing), b(mtm::Dimensions(m,p),missing,mtm::DEEP_COPY,mtm::TILED);
+            mtm::Matrix<bool> x(mtm::Dimensions(n,m),false), y(mtm::Dimensions(m,p),false);
+            for (int i = 0; i < n * m; i++)
+            {
+                a(i / m, i % m) = (random() % 3 == 0) ? missing : (int)(random() % 1000) - 500;
+                x(i / m, i % m) = random() % 10 == 0;
+            }
+            for (int i = 0; i < m * p; i++)
+            {
+                b(i / p, i % p) = (random() % 3 == 0) ? missing : (int)(random() % 1000) - 500;
+                y(i / p, i % p) = random() % 10 == 0;
+            }
+            mtm::Execution execution = (shape % 2) ? mtm::PARALLEL : mtm::SEQUENTIAL;
+            mtm::Matrix<int> shortest = mtm::semiringMultiply<mtm::MinPlus<int>>(a, b, execution);
+            mtm::Matrix<bool> reached = mtm::semiringMultiply<mtm::OrAnd<bool>>(x, y,
+                (shape % 2) ? mtm::SEQUENTIAL : mtm::PARALLEL);
+            for (int i = 0; i < n; i++)
+            {
+                for (int j = 0; j < p; j++)
+                {
+                    int best = missing;
+                    bool any_path = false;
+                    for (int k = 0; k < m; k++)
+                    {
+                        if (a(i,k) != missing && b(k,j) != missing)
+                        {
+                            best = std::min(best, a(i,k) + b(k,j));
+                        }
+                        any_path = any_path || (x(i,k) && y(k,j));
+                    }
+                    min_plus = min_plus && shortest(i,j) == best;
+                    or_and = or_and && reached(i,j) == any_path;
+                }
+            }
+        }
+        std::cout<<"semiring "<<min_plus<<" "<<or_and<<std::endl;
+        mtm::floydWarshall(mtm::Matrix<int>(dim_1,0));
+    } catch(mtm::Matrix<int>::DimensionMismatch& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        std::mt19937 random(35);
+        const int boards[][2] = {{1,1}, {7,13}, {40,33}, {70,45}};
+        bool manhattan = true, fields = true, diamonds = true, ranges = true;
+        for (int b = 0; b < 4; b++)
+        {
+            int height = boards[b][0], width = boards[b][1];
+            mtm::Dimensions dims(height, width);
+            for (int count = 0; count < 4; count++)
+            {
+                std::vector<mtm::GridPoint> sources;
+                mtm::Matrix<bool> walls(dims,false);
+                for (int i = 0; i < height; i++)
+                {
+                    for (int j = 0; j < width; j++)
+                    {
+                        walls(i,j) = random() % 4 == 0;
+                    }
+                }
+                for (int k = 0; k < count * count; k++)
+                {
+                    sources.push_back(mtm::GridPoint(random() % height, random() % width));
+                    walls(sources.back().row, sources.back().col) = false;
+                }
+                mtm::Execution execution = (count % 2) ? mtm::PARALLEL : mtm::SEQUENTIAL;
+                mtm::Matrix<int> distances = mtm::manhattanDistance(dims, sources, execution);
+                mtm::Matrix<int> open = mtm::distanceField(mtm::Matrix<bool>(dims,false), sources);
+                mtm::Matrix<int> walled = mtm::distanceField(walls, sources);
+                mtm::Matrix<int> relaxed(dims,mtm::UNREACHABLE);
+                for (const mtm::GridPoint& source : sources)
+                {
+                    relaxed(source.row, source.col) = 0;
+                }
+                for (bool changed = true; changed; )
+                {
+                    changed = false;
+                    for (int i = 0; i < height; i++)
+                    {
+                        for (int j = 0; j < width; j++)
+                        {
+                            const int steps[][2] = {{-1,0}, {1,0}, {0,-1}, {0,1}};
+                            for (int d = 0; d < 4 && !walls(i,j); d++)
+                            {
+                                int row = i + steps[d][0], col = j + steps[d][1];
+                                if (row >= 0 && row < height && col >= 0 && col < width &&
+                                    relaxed(row,col) != mtm::UNREACHABLE && relaxed(row,col) + 1 < relaxed(i,j))
+                                {
+                                    relaxed(i,j) = relaxed(row,col) + 1;
+                                    changed = true;
+                                }
+                            }
+                        }
+                    }
+                }
+                for (int i = 0; i < height; i++)
+                {
+                    for (int j = 0; j < width; j++)
+                    {
+                        int nearest = mtm::UNREACHABLE;
+                        for (const mtm::GridPoint& source : sources)
+                        {
+                            nearest = std::min(nearest, mtm::GridPoint::distance(source, mtm::GridPoint(i,j)));
+                        }
+                        manhattan = manhattan && distances(i,j) == nearest;
+                        fields = fields && open(i,j) == nearest && walled(i,j) == relaxed(i,j);
+                    }
+                }
+                mtm::GridPoint center(random() % height, random() % width);
+                int k = (int)(random() % (height + width)) - 1;
+                std::vector<mtm::GridPoint> diamond, below;
+                for (int i = 0; i < height; i++)
+                {
+                    for (int j = 0; j < width; j++)
+                    {
+                        if (mtm::GridPoint::distance(center, mtm::GridPoint(i,j)) <= k)
+                        {
+                            diamond.push_back(mtm::GridPoint(i,j));
+                        }
+                        if (walled(i,j) <= k)
+                        {
+                            below.push_back(mtm::GridPoint(i,j));
+                        }
+                    }
+                }
+                diamonds = diamonds && mtm::pointsWithin(dims, center, k) == diamond;
+                ranges = ranges && mtm::pointsWithin(walled, k) == below;
+            }
+        }
+        std::cout<<"grid board "<<manhattan<<" "<<fields<<" "<<diamonds<<" "<<ranges<<std::endl;
+
+        mtm::BoardRenderer renderer;
+        bool rendered = true;
+        for (int b = 0; b < 4; b++)
+        {
+            int height = boards[b][0], width = boards[b][1];
+            mtm::Matrix<char> board(mtm::Dimensions(height, width),' ',mtm::DEEP_COPY,
+                b % 2 ? mtm::COLUMN_MAJOR : mtm::ROW_MAJOR);
+            std::string cells;
+            for (int i = 0; i < height; i++)
+            {
+                for (int j = 0; j < width; j++)
+                {
+                    board(i,j) = " sSmMnN"[random() % 7];
+                    cells += board(i,j);
+                }
+            }
+            std::ostringstream expected, printed;
+            mtm::printGameBoard(expected, cells.data(), cells.data() + cells.size(), width);
+            renderer.print(printed, board);
+            rendered = rendered && renderer.render(board) == expected.str() && printed.str() == expected.str() &&
+                renderer.render(cells.data(), cells.data() + cells.size(), width) == expected.str();
+        }
+        std::cout<<"board renderer "<<rendered<<std::endl;
+        mtm::manhattanDistance(dim_1, std::vector<mtm::GridPoint>(1, mtm::GridPoint(2,0)));
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        static_assert(std::is_trivially_copyable<mtm::InternedString>::value, "InternedString is a plain handle");
+        std::size_t arena = mtm::InternedString::arenaSize();
+        mtm::InternedString pear("interned pear"), same(std::string("interned ") + "pear"), fig("interned fig");
+        std::size_t added = mtm::InternedString::arenaSize() - arena;
+        mtm::InternedString again("interned fig");
+        bool identity = mtm::InternedString::arenaSize() - arena == added && &pear.str() == &same.str() &&
+            pear == same && pear != fig && again == fig && mtm::InternedString() == mtm::InternedString("");
+        mtm::InternedString joined = pear + fig;
+        mtm::InternedString appended = pear;
+        appended += fig;
+        identity = identity && joined == appended && &joined.str() == &appended.str() &&
+            joined.str() == "interned pearinterned fig" && pear.str() == "interned pear";
+        const char* words[] = {"b", "a", "ab", "", "ba", "B", "a"};
+        bool ordered = true;
+        for (int i = 0; i < 7; i++)
+        {
+            for (int j = 0; j < 7; j++)
+            {
+                mtm::InternedString x(words[i]), y(words[j]);
+                std::string u(words[i]), v(words[j]);
+                ordered = ordered && (x == y) == (u == v) && (x != y) == (u != v) && (x < y) == (u < v) &&
+                    (x > y) == (u > v) && (x <= y) == (u <= v) && (x >= y) == (u >= v);
+            }
+        }
+        std::vector<mtm::InternedString> handles(64);
+        mtm::parallelRows(64, 1 << 20, mtm::PARALLEL, [&](int first, int last)
+        {
+            for (int k = first; k < last; k++)
+            {
+                handles[k] = mtm::InternedString("interned label " + std::to_string(k % 8));
+            }
+        });
+        bool shared = true;
+        for (int k = 0; k < 64; k++)
+        {
+            shared = shared && handles[k] == mtm::InternedString("interned label " + std::to_string(k % 8)) &&
+                &handles[k].str() == &handles[k % 8].str();
+        }
+        std::cout<<"interned "<<added<<" "<<identity<<" "<<ordered<<" "<<shared<<std::endl;
+
+        mtm::Matrix<mtm::InternedString> labels(dim_1,mtm::InternedString("empty"),mtm::COPY_ON_WRITE);
+        labels(0,1) = "wall";
+        labels(1,2) = labels(0,1) + mtm::InternedString("!");
+        mtm::Matrix<mtm::InternedString> copy = labels;
+        copy(1,0) = "floor";
+        mtm::Matrix<bool> empty = copy == mtm::InternedString("empty");
+        std::cout<<labels<<labels.transpose()(2,1)<<" "<<copy(1,0)<<" "<<labels(1,0)<<" "<<empty(1,0)<<empty(1,1)<<" "<<
+            (labels(0,1) < labels(0,0))<<std::endl;
+        labels(2,0) = "out";
+    } catch(mtm::Matrix<mtm::InternedString>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
+    try{
+        mtm::Matrix<int> original(dim_1,1,mtm::COPY_ON_WRITE);
+        const mtm::Matrix<int> &reader = original;
+        mtm::Matrix<int> before = original;
+        bool shared = reader.data() == static_cast<const mtm::Matrix<int>&>(before).data() && reader(1,2) == 1;
+        int &element = original(0,0);
+        int* row = original.data();
+        mtm::Matrix<int> after = original;
+        mtm::Matrix<int> assigned(dim_3,0,mtm::COPY_ON_WRITE);
+        assigned = original;
+        const mtm::Matrix<int> flipped = original.transpose();
+        element = 7;
+        row[2] = 8;
+        const mtm::Matrix<int> &after_reader = after;
+        mtm::Matrix<int> again = after;
+        bool copies_shared = after_reader.data() == static_cast<const mtm::Matrix<int>&>(again).data();
+        std::cout<<"cow references "<<shared<<" "<<original(0,0)<<original(0,2)<<" "<<before(0,0)<<before(0,2)<<" "<<
+            after(0,0)<<after(0,2)<<" "<<assigned(0,0)<<assigned(0,2)<<" "<<flipped(0,0)<<flipped(2,0)<<" "<<
+            copies_shared<<std::endl;
+
+        mtm::Matrix<int> iterated(dim_3,2,mtm::COPY_ON_WRITE,mtm::COLUMN_MAJOR);
+        mtm::Matrix<int>::iterator it = iterated.begin();
+        int &first = *it;
+        mtm::Matrix<int> iterated_copy = iterated;
+        first = 9;
+        mtm::Matrix<int> tiled(mtm::Dimensions(40,40),3,mtm::COPY_ON_WRITE,mtm::TILED);
+        mtm::Matrix<int>::Block corner = tiled.blocks(8,8)[0];
+        mtm::Matrix<int> tiled_copy = tiled;
+        std::vector<int> fours(64,4);
+        corner.copyFrom(&fours[0]);
+        std::cout<<iterated(0,0)<<" "<<iterated_copy(0,0)<<" "<<tiled(7,7)<<" "<<tiled_copy(7,7)<<std::endl;
+        original(2,0) = 0;
+    } catch(mtm::Matrix<int>::AccessIllegalElement& e){
+        std::cout<<e.what()<<std::endl;
+    }
 }